@@ -181,6 +181,12 @@ def setup_driver(arguments, product, target_platform):
 			"GEMINI_ENABLE_AUDIO=1"
 		]
 
+	# Enable the hierarchical profiler
+	if arguments.with_profiler:
+		product.defines += [
+			"GEMINI_ENABLE_PROFILER=1"
+		]
+
 	gcc_flags = [
 		# We need exceptions for jsoncpp.
 		#"-fno-exceptions",
@@ -893,7 +899,7 @@ def get_rnd(arguments, links, **kwargs):
 
 	return rnd
 
-def create_unit_test(target_platform, arguments, name, dependencies, source, output_type = ProductType.Commandline):
+def create_unit_test(target_platform, arguments, name, dependencies, source, output_type = ProductType.Commandline, extra_sources = []):
 	product = Product(name=name, output=output_type)
 	product.project_root = COMMON_PROJECT_ROOT
 	product.root = "../"
@@ -904,6 +910,7 @@ def create_unit_test(target_platform, arguments, name, dependencies, source, out
 		"tests/unit_test.h",
 		source
 	]
+	product.sources += extra_sources
 
 	if output_type == ProductType.Application:
 		macosx = product.layout(platform="macosx")
@@ -931,11 +938,38 @@ def get_unit_tests(arguments, libcore, librenderer, libruntime, libglm, **kwargs
 		create_unit_test(target_platform, arguments, "test_core", [libcore, libglm], "tests/src/test_core.cpp"),
 		create_unit_test(target_platform, arguments, "test_platform", [libcore, libglm], "tests/src/test_platform.cpp"),
 		create_unit_test(target_platform, arguments, "test_runtime", [libruntime, librenderer, libfreetype, libcore, libglm], "tests/src/test_runtime.cpp"),
+		create_unit_test(target_platform, arguments, "test_engine", [libruntime, librenderer, libfreetype, libcore, libglm], "tests/src/test_engine.cpp", extra_sources=["src/engine/game/particlesystem.cpp"]),
 		create_unit_test(target_platform, arguments, "test_render", [libruntime, librenderer, libfreetype, libcore, libglm], "tests/src/test_render.cpp", ProductType.Application),
 		create_unit_test(target_platform, arguments, "test_ui", [librenderer, libfreetype, libruntime, libcore, libglm], "tests/src/test_ui.cpp", ProductType.Application),
 		create_unit_test(target_platform, arguments, "test_window", [librenderer, libfreetype, libruntime, libcore, libglm], "tests/src/test_window.cpp", ProductType.Application)
 	]
 
+def create_benchmark(target_platform, arguments, name, dependencies, *sources):
+	product = Product(name=name, output=ProductType.Commandline)
+	product.project_root = COMMON_PROJECT_ROOT
+	product.root = "../"
+	product.sources += list(sources)
+
+	product.dependencies.extend(dependencies)
+
+	setup_driver(arguments, product, target_platform)
+
+	return product
+
+def get_benchmarks(arguments, libcore, librenderer, libruntime, libglm, **kwargs):
+	target_platform = kwargs.get("target_platform", None)
+	return [
+		create_benchmark(target_platform, arguments, "test_allocators", [libcore], "src/engine/kernels/test_allocators.cpp"),
+		create_benchmark(target_platform, arguments, "test_animation", [libruntime, librenderer, libfreetype, libcore, libglm], "src/engine/kernels/test_animation.cpp"),
+		create_benchmark(target_platform, arguments, "test_audiomixer", [libruntime, libcore, libglm], "src/engine/kernels/test_audiomixer.cpp"),
+		create_benchmark(target_platform, arguments, "test_jobscheduler", [libruntime, libcore, libglm], "src/engine/kernels/test_jobscheduler.cpp"),
+		create_benchmark(target_platform, arguments, "test_meshload", [libruntime, librenderer, libfreetype, libcore, libglm], "src/engine/kernels/test_meshload.cpp"),
+		create_benchmark(target_platform, arguments, "test_packload", [libruntime, librenderer, libfreetype, libcore, libglm], "src/engine/kernels/test_packload.cpp"),
+		create_benchmark(target_platform, arguments, "test_particles", [libruntime, librenderer, libfreetype, libcore, libglm], "src/engine/kernels/test_particles.cpp", "src/engine/game/particlesystem.cpp"),
+		create_benchmark(target_platform, arguments, "test_profiler", [libcore], "src/engine/kernels/test_profiler.cpp"),
+		create_benchmark(target_platform, arguments, "test_renderqueue", [libruntime, librenderer, libfreetype, libcore, libglm], "src/engine/kernels/test_renderqueue.cpp")
+	]
+
 def get_orion(arguments, libruntime, libcore, librenderer, libsdk, **kwargs):
 	orion = Product(name="orion", output=ProductType.Application)
 	orion.project_root = COMMON_PROJECT_ROOT
@@ -1015,6 +1049,8 @@ def arguments(parser):
 
 	parser.add_argument("--with-tools", dest="with_tools", action="store_true", help="Build with support for tools", default=False)
 	parser.add_argument("--with-tests", dest="with_tests", action="store_true", help="Build with support for unit tests", default=False)
+	parser.add_argument("--with-benchmarks", dest="with_benchmarks", action="store_true", help="Build the benchmark kernels", default=False)
+	parser.add_argument("--with-profiler", dest="with_profiler", action="store_true", help="Build with the hierarchical profiler enabled", default=False)
 
 	parser.add_argument("--with-game", dest="with_game", help="Build with support for external game", default=None)
 
@@ -1287,8 +1323,8 @@ def products(arguments, **kwargs):
 		# "src/engine/game/screencontrol.*",
 
 		"src/engine/game/entity_allocator.h",
-		# "src/engine/game/particlesystem.h",
-		# "src/engine/game/particlesystem.cpp",
+		"src/engine/game/particlesystem.h",
+		"src/engine/game/particlesystem.cpp",
 
 		os.path.join(DEPENDENCIES_FOLDER, "stb", "stb_image.h"),
 		os.path.join(DEPENDENCIES_FOLDER, "stb", "stb_vorbis.c")
@@ -1380,6 +1416,15 @@ def products(arguments, **kwargs):
 			Dependency(file="glm.py"),
 			**kwargs)
 
+	benchmarks = []
+	if arguments.with_benchmarks:
+		benchmarks = get_benchmarks(arguments,
+			libcore,
+			librenderer,
+			libruntime,
+			Dependency(file="glm.py"),
+			**kwargs)
+
 	return games + [
 		librenderer,
 		libruntime,
@@ -1387,5 +1432,5 @@ def products(arguments, **kwargs):
 		libsdk,
 		librapid,
 		rnd,
-		gemini] + tools + tests
+		gemini] + tools + tests + benchmarks
 
@@ -39,11 +39,24 @@ namespace gemini
 			reinterpret_cast<volatile int32_t*>(destination));
 	}
 
+	bool atom_compare_and_swap64(volatile uint64_t* destination, uint64_t new_value, uint64_t comparand)
+	{
+		return OSAtomicCompareAndSwap64Barrier(
+			static_cast<int64_t>(comparand),
+			static_cast<int64_t>(new_value),
+			reinterpret_cast<volatile int64_t*>(destination));
+	}
+
 	uint32_t atom_increment32(volatile uint32_t* destination)
 	{
 		return static_cast<uint32_t>(OSAtomicIncrement32(reinterpret_cast<volatile int32_t*>(destination)));
 	}
 
+	uint32_t atom_decrement32(volatile uint32_t* destination)
+	{
+		return static_cast<uint32_t>(OSAtomicDecrement32(reinterpret_cast<volatile int32_t*>(destination)));
+	}
+
 	uint64_t atom_increment64(volatile uint64_t* destination, uint64_t value)
 	{
 		#error Implement on this platform.
@@ -59,11 +72,25 @@ namespace gemini
 		return (initial_destination == comparand);
 	}
 
+	bool atom_compare_and_swap64(volatile uint64_t* destination, uint64_t new_value, uint64_t comparand)
+	{
+		LONG64 initial_destination = InterlockedCompareExchange64(
+			reinterpret_cast<volatile LONG64*>(destination),
+			static_cast<LONG64>(new_value),
+			static_cast<LONG64>(comparand));
+		return (static_cast<uint64_t>(initial_destination) == comparand);
+	}
+
 	uint32_t atom_increment32(volatile uint32_t* destination)
 	{
 		return InterlockedIncrement((volatile unsigned int*)destination);
 	}
 
+	uint32_t atom_decrement32(volatile uint32_t* destination)
+	{
+		return InterlockedDecrement((volatile unsigned int*)destination);
+	}
+
 	uint64_t atom_increment64(volatile uint64_t* destination, uint64_t value)
 	{
 		return InterlockedAdd64((volatile LONG64*)destination, value);
@@ -74,11 +101,21 @@ namespace gemini
 		return __sync_bool_compare_and_swap(destination, comparand, new_value);
 	}
 
+	bool atom_compare_and_swap64(volatile uint64_t* destination, uint64_t new_value, uint64_t comparand)
+	{
+		return __sync_bool_compare_and_swap(destination, comparand, new_value);
+	}
+
 	uint32_t atom_increment32(volatile uint32_t* destination)
 	{
 		return __sync_add_and_fetch(destination, 1);
 	}
 
+	uint32_t atom_decrement32(volatile uint32_t* destination)
+	{
+		return __sync_sub_and_fetch(destination, 1);
+	}
+
 	uint64_t atom_increment64(volatile uint64_t* destination, uint64_t value)
 	{
 		return __sync_add_and_fetch(destination, 1);
@@ -86,4 +123,17 @@ namespace gemini
 #else
 	#error No atomic synchronization functions defined for this platform.
 #endif
+
+	void atom_spin_lock(volatile uint32_t* lock)
+	{
+		while (*lock || !atom_compare_and_swap32(lock, 1, 0))
+		{
+			// spin
+		}
+	}
+
+	void atom_spin_unlock(volatile uint32_t* lock)
+	{
+		atom_compare_and_swap32(lock, 0, 1);
+	}
 } // namespace gemini
\ No newline at end of file
@@ -73,10 +73,28 @@ namespace gemini
 	/// @returns true if the operation succeeded (destination now equals new_value)
 	bool atom_compare_and_swap32(volatile uint32_t* destination, uint32_t new_value, uint32_t comparand);
 
+	/// @brief Spin until the lock is acquired. lock must be zero-initialized.
+	/// Intended for short critical sections only.
+	void atom_spin_lock(volatile uint32_t* lock);
+
+	/// @brief Release a lock acquired with atom_spin_lock.
+	/// This is a full barrier: writes in the critical section are visible
+	/// before the lock is released and later reads are not moved ahead of it.
+	void atom_spin_unlock(volatile uint32_t* lock);
+
+	/// @brief Perform an atomic compare and swap on a 64-bit value
+	/// If the value in destination is equal to the comparand, destination is set to new_value.
+	/// @returns true if the operation succeeded (destination now equals new_value)
+	bool atom_compare_and_swap64(volatile uint64_t* destination, uint64_t new_value, uint64_t comparand);
+
 	/// @brief Atomically increments an integer of 32-bit width.
 	/// @returns The value of destination post increment.
 	uint32_t atom_increment32(volatile uint32_t* destination);
 
+	/// @brief Atomically decrements an integer of 32-bit width.
+	/// @returns The value of destination post decrement.
+	uint32_t atom_decrement32(volatile uint32_t* destination);
+
 	uint64_t atom_increment64(volatile uint64_t* destination);
 
 	// Use this to wrap atomic variables. Update as needed.
@@ -123,7 +123,7 @@ private:
 		}
 
 		// free the old table
-		deallocate(old_table);
+		deallocate(old_table, total_items);
 	} // repopulate
 
 	Bucket* find_or_create_bucket(const K& key)
@@ -183,10 +183,10 @@ private:
 		return data;
 	} // allocate
 
-	void deallocate(Bucket* pointer)
+	void deallocate(Bucket* pointer, size_t elements)
 	{
 		// Call the destructor for each element
-		for (size_t index = 0; index < table_size; ++index)
+		for (size_t index = 0; index < elements; ++index)
 		{
 			if (pointer[index].hash != 0)
 			{
@@ -224,7 +224,7 @@ public:
 
 	~HashSet()
 	{
-		deallocate(table);
+		deallocate(table, table_size);
 	} // ~HashSet
 
 	HashSet<K, T, H>& operator=(const HashSet<K, T, H>& /*other*/)
@@ -24,6 +24,7 @@
 // -------------------------------------------------------------
 #include "mem.h"
 
+#include <core/atomic.h>
 #include <core/logging.h>
 #include <core/str.h>
 
@@ -36,6 +37,22 @@ namespace gemini
 	ZoneStats* _tracking_stats = nullptr;
 	gemini::StaticMemory<gemini::ZoneStats, gemini::MEMORY_ZONE_MAX> zone_stat_memory;
 
+#if defined(ENABLE_MEMORY_TRACKING)
+	// Guards the zone stats and the debug lists; allocations may be made
+	// from any thread (asset streaming, job workers).
+	static volatile uint32_t _tracking_lock = 0;
+
+	static void memory_tracking_lock()
+	{
+		atom_spin_lock(&_tracking_lock);
+	}
+
+	static void memory_tracking_unlock()
+	{
+		atom_spin_unlock(&_tracking_lock);
+	}
+#endif
+
 	ZoneStats* memory_zone_tracking_stats()
 	{
 		return _tracking_stats;
@@ -84,6 +101,10 @@ namespace gemini
 					(unsigned long)zone_stat.smallest_allocation,
 					(unsigned long)zone_stat.largest_allocation);
 
+				LOGV("\t* last_frame_allocations = %lu, last_frame_peak_bytes = %lu\n",
+					(unsigned long)zone_stat.last_frame_allocations,
+					(unsigned long)zone_stat.last_frame_peak_bytes);
+
 				//LOGV("*** MEMORY LEAK [addr=%x] [file=%s] [line=%i] [size=%lu] [alloc_num=%lu]\n",
 				//	(((char*)block) + sizeof(MemoryHeader)),
 				//	block->filename,
@@ -173,6 +194,12 @@ namespace gemini
 		{
 			stats.high_watermark = stats.active_bytes;
 		}
+
+		stats.frame_allocations++;
+		if (stats.active_bytes > stats.frame_peak_bytes)
+		{
+			stats.frame_peak_bytes = stats.active_bytes;
+		}
 	} // memory_zone_track
 
 	void memory_zone_untrack(MemoryZone zone, size_t allocation_size)
@@ -205,6 +232,13 @@ namespace gemini
 		}
 	} // memory_zone_name
 
+	// Alignment of blocks carrying a MemoryZoneHeader; the header must
+	// itself be aligned.
+	static uint32_t memory_block_alignment(uint32_t alignment)
+	{
+		return (alignment < alignof(MemoryZoneHeader)) ? static_cast<uint32_t>(alignof(MemoryZoneHeader)) : alignment;
+	} // memory_block_alignment
+
 	MemoryZoneHeader* memory_zone_header_from_pointer(void* pointer)
 	{
 		unsigned char* memory = reinterpret_cast<unsigned char*>(pointer);
@@ -219,17 +253,17 @@ namespace gemini
 	void* memory_allocate(MemoryZone zone, size_t requested_size, uint32_t alignment, const char* filename, int line)
 	{
 		// Add header sizes onto the requested size.
-		size_t allocation_size = requested_size + memory_per_allocation_overhead();
+		const size_t overhead = memory_per_allocation_overhead();
+		size_t allocation_size = requested_size + overhead;
 
-		// compute alignment offset if the allocation_size would spill
-		// across boundaries.
-		uintptr_t pointer_size = static_cast<uintptr_t>(allocation_size);
-		pointer_size = reinterpret_cast<uintptr_t>(memory_force_alignment(reinterpret_cast<void*>(pointer_size), alignment));
-		uintptr_t alignment_offset = pointer_size - allocation_size;
+		// Pad the headers so both the zone header and the returned
+		// pointer are aligned within the aligned block.
+		const uint32_t block_alignment = memory_block_alignment(alignment);
+		uintptr_t alignment_offset = reinterpret_cast<uintptr_t>(memory_force_alignment(reinterpret_cast<void*>(overhead), block_alignment)) - overhead;
 		allocation_size += alignment_offset;
 
 		// request the memory from the OS
-		void* memory = memory_aligned_malloc(allocation_size, alignment);
+		void* memory = memory_aligned_malloc(allocation_size, block_alignment);
 
 		ZoneStats* stats = memory_zone_tracking_stats();
 		ZoneStats& target_stat = stats[zone];
@@ -237,6 +271,8 @@ namespace gemini
 		unsigned char* block = reinterpret_cast<unsigned char*>(memory);
 		MemoryDebugHeader* debug = reinterpret_cast<MemoryDebugHeader*>(memory);
 		memset(debug, 0, sizeof(MemoryDebugHeader));
+
+		memory_tracking_lock();
 		debug->alignment = alignment;
 		debug->allocation_index = target_stat.total_allocations;
 		debug->filename = filename;
@@ -265,6 +301,7 @@ namespace gemini
 		zone_header->allocation_size = static_cast<uint32_t>(allocation_size);
 		zone_header->alignment_offset = static_cast<uint32_t>(alignment_offset);
 		memory_zone_track(zone, allocation_size);
+		memory_tracking_unlock();
 
 		// populate zone header
 		memory = block + sizeof(MemoryDebugHeader) + alignment_offset + sizeof(MemoryZoneHeader);
@@ -292,6 +329,8 @@ namespace gemini
 		unsigned char* memory = reinterpret_cast<unsigned char*>(pointer);
 
 		MemoryZoneHeader* zone_header = memory_zone_header_from_pointer(pointer);
+
+		memory_tracking_lock();
 		memory_zone_untrack(zone_header->zone, zone_header->allocation_size);
 
 		memory = reinterpret_cast<unsigned char*>(zone_header);
@@ -318,6 +357,7 @@ namespace gemini
 		{
 			target_stat.tail = next;
 		}
+		memory_tracking_unlock();
 
 		//LOGV("[-] '%s' %x size=%lu, align=%lu, line=%i, alloc_num=%zu\n",
 		//	zone ? zone->name() : "",
@@ -333,17 +373,17 @@ namespace gemini
 	void* memory_allocate(MemoryZone zone, size_t requested_size, size_t alignment)
 	{
 		// Add header sizes onto the requested size.
-		size_t allocation_size = requested_size + memory_per_allocation_overhead();
+		const size_t overhead = memory_per_allocation_overhead();
+		size_t allocation_size = requested_size + overhead;
 
-		// compute alignment offset if the allocation_size would spill
-		// across boundaries.
-		void* pointer_size = reinterpret_cast<void*>(allocation_size);
-		pointer_size = memory_force_alignment(pointer_size, alignment);
-		uint32_t alignment_offset = static_cast<uint32_t>((size_t)pointer_size - (size_t)allocation_size);
+		// Pad the header so both the zone header and the returned
+		// pointer are aligned within the aligned block.
+		const uint32_t block_alignment = memory_block_alignment(static_cast<uint32_t>(alignment));
+		uint32_t alignment_offset = static_cast<uint32_t>((size_t)memory_force_alignment(reinterpret_cast<void*>(overhead), block_alignment) - overhead);
 		allocation_size += alignment_offset;
 
 		// request the memory from the OS
-		unsigned char* block = reinterpret_cast<unsigned char*>(memory_aligned_malloc(allocation_size, alignment));
+		unsigned char* block = reinterpret_cast<unsigned char*>(memory_aligned_malloc(allocation_size, block_alignment));
 
 		block += alignment_offset;
 		MemoryZoneHeader* zone_header = reinterpret_cast<MemoryZoneHeader*>(block);
@@ -418,17 +458,15 @@ namespace gemini
 	{
 		// We purposely don't track memory leaks for the linear allocators.
 		// That memory is the responsibility of the allocator's creator.
-		size_t allocation_size = requested_size + sizeof(MemoryZoneHeader);
-
-		void* pointer_size = reinterpret_cast<void*>(allocation_size);
-		pointer_size = memory_force_alignment(pointer_size, alignment);
-		uint32_t alignment_offset = static_cast<uint32_t>((size_t)pointer_size - (size_t)allocation_size);
-		allocation_size += alignment_offset;
+		// The zone header sits directly before the returned pointer; pad
+		// from the current position so both are aligned.
+		unsigned char* block = reinterpret_cast<unsigned char*>(allocator.memory) + allocator.bytes_used;
+		unsigned char* aligned = static_cast<unsigned char*>(memory_force_alignment(block + sizeof(MemoryZoneHeader), memory_block_alignment(alignment)));
+		uint32_t alignment_offset = static_cast<uint32_t>(aligned - sizeof(MemoryZoneHeader) - block);
+		size_t allocation_size = alignment_offset + sizeof(MemoryZoneHeader) + requested_size;
 
 		if (allocator.bytes_used + allocation_size <= allocator.memory_size)
 		{
-			unsigned char* block = reinterpret_cast<unsigned char*>(allocator.memory) + allocator.bytes_used;
-
 			block += alignment_offset;
 			MemoryZoneHeader* zone_header = reinterpret_cast<MemoryZoneHeader*>(block);
 			zone_header->zone = zone;
@@ -489,6 +527,418 @@ namespace gemini
 	} // memory_allocator_linear
 
 
+	// ---------------------------------------------------------------------
+	// frame allocator: Thread-local, double-buffered arenas
+	// ---------------------------------------------------------------------
+	struct FrameOverflowBlock
+	{
+		FrameOverflowBlock* next;
+	}; // FrameOverflowBlock
+
+	struct FrameArena
+	{
+		unsigned char* memory;
+		size_t bytes_used;
+
+		// heap blocks for requests which didn't fit in memory
+		FrameOverflowBlock* overflow;
+
+		// Allocations made by the owning thread during this arena's frame
+		// (frame and pool allocations). Folded into the zone stats by
+		// memory_frame_advance, which avoids taking the tracking lock.
+		// The owner may still be counting into an arena while it is
+		// folded; so both sides use frame_counter_add/frame_counter_take.
+		volatile uint64_t zone_allocations[MEMORY_ZONE_MAX];
+		volatile uint64_t zone_bytes[MEMORY_ZONE_MAX];
+	}; // FrameArena
+
+	struct FrameThreadState
+	{
+		// indexed by the low bit of the frame index
+		FrameArena arenas[2];
+		FrameThreadState* next;
+	}; // FrameThreadState
+
+	// every thread which has made a frame or pool allocation
+	static FrameThreadState* _frame_threads = nullptr;
+	static volatile uint32_t _frame_threads_lock = 0;
+	static volatile uint32_t _frame_index = 0;
+
+	// Bumped on shutdown; stale thread states are re-created on next use.
+	static volatile uint32_t _frame_generation = 1;
+	static PLATFORM_THREAD_LOCAL FrameThreadState* tls_frame_state = nullptr;
+	static PLATFORM_THREAD_LOCAL uint32_t tls_frame_generation = 0;
+
+	static void frame_counter_add(volatile uint64_t* counter, uint64_t value)
+	{
+		uint64_t current;
+		do
+		{
+			current = *counter;
+		} while (!atom_compare_and_swap64(counter, current + value, current));
+	} // frame_counter_add
+
+	// Atomically reset counter to zero; returns its previous value.
+	static uint64_t frame_counter_take(volatile uint64_t* counter)
+	{
+		uint64_t current;
+		do
+		{
+			current = *counter;
+		} while (!atom_compare_and_swap64(counter, 0, current));
+		return current;
+	} // frame_counter_take
+
+	static FrameArena& frame_current_arena()
+	{
+		if (tls_frame_generation != _frame_generation)
+		{
+			FrameThreadState* state = static_cast<FrameThreadState*>(memory_aligned_malloc(sizeof(FrameThreadState), alignof(FrameThreadState)));
+			memset(state, 0, sizeof(FrameThreadState));
+
+			atom_spin_lock(&_frame_threads_lock);
+			state->next = _frame_threads;
+			_frame_threads = state;
+			atom_spin_unlock(&_frame_threads_lock);
+
+			tls_frame_state = state;
+			tls_frame_generation = _frame_generation;
+		}
+
+		return tls_frame_state->arenas[_frame_index & 1];
+	} // frame_current_arena
+
+	static void frame_arena_reset(FrameArena& arena)
+	{
+		FrameOverflowBlock* block = arena.overflow;
+		while (block)
+		{
+			FrameOverflowBlock* next = block->next;
+			memory_aligned_free(block);
+			block = next;
+		}
+
+		arena.overflow = nullptr;
+		arena.bytes_used = 0;
+	} // frame_arena_reset
+
+	void* frame_allocate_common(Allocator& allocator, size_t requested_size, uint32_t alignment)
+	{
+		FrameArena& arena = frame_current_arena();
+		frame_counter_add(&arena.zone_allocations[allocator.zone], 1);
+		frame_counter_add(&arena.zone_bytes[allocator.zone], requested_size);
+
+		if (!arena.memory)
+		{
+			arena.memory = static_cast<unsigned char*>(memory_aligned_malloc(MEMORY_FRAME_ARENA_SIZE, 16));
+		}
+
+		unsigned char* block = static_cast<unsigned char*>(memory_force_alignment(arena.memory + arena.bytes_used, alignment));
+		const size_t bytes_used = static_cast<size_t>(block - arena.memory) + requested_size;
+		if (bytes_used <= MEMORY_FRAME_ARENA_SIZE)
+		{
+			arena.bytes_used = bytes_used;
+			return block;
+		}
+
+		// The arena is exhausted; spill this request to the heap.
+		// The block is released when the arena is recycled.
+		if (alignment < alignof(FrameOverflowBlock))
+		{
+			alignment = alignof(FrameOverflowBlock);
+		}
+		const size_t header_size = reinterpret_cast<size_t>(memory_force_alignment(reinterpret_cast<void*>(sizeof(FrameOverflowBlock)), alignment));
+		FrameOverflowBlock* overflow = static_cast<FrameOverflowBlock*>(memory_aligned_malloc(header_size + requested_size, alignment));
+		if (!overflow)
+		{
+			return nullptr;
+		}
+
+		overflow->next = arena.overflow;
+		arena.overflow = overflow;
+		return reinterpret_cast<unsigned char*>(overflow) + header_size;
+	} // frame_allocate_common
+
+#if defined(ENABLE_MEMORY_TRACKING)
+	void* frame_allocate(Allocator& allocator, size_t requested_size, uint32_t alignment, const char* /*filename*/, int /*line*/)
+	{
+		return frame_allocate_common(allocator, requested_size, alignment);
+	} // frame_allocate
+
+	void frame_deallocate(Allocator& /*allocator*/, void* /*pointer*/, const char* /*filename*/, int /*line*/)
+	{
+		// Frame memory is released when the arena is recycled.
+	} // frame_deallocate
+#else
+	void* frame_allocate(Allocator& allocator, size_t requested_size, uint32_t alignment)
+	{
+		return frame_allocate_common(allocator, requested_size, alignment);
+	} // frame_allocate
+
+	void frame_deallocate(Allocator& /*allocator*/, void* /*pointer*/)
+	{
+		// Frame memory is released when the arena is recycled.
+	} // frame_deallocate
+#endif
+
+	Allocator memory_allocator_frame(MemoryZone zone)
+	{
+		Allocator allocator;
+		memset(&allocator, 0, sizeof(Allocator));
+		allocator.zone = zone;
+		allocator.allocate = frame_allocate;
+		allocator.deallocate = frame_deallocate;
+		allocator.type = ALLOCATOR_FRAME;
+		return allocator;
+	} // memory_allocator_frame
+
+	void memory_frame_advance()
+	{
+		const uint32_t last_frame = _frame_index;
+		const uint32_t next_frame = last_frame + 1;
+
+		size_t frame_allocations[MEMORY_ZONE_MAX];
+		size_t frame_bytes[MEMORY_ZONE_MAX];
+		memset(frame_allocations, 0, sizeof(size_t) * MEMORY_ZONE_MAX);
+		memset(frame_bytes, 0, sizeof(size_t) * MEMORY_ZONE_MAX);
+
+		atom_spin_lock(&_frame_threads_lock);
+
+		// Recycle the arenas from two frames ago before any thread can
+		// observe the new frame index.
+		for (FrameThreadState* state = _frame_threads; state; state = state->next)
+		{
+			frame_arena_reset(state->arenas[next_frame & 1]);
+		}
+
+		PLATFORM_MEMORY_FENCE();
+		_frame_index = next_frame;
+		PLATFORM_MEMORY_FENCE();
+
+		for (FrameThreadState* state = _frame_threads; state; state = state->next)
+		{
+			FrameArena& arena = state->arenas[last_frame & 1];
+			for (size_t zone = 0; zone < MEMORY_ZONE_MAX; ++zone)
+			{
+				frame_allocations[zone] += static_cast<size_t>(frame_counter_take(&arena.zone_allocations[zone]));
+				frame_bytes[zone] += static_cast<size_t>(frame_counter_take(&arena.zone_bytes[zone]));
+			}
+		}
+		atom_spin_unlock(&_frame_threads_lock);
+
+#if defined(ENABLE_MEMORY_TRACKING)
+		memory_tracking_lock();
+#endif
+		for (size_t zone = 0; zone < MEMORY_ZONE_MAX; ++zone)
+		{
+			ZoneStats& stats = _tracking_stats[zone];
+			stats.total_allocations += frame_allocations[zone];
+			stats.total_bytes += frame_bytes[zone];
+
+			stats.last_frame_allocations = stats.frame_allocations + frame_allocations[zone];
+			stats.last_frame_peak_bytes = stats.frame_peak_bytes + frame_bytes[zone];
+
+			stats.frame_allocations = 0;
+			stats.frame_peak_bytes = stats.active_bytes;
+		}
+#if defined(ENABLE_MEMORY_TRACKING)
+		memory_tracking_unlock();
+#endif
+	} // memory_frame_advance
+
+	static void frame_shutdown()
+	{
+		atom_spin_lock(&_frame_threads_lock);
+		FrameThreadState* state = _frame_threads;
+		while (state)
+		{
+			FrameThreadState* next = state->next;
+			for (size_t index = 0; index < 2; ++index)
+			{
+				frame_arena_reset(state->arenas[index]);
+				memory_aligned_free(state->arenas[index].memory);
+			}
+			memory_aligned_free(state);
+			state = next;
+		}
+		_frame_threads = nullptr;
+		_frame_index = 0;
+		_frame_generation++;
+		atom_spin_unlock(&_frame_threads_lock);
+	} // frame_shutdown
+
+
+	// ---------------------------------------------------------------------
+	// pool allocator: Fixed-size blocks from a lock-free free list
+	// ---------------------------------------------------------------------
+	const uint32_t MEMORY_POOL_INVALID_INDEX = UINT32_MAX;
+
+	// Lives at the start of the pool's memory so copies of the Allocator
+	// share the same free list.
+	struct MemoryPoolHeader
+	{
+		// index of the first free element in the low 32 bits; the high
+		// 32 bits are a tag bumped on every change to avoid ABA.
+		volatile uint64_t head;
+
+		unsigned char* elements;
+		uint32_t element_stride;
+		uint32_t total_elements;
+		uint32_t alignment;
+	}; // MemoryPoolHeader
+
+	static uint32_t pool_alignment(uint32_t alignment)
+	{
+		// free elements hold the index of the next free element
+		return (alignment < alignof(uint32_t)) ? static_cast<uint32_t>(alignof(uint32_t)) : alignment;
+	} // pool_alignment
+
+	static uint32_t pool_stride(size_t element_size, uint32_t alignment)
+	{
+		if (element_size < sizeof(uint32_t))
+		{
+			element_size = sizeof(uint32_t);
+		}
+		return static_cast<uint32_t>(reinterpret_cast<size_t>(memory_force_alignment(reinterpret_cast<void*>(element_size), alignment)));
+	} // pool_stride
+
+	void* pool_allocate_common(Allocator& allocator, size_t requested_size, uint32_t alignment)
+	{
+		MemoryPoolHeader* pool = static_cast<MemoryPoolHeader*>(allocator.memory);
+		if ((requested_size <= pool->element_stride) && (alignment <= pool->alignment))
+		{
+			for (;;)
+			{
+				const uint64_t head = pool->head;
+				const uint32_t index = static_cast<uint32_t>(head);
+				if (index == MEMORY_POOL_INVALID_INDEX)
+				{
+					break;
+				}
+
+				// If another thread pops this element first; next may be
+				// garbage, but the tag will have changed and the swap fails.
+				unsigned char* element = pool->elements + (static_cast<size_t>(index) * pool->element_stride);
+				const uint32_t next = *reinterpret_cast<volatile uint32_t*>(element);
+				const uint64_t new_head = (((head >> 32) + 1) << 32) | next;
+				if (atom_compare_and_swap64(&pool->head, new_head, head))
+				{
+					frame_counter_add(&frame_current_arena().zone_allocations[allocator.zone], 1);
+					return element;
+				}
+			}
+		}
+
+		return nullptr;
+	} // pool_allocate_common
+
+	bool pool_deallocate_common(Allocator& allocator, void* pointer)
+	{
+		MemoryPoolHeader* pool = static_cast<MemoryPoolHeader*>(allocator.memory);
+		unsigned char* element = static_cast<unsigned char*>(pointer);
+		const unsigned char* last = pool->elements + (static_cast<size_t>(pool->total_elements) * pool->element_stride);
+		if (element < pool->elements || element >= last)
+		{
+			// this came from the heap
+			return false;
+		}
+
+		const uint32_t index = static_cast<uint32_t>((element - pool->elements) / pool->element_stride);
+
+		// If you hit this assert; the pointer is not the start of an element.
+		assert(element == pool->elements + (static_cast<size_t>(index) * pool->element_stride));
+
+		for (;;)
+		{
+			const uint64_t head = pool->head;
+			*reinterpret_cast<volatile uint32_t*>(element) = static_cast<uint32_t>(head);
+			const uint64_t new_head = (((head >> 32) + 1) << 32) | index;
+			if (atom_compare_and_swap64(&pool->head, new_head, head))
+			{
+				return true;
+			}
+		}
+	} // pool_deallocate_common
+
+#if defined(ENABLE_MEMORY_TRACKING)
+	void* pool_allocate(Allocator& allocator, size_t requested_size, uint32_t alignment, const char* filename, int line)
+	{
+		void* pointer = pool_allocate_common(allocator, requested_size, alignment);
+		if (!pointer)
+		{
+			pointer = memory_allocate(allocator.zone, requested_size, alignment, filename, line);
+		}
+		return pointer;
+	} // pool_allocate
+
+	void pool_deallocate(Allocator& allocator, void* pointer, const char* filename, int line)
+	{
+		if (pointer && !pool_deallocate_common(allocator, pointer))
+		{
+			memory_deallocate(pointer, filename, line);
+		}
+	} // pool_deallocate
+#else
+	void* pool_allocate(Allocator& allocator, size_t requested_size, uint32_t alignment)
+	{
+		void* pointer = pool_allocate_common(allocator, requested_size, alignment);
+		if (!pointer)
+		{
+			pointer = memory_allocate(allocator.zone, requested_size, alignment);
+		}
+		return pointer;
+	} // pool_allocate
+
+	void pool_deallocate(Allocator& allocator, void* pointer)
+	{
+		if (pointer && !pool_deallocate_common(allocator, pointer))
+		{
+			memory_deallocate(pointer);
+		}
+	} // pool_deallocate
+#endif
+
+	size_t memory_pool_size(size_t element_size, uint32_t alignment, size_t total_elements)
+	{
+		alignment = pool_alignment(alignment);
+		return (alignof(MemoryPoolHeader) - 1) + sizeof(MemoryPoolHeader) + (alignment - 1) + (pool_stride(element_size, alignment) * total_elements);
+	} // memory_pool_size
+
+	Allocator memory_allocator_pool(MemoryZone zone, void* memory, size_t memory_size, size_t element_size, uint32_t alignment)
+	{
+		// If you hit this assert, the memory is too small for the header.
+		assert(memory_size >= memory_pool_size(element_size, alignment, 0));
+
+		alignment = pool_alignment(alignment);
+
+		MemoryPoolHeader* pool = static_cast<MemoryPoolHeader*>(memory_force_alignment(memory, alignof(MemoryPoolHeader)));
+		pool->elements = static_cast<unsigned char*>(memory_force_alignment(pool + 1, alignment));
+		pool->element_stride = pool_stride(element_size, alignment);
+		pool->alignment = alignment;
+
+		const size_t header_size = static_cast<size_t>(pool->elements - static_cast<unsigned char*>(memory));
+		pool->total_elements = static_cast<uint32_t>((memory_size - header_size) / pool->element_stride);
+
+		// thread every element onto the free list
+		for (uint32_t index = 0; index < pool->total_elements; ++index)
+		{
+			uint32_t* next = reinterpret_cast<uint32_t*>(pool->elements + (static_cast<size_t>(index) * pool->element_stride));
+			*next = ((index + 1) < pool->total_elements) ? (index + 1) : MEMORY_POOL_INVALID_INDEX;
+		}
+		pool->head = (pool->total_elements > 0) ? 0 : MEMORY_POOL_INVALID_INDEX;
+
+		Allocator allocator;
+		memset(&allocator, 0, sizeof(Allocator));
+		allocator.zone = zone;
+		allocator.allocate = pool_allocate;
+		allocator.deallocate = pool_deallocate;
+		allocator.memory = pool;
+		allocator.memory_size = memory_size;
+		allocator.type = ALLOCATOR_POOL;
+		return allocator;
+	} // memory_allocator_pool
+
+
 	// ---------------------------------------------------------------------
 	// interface
 	// ---------------------------------------------------------------------
@@ -510,6 +960,8 @@ namespace gemini
 	{
 		gemini::memory_leak_report();
 
+		frame_shutdown();
+
 		// If you hit this assert, there's a double memory shutdown
 		assert(gemini::_tracking_stats);
 		gemini::_tracking_stats = nullptr;
@@ -71,6 +71,12 @@ namespace gemini
 
 		ALLOCATOR_LINEAR,
 
+		// Thread-local, double-buffered arena reset at frame boundaries.
+		ALLOCATOR_FRAME,
+
+		// Fixed-size blocks from a lock-free free list.
+		ALLOCATOR_POOL,
+
 		ALLOCATOR_TYPE_MAX
 	}; // AllocatorType
 
@@ -190,6 +196,15 @@ namespace gemini
 		size_t smallest_allocation;
 		size_t largest_allocation;
 
+		// Allocations and peak bytes (active heap bytes plus frame arena
+		// bytes) since the last memory_frame_advance.
+		size_t frame_allocations;
+		size_t frame_peak_bytes;
+
+		// Values for the last completed frame.
+		size_t last_frame_allocations;
+		size_t last_frame_peak_bytes;
+
 #if defined(ENABLE_MEMORY_TRACKING)
 		// list of active allocations for this zone
 		MemoryDebugHeader* tail;
@@ -220,6 +235,29 @@ namespace gemini
 	Allocator memory_allocator_default(MemoryZone zone);
 	Allocator memory_allocator_linear(MemoryZone zone, void* memory, size_t memory_size);
 
+	// Frame allocations come from an arena owned by the calling thread and
+	// are released in bulk; deallocate is a no-op. Each thread has two
+	// arenas which alternate per frame, so memory allocated during frame N
+	// stays valid until memory_frame_advance begins frame N + 2.
+	// Requests which don't fit in the arena spill to the heap and are
+	// released along with the arena.
+	Allocator memory_allocator_frame(MemoryZone zone);
+
+	// Pool allocations are fixed-size blocks carved from memory, which
+	// must be at least memory_pool_size bytes. Alloc and free are lock-free
+	// and may be called from any thread. Requests larger than element_size
+	// or made while the pool is exhausted fall back to the heap.
+	Allocator memory_allocator_pool(MemoryZone zone, void* memory, size_t memory_size, size_t element_size, uint32_t alignment);
+	size_t memory_pool_size(size_t element_size, uint32_t alignment, size_t total_elements);
+
+	// Frame arena size per thread, per buffer.
+	const size_t MEMORY_FRAME_ARENA_SIZE = (1 * Megabyte);
+
+	// Call once per frame from the main thread to recycle the frame arenas
+	// of two frames ago and roll over per-frame zone stats.
+	// No thread may still be using frame memory from two frames ago.
+	void memory_frame_advance();
+
 #if defined(ENABLE_MEMORY_TRACKING)
 	#define MEMORY2_ALLOC(allocator, size) (allocator).allocate((allocator), size, alignof(void*), __FILE__, __LINE__)
 	#define MEMORY2_DEALLOC(allocator, pointer) (allocator).deallocate((allocator), pointer, __FILE__, __LINE__)
@@ -251,6 +289,8 @@ namespace gemini
 	#define MEMORY2_ALLOC(allocator, size) (allocator).allocate((allocator), size, alignof(void*))
 	#define MEMORY2_DEALLOC(allocator, pointer) (allocator).deallocate((allocator), pointer)
 
+	#define MEMORY2_ALLOC_ALIGNED(allocator, alignment, size) (allocator).allocate((allocator), size, alignment)
+
 	#define MEMORY2_NEW(allocator, type) new ((allocator).allocate((allocator), sizeof(type), alignof(type))) type
 	#define MEMORY2_DELETE(allocator, pointer) (allocator).deallocate((allocator), pointer)
 
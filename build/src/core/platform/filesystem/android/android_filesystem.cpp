@@ -173,6 +173,40 @@ namespace platform
 		return posix_fs_directory_exists(path);
 	}
 
+	platform::FileMapping fs_map_file(const char* path)
+	{
+		platform::FileMapping mapping;
+
+		// Uncompressed assets are memory mapped directly from the APK;
+		// compressed assets are inflated into a buffer owned by the asset.
+		AAsset* asset = AAssetManager_open(get_asset_manager(), path, AASSET_MODE_BUFFER);
+		if (asset)
+		{
+			mapping.data = AAsset_getBuffer(asset);
+			if (mapping.data)
+			{
+				mapping.size = static_cast<size_t>(AAsset_getLength(asset));
+				mapping.handle = asset;
+			}
+			else
+			{
+				AAsset_close(asset);
+			}
+		}
+
+		return mapping;
+	}
+
+	void fs_unmap_file(platform::FileMapping& mapping)
+	{
+		if (mapping.handle)
+		{
+			AAsset_close(static_cast<AAsset*>(mapping.handle));
+		}
+
+		mapping = platform::FileMapping();
+	}
+
 	PathString fs_content_directory()
 	{
 		return android::obb_path();
@@ -126,6 +126,16 @@ namespace platform
 		return posix_fs_directory_exists(path);
 	}
 
+	platform::FileMapping fs_map_file(const char* path)
+	{
+		return posix_fs_map_file(path);
+	}
+
+	void fs_unmap_file(platform::FileMapping& mapping)
+	{
+		posix_fs_unmap_file(mapping);
+	}
+
 	PathString fs_content_directory()
 	{
 		// On Mac/iOS, the root directory points to the app bundle
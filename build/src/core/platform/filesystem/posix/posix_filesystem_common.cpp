@@ -25,7 +25,9 @@
 
 #include "platform_internal.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h> // for getenv
 
@@ -158,4 +160,41 @@ namespace platform
 		int result = stat(path, &info);
 		return (result == 0) && ((info.st_mode & S_IFMT) == S_IFDIR);
 	}
+
+	platform::FileMapping posix_fs_map_file(const char* path)
+	{
+		platform::FileMapping mapping;
+
+		int fd = open(path, O_RDONLY);
+		if (fd == -1)
+		{
+			return mapping;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0)
+		{
+			void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				mapping.data = data;
+				mapping.size = static_cast<size_t>(info.st_size);
+			}
+		}
+
+		// the mapping holds its own reference to the file
+		close(fd);
+		return mapping;
+	} // posix_fs_map_file
+
+	void posix_fs_unmap_file(platform::FileMapping& mapping)
+	{
+		if (mapping.data)
+		{
+			munmap(const_cast<void*>(mapping.data), mapping.size);
+		}
+
+		mapping.data = nullptr;
+		mapping.size = 0;
+	} // posix_fs_unmap_file
 } // namespace platform
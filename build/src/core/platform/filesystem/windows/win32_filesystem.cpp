@@ -242,6 +242,58 @@ namespace platform
 		return PathFileExistsA(path) == TRUE;
 	}
 
+	platform::FileMapping fs_map_file(const char* path)
+	{
+		platform::FileMapping mapping;
+
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return mapping;
+		}
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return mapping;
+		}
+
+		HANDLE file_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (file_mapping == NULL)
+		{
+			LOGW("CreateFileMappingA returned error: %i\n", GetLastError());
+			CloseHandle(file);
+			return mapping;
+		}
+
+		mapping.data = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (mapping.data == nullptr)
+		{
+			LOGW("MapViewOfFile returned error: %i\n", GetLastError());
+			CloseHandle(file_mapping);
+			CloseHandle(file);
+			return mapping;
+		}
+
+		mapping.size = static_cast<size_t>(file_size.QuadPart);
+		mapping.handle = file;
+		mapping.mapping_handle = file_mapping;
+		return mapping;
+	}
+
+	void fs_unmap_file(platform::FileMapping& mapping)
+	{
+		if (mapping.data)
+		{
+			UnmapViewOfFile(mapping.data);
+			CloseHandle(mapping.mapping_handle);
+			CloseHandle(mapping.handle);
+		}
+
+		mapping = platform::FileMapping();
+	}
+
 	PathString fs_content_directory()
 	{
 		return get_program_directory();
@@ -240,6 +240,30 @@ namespace platform
 		}
 	};
 
+	// A read-only view of a file's contents mapped into memory.
+	struct FileMapping
+	{
+		const void* data;
+		size_t size;
+
+		// platform-specific handle(s) needed to release the mapping
+		void* handle;
+		void* mapping_handle;
+
+		FileMapping()
+			: data(nullptr)
+			, size(0)
+			, handle(nullptr)
+			, mapping_handle(nullptr)
+		{
+		}
+
+		bool is_mapped() const
+		{
+			return (data != nullptr);
+		}
+	};
+
 	enum FileMode
 	{
 		FileMode_Read,
@@ -321,6 +345,14 @@ namespace platform
 	bool fs_file_exists(const char* path);
 	bool fs_directory_exists(const char* path);
 
+	/// @brief Map an entire file into memory for reading.
+	/// The returned view remains valid until fs_unmap_file is called.
+	/// @returns A FileMapping; is_mapped() is false on failure.
+	platform::FileMapping fs_map_file(const char* path);
+
+	/// @brief Release a mapping returned by fs_map_file.
+	void fs_unmap_file(platform::FileMapping& mapping);
+
 	/// @brief Construct this platform's content directory
 	/// @returns A string pointing to the absolute path for content on this platform
 	/// example: On Mac/iOS/TVOS <AppBundle>/Content/Resources directory is the 'content' directory.
@@ -444,6 +476,9 @@ namespace platform
 	/// @brief Allows the calling thread to sleep
 	void thread_sleep(int milliseconds);
 
+	/// @brief Yield the remainder of the calling thread's time slice
+	void thread_yield();
+
 	/// @brief Get the calling thread's id
 	/// @returns The calling thread's platform designated id
 	ThreadId thread_id();
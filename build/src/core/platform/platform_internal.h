@@ -76,12 +76,15 @@ namespace platform
 	long int posix_fs_tell(platform::File handle);
 	bool posix_fs_file_exists(const char* path);
 	bool posix_fs_directory_exists(const char* path);
+	platform::FileMapping posix_fs_map_file(const char* path);
+	void posix_fs_unmap_file(platform::FileMapping& mapping);
 
 	// threads
 	Thread* posix_thread_create(ThreadEntry entry, void* data);
 	void posix_thread_destroy(Thread* thread);
 	int posix_thread_join(Thread* thread);
 	void posix_thread_sleep(int milliseconds);
+	void posix_thread_yield();
 	pthread_t posix_thread_id();
 	ThreadStatus posix_thread_status(Thread* thread);
 	bool posix_thread_is_active(Thread* thread);
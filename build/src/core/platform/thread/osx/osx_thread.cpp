@@ -46,6 +46,11 @@ namespace platform
 		posix_thread_sleep(milliseconds);
 	}
 
+	void thread_yield()
+	{
+		posix_thread_yield();
+	}
+
 	pthread_t thread_id()
 	{
 		return posix_thread_id();
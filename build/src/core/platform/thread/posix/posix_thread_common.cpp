@@ -26,6 +26,7 @@
 #include "platform_internal.h"
 
 #include <pthread.h>
+#include <sched.h> // for sched_yield
 #include <signal.h> // for pthread_kill
 #include <unistd.h> // for usleep
 
@@ -141,6 +142,11 @@ namespace platform
 		usleep(milliseconds * MicrosecondsPerMillisecond);
 	}
 
+	void posix_thread_yield()
+	{
+		sched_yield();
+	}
+
 	pthread_t posix_thread_id()
 	{
 		return pthread_self();
@@ -163,9 +169,10 @@ namespace platform
 	public:
 		sem_t handle;
 
-		PosixSemaphore(int32_t initial_count, int32_t max_count)
+		PosixSemaphore(int32_t initial_count, int32_t /*max_count*/)
 		{
-			sem_init(&handle, initial_count, max_count);
+			// POSIX semaphores have no maximum count.
+			sem_init(&handle, 0, static_cast<unsigned int>(initial_count));
 		}
 
 		~PosixSemaphore()
@@ -172,6 +172,11 @@ namespace platform
 		Sleep(static_cast<DWORD>(milliseconds));
 	}
 
+	void thread_yield()
+	{
+		SwitchToThread();
+	}
+
 	DWORD thread_id()
 	{
 		return GetCurrentThreadId();
@@ -24,43 +24,205 @@
 // -------------------------------------------------------------
 #include "profiler.h"
 #include "array.h"
-#include "hashset.h"
-#include "stack.h"
+#include "atomic.h"
+#include "mem.h"
+#include "str.h"
 
 #include <platform/platform.h>
 #include <core/logging.h>
 
+#include <string.h> // for strcmp
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h> // for __rdtsc
+	#define GEMINI_PROFILER_USE_TSC 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <x86intrin.h> // for __rdtsc
+	#define GEMINI_PROFILER_USE_TSC 1
+#endif
+
 namespace gemini
 {
 #if defined(GEMINI_ENABLE_PROFILER)
 	namespace profiler
 	{
-		typedef HashSet<const char*, ProfileBlock*> ScopeToProfileBlockHashSet;
+		static_assert((MAX_EVENTS_PER_THREAD & (MAX_EVENTS_PER_THREAD - 1)) == 0, "MAX_EVENTS_PER_THREAD must be a power of two.");
+
+		// maximum scope depth tracked by report
+		const uint32_t MAX_REPORT_DEPTH = 64;
+
+		enum ProfileEventType
+		{
+			ProfileEvent_Begin,
+			ProfileEvent_End
+		}; // ProfileEventType
+
+		struct ProfileEvent
+		{
+			const char* name;
+			uint64_t ticks;
+			uint32_t type;
+			uint32_t depth;
+		}; // ProfileEvent
+
+		// A ring of events written only by the owning thread.
+		// Readers copy a range and then discard anything the writer may
+		// have overwritten while they were copying.
+		// Aligned so that threads' write positions are on separate cache lines.
+		struct PLATFORM_ALIGN(64) ThreadBuffer
+		{
+			ProfileEvent* events;
+			const char* name;
+
+			// total events written
+			volatile uint32_t head;
+
+			uint32_t index;
+		}; // ThreadBuffer
 
 		struct ProfilerState
 		{
-			Array<ProfileBlock*> scopes;
-			size_t depth;
-			uint64_t overhead;
-			gemini::stack<ProfileBlock*> profile_stack;
-			ScopeToProfileBlockHashSet blocks;
-			ProfileBlock* current_scope;
+			ThreadBuffer threads[MAX_THREADS];
+			volatile uint32_t total_threads;
 
-			ProfilerState(gemini::Allocator& allocator)
-				: scopes(allocator)
-				, depth(0)
-				, overhead(0)
-				//, profile_stack(allocator)
-				, blocks(allocator)
-				, current_scope(nullptr)
-			{
-			}
-		}; // ProfilerState
+			// start ticks for the most recent frames; indexed by frame % MAX_FRAMES
+			uint64_t frame_ticks[MAX_FRAMES];
+			uint32_t total_frames;
+
+			// events before this are ignored
+			uint64_t reset_ticks;
 
+			// used to convert ticks to microseconds for traces
+			uint64_t start_ticks;
+			uint64_t start_microseconds;
+
+			bool pending_capture;
+
+			ProfileEvent* event_memory;
+		}; // ProfilerState
 
 		gemini::Allocator* _allocator = nullptr;
 		ProfilerState* _state = nullptr;
 
+		// used by threads that registered after all slots were taken;
+		// events is null so nothing is recorded.
+		ThreadBuffer _overflow_buffer;
+
+		PLATFORM_THREAD_LOCAL ThreadBuffer* tls_buffer = nullptr;
+
+		namespace detail
+		{
+			volatile bool capture_enabled = false;
+			PLATFORM_THREAD_LOCAL uint32_t scope_depth = 0;
+		} // namespace detail
+
+		// Scopes are often shorter than a microsecond; time them with the
+		// time stamp counter where the compiler exposes it.
+		inline uint64_t profiler_ticks()
+		{
+#if defined(GEMINI_PROFILER_USE_TSC)
+			return __rdtsc();
+#else
+			return platform::time_ticks();
+#endif
+		} // profiler_ticks
+
+		ThreadBuffer* register_thread()
+		{
+			const uint32_t index = atom_increment32(&_state->total_threads) - 1;
+			if (index >= MAX_THREADS)
+			{
+				LOGW("Profiler supports %u threads; scopes on this thread will be ignored.\n", MAX_THREADS);
+				return &_overflow_buffer;
+			}
+
+			return &_state->threads[index];
+		} // register_thread
+
+		inline ThreadBuffer* thread_buffer()
+		{
+			if (!tls_buffer)
+			{
+				tls_buffer = register_thread();
+			}
+			return tls_buffer;
+		} // thread_buffer
+
+		inline void record_event(ThreadBuffer* buffer, const char* name, uint32_t type)
+		{
+			const uint32_t head = buffer->head;
+			ProfileEvent& event = buffer->events[head & (MAX_EVENTS_PER_THREAD - 1)];
+			event.name = name;
+			event.ticks = profiler_ticks();
+			event.type = type;
+			event.depth = detail::scope_depth;
+
+			// publish the event before advancing the head
+			PLATFORM_MEMORY_FENCE();
+			buffer->head = head + 1;
+		} // record_event
+
+		uint64_t retained_start_ticks()
+		{
+			uint64_t start_ticks = _state->reset_ticks;
+			if (_state->total_frames > 0)
+			{
+				const uint32_t oldest_frame = (_state->total_frames > MAX_FRAMES) ? (_state->total_frames - MAX_FRAMES) : 0;
+				const uint64_t frame_start = _state->frame_ticks[oldest_frame % MAX_FRAMES];
+				if (frame_start > start_ticks)
+				{
+					start_ticks = frame_start;
+				}
+			}
+			return start_ticks;
+		} // retained_start_ticks
+
+		// Copy the events from a thread that are newer than start_ticks.
+		void copy_thread_events(ThreadBuffer* buffer, uint64_t start_ticks, Array<ProfileEvent>& output)
+		{
+			output.clear(false);
+
+			const uint32_t head = buffer->head;
+			PLATFORM_MEMORY_FENCE();
+
+			const uint32_t available = (head < MAX_EVENTS_PER_THREAD) ? head : MAX_EVENTS_PER_THREAD;
+			const uint32_t first = head - available;
+
+			output.resize(available);
+			for (uint32_t index = 0; index < available; ++index)
+			{
+				output[index] = buffer->events[(first + index) & (MAX_EVENTS_PER_THREAD - 1)];
+			}
+
+			// Anything the writer could have lapped while we copied is invalid.
+			PLATFORM_MEMORY_FENCE();
+			const uint32_t head_after = buffer->head;
+			// When the ring is full, the oldest slot is also the next one
+			// the writer fills; it may have been half written during the copy.
+			uint32_t overwritten = head_after - head;
+			if (available == MAX_EVENTS_PER_THREAD)
+			{
+				++overwritten;
+			}
+			uint32_t skip = (overwritten < available) ? overwritten : available;
+
+			// skip events from before the retained window
+			while (skip < available && output[skip].ticks < start_ticks)
+			{
+				++skip;
+			}
+
+			if (skip > 0)
+			{
+				const uint32_t remaining = available - skip;
+				if (remaining > 0)
+				{
+					memmove(&output[0], &output[skip], sizeof(ProfileEvent) * remaining);
+				}
+				output.resize(remaining);
+			}
+		} // copy_thread_events
+
 		void default_profile_output(const char* name, uint64_t cycles, uint32_t depth, uint32_t hitcount, float parent_weight)
 		{
 			size_t indents = 0;
@@ -73,108 +235,273 @@ namespace gemini
 			LOGV(" %s, cycles: %llu, hits: %i, pct: %2.3f cycles/hit: %2.2f\n", name, cycles, hitcount, parent_weight * 100.0, cycles / (float)hitcount);
 		}
 
-		ProfileBlock* find_or_create_block(const char* name)
+		uint32_t find_or_create_block(Array<ProfileBlock>& blocks, const char* name, uint32_t parent_index, uint32_t depth)
 		{
-			if (_state->blocks.has_key(name))
-				return _state->blocks.get(name);
+			// Identical names may have different pointers across
+			// compilation units; compare the strings as well.
+			for (size_t index = 0; index < blocks.size(); ++index)
+			{
+				const ProfileBlock& block = blocks[index];
+				const bool same_parent = (depth == 0) || (block.parent_index == parent_index);
+				if (same_parent && block.depth == depth && (block.name == name || strcmp(block.name, name) == 0))
+				{
+					return static_cast<uint32_t>(index);
+				}
+			}
 
-			ProfileBlock* block = new ProfileBlock();
-			block->index = static_cast<uint32_t>(_state->scopes.size());
-			_state->scopes.push_back(block);
-			_state->blocks[name] = block;
-			return block;
-		}
+			ProfileBlock block;
+			block.index = static_cast<uint32_t>(blocks.size());
+			block.parent_index = (depth == 0) ? block.index : parent_index;
+			block.hitcount = 0;
+			block.depth = depth;
+			block.cycles = 0;
+			block.name = name;
+			blocks.push_back(block);
+			return block.index;
+		} // find_or_create_block
 
 		void begin_scope(const char* name, const char* /*fancy_name*/)
 		{
-			ProfileBlock* block = find_or_create_block(name);
-			block->parent_index = _state->current_scope ? _state->current_scope->index : block->index;
-			block->cycles -= platform::time_ticks();
-			block->name = name;
-			block->depth = static_cast<uint32_t>(_state->depth++);
-			block->hitcount++;
-			_state->profile_stack.push(block);
-			_state->current_scope = block;
+			ThreadBuffer* buffer = thread_buffer();
+			if (buffer->events)
+			{
+				record_event(buffer, name, ProfileEvent_Begin);
+				++detail::scope_depth;
+			}
 		}
 
-		void end_scope(const char* /*name*/, const char* /*fancy_name*/)
+		void end_scope(const char* name, const char* /*fancy_name*/)
 		{
-			ProfileBlock* scope = _state->profile_stack.top();
-			scope->cycles += platform::time_ticks() - _state->overhead;
+			// ignore scopes that began before capture was enabled
+			if (detail::scope_depth > 0)
+			{
+				--detail::scope_depth;
+				record_event(thread_buffer(), name, ProfileEvent_End);
+			}
+		}
 
-			--_state->depth;
+		void thread_name(const char* name)
+		{
+			thread_buffer()->name = name;
+		}
+
+		void next_frame()
+		{
+			_state->frame_ticks[_state->total_frames % MAX_FRAMES] = profiler_ticks();
+			++_state->total_frames;
 
-			// restore the last scope
-			_state->profile_stack.pop();
-			if (_state->profile_stack.empty())
+			detail::capture_enabled = _state->pending_capture;
+		}
+
+		void set_capture(bool enabled)
+		{
+			_state->pending_capture = enabled;
+		}
+
+		void report(profile_callback callback)
+		{
+			if (!callback)
 			{
-				_state->current_scope = nullptr;
+				callback = &default_profile_output;
 			}
-			else
+
+			const uint64_t start_ticks = retained_start_ticks();
+			const uint32_t total_threads = (_state->total_threads < MAX_THREADS) ? _state->total_threads : MAX_THREADS;
+
+			Array<ProfileEvent> events(*_allocator);
+			Array<ProfileBlock> blocks(*_allocator);
+			for (uint32_t thread_index = 0; thread_index < total_threads; ++thread_index)
 			{
-				_state->current_scope = _state->profile_stack.top();
+				ThreadBuffer* buffer = &_state->threads[thread_index];
+				copy_thread_events(buffer, start_ticks, events);
+				if (events.empty())
+				{
+					continue;
+				}
+
+				blocks.clear(false);
+
+				uint32_t stack[MAX_REPORT_DEPTH];
+				uint64_t begin_ticks[MAX_REPORT_DEPTH];
+				uint32_t depth = 0;
+				for (size_t index = 0; index < events.size(); ++index)
+				{
+					const ProfileEvent& event = events[index];
+					if (event.type == ProfileEvent_Begin)
+					{
+						if (depth < MAX_REPORT_DEPTH)
+						{
+							const uint32_t parent_index = (depth > 0) ? stack[depth - 1] : 0;
+							stack[depth] = find_or_create_block(blocks, event.name, parent_index, depth);
+							begin_ticks[depth] = event.ticks;
+						}
+						++depth;
+					}
+					else if (depth > 0)
+					{
+						// ends without a matching begin in the window are skipped
+						--depth;
+						if (depth < MAX_REPORT_DEPTH)
+						{
+							ProfileBlock& block = blocks[stack[depth]];
+							block.cycles += event.ticks - begin_ticks[depth];
+							block.hitcount++;
+						}
+					}
+				}
+
+				LOGV("thread: %s (%u)\n", buffer->name ? buffer->name : "unnamed", thread_index);
+				for (const ProfileBlock& block : blocks)
+				{
+					if (block.hitcount == 0)
+					{
+						continue;
+					}
+
+					const ProfileBlock& parent = blocks[block.parent_index];
+					const float parent_weight = (parent.cycles > 0) ? (block.cycles / float(parent.cycles)) : 1.0f;
+					callback(block.name, block.cycles, block.depth, block.hitcount, parent_weight);
+				}
 			}
 		}
 
-		void report(profile_callback callback)
+		void write_escaped(platform::File handle, const char* text)
 		{
-			if (!callback)
+			char buffer[256];
+			size_t length = 0;
+			for (const char* character = text; *character && length < (sizeof(buffer) - 2); ++character)
 			{
-				callback = &default_profile_output;
+				if (*character == '"' || *character == '\\')
+				{
+					buffer[length++] = '\\';
+				}
+				buffer[length++] = *character;
+			}
+			platform::fs_write(handle, buffer, 1, length);
+		} // write_escaped
+
+		bool write_trace(const char* path)
+		{
+			platform::File handle = platform::fs_open(path, platform::FileMode_Write);
+			if (!handle.is_open())
+			{
+				LOGW("Unable to open \"%s\" for writing.\n", path);
+				return false;
+			}
+
+			// calibrate ticks against microseconds over the life of the profiler
+			const uint64_t elapsed_ticks = profiler_ticks() - _state->start_ticks;
+			const uint64_t elapsed_microseconds = platform::microseconds() - _state->start_microseconds;
+			const double microseconds_per_tick = (elapsed_ticks > 0 && elapsed_microseconds > 0) ? (elapsed_microseconds / static_cast<double>(elapsed_ticks)) : 1.0;
+
+			const uint64_t start_ticks = retained_start_ticks();
+
+			char line[128];
+			int length = 0;
+			const char* header = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+			platform::fs_write(handle, header, 1, core::str::len(header));
+
+			// frames are drawn on their own track
+			length = core::str::sprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"frames\"}}");
+			platform::fs_write(handle, line, 1, static_cast<size_t>(length));
+
+			const uint32_t total_frames = _state->total_frames;
+			const uint32_t oldest_frame = (total_frames > MAX_FRAMES) ? (total_frames - MAX_FRAMES) : 0;
+			for (uint32_t frame = oldest_frame; frame + 1 < total_frames; ++frame)
+			{
+				const uint64_t frame_start = _state->frame_ticks[frame % MAX_FRAMES];
+				const uint64_t frame_end = _state->frame_ticks[(frame + 1) % MAX_FRAMES];
+				if (frame_start < start_ticks)
+				{
+					continue;
+				}
+
+				length = core::str::sprintf(line, sizeof(line), ",\n{\"name\":\"frame %u\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+					frame,
+					(frame_start - _state->start_ticks) * microseconds_per_tick,
+					(frame_end - frame_start) * microseconds_per_tick);
+				platform::fs_write(handle, line, 1, static_cast<size_t>(length));
 			}
 
-			for (ProfileBlock* scope : _state->scopes)
+			const uint32_t total_threads = (_state->total_threads < MAX_THREADS) ? _state->total_threads : MAX_THREADS;
+			Array<ProfileEvent> events(*_allocator);
+			for (uint32_t thread_index = 0; thread_index < total_threads; ++thread_index)
 			{
-				const ProfileBlock* parent = _state->scopes[scope->parent_index];
-				const float parent_weight = scope->cycles / float(parent->cycles);
-				callback(scope->name, scope->cycles, scope->depth, scope->hitcount, parent_weight);
+				ThreadBuffer* buffer = &_state->threads[thread_index];
+				const uint32_t tid = thread_index + 1;
+
+				length = core::str::sprintf(line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"", tid);
+				platform::fs_write(handle, line, 1, static_cast<size_t>(length));
+				if (buffer->name)
+				{
+					write_escaped(handle, buffer->name);
+				}
+				else
+				{
+					length = core::str::sprintf(line, sizeof(line), "thread %u", thread_index);
+					platform::fs_write(handle, line, 1, static_cast<size_t>(length));
+				}
+				platform::fs_write(handle, "\"}}", 1, 3);
+
+				copy_thread_events(buffer, start_ticks, events);
+				for (const ProfileEvent& event : events)
+				{
+					platform::fs_write(handle, ",\n{\"name\":\"", 1, 11);
+					write_escaped(handle, event.name);
+					length = core::str::sprintf(line, sizeof(line), "\",\"ph\":\"%c\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}",
+						(event.type == ProfileEvent_Begin) ? 'B' : 'E',
+						tid,
+						(event.ticks - _state->start_ticks) * microseconds_per_tick);
+					platform::fs_write(handle, line, 1, static_cast<size_t>(length));
+				}
 			}
+
+			platform::fs_write(handle, "\n]}\n", 1, 4);
+			platform::fs_close(handle);
+			return true;
 		}
 
 		void reset()
 		{
-			_state->depth = 0;
-			_state->profile_stack.clear(false);
-			_state->current_scope = nullptr;
-			_state->scopes.clear(false);
-			_state->blocks.clear(/*false*/);
+			_state->reset_ticks = profiler_ticks();
+			_state->total_frames = 0;
 		}
 
 		void startup(gemini::Allocator& allocator)
 		{
 			_allocator = &allocator;
 
-			_state = MEMORY2_NEW(allocator, ProfilerState)(allocator);
+			_state = MEMORY2_NEW(allocator, ProfilerState);
+			memset(_state, 0, sizeof(ProfilerState));
 
-			// calculate an average overhead for ticks
-			uint64_t sum = 0;
-			for (uint64_t count = 0; count < 11; ++count)
+			// All thread buffers are allocated up front: threads register
+			// from anywhere and the allocator isn't safe to use concurrently.
+			const size_t event_memory_size = sizeof(ProfileEvent) * MAX_EVENTS_PER_THREAD * MAX_THREADS;
+			_state->event_memory = static_cast<ProfileEvent*>(MEMORY2_ALLOC(allocator, event_memory_size));
+			for (uint32_t index = 0; index < MAX_THREADS; ++index)
 			{
-				uint64_t a, b;
-				a = platform::time_ticks();
-				b = platform::time_ticks();
-				sum += (b-a);
+				_state->threads[index].events = _state->event_memory + (index * MAX_EVENTS_PER_THREAD);
+				_state->threads[index].index = index;
 			}
 
-			// multiply by two since we call ticks TWICE for a scope
-			// and this will allow us to simply subtract overhead.
-			_state->overhead = (sum / 11) * 2;
+			memset(&_overflow_buffer, 0, sizeof(ThreadBuffer));
+
+			_state->start_ticks = profiler_ticks();
+			_state->start_microseconds = platform::microseconds();
+			_state->reset_ticks = _state->start_ticks;
 		}
 
 		void shutdown()
 		{
-			for (ProfileBlock* block : _state->scopes)
-			{
-				delete block;
-			}
-			_state->scopes.clear();
-			_state->profile_stack.clear();
-			_state->blocks.clear();
+			detail::capture_enabled = false;
 
+			MEMORY2_DEALLOC(*_allocator, _state->event_memory);
 			MEMORY2_DELETE(*_allocator, _state);
+			_state = nullptr;
 		}
 
 		static_assert(sizeof(profiler::ProfileBlock) == 32, "ProfileBlock is not aligned on cache line.");
+		static_assert(sizeof(ThreadBuffer) == 64, "ThreadBuffer should occupy one cache line.");
 	} // namespace profiler
 #endif
-} // namespace gemini
\ No newline at end of file
+} // namespace gemini
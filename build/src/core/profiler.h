@@ -26,23 +26,34 @@
 
 #include <core/typedefs.h>
 
-// KNOWN ISSUES:
-// The profiler can be confused if you use identical string names
-// for different blocks. This is because (I'm guessing) the string pointers
-// will be identical in the text segment of the binary -- even though they are
-// referenced from different compilation units. I should verify this.
-
 // enable this to allow profiling
 //#define GEMINI_ENABLE_PROFILER
 
 namespace gemini
 {
 #if defined(GEMINI_ENABLE_PROFILER)
-	#define PROFILE_BEGIN(x) ::gemini::profiler::begin_scope(x, PLATFORM_FANCY_FUNCTION)
-	#define PROFILE_END(x) ::gemini::profiler::end_scope(x, PLATFORM_FANCY_FUNCTION)
+	// Scopes are cheap to leave in place: while capture is disabled each
+	// PROFILE_BEGIN/PROFILE_END costs a couple of loads and a branch.
+	// Scopes nested inside a recorded scope are always recorded, so a
+	// thread's begin and end events stay balanced when capture is toggled.
+	#define PROFILE_BEGIN(x) do { if (::gemini::profiler::detail::capture_enabled || ::gemini::profiler::detail::scope_depth > 0) { ::gemini::profiler::begin_scope(x, PLATFORM_FANCY_FUNCTION); } } while (0)
+	#define PROFILE_END(x) do { if (::gemini::profiler::detail::scope_depth > 0) { ::gemini::profiler::end_scope(x, PLATFORM_FANCY_FUNCTION); } } while (0)
+	#define PROFILE_THREAD_NAME(x) ::gemini::profiler::thread_name(x)
+	#define PROFILE_FRAME() ::gemini::profiler::next_frame()
 
 	namespace profiler
 	{
+		// Each thread which records scopes is assigned one of these slots
+		// the first time it uses the profiler.
+		const uint32_t MAX_THREADS = 16;
+
+		// Per-thread event ring; each scope uses two events.
+		// This must be a power of two.
+		const uint32_t MAX_EVENTS_PER_THREAD = 16384;
+
+		// number of most recent frames retained for report and write_trace
+		const uint32_t MAX_FRAMES = 32;
+
 		struct ProfileBlock
 		{
 			uint32_t parent_index;
@@ -55,9 +66,41 @@ namespace gemini
 
 		typedef void (*profile_callback)(const char* name, uint64_t cycles, uint32_t depth, uint32_t hitcount, float parent_weight);
 
+		namespace detail
+		{
+			// latched by next_frame
+			extern volatile bool capture_enabled;
+
+			// recorded scopes still open on the calling thread
+			extern PLATFORM_THREAD_LOCAL uint32_t scope_depth;
+		} // namespace detail
+
+		// Scopes are recorded into a buffer owned by the calling thread;
+		// these can be called from any thread without locking.
+		// name must remain valid until shutdown (use string literals).
 		void begin_scope(const char* name, const char* fancy_name);
 		void end_scope(const char* name, const char* caller_name);
+
+		// Set the name of the calling thread used by report and write_trace.
+		void thread_name(const char* name);
+
+		// Marks the start of a new frame. Call once per frame from the main thread.
+		void next_frame();
+
+		// Enable or disable capture. This takes effect on the next frame;
+		// capture is disabled after startup.
+		void set_capture(bool enabled);
+
+		// Aggregate the retained frames into a hierarchy of blocks per thread.
+		// cycles are in profiler ticks: the CPU time stamp counter where
+		// available, otherwise platform::time_ticks.
 		void report(profile_callback callback = nullptr);
+
+		// Write the retained frames as Chrome trace_event JSON.
+		// Open the output with chrome://tracing or ui.perfetto.dev
+		bool write_trace(const char* path);
+
+		// Discard all retained frames and events.
 		void reset();
 		void startup(gemini::Allocator& allocator);
 		void shutdown();
@@ -66,5 +109,7 @@ namespace gemini
 #else
 	#define PROFILE_BEGIN(x)
 	#define PROFILE_END(x)
+	#define PROFILE_THREAD_NAME(x)
+	#define PROFILE_FRAME()
 #endif
-} // namespace gemini
\ No newline at end of file
+} // namespace gemini
@@ -23,22 +23,167 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // -------------------------------------------------------------
 #include <core/typedefs.h>
+#include <core/util.h>
+
+#include <runtime/job_scheduler.h>
 
 #include "particlesystem.h"
 
+#include <string.h> // for memset, memcpy
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GEMINI_PARTICLES_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define GEMINI_PARTICLES_NEON 1
+#endif
+
 namespace gemini
 {
+	namespace
+	{
+		const uint32_t PARTICLE_FLOAT_STREAMS = 9;
+		const uint32_t PARTICLE_STREAM_ALIGNMENT = 16;
+
+		// random values are built from the top 24 bits of each state
+		const float RANDOM_SCALE = (1.0f / 16777216.0f);
+
+		// life is clamped to this so inverse_life stays finite
+		const float PARTICLE_MIN_LIFE = 0.001f;
+
+#if !defined(GEMINI_PARTICLES_SSE) && !defined(GEMINI_PARTICLES_NEON)
+		uint32_t random_next(uint32_t& state)
+		{
+			state ^= (state << 13);
+			state ^= (state >> 17);
+			state ^= (state << 5);
+			return state;
+		} // random_next
+
+		float random_unit(uint32_t& state)
+		{
+			return static_cast<float>(random_next(state) >> 8) * RANDOM_SCALE;
+		} // random_unit
+#endif
+
+		// Interpolation constants derived from the emitter config;
+		// colors are pre-scaled to [0, 255].
+		struct ParticleCurves
+		{
+			float color_start[4];
+			float color_delta[4];
+			float size_start;
+			float size_delta;
+		};
+
+		void curves_from_config(ParticleCurves& curves, const EmitterConfig& config)
+		{
+			const float start[4] = { config.color_start.red, config.color_start.green, config.color_start.blue, config.color_start.alpha };
+			const float end[4] = { config.color_end.red, config.color_end.green, config.color_end.blue, config.color_end.alpha };
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				const float first = glm::clamp(start[channel], 0.0f, 1.0f) * 255.0f;
+				const float last = glm::clamp(end[channel], 0.0f, 1.0f) * 255.0f;
+				curves.color_start[channel] = first;
+				curves.color_delta[channel] = (last - first);
+			}
+
+			curves.size_start = config.size_start;
+			curves.size_delta = (config.size_end - config.size_start);
+		} // curves_from_config
+
+		uint32_t pack_color(const float* color)
+		{
+			return static_cast<uint32_t>(color[0])
+				| (static_cast<uint32_t>(color[1]) << 8)
+				| (static_cast<uint32_t>(color[2]) << 16)
+				| (static_cast<uint32_t>(color[3]) << 24);
+		} // pack_color
+
+		void copy_particle(ParticleStreams& streams, uint32_t destination, uint32_t source)
+		{
+			streams.position_x[destination] = streams.position_x[source];
+			streams.position_y[destination] = streams.position_y[source];
+			streams.position_z[destination] = streams.position_z[source];
+			streams.velocity_x[destination] = streams.velocity_x[source];
+			streams.velocity_y[destination] = streams.velocity_y[source];
+			streams.velocity_z[destination] = streams.velocity_z[source];
+			streams.life_remaining[destination] = streams.life_remaining[source];
+			streams.inverse_life[destination] = streams.inverse_life[source];
+			streams.size[destination] = streams.size[source];
+			streams.color[destination] = streams.color[source];
+		} // copy_particle
+
+		// Returns true if all particles in the group at index are alive.
+		bool group_is_alive(const float* life_remaining, uint32_t index)
+		{
+#if defined(GEMINI_PARTICLES_SSE)
+			const __m128 dead = _mm_cmple_ps(_mm_load_ps(life_remaining + index), _mm_setzero_ps());
+			return (_mm_movemask_ps(dead) == 0);
+#elif defined(GEMINI_PARTICLES_NEON)
+			const uint32x4_t dead = vcleq_f32(vld1q_f32(life_remaining + index), vdupq_n_f32(0.0f));
+			const uint32x2_t either = vorr_u32(vget_low_u32(dead), vget_high_u32(dead));
+			return (vget_lane_u64(vreinterpret_u64_u32(either), 0) == 0);
+#else
+			return (life_remaining[index + 0] > 0.0f)
+				&& (life_remaining[index + 1] > 0.0f)
+				&& (life_remaining[index + 2] > 0.0f)
+				&& (life_remaining[index + 3] > 0.0f);
+#endif
+		} // group_is_alive
+
+		struct ParticleStepJob
+		{
+			ParticleEmitter* emitter;
+			float delta_seconds;
+		};
+
+		struct ParticleVertexJob
+		{
+			ParticleEmitter* emitter;
+			ParticleVertex* vertices;
+			glm::vec3 right;
+			glm::vec3 up;
+		};
+
+		void integrate_groups(void* data, uint32_t start_group, uint32_t end_group)
+		{
+			ParticleStepJob* job = static_cast<ParticleStepJob*>(data);
+			const uint32_t last = glm::min(end_group * PARTICLE_GROUP_SIZE, job->emitter->num_particles_alive);
+			job->emitter->integrate(job->delta_seconds, start_group * PARTICLE_GROUP_SIZE, last);
+		} // integrate_groups
+
+		void maintain_emitter(void* data)
+		{
+			ParticleStepJob* job = static_cast<ParticleStepJob*>(data);
+			job->emitter->compact();
+			job->emitter->spawn(job->delta_seconds);
+		} // maintain_emitter
+
+		void write_vertex_range(void* data, uint32_t start_index, uint32_t end_index)
+		{
+			ParticleVertexJob* job = static_cast<ParticleVertexJob*>(data);
+			ParticleVertex* vertices = job->vertices + (start_index * PARTICLE_VERTICES_PER_PARTICLE);
+			job->emitter->write_vertices(vertices, start_index, end_index, job->right, job->up);
+		} // write_vertex_range
+	} // namespace
+
 	// -------------------------------------------------------------
-	// Particle
+	// EmitterConfig
 	// -------------------------------------------------------------
-	Particle::Particle()
+	EmitterConfig::EmitterConfig()
+		: max_particles(0)
+		, spawn_rate(0)
+		, spawn_delay_seconds(0.0f)
+		, life_min(1.0f)
+		, life_max(1.0f)
+		, velocity_min(0.0f)
+		, velocity_max(0.0f)
+		, size_start(1.0f)
+		, size_end(1.0f)
 	{
-		color.set(255, 255, 255, 255);
-		life_remaining = 0;
-		life_total = 0;
-		size = 1.0f;
-	} // Particle
-
+	} // EmitterConfig
 
 	// -------------------------------------------------------------
 	// ParticleEmitter
@@ -48,8 +193,15 @@ namespace gemini
 	{
 		emitter_config = 0;
 		num_particles_alive = 0;
-		particle_list = 0;
+		memset(&streams, 0, sizeof(ParticleStreams));
 		next_spawn = 0;
+		stream_memory = 0;
+
+		for (uint32_t lane = 0; lane < PARTICLE_GROUP_SIZE; ++lane)
+		{
+			// xorshift requires a non-zero state
+			random_state[lane] = (static_cast<uint32_t>(core::util::random_range(0.0f, 16777215.0f)) * 2654435761u) | 1;
+		}
 	} // ParticleEmitter
 
 	ParticleEmitter::~ParticleEmitter()
@@ -59,87 +211,393 @@ namespace gemini
 
 	void ParticleEmitter::init()
 	{
-		particle_list = MEMORY2_NEW_ARRAY(allocator, Particle, emitter_config->max_particles);
+		// round up to whole groups; plus one group of padding
+		const uint32_t capacity = ((emitter_config->max_particles + PARTICLE_GROUP_SIZE - 1) & ~(PARTICLE_GROUP_SIZE - 1)) + PARTICLE_GROUP_SIZE;
+		const size_t stream_bytes = (capacity * sizeof(float));
+		const size_t total_bytes = (stream_bytes * PARTICLE_FLOAT_STREAMS) + (capacity * sizeof(uint32_t));
+
+		stream_memory = MEMORY2_ALLOC_ALIGNED(allocator, PARTICLE_STREAM_ALIGNMENT, total_bytes);
+		memset(stream_memory, 0, total_bytes);
+
+		float* stream = static_cast<float*>(stream_memory);
+		streams.position_x = stream; stream += capacity;
+		streams.position_y = stream; stream += capacity;
+		streams.position_z = stream; stream += capacity;
+		streams.velocity_x = stream; stream += capacity;
+		streams.velocity_y = stream; stream += capacity;
+		streams.velocity_z = stream; stream += capacity;
+		streams.life_remaining = stream; stream += capacity;
+		streams.inverse_life = stream; stream += capacity;
+		streams.size = stream; stream += capacity;
+		streams.color = reinterpret_cast<uint32_t*>(stream);
+		streams.capacity = capacity;
+
+		// Particles are spawned on the next step: this ensures that the
+		// world position is set properly before they're rendered -- as it
+		// may not be set to the desired value at this point.
+		next_spawn = 0;
+		num_particles_alive = 0;
+	} // init
+
+	void ParticleEmitter::step(float delta_seconds)
+	{
+		if (!emitter_config)
+		{
+			return;
+		}
 
-		this->next_spawn = 0;
-		this->num_particles_alive = this->emitter_config->max_particles;
+		integrate(delta_seconds, 0, num_particles_alive);
+		compact();
+		spawn(delta_seconds);
+	} // step
 
-		Particle * p = 0;
-		for(int i = 0; i < this->emitter_config->max_particles; ++i)
+	void ParticleEmitter::integrate(float delta_seconds, uint32_t first, uint32_t last)
+	{
+		ParticleCurves curves;
+		curves_from_config(curves, *emitter_config);
+
+		float* position_x = streams.position_x;
+		float* position_y = streams.position_y;
+		float* position_z = streams.position_z;
+		const float* velocity_x = streams.velocity_x;
+		const float* velocity_y = streams.velocity_y;
+		const float* velocity_z = streams.velocity_z;
+		float* life_remaining = streams.life_remaining;
+		const float* inverse_life = streams.inverse_life;
+		float* size = streams.size;
+		uint32_t* color = streams.color;
+
+#if defined(GEMINI_PARTICLES_SSE)
+		// the stream padding allows integrating whole groups
+		const __m128 delta = _mm_set1_ps(delta_seconds);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 size_start = _mm_set1_ps(curves.size_start);
+		const __m128 size_delta = _mm_set1_ps(curves.size_delta);
+		const __m128 red_start = _mm_set1_ps(curves.color_start[0]);
+		const __m128 red_delta = _mm_set1_ps(curves.color_delta[0]);
+		const __m128 green_start = _mm_set1_ps(curves.color_start[1]);
+		const __m128 green_delta = _mm_set1_ps(curves.color_delta[1]);
+		const __m128 blue_start = _mm_set1_ps(curves.color_start[2]);
+		const __m128 blue_delta = _mm_set1_ps(curves.color_delta[2]);
+		const __m128 alpha_start = _mm_set1_ps(curves.color_start[3]);
+		const __m128 alpha_delta = _mm_set1_ps(curves.color_delta[3]);
+
+		for (uint32_t index = first; index < last; index += PARTICLE_GROUP_SIZE)
 		{
-			p = &particle_list[i];
-			generate_particle( p );
-			// force the particles to spawn next step: this is mainly done
-			// to ensure that the world position is set properly before they're
-			// rendered -- as it may not be set to the desired value at this point.
-			p->life_total = p->life_remaining = 0;
+			const __m128 life = _mm_sub_ps(_mm_load_ps(life_remaining + index), delta);
+			_mm_store_ps(life_remaining + index, life);
+
+			_mm_store_ps(position_x + index, _mm_add_ps(_mm_load_ps(position_x + index), _mm_mul_ps(_mm_load_ps(velocity_x + index), delta)));
+			_mm_store_ps(position_y + index, _mm_add_ps(_mm_load_ps(position_y + index), _mm_mul_ps(_mm_load_ps(velocity_y + index), delta)));
+			_mm_store_ps(position_z + index, _mm_add_ps(_mm_load_ps(position_z + index), _mm_mul_ps(_mm_load_ps(velocity_z + index), delta)));
+
+			// fraction of life elapsed
+			__m128 t = _mm_sub_ps(one, _mm_mul_ps(life, _mm_load_ps(inverse_life + index)));
+			t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+			_mm_store_ps(size + index, _mm_add_ps(size_start, _mm_mul_ps(size_delta, t)));
+
+			const __m128i red = _mm_cvttps_epi32(_mm_add_ps(red_start, _mm_mul_ps(red_delta, t)));
+			const __m128i green = _mm_cvttps_epi32(_mm_add_ps(green_start, _mm_mul_ps(green_delta, t)));
+			const __m128i blue = _mm_cvttps_epi32(_mm_add_ps(blue_start, _mm_mul_ps(blue_delta, t)));
+			const __m128i alpha = _mm_cvttps_epi32(_mm_add_ps(alpha_start, _mm_mul_ps(alpha_delta, t)));
+			const __m128i packed = _mm_or_si128(
+				_mm_or_si128(red, _mm_slli_epi32(green, 8)),
+				_mm_or_si128(_mm_slli_epi32(blue, 16), _mm_slli_epi32(alpha, 24)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(color + index), packed);
 		}
-	} // init
+#elif defined(GEMINI_PARTICLES_NEON)
+		const float32x4_t delta = vdupq_n_f32(delta_seconds);
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t size_start = vdupq_n_f32(curves.size_start);
+		const float32x4_t size_delta = vdupq_n_f32(curves.size_delta);
+		const float32x4_t red_start = vdupq_n_f32(curves.color_start[0]);
+		const float32x4_t red_delta = vdupq_n_f32(curves.color_delta[0]);
+		const float32x4_t green_start = vdupq_n_f32(curves.color_start[1]);
+		const float32x4_t green_delta = vdupq_n_f32(curves.color_delta[1]);
+		const float32x4_t blue_start = vdupq_n_f32(curves.color_start[2]);
+		const float32x4_t blue_delta = vdupq_n_f32(curves.color_delta[2]);
+		const float32x4_t alpha_start = vdupq_n_f32(curves.color_start[3]);
+		const float32x4_t alpha_delta = vdupq_n_f32(curves.color_delta[3]);
+
+		for (uint32_t index = first; index < last; index += PARTICLE_GROUP_SIZE)
+		{
+			const float32x4_t life = vsubq_f32(vld1q_f32(life_remaining + index), delta);
+			vst1q_f32(life_remaining + index, life);
+
+			vst1q_f32(position_x + index, vmlaq_f32(vld1q_f32(position_x + index), vld1q_f32(velocity_x + index), delta));
+			vst1q_f32(position_y + index, vmlaq_f32(vld1q_f32(position_y + index), vld1q_f32(velocity_y + index), delta));
+			vst1q_f32(position_z + index, vmlaq_f32(vld1q_f32(position_z + index), vld1q_f32(velocity_z + index), delta));
+
+			// fraction of life elapsed
+			float32x4_t t = vmlsq_f32(one, life, vld1q_f32(inverse_life + index));
+			t = vminq_f32(vmaxq_f32(t, zero), one);
+
+			vst1q_f32(size + index, vmlaq_f32(size_start, size_delta, t));
+
+			const uint32x4_t red = vcvtq_u32_f32(vmlaq_f32(red_start, red_delta, t));
+			const uint32x4_t green = vcvtq_u32_f32(vmlaq_f32(green_start, green_delta, t));
+			const uint32x4_t blue = vcvtq_u32_f32(vmlaq_f32(blue_start, blue_delta, t));
+			const uint32x4_t alpha = vcvtq_u32_f32(vmlaq_f32(alpha_start, alpha_delta, t));
+			const uint32x4_t packed = vorrq_u32(
+				vorrq_u32(red, vshlq_n_u32(green, 8)),
+				vorrq_u32(vshlq_n_u32(blue, 16), vshlq_n_u32(alpha, 24)));
+			vst1q_u32(color + index, packed);
+		}
+#else
+		for (uint32_t index = first; index < last; ++index)
+		{
+			life_remaining[index] -= delta_seconds;
 
+			position_x[index] += velocity_x[index] * delta_seconds;
+			position_y[index] += velocity_y[index] * delta_seconds;
+			position_z[index] += velocity_z[index] * delta_seconds;
 
-	void ParticleEmitter::step(float delta_seconds)
+			// fraction of life elapsed
+			const float t = glm::clamp(1.0f - (life_remaining[index] * inverse_life[index]), 0.0f, 1.0f);
+
+			size[index] = curves.size_start + (curves.size_delta * t);
+
+			float value[4];
+			for (uint32_t channel = 0; channel < 4; ++channel)
+			{
+				value[channel] = curves.color_start[channel] + (curves.color_delta[channel] * t);
+			}
+			color[index] = pack_color(value);
+		}
+#endif
+	} // integrate
+
+	void ParticleEmitter::compact()
 	{
-		unsigned int pid = 0;
-		Particle * p = 0;
+		uint32_t alive = num_particles_alive;
+		uint32_t index = 0;
+		while (index < alive)
+		{
+			// skip whole groups of live particles
+			if (((index % PARTICLE_GROUP_SIZE) == 0) && ((index + PARTICLE_GROUP_SIZE) <= alive) && group_is_alive(streams.life_remaining, index))
+			{
+				index += PARTICLE_GROUP_SIZE;
+				continue;
+			}
+
+			if (streams.life_remaining[index] <= 0.0f)
+			{
+				// fill the hole with the last live particle and check it next
+				--alive;
+				copy_particle(streams, index, alive);
+			}
+			else
+			{
+				++index;
+			}
+		}
 
-		float delta_msec = (delta_seconds * MillisecondsPerSecond);
+		num_particles_alive = alive;
+	} // compact
 
+	void ParticleEmitter::spawn(float delta_seconds)
+	{
 		if (!emitter_config)
 		{
 			return;
 		}
 
-		world_position.step(delta_seconds);
-
-		this->next_spawn -= delta_msec;
-		uint32_t particles_to_spawn = 0;
-		if (this->next_spawn <= 0)
+		next_spawn -= delta_seconds;
+		if (next_spawn > 0.0f)
 		{
-			this->next_spawn = this->emitter_config->spawn_delay_seconds;
-			particles_to_spawn = this->emitter_config->spawn_rate;
-			uint32_t eff = (this->emitter_config->max_particles-num_particles_alive);
-			if (particles_to_spawn > eff )
-			{
-				particles_to_spawn = (this->emitter_config->max_particles-num_particles_alive);
-	//			LOGV( "particle_to_spawn: %i\n", particles_to_spawn );
-			}
+			return;
 		}
 
-		num_particles_alive = 0;
-		for(pid = 0; pid < this->emitter_config->max_particles; ++pid)
+		next_spawn = emitter_config->spawn_delay_seconds;
+
+		const uint32_t available = (emitter_config->max_particles - num_particles_alive);
+		const uint32_t particles_to_spawn = glm::min(emitter_config->spawn_rate, available);
+		if (particles_to_spawn > 0)
 		{
-			p = &particle_list[pid];
-			p->life_remaining -= delta_msec;
+			generate_particles(num_particles_alive, num_particles_alive + particles_to_spawn);
+			num_particles_alive += particles_to_spawn;
+		}
+	} // spawn
 
-			if (p->life_remaining > 0.1)
+	void ParticleEmitter::generate_particles(uint32_t first, uint32_t last)
+	{
+		const EmitterConfig& config = *emitter_config;
+
+		ParticleCurves curves;
+		curves_from_config(curves, config);
+		const uint32_t start_color = pack_color(curves.color_start);
+
+		const float life_min = glm::max(config.life_min, PARTICLE_MIN_LIFE);
+		const float life_range = glm::max(config.life_max, life_min) - life_min;
+		const glm::vec3 velocity_range = (config.velocity_max - config.velocity_min);
+
+#if defined(GEMINI_PARTICLES_SSE)
+		// first may be any index; the stream padding allows writing
+		// whole groups past last
+		__m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(random_state));
+		const __m128 scale = _mm_set1_ps(RANDOM_SCALE);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 position_x = _mm_set1_ps(world_position.x);
+		const __m128 position_y = _mm_set1_ps(world_position.y);
+		const __m128 position_z = _mm_set1_ps(world_position.z);
+		const __m128 size = _mm_set1_ps(curves.size_start);
+		const __m128i color = _mm_set1_epi32(static_cast<int>(start_color));
+
+		const __m128 minimum[4] = {
+			_mm_set1_ps(config.velocity_min.x),
+			_mm_set1_ps(config.velocity_min.y),
+			_mm_set1_ps(config.velocity_min.z),
+			_mm_set1_ps(life_min)
+		};
+		const __m128 range[4] = {
+			_mm_set1_ps(velocity_range.x),
+			_mm_set1_ps(velocity_range.y),
+			_mm_set1_ps(velocity_range.z),
+			_mm_set1_ps(life_range)
+		};
+
+		for (uint32_t index = first; index < last; index += PARTICLE_GROUP_SIZE)
+		{
+			__m128 value[4];
+			for (uint32_t component = 0; component < 4; ++component)
 			{
-				float lifet = 1.0 - (p->life_remaining / p->life_total);
-				p->position.step(delta_seconds);
-				p->position.current += (p->velocity * delta_seconds);
-				p->color = this->emitter_config->color_channel.get_value(lifet);
-				p->color.alpha = this->emitter_config->alpha_channel.get_value(lifet);
-				p->size = this->emitter_config->size_channel.get_value(lifet);
-				++num_particles_alive;
+				state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+				state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+				state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+				const __m128 unit = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), scale);
+				value[component] = _mm_add_ps(minimum[component], _mm_mul_ps(range[component], unit));
 			}
-			else if (particles_to_spawn > 0)
+
+			_mm_storeu_ps(streams.position_x + index, position_x);
+			_mm_storeu_ps(streams.position_y + index, position_y);
+			_mm_storeu_ps(streams.position_z + index, position_z);
+			_mm_storeu_ps(streams.velocity_x + index, value[0]);
+			_mm_storeu_ps(streams.velocity_y + index, value[1]);
+			_mm_storeu_ps(streams.velocity_z + index, value[2]);
+			_mm_storeu_ps(streams.life_remaining + index, value[3]);
+			_mm_storeu_ps(streams.inverse_life + index, _mm_div_ps(one, value[3]));
+			_mm_storeu_ps(streams.size + index, size);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(streams.color + index), color);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(random_state), state);
+#elif defined(GEMINI_PARTICLES_NEON)
+		uint32x4_t state = vld1q_u32(random_state);
+		const float32x4_t scale = vdupq_n_f32(RANDOM_SCALE);
+		const float32x4_t position_x = vdupq_n_f32(world_position.x);
+		const float32x4_t position_y = vdupq_n_f32(world_position.y);
+		const float32x4_t position_z = vdupq_n_f32(world_position.z);
+		const float32x4_t size = vdupq_n_f32(curves.size_start);
+		const uint32x4_t color = vdupq_n_u32(start_color);
+
+		const float minimum[4] = { config.velocity_min.x, config.velocity_min.y, config.velocity_min.z, life_min };
+		const float range[4] = { velocity_range.x, velocity_range.y, velocity_range.z, life_range };
+
+		for (uint32_t index = first; index < last; index += PARTICLE_GROUP_SIZE)
+		{
+			float32x4_t value[4];
+			for (uint32_t component = 0; component < 4; ++component)
 			{
-				generate_particle( p );
-				--particles_to_spawn;
-				++num_particles_alive;
+				state = veorq_u32(state, vshlq_n_u32(state, 13));
+				state = veorq_u32(state, vshrq_n_u32(state, 17));
+				state = veorq_u32(state, vshlq_n_u32(state, 5));
+				const float32x4_t unit = vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), scale);
+				value[component] = vmlaq_f32(vdupq_n_f32(minimum[component]), vdupq_n_f32(range[component]), unit);
 			}
+
+			// reciprocal estimate refined with two Newton-Raphson steps
+			float32x4_t inverse_life = vrecpeq_f32(value[3]);
+			inverse_life = vmulq_f32(vrecpsq_f32(value[3], inverse_life), inverse_life);
+			inverse_life = vmulq_f32(vrecpsq_f32(value[3], inverse_life), inverse_life);
+
+			vst1q_f32(streams.position_x + index, position_x);
+			vst1q_f32(streams.position_y + index, position_y);
+			vst1q_f32(streams.position_z + index, position_z);
+			vst1q_f32(streams.velocity_x + index, value[0]);
+			vst1q_f32(streams.velocity_y + index, value[1]);
+			vst1q_f32(streams.velocity_z + index, value[2]);
+			vst1q_f32(streams.life_remaining + index, value[3]);
+			vst1q_f32(streams.inverse_life + index, inverse_life);
+			vst1q_f32(streams.size + index, size);
+			vst1q_u32(streams.color + index, color);
 		}
-	} // step
+
+		vst1q_u32(random_state, state);
+#else
+		for (uint32_t index = first; index < last; ++index)
+		{
+			uint32_t& state = random_state[index % PARTICLE_GROUP_SIZE];
+			const float life = life_min + (life_range * random_unit(state));
+
+			streams.position_x[index] = world_position.x;
+			streams.position_y[index] = world_position.y;
+			streams.position_z[index] = world_position.z;
+			streams.velocity_x[index] = config.velocity_min.x + (velocity_range.x * random_unit(state));
+			streams.velocity_y[index] = config.velocity_min.y + (velocity_range.y * random_unit(state));
+			streams.velocity_z[index] = config.velocity_min.z + (velocity_range.z * random_unit(state));
+			streams.life_remaining[index] = life;
+			streams.inverse_life[index] = (1.0f / life);
+			streams.size[index] = curves.size_start;
+			streams.color[index] = start_color;
+		}
+#endif
+	} // generate_particles
+
+	void ParticleEmitter::write_vertices(ParticleVertex* vertices, uint32_t first, uint32_t last, const glm::vec3& right, const glm::vec3& up) const
+	{
+		// corners are (-right - up), (right - up), (right + up), (-right + up)
+		const glm::vec3 corner0 = (-right - up);
+		const glm::vec3 corner1 = (right - up);
+
+		for (uint32_t index = first; index < last; ++index)
+		{
+			const float x = streams.position_x[index];
+			const float y = streams.position_y[index];
+			const float z = streams.position_z[index];
+			const float size = streams.size[index];
+			const uint32_t color = streams.color[index];
+
+			const float x0 = corner0.x * size;
+			const float y0 = corner0.y * size;
+			const float z0 = corner0.z * size;
+			const float x1 = corner1.x * size;
+			const float y1 = corner1.y * size;
+			const float z1 = corner1.z * size;
+
+			// opposite corners are negated; fill each vertex in order
+			vertices[0].x = x + x0; vertices[0].y = y + y0; vertices[0].z = z + z0;
+			vertices[0].color = color; vertices[0].u = 0.0f; vertices[0].v = 0.0f;
+
+			vertices[1].x = x + x1; vertices[1].y = y + y1; vertices[1].z = z + z1;
+			vertices[1].color = color; vertices[1].u = 1.0f; vertices[1].v = 0.0f;
+
+			vertices[2].x = x - x0; vertices[2].y = y - y0; vertices[2].z = z - z0;
+			vertices[2].color = color; vertices[2].u = 1.0f; vertices[2].v = 1.0f;
+
+			vertices[3].x = x - x1; vertices[3].y = y - y1; vertices[3].z = z - z1;
+			vertices[3].color = color; vertices[3].u = 0.0f; vertices[3].v = 1.0f;
+
+			vertices += PARTICLE_VERTICES_PER_PARTICLE;
+		}
+	} // write_vertices
 
 	void ParticleEmitter::purge()
 	{
-		if (this->emitter_config && this->particle_list)
+		if (stream_memory)
 		{
-			MEMORY2_DELETE_ARRAY(allocator, particle_list);
+			MEMORY2_DEALLOC(allocator, stream_memory);
+			stream_memory = 0;
 		}
+
+		memset(&streams, 0, sizeof(ParticleStreams));
+		num_particles_alive = 0;
 	} // purge
 
 
-	void ParticleEmitter::load_from_emitter_config(assets::EmitterConfig* emitter_config)
+	void ParticleEmitter::load_from_emitter_config(EmitterConfig* emitter_config)
 	{
 		if (emitter_config)
 		{
@@ -151,21 +609,6 @@ namespace gemini
 		}
 	} // load_from_emitter_config
 
-	void ParticleEmitter::generate_particle( Particle * p )
-	{
-		p->life_total = p->life_remaining = core::util::random_range(this->emitter_config->life.min, this->emitter_config->life.max);
-		p->velocity = glm::vec3(core::util::random_range(
-												   this->emitter_config->velocity.min[0], this->emitter_config->velocity.max[0]),
-								core::util::random_range(this->emitter_config->velocity.min[1], this->emitter_config->velocity.max[1]),
-								core::util::random_range(this->emitter_config->velocity.min[2], this->emitter_config->velocity.max[2]));
-
-		p->position.snap(world_position.render);
-	//	LOGV( "p->position: %g, %g %g\n", p->position.render.x, p->position.render.y, p->position.render.z );
-		p->color = this->emitter_config->color_channel.get_value(0);
-		p->color.alpha = this->emitter_config->alpha_channel.get_value(0);
-		p->size = this->emitter_config->size_channel.get_value(0);
-	} // generate_particle
-
 	// -------------------------------------------------------------
 	// ParticleSystem
 	// -------------------------------------------------------------
@@ -173,11 +616,15 @@ namespace gemini
 	ParticleSystem::ParticleSystem(gemini::Allocator& _allocator)
 		: allocator(_allocator)
 	{
+		const size_t pool_size = memory_pool_size(sizeof(ParticleEmitter), alignof(ParticleEmitter), PARTICLE_MAX_POOLED_EMITTERS);
+		emitter_memory = MEMORY2_ALLOC(allocator, pool_size);
+		emitter_pool = memory_allocator_pool(allocator.zone, emitter_memory, pool_size, sizeof(ParticleEmitter), alignof(ParticleEmitter));
 	} // ParticleSystem
 
 	ParticleSystem::~ParticleSystem()
 	{
 		purge();
+		MEMORY2_DEALLOC(allocator, emitter_memory);
 	} // ~ParticleSystem
 
 	void ParticleSystem::purge()
@@ -186,25 +633,117 @@ namespace gemini
 		for( ; iter != emitters.end(); ++iter)
 		{
 			ParticleEmitter* emitter = (*iter);
-			MEMORY2_DELETE(allocator, emitter);
+			MEMORY2_DELETE(emitter_pool, emitter);
 		}
 
 		emitters.clear();
 	} // purge
 
-	void ParticleSystem::step(float delta_seconds)
+	void ParticleSystem::step(float delta_seconds, JobScheduler* scheduler)
 	{
-		ParticleEmitterVector::iterator iter = emitters.begin();
-		for( ; iter != emitters.end(); ++iter)
+		if (!scheduler)
 		{
-			ParticleEmitter* emitter = (*iter);
-			emitter->step( delta_seconds );
+			ParticleEmitterVector::iterator iter = emitters.begin();
+			for( ; iter != emitters.end(); ++iter)
+			{
+				ParticleEmitter* emitter = (*iter);
+				emitter->step( delta_seconds );
+			}
+			return;
 		}
+
+		const size_t total_emitters = emitters.size();
+		if (total_emitters == 0)
+		{
+			return;
+		}
+
+		Allocator frame_allocator = memory_allocator_frame(allocator.zone);
+		ParticleStepJob* jobs = static_cast<ParticleStepJob*>(MEMORY2_ALLOC(frame_allocator, sizeof(ParticleStepJob) * total_emitters));
+
+		// integrate every emitter; each is split into batches of groups
+		JobCounter counter;
+		for (size_t index = 0; index < total_emitters; ++index)
+		{
+			ParticleEmitter* emitter = emitters[index];
+			jobs[index].emitter = emitter;
+			jobs[index].delta_seconds = delta_seconds;
+
+			if (emitter->emitter_config && emitter->num_particles_alive > 0)
+			{
+				const uint32_t total_groups = (emitter->num_particles_alive + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE;
+				scheduler->parallel_for(integrate_groups, &jobs[index], total_groups, PARTICLE_JOB_BATCH_SIZE / PARTICLE_GROUP_SIZE, &counter);
+			}
+		}
+		scheduler->wait(&counter);
+
+		// compaction and spawning are serial within an emitter
+		for (size_t index = 0; index < total_emitters; ++index)
+		{
+			if (jobs[index].emitter->emitter_config)
+			{
+				scheduler->push_back(maintain_emitter, &jobs[index], &counter);
+			}
+		}
+		scheduler->wait(&counter);
 	} // step
 
+	uint32_t ParticleSystem::total_particles() const
+	{
+		uint32_t total = 0;
+		for (size_t index = 0; index < emitters.size(); ++index)
+		{
+			total += emitters[index]->num_particles_alive;
+		}
+		return total;
+	} // total_particles
+
+	uint32_t ParticleSystem::write_vertices(ParticleVertex* vertices, uint32_t max_particles, const glm::vec3& right, const glm::vec3& up, JobScheduler* scheduler)
+	{
+		const size_t total_emitters = emitters.size();
+		ParticleVertexJob* jobs = nullptr;
+		if (scheduler && total_emitters > 0)
+		{
+			Allocator frame_allocator = memory_allocator_frame(allocator.zone);
+			jobs = static_cast<ParticleVertexJob*>(MEMORY2_ALLOC(frame_allocator, sizeof(ParticleVertexJob) * total_emitters));
+		}
+
+		// each emitter writes a disjoint range of the buffer
+		JobCounter counter;
+		uint32_t total_written = 0;
+		for (size_t index = 0; index < total_emitters; ++index)
+		{
+			ParticleEmitter* emitter = emitters[index];
+			const uint32_t total = glm::min(emitter->num_particles_alive, max_particles - total_written);
+			ParticleVertex* emitter_vertices = vertices + (total_written * PARTICLE_VERTICES_PER_PARTICLE);
+
+			if (jobs && total > 0)
+			{
+				jobs[index].emitter = emitter;
+				jobs[index].vertices = emitter_vertices;
+				jobs[index].right = right;
+				jobs[index].up = up;
+				scheduler->parallel_for(write_vertex_range, &jobs[index], total, PARTICLE_JOB_BATCH_SIZE, &counter);
+			}
+			else
+			{
+				emitter->write_vertices(emitter_vertices, 0, total, right, up);
+			}
+
+			total_written += total;
+		}
+
+		if (jobs)
+		{
+			scheduler->wait(&counter);
+		}
+
+		return total_written;
+	} // write_vertices
+
 	ParticleEmitter* ParticleSystem::add_emitter()
 	{
-		ParticleEmitter* emitter = MEMORY2_NEW(allocator, ParticleEmitter)(allocator);
+		ParticleEmitter* emitter = MEMORY2_NEW(emitter_pool, ParticleEmitter)(allocator);
 		this->emitters.push_back(emitter);
 		return emitter;
 	} // add_emitter
@@ -217,7 +756,7 @@ namespace gemini
 		{
 			if (emitter == (*iter))
 			{
-				MEMORY2_DELETE(allocator, emitter);
+				MEMORY2_DELETE(emitter_pool, emitter);
 				emitters.erase(iter);
 				break;
 			}
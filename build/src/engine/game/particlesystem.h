@@ -24,90 +24,186 @@
 // -------------------------------------------------------------
 #pragma once
 
-#include "keyframechannel.h"
-#include "assets/asset_emitter.h"
-
 #include <core/mem.h>
-#include <core/util.h>
 #include <core/mathlib.h>
 
-#include <renderer/render_utilities.h>
 #include <renderer/color.h>
 
 #include <vector>
 
 namespace gemini
 {
+	class JobScheduler;
+
+	// particles are simulated in groups of this many lanes
+	const uint32_t PARTICLE_GROUP_SIZE = 4;
+
+	// emitters with more live particles than this are split across workers
+	const uint32_t PARTICLE_JOB_BATCH_SIZE = 4096;
+
+	const uint32_t PARTICLE_VERTICES_PER_PARTICLE = 4;
+	const uint32_t PARTICLE_INDICES_PER_PARTICLE = 6;
+
 	// -------------------------------------------------------------
-	// Particle
+	// EmitterConfig
 	// -------------------------------------------------------------
-	struct Particle
+	struct EmitterConfig
 	{
-		Color color;
-		::renderer::render_utilities::PhysicsState<glm::vec3> position;
-		glm::vec3 velocity;
-
-		float life_remaining;
-		float life_total;
-		float size;
+		uint32_t max_particles;
 
-		Particle();
-	//	~Particle()=default;
-	}; // Particle
+		// particles spawned every spawn_delay_seconds
+		uint32_t spawn_rate;
+		float spawn_delay_seconds;
 
+		float life_min;
+		float life_max;
 
+		glm::vec3 velocity_min;
+		glm::vec3 velocity_max;
 
+		// values are interpolated over the lifetime of each particle
+		Color color_start;
+		Color color_end;
+		float size_start;
+		float size_end;
 
+		EmitterConfig();
+	}; // EmitterConfig
 
 	// -------------------------------------------------------------
-	// ParticleEmitter
+	// ParticleVertex
 	// -------------------------------------------------------------
-	struct ParticleEmitter
+	// position: float3, color: normalized ubyte4, uv: float2
+	struct ParticleVertex
 	{
-		enum
+		float x;
+		float y;
+		float z;
+		uint32_t color;
+		float u;
+		float v;
+	}; // ParticleVertex
+
+	// Fill indices for total_particles quads written by write_vertices.
+	template <class IndexType>
+	void particle_fill_indices(IndexType* indices, uint32_t total_particles)
+	{
+		for (uint32_t particle = 0; particle < total_particles; ++particle)
 		{
-			PLANE,
-			SPHERE,
-			CONE,
-			BOX
-		};
+			const IndexType base = static_cast<IndexType>(particle * PARTICLE_VERTICES_PER_PARTICLE);
+			indices[0] = base;
+			indices[1] = static_cast<IndexType>(base + 1);
+			indices[2] = static_cast<IndexType>(base + 2);
+			indices[3] = static_cast<IndexType>(base + 2);
+			indices[4] = static_cast<IndexType>(base + 3);
+			indices[5] = base;
+			indices += PARTICLE_INDICES_PER_PARTICLE;
+		}
+	} // particle_fill_indices
 
-		assets::EmitterConfig * emitter_config;
+	// -------------------------------------------------------------
+	// ParticleStreams
+	// -------------------------------------------------------------
+	// Each attribute lives in its own 16-byte aligned stream.
+	// Live particles are packed at [0, num_particles_alive).
+	// Capacity is padded by one group so kernels can always
+	// read and write whole groups past the last live particle.
+	struct ParticleStreams
+	{
+		float* position_x;
+		float* position_y;
+		float* position_z;
+		float* velocity_x;
+		float* velocity_y;
+		float* velocity_z;
+		float* life_remaining;
+		float* inverse_life;
+		float* size;
+
+		// packed as Color::as_uint32
+		uint32_t* color;
+
+		uint32_t capacity;
+	}; // ParticleStreams
 
+	// -------------------------------------------------------------
+	// ParticleEmitter
+	// -------------------------------------------------------------
+	struct ParticleEmitter
+	{
+		EmitterConfig* emitter_config;
 
+		glm::vec3 world_position;
+		uint32_t num_particles_alive;
+		ParticleStreams streams;
+		float next_spawn;
 
+		// one xorshift state per lane
+		uint32_t random_state[PARTICLE_GROUP_SIZE];
 
-		::renderer::render_utilities::PhysicsState<glm::vec3> world_position;
-		unsigned int num_particles_alive;
-		Particle * particle_list;
-		float next_spawn;
+		void* stream_memory;
 		gemini::Allocator& allocator;
 
 		ParticleEmitter(gemini::Allocator& allocator);
 		~ParticleEmitter();
 		void init();
-		void step( float delta_seconds );
 		void purge();
-		void load_from_emitter_config( assets::EmitterConfig * emitter_config );
-		void generate_particle( Particle * particle );
+		void load_from_emitter_config(EmitterConfig* emitter_config);
+
+		// integrate, compact and spawn on the calling thread
+		void step(float delta_seconds);
+
+		// Advance particles [first, last); first must be a multiple of
+		// PARTICLE_GROUP_SIZE. Ranges may run on different threads.
+		void integrate(float delta_seconds, uint32_t first, uint32_t last);
+
+		// move dead particles out of [0, num_particles_alive)
+		void compact();
+
+		// spawn new particles according to the emitter config
+		void spawn(float delta_seconds);
+
+		// Write camera-facing quads for particles [first, last) to vertices.
+		// vertices may point into a mapped buffer; it is written sequentially.
+		void write_vertices(ParticleVertex* vertices, uint32_t first, uint32_t last, const glm::vec3& right, const glm::vec3& up) const;
+
+		// Generate particles [first, last) at the emitter's world position.
+		void generate_particles(uint32_t first, uint32_t last);
 	}; // ParticleEmitter
 
 	typedef std::vector<ParticleEmitter*> ParticleEmitterVector;
 
+	// emitters held in the system's pool; more fall back to the heap
+	const size_t PARTICLE_MAX_POOLED_EMITTERS = 64;
+
 	// -------------------------------------------------------------
 	// ParticleSystem
 	// -------------------------------------------------------------
 	struct ParticleSystem
 	{
-	//	unsigned int num_active_emitters;
-	//	ParticleEmitter * emitter_list;
 		ParticleEmitterVector emitters;
 		gemini::Allocator& allocator;
 
+		// emitters come and go with effects
+		void* emitter_memory;
+		gemini::Allocator emitter_pool;
+
 		ParticleSystem(gemini::Allocator& allocator);
 		~ParticleSystem();
 		void purge();
-		void step( float delta_seconds );
+
+		// If scheduler is not null, emitters are stepped on its workers and
+		// large emitters are split into batches of PARTICLE_JOB_BATCH_SIZE.
+		// Job data is allocated from the frame allocator.
+		void step(float delta_seconds, JobScheduler* scheduler = nullptr);
+
+		uint32_t total_particles() const;
+
+		// Write quads for up to max_particles particles, facing along
+		// right and up, to caller-provided vertices. Nothing in the renderer
+		// calls this yet. Returns the number of particles written; use
+		// particle_fill_indices for the matching indices.
+		uint32_t write_vertices(ParticleVertex* vertices, uint32_t max_particles, const glm::vec3& right, const glm::vec3& up, JobScheduler* scheduler = nullptr);
 
 		ParticleEmitter * add_emitter();
 		void remove_emitter( ParticleEmitter * emitter );
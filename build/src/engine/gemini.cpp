@@ -37,6 +37,7 @@
 #include <runtime/assets.h>
 #include <runtime/audio_mixer.h>
 #include <runtime/filesystem.h>
+#include <runtime/job_scheduler.h>
 #include <runtime/runtime.h>
 #include <runtime/standaloneresourcecache.h>
 
@@ -345,12 +346,15 @@ struct SharedState
 
 static SharedState _sharedstate;
 
+// Time per frame spent finalizing streamed assets on the main thread.
+const float AssetFinalizeBudgetMilliseconds = 2.0f;
+
 class AudioInterface : public IAudioInterface
 {
 public:
 	virtual void precache_sound(const char* path)
 	{
-		sound_load(path, false);
+		sound_load_async(path);
 	}
 
 	virtual gemini::AudioHandle play(const char* path, int num_repeats)
@@ -681,6 +685,7 @@ private:
 
 	float interpolate_alpha;
 	RenderScene* render_scene;
+	JobScheduler* job_scheduler;
 	EntityRenderState* entity_render_state;
 
 	CameraState camera_state[2];
@@ -790,6 +795,7 @@ public:
 		, engine_allocator(memory_allocator_default(MEMORY_ZONE_DEFAULT))
 		, queued_messages(nullptr)
 		, interpolate_alpha(0.0f)
+		, job_scheduler(nullptr)
 	{
 		game_path = "";
 		compositor = nullptr;
@@ -941,18 +947,24 @@ public:
 		core::argparse::VariableMap vm;
 		const char* docstring = R"(
 Usage:
-	--game=<game_path>
+	--game=<game_path> [--profile]
 
 Options:
 	-h, --help  Show this help screen
 	--version  Display the version number
 	--game=<game_path>  The game path to load content from
+	--profile  Capture profiler events for the report and trace at shutdown
 	)";
 
 		if (parser.parse(docstring, arguments, vm, "1.0.0-alpha"))
 		{
 			std::string path = vm["--game"];
 			game_path = platform::make_absolute_path(path.c_str());
+
+#if defined(GEMINI_ENABLE_PROFILER)
+			// capture starts with the first frame
+			gemini::profiler::set_capture(vm["--profile"] == "true");
+#endif
 		}
 		else
 		{
@@ -1011,7 +1023,12 @@ Options:
 			filesystem->user_application_directory(application_path);
 		};
 
-		const uint32_t runtime_flags = RF_CORE | RF_WINDOW_SYSTEM;
+		uint32_t runtime_flags = RF_CORE | RF_WINDOW_SYSTEM;
+		if (!game_path.is_empty())
+		{
+			// dev builds hotload loose files over the content pack
+			runtime_flags |= RF_LOOSE_FILES_OVERRIDE;
+		}
 		gemini::runtime_startup(nullptr, custom_path_setup, runtime_flags);
 
 		LOGV("Logging system initialized.\n");
@@ -1117,6 +1134,12 @@ Options:
 		// create the render scene
 		render_scene = render_scene_create(engine_allocator, device);
 
+		// the render scene splits culling and command recording across these workers
+		const uint32_t total_processors = static_cast<uint32_t>(platform::system_processor_count());
+		job_scheduler = MEMORY2_NEW(engine_allocator, JobScheduler)(engine_allocator);
+		job_scheduler->create_workers((total_processors > 1) ? (total_processors - 1) : 0);
+		render_scene->job_scheduler = job_scheduler;
+
 		EngineInterface* engine_instance = static_cast<EngineInterface*>(engine_interface);
 		engine_instance->render_scene = render_scene;
 
@@ -1145,6 +1168,11 @@ Options:
 
 	virtual void tick()
 	{
+		PROFILE_FRAME();
+
+		// recycle frame memory from two frames ago
+		memory_frame_advance();
+
 		uint64_t current_time = platform::microseconds();
 		kernel::Parameters& params = kernel::parameters();
 
@@ -1179,16 +1207,26 @@ Options:
 												static_cast<uint32_t>(1000.0f / params.framedelta_milliseconds)),
 												Color());
 		y += 12;
-		//debugdraw::text(x, y, core::str::format("allocations = %i, total %2.2f MB\n",
-		//	core::memory::global_allocator().get_zone()->get_active_allocations(),
-		//	core::memory::global_allocator().get_zone()->get_active_bytes() / (float)(1024 * 1024)), Color());
-		//y += 12;
+
+		size_t frame_allocations = 0;
+		size_t frame_peak_bytes = 0;
+		ZoneStats* zone_stats = memory_zone_tracking_stats();
+		for (size_t zone = 0; zone < MEMORY_ZONE_MAX; ++zone)
+		{
+			frame_allocations += zone_stats[zone].last_frame_allocations;
+			frame_peak_bytes += zone_stats[zone].last_frame_peak_bytes;
+		}
+		debugdraw::text(x, y, core::str::format("frame allocations = %i, peak %2.2f MB\n",
+			static_cast<int>(frame_allocations),
+			frame_peak_bytes / (float)(1024 * 1024)), Color());
+		y += 12;
 
 		uint32_t reset_queue = 0;
 
 		EngineInterface* ei = reinterpret_cast<EngineInterface*>(engine_interface);
 
 
+		PROFILE_BEGIN("fixed_step");
 		while (accumulator > params.step_interval_seconds)
 		{
 			// iterate over queued messages and play until we hit the time cap
@@ -1218,6 +1256,7 @@ Options:
 
 			reset_queue = 1;
 		}
+		PROFILE_END("fixed_step");
 
 		if (game_interface)
 		{
@@ -1266,9 +1305,17 @@ Options:
 			params.step_alpha -= 1.0f;
 		}
 
+		assets::update(AssetFinalizeBudgetMilliseconds);
+
+		PROFILE_BEGIN("animation_update");
 		animation::update(kernel::parameters().framedelta_seconds);
+		PROFILE_END("animation_update");
+
 		hotloading::tick();
+
+		PROFILE_BEGIN("render");
 		post_tick();
+		PROFILE_END("render");
 		kernel::parameters().current_frame++;
 
 		//gemini::profiler::report();
@@ -1454,6 +1501,10 @@ Options:
 		render_scene_destroy(render_scene, device);
 		render_scene_shutdown();
 
+		job_scheduler->destroy_workers();
+		MEMORY2_DELETE(engine_allocator, job_scheduler);
+		job_scheduler = nullptr;
+
 		// shutdown subsystems
 		hotloading::shutdown();
 		animation::shutdown();
@@ -1488,6 +1539,7 @@ Options:
 
 #if defined(GEMINI_ENABLE_PROFILER)
 		gemini::profiler::report();
+		gemini::profiler::write_trace("profile_trace.json");
 #endif
 
 		gemini::runtime_shutdown();
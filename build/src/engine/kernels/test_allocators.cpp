@@ -0,0 +1,206 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mem.h>
+
+#include <platform/platform.h>
+
+// Measures alloc/free throughput of the per-frame allocation pattern:
+// every frame each thread allocates a batch of small objects and frees
+// them all again.
+//	- default: malloc-backed allocator (zone tracking under a global lock)
+//	- pool: one fixed-size pool shared by every thread
+//	- frame: thread-local frame arena; frees are no-ops and the arena is
+//	  recycled by memory_frame_advance
+// Each allocator is run on one thread and then on every processor at once.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t OBJECTS_PER_FRAME = 4096;
+	const uint32_t TOTAL_FRAMES = 256;
+	const size_t MAX_OBJECT_SIZE = 128;
+
+	// a spread of typical small object sizes
+	const size_t OBJECT_SIZES[] = { 16, 24, 32, 48, 64, 96, 128, 40 };
+	const size_t TOTAL_OBJECT_SIZES = sizeof(OBJECT_SIZES) / sizeof(OBJECT_SIZES[0]);
+
+	volatile uint32_t sink = 0;
+
+	void run_frame(Allocator& allocator, void** objects)
+	{
+		for (uint32_t index = 0; index < OBJECTS_PER_FRAME; ++index)
+		{
+			objects[index] = MEMORY2_ALLOC(allocator, OBJECT_SIZES[index % TOTAL_OBJECT_SIZES]);
+			*static_cast<uint32_t*>(objects[index]) = index;
+		}
+
+		for (uint32_t index = OBJECTS_PER_FRAME; index > 0; --index)
+		{
+			sink = sink + *static_cast<uint32_t*>(objects[index - 1]);
+			MEMORY2_DEALLOC(allocator, objects[index - 1]);
+		}
+	}
+
+	struct Worker
+	{
+		platform::Thread* thread;
+		platform::Semaphore* start;
+		platform::Semaphore* finished;
+		Allocator* allocator;
+		void* objects[OBJECTS_PER_FRAME];
+		bool quit;
+	};
+
+	void worker_thread(platform::Thread* thread)
+	{
+		Worker* worker = static_cast<Worker*>(thread->user_data);
+		for (;;)
+		{
+			platform::semaphore_wait(worker->start);
+			if (worker->quit)
+			{
+				break;
+			}
+
+			run_frame(*worker->allocator, worker->objects);
+			platform::semaphore_signal(worker->finished);
+		}
+	}
+
+	// Returns nanoseconds per alloc/free pair.
+	double run_single(Allocator& allocator, Allocator& scratch)
+	{
+		void** objects = static_cast<void**>(MEMORY2_ALLOC(scratch, sizeof(void*) * OBJECTS_PER_FRAME));
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t frame = 0; frame < TOTAL_FRAMES; ++frame)
+		{
+			run_frame(allocator, objects);
+			memory_frame_advance();
+		}
+		const uint64_t elapsed = platform::microseconds() - start;
+
+		MEMORY2_DEALLOC(scratch, objects);
+		return (elapsed * 1000.0) / (static_cast<double>(TOTAL_FRAMES) * OBJECTS_PER_FRAME);
+	}
+
+	// Every worker runs a frame at once; the main thread advances the
+	// frame once they have all finished.
+	// Returns nanoseconds per alloc/free pair over all threads.
+	double run_contended(Allocator& allocator, Worker* workers, uint32_t total_threads, platform::Semaphore* finished)
+	{
+		for (uint32_t index = 0; index < total_threads; ++index)
+		{
+			workers[index].allocator = &allocator;
+		}
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t frame = 0; frame < TOTAL_FRAMES; ++frame)
+		{
+			for (uint32_t index = 0; index < total_threads; ++index)
+			{
+				platform::semaphore_signal(workers[index].start);
+			}
+
+			for (uint32_t index = 0; index < total_threads; ++index)
+			{
+				platform::semaphore_wait(finished);
+			}
+			memory_frame_advance();
+		}
+		const uint64_t elapsed = platform::microseconds() - start;
+
+		return (elapsed * 1000.0) / (static_cast<double>(TOTAL_FRAMES) * OBJECTS_PER_FRAME * total_threads);
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+		Allocator frame_allocator = memory_allocator_frame(MEMORY_ZONE_DEFAULT);
+
+		const uint32_t total_threads = static_cast<uint32_t>(platform::system_processor_count());
+
+		// enough elements for every thread's frame; so none fall back
+		const size_t pool_size = memory_pool_size(MAX_OBJECT_SIZE, alignof(void*), OBJECTS_PER_FRAME * total_threads);
+		void* pool_memory = MEMORY2_ALLOC(allocator, pool_size);
+		Allocator pool_allocator = memory_allocator_pool(MEMORY_ZONE_DEFAULT, pool_memory, pool_size, MAX_OBJECT_SIZE, alignof(void*));
+
+		const double default_single = run_single(allocator, allocator);
+		const double pool_single = run_single(pool_allocator, allocator);
+		const double frame_single = run_single(frame_allocator, allocator);
+
+		platform::Semaphore* finished = platform::semaphore_create(0, total_threads);
+		Worker* workers = MEMORY2_NEW_ARRAY(allocator, Worker, total_threads);
+		for (uint32_t index = 0; index < total_threads; ++index)
+		{
+			Worker& worker = workers[index];
+			worker.start = platform::semaphore_create(0, 1);
+			worker.finished = finished;
+			worker.quit = false;
+			worker.thread = platform::thread_create(worker_thread, &worker);
+		}
+
+		const double default_contended = run_contended(allocator, workers, total_threads, finished);
+		const double pool_contended = run_contended(pool_allocator, workers, total_threads, finished);
+		const double frame_contended = run_contended(frame_allocator, workers, total_threads, finished);
+
+		for (uint32_t index = 0; index < total_threads; ++index)
+		{
+			Worker& worker = workers[index];
+			worker.quit = true;
+			platform::semaphore_signal(worker.start);
+			platform::thread_join(worker.thread);
+			platform::thread_destroy(worker.thread);
+			platform::semaphore_destroy(worker.start);
+		}
+		MEMORY2_DELETE_ARRAY(allocator, workers);
+		platform::semaphore_destroy(finished);
+
+		MEMORY2_DEALLOC(allocator, pool_memory);
+
+		const ZoneStats& stats = memory_zone_tracking_stats()[MEMORY_ZONE_DEFAULT];
+
+		LOGV("%u objects per frame, %u frames\n", OBJECTS_PER_FRAME, TOTAL_FRAMES);
+		LOGV("default:           %8.2f ns/op\n", default_single);
+		LOGV("pool:              %8.2f ns/op (%.1fx)\n", pool_single, default_single / pool_single);
+		LOGV("frame:             %8.2f ns/op (%.1fx)\n", frame_single, default_single / frame_single);
+		LOGV("default x %2u:      %8.2f ns/op\n", total_threads, default_contended);
+		LOGV("pool x %2u:         %8.2f ns/op (%.1fx)\n", total_threads, pool_contended, default_contended / pool_contended);
+		LOGV("frame x %2u:        %8.2f ns/op (%.1fx)\n", total_threads, frame_contended, default_contended / frame_contended);
+		LOGV("last frame: %lu allocations, %lu peak bytes\n",
+			(unsigned long)stats.last_frame_allocations,
+			(unsigned long)stats.last_frame_peak_bytes);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
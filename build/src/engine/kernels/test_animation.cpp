@@ -0,0 +1,230 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/interpolation.h>
+#include <core/logging.h>
+#include <core/mem.h>
+
+#include <platform/platform.h>
+
+#include <runtime/animation.h>
+#include <runtime/job_scheduler.h>
+
+#include <stdlib.h>
+
+// Measures pose evaluation in instances/ms for skinned characters:
+//	- Linear scan: the previous Channel::evaluate; which scanned every key
+//	  of each of the seven channels per joint.
+//	- Channels: Channel::evaluate with direct key indexing; still one
+//	  channel at a time.
+//	- Batched: animated_instance_get_poses; which blends each key's
+//	  resampled joint values with SIMD.
+//	- Parallel: the batched path split across JobScheduler workers.
+
+using namespace gemini;
+using namespace gemini::animation;
+
+namespace
+{
+	const uint32_t TOTAL_INSTANCES = 1024;
+	const uint32_t TOTAL_JOINTS = 60;
+	const uint32_t FRAMES_PER_SECOND = 30;
+	const float DURATION_SECONDS = 4.0f;
+	const uint32_t ITERATIONS = 16;
+
+	// The previous implementation of Channel::evaluate.
+	float evaluate_linear_scan(const KeyframeList* keyframelist, float t_seconds, float frame_delay_seconds)
+	{
+		if (keyframelist->duration_seconds == 0)
+		{
+			return 0.0f;
+		}
+
+		uint32_t last_key = (keyframelist->total_keys - 1);
+		for (uint32_t key = 0; key < keyframelist->total_keys; ++key)
+		{
+			const Keyframe* keyframe = &keyframelist->keys[key];
+			if (t_seconds < keyframe->seconds)
+			{
+				if (key == 0)
+				{
+					const Keyframe* next = &keyframelist->keys[key + 1];
+					float alpha = ((next->seconds - keyframe->seconds) / frame_delay_seconds);
+					return gemini::lerp(next->value, keyframe->value, alpha);
+				}
+
+				const Keyframe* prev_keyframe = &keyframelist->keys[key - 1];
+				float alpha = (t_seconds - prev_keyframe->seconds) / frame_delay_seconds;
+				return gemini::lerp(prev_keyframe->value, keyframe->value, alpha);
+			}
+			else if (last_key == key)
+			{
+				return keyframelist->keys[last_key].value;
+			}
+		}
+
+		return 0.0f;
+	}
+
+	void get_pose_linear_scan(AnimatedInstance* instance, Sequence* sequence, Pose& pose)
+	{
+		const float t = instance->local_time_seconds;
+		const float delay = sequence->frame_delay_seconds;
+		for (uint32_t joint = 0; joint < TOTAL_JOINTS; ++joint)
+		{
+			const KeyframeList* lists = &sequence->animation_set[joint * ANIMATION_KEYFRAME_VALUES_MAX];
+			pose.pos[joint] = glm::vec3(evaluate_linear_scan(&lists[0], t, delay),
+				evaluate_linear_scan(&lists[1], t, delay),
+				evaluate_linear_scan(&lists[2], t, delay));
+			pose.rot[joint] = glm::quat(evaluate_linear_scan(&lists[6], t, delay),
+				evaluate_linear_scan(&lists[3], t, delay),
+				evaluate_linear_scan(&lists[4], t, delay),
+				evaluate_linear_scan(&lists[5], t, delay));
+		}
+	}
+
+	void get_pose_channels(AnimatedInstance* instance, Sequence* sequence, Pose& pose)
+	{
+		const float t = instance->local_time_seconds;
+		const float delay = sequence->frame_delay_seconds;
+		for (uint32_t joint = 0; joint < TOTAL_JOINTS; ++joint)
+		{
+			const Channel* channels = &instance->channel_set[joint * ANIMATION_KEYFRAME_VALUES_MAX];
+			pose.pos[joint] = glm::vec3(channels[0].evaluate(t, delay), channels[1].evaluate(t, delay), channels[2].evaluate(t, delay));
+			pose.rot[joint] = glm::quat(channels[6].evaluate(t, delay), channels[3].evaluate(t, delay), channels[4].evaluate(t, delay), channels[5].evaluate(t, delay));
+		}
+	}
+
+	Sequence* create_sequence(Allocator& allocator)
+	{
+		const uint32_t total_keys = static_cast<uint32_t>(DURATION_SECONDS * FRAMES_PER_SECOND) + 1;
+
+		Sequence* sequence = MEMORY2_NEW(allocator, Sequence)(allocator);
+		sequence->name = "test_animation";
+		sequence->duration_seconds = DURATION_SECONDS;
+		sequence->frame_delay_seconds = (1.0f / FRAMES_PER_SECOND);
+		sequence->animation_set.allocate(TOTAL_JOINTS * ANIMATION_KEYFRAME_VALUES_MAX, KeyframeList(allocator));
+		for (size_t channel = 0; channel < sequence->animation_set.size(); ++channel)
+		{
+			KeyframeList& list = sequence->animation_set[channel];
+			list.allocate(total_keys);
+			list.duration_seconds = DURATION_SECONDS;
+			for (uint32_t key = 0; key < total_keys; ++key)
+			{
+				list.set_key(key, key * sequence->frame_delay_seconds, static_cast<float>(rand() % 1000) / 500.0f - 1.0f);
+			}
+		}
+
+		return sequence;
+	}
+
+	double instances_per_ms(uint64_t start)
+	{
+		const double elapsed_ms = (platform::microseconds() - start) / 1000.0;
+		return (TOTAL_INSTANCES * ITERATIONS) / elapsed_ms;
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+		animation::startup(allocator);
+
+		Sequence* sequence = create_sequence(allocator);
+		SequenceId sequence_id = add_sequence(sequence);
+
+		AnimatedInstance** instances = MEMORY2_NEW_ARRAY(allocator, AnimatedInstance*, TOTAL_INSTANCES);
+		Pose* poses = MEMORY2_NEW_ARRAY(allocator, Pose, TOTAL_INSTANCES);
+		for (uint32_t index = 0; index < TOTAL_INSTANCES; ++index)
+		{
+			instances[index] = create_sequence_instance(allocator, sequence_id);
+			instances[index]->local_time_seconds = (DURATION_SECONDS * index) / TOTAL_INSTANCES;
+		}
+
+		LOGV("%u instances, %u joints, %u keys per channel\n", TOTAL_INSTANCES, TOTAL_JOINTS, sequence->animation_set[0].total_keys);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			for (uint32_t index = 0; index < TOTAL_INSTANCES; ++index)
+			{
+				get_pose_linear_scan(instances[index], sequence, poses[index]);
+			}
+		}
+		const double linear_rate = instances_per_ms(start);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			for (uint32_t index = 0; index < TOTAL_INSTANCES; ++index)
+			{
+				get_pose_channels(instances[index], sequence, poses[index]);
+			}
+		}
+		const double channel_rate = instances_per_ms(start);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			animated_instance_get_poses(instances, poses, TOTAL_INSTANCES);
+		}
+		const double batched_rate = instances_per_ms(start);
+
+		// the calling thread executes jobs while it waits
+		const uint32_t total_threads = static_cast<uint32_t>(platform::system_processor_count());
+		JobScheduler scheduler(allocator);
+		scheduler.create_workers(total_threads - 1);
+
+		PoseEvaluation evaluation;
+		evaluation.instances = instances;
+		evaluation.poses = poses;
+		evaluation.total_instances = TOTAL_INSTANCES;
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			JobCounter counter;
+			animated_instance_get_poses_async(scheduler, evaluation, &counter);
+			scheduler.wait(&counter);
+		}
+		const double parallel_rate = instances_per_ms(start);
+		scheduler.destroy_workers();
+
+		LOGV("linear scan:        %10.1f instances/ms\n", linear_rate);
+		LOGV("channels:           %10.1f instances/ms (%.1fx)\n", channel_rate, channel_rate / linear_rate);
+		LOGV("batched:            %10.1f instances/ms (%.1fx)\n", batched_rate, batched_rate / linear_rate);
+		LOGV("parallel (%2u thr):  %10.1f instances/ms (%.1fx)\n", total_threads, parallel_rate, parallel_rate / linear_rate);
+
+		MEMORY2_DELETE_ARRAY(allocator, poses);
+		MEMORY2_DELETE_ARRAY(allocator, instances);
+		animation::shutdown();
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
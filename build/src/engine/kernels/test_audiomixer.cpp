@@ -0,0 +1,190 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mathlib.h>
+#include <core/mem.h>
+
+#include <platform/platform.h>
+
+#include <runtime/audio_library.h>
+#include <runtime/audio_mixer.h>
+
+// Renders voices offline, without an audio device, and reports how many
+// voices one core can mix in real time.
+//	- reference: the previous mixer; one frame at a time across all voices
+//	- 44.1 kHz: block mixing straight from the source
+//	- 48 kHz: block mixing with sample rate conversion
+//	- 48 kHz virtualized: only the default number of voices are audible
+// Every voice loops one of several sounds with its own gain and pan.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t TOTAL_SOUNDS = 8;
+	const uint32_t SOUND_FRAMES = (audio::AUDIO_FREQUENCY_HZ * 2);
+	const uint32_t PERIOD_FRAMES = 512;
+	const uint32_t RENDER_SECONDS = 4;
+	const uint32_t VOICE_COUNTS[] = { 16, 64, 256 };
+	const uint32_t TOTAL_VOICE_COUNTS = sizeof(VOICE_COUNTS) / sizeof(VOICE_COUNTS[0]);
+
+	volatile int32_t sink = 0;
+
+	size_t get_frame_sound(Sound* sound, size_t frame, float* buffer)
+	{
+		buffer[0] = sound->pcmdata[(frame * 2) + 0];
+		buffer[1] = sound->pcmdata[(frame * 2) + 1];
+		return frame;
+	}
+
+	// deterministic noise so the output can't be optimized away
+	void fill_sound(Sound* sound, uint32_t seed)
+	{
+		sound->channels = audio::InMemoryChannelCount;
+		sound->get_frame_callback = get_frame_sound;
+		sound->pcmdata.resize(SOUND_FRAMES * audio::InMemoryChannelCount);
+		for (size_t index = 0; index < sound->pcmdata.size(); ++index)
+		{
+			seed = (seed * 1664525) + 1013904223;
+			sound->pcmdata[index] = ((seed >> 8) / 16777216.0f - 0.5f) * 0.25f;
+		}
+	}
+
+	// Returns voices per core.
+	double run_mixer(Sound** sounds, uint32_t total_voices, size_t sample_rate_hz, uint32_t audible_voices, int16_t* output)
+	{
+		audio::set_max_audible_voices(audible_voices);
+		for (uint32_t voice = 0; voice < total_voices; ++voice)
+		{
+			audio::SoundHandle_t handle = audio::play_sound(sounds[voice % TOTAL_SOUNDS], -1);
+			audio::set_sound_pan(handle, ((voice % 3) - 1.0f) * 0.5f);
+			audio::set_sound_gain(handle, 1.0f / (1 + (voice % 7)));
+
+			// keep the command queue from filling up
+			if ((voice % 64) == 63)
+			{
+				audio::audio_fill_buffer(output, PERIOD_FRAMES, sample_rate_hz, nullptr);
+			}
+		}
+
+		const uint32_t total_periods = static_cast<uint32_t>((sample_rate_hz * RENDER_SECONDS) / PERIOD_FRAMES);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t period = 0; period < total_periods; ++period)
+		{
+			audio::audio_fill_buffer(output, PERIOD_FRAMES, sample_rate_hz, nullptr);
+			sink = sink + output[period % PERIOD_FRAMES];
+		}
+		const uint64_t elapsed = platform::microseconds() - start;
+
+		audio::stop_all_sounds();
+		audio::audio_fill_buffer(output, PERIOD_FRAMES, sample_rate_hz, nullptr);
+
+		const double rendered_seconds = (total_periods * PERIOD_FRAMES) / static_cast<double>(sample_rate_hz);
+		return (total_voices * rendered_seconds) / (elapsed / 1000000.0);
+	}
+
+	// The previous audio_fill_buffer: every voice is visited for each
+	// frame and read through Sound::get_frame.
+	double run_reference(Sound** sounds, uint32_t total_voices, int16_t* output)
+	{
+		uint64_t positions[audio::AUDIO_MAX_VOICES];
+		memset(positions, 0, sizeof(uint64_t) * total_voices);
+
+		const uint32_t total_periods = static_cast<uint32_t>((audio::AUDIO_FREQUENCY_HZ * RENDER_SECONDS) / PERIOD_FRAMES);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t period = 0; period < total_periods; ++period)
+		{
+			for (uint32_t frame = 0; frame < PERIOD_FRAMES; ++frame)
+			{
+				float channels[2] = { 0.0f, 0.0f };
+				for (uint32_t voice = 0; voice < total_voices; ++voice)
+				{
+					Sound* sound = sounds[voice % TOTAL_SOUNDS];
+					float current_sample[2];
+					sound->get_frame(positions[voice], current_sample);
+					channels[0] += current_sample[0];
+					channels[1] += current_sample[1];
+					positions[voice] = (positions[voice] + 1) % SOUND_FRAMES;
+				}
+
+				channels[0] = glm::clamp(channels[0], -1.0f, 1.0f);
+				channels[1] = glm::clamp(channels[1], -1.0f, 1.0f);
+				output[(frame * 2) + 0] = static_cast<int16_t>(channels[0] * audio::InMemorySampleValueMax);
+				output[(frame * 2) + 1] = static_cast<int16_t>(channels[1] * audio::InMemorySampleValueMax);
+			}
+			sink = sink + output[period % PERIOD_FRAMES];
+		}
+		const uint64_t elapsed = platform::microseconds() - start;
+
+		const double rendered_seconds = (total_periods * PERIOD_FRAMES) / static_cast<double>(audio::AUDIO_FREQUENCY_HZ);
+		return (total_voices * rendered_seconds) / (elapsed / 1000000.0);
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_AUDIO);
+		audio::startup(allocator, false);
+
+		Sound* sounds[TOTAL_SOUNDS];
+		for (uint32_t index = 0; index < TOTAL_SOUNDS; ++index)
+		{
+			sounds[index] = MEMORY2_NEW(allocator, Sound)(allocator);
+			fill_sound(sounds[index], index + 1);
+		}
+
+		int16_t* output = static_cast<int16_t*>(MEMORY2_ALLOC(allocator, sizeof(int16_t) * PERIOD_FRAMES * audio::AUDIO_MAX_OUTPUT_CHANNELS));
+
+		LOGV("%u frames per period, %u seconds per run\n", PERIOD_FRAMES, RENDER_SECONDS);
+		LOGV("voices    reference   44.1 kHz     48 kHz  48 kHz (%u audible)   [voices per core]\n", audio::AUDIO_DEFAULT_AUDIBLE_VOICES);
+		for (uint32_t index = 0; index < TOTAL_VOICE_COUNTS; ++index)
+		{
+			const uint32_t total_voices = VOICE_COUNTS[index];
+			const uint32_t all_voices = static_cast<uint32_t>(audio::AUDIO_MAX_VOICES);
+			const double reference = run_reference(sounds, total_voices, output);
+			const double passthrough = run_mixer(sounds, total_voices, 44100, all_voices, output);
+			const double resampled = run_mixer(sounds, total_voices, 48000, all_voices, output);
+			const double virtualized = run_mixer(sounds, total_voices, 48000, audio::AUDIO_DEFAULT_AUDIBLE_VOICES, output);
+			LOGV("%6u %12.0f %10.0f %10.0f %21.0f\n", total_voices, reference, passthrough, resampled, virtualized);
+		}
+
+		MEMORY2_DEALLOC(allocator, output);
+		for (uint32_t index = 0; index < TOTAL_SOUNDS; ++index)
+		{
+			MEMORY2_DELETE(allocator, sounds[index]);
+		}
+
+		audio::shutdown();
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
@@ -0,0 +1,258 @@
+// -------------------------------------------------------------
+// Copyright (C) 2016- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mem.h>
+
+#include <platform/platform.h>
+
+#include <runtime/jobqueue.h>
+#include <runtime/job_scheduler.h>
+
+// Measures jobs/sec for the JobQueue and JobScheduler while scaling the
+// number of threads from one to the number of processors in the system.
+//
+// Both variants use the same number of cores: JobQueue runs 'threads'
+// workers while the caller spins in wait_for_jobs_to_complete. JobScheduler
+// runs 'threads - 1' workers and the caller executes jobs while it waits.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t TOTAL_JOBS = 65536;
+	const uint32_t TOTAL_ITERATIONS = 8;
+
+	// JobQueue can only hold MAX_QUEUE_ITEMS - 1 jobs at once.
+	const uint32_t JOBQUEUE_BATCH_SIZE = 15;
+
+	// number of children spawned by each job in the nested test
+	const uint32_t NESTED_CHILDREN = 64;
+
+	struct BenchmarkState
+	{
+		uint32_t work_iterations;
+		uint32_t* results;
+		JobScheduler* scheduler;
+		JobCounter* counter;
+	};
+
+	BenchmarkState state;
+
+	uint32_t do_work(uint32_t seed, uint32_t iterations)
+	{
+		uint32_t value = seed;
+		for (uint32_t index = 0; index < iterations; ++index)
+		{
+			value = (value * 1664525U) + 1013904223U;
+		}
+		return value;
+	}
+
+	void jobqueue_work(const char* data)
+	{
+		uint32_t* result = reinterpret_cast<uint32_t*>(const_cast<char*>(data));
+		*result = do_work(*result, state.work_iterations);
+	}
+
+	void scheduler_work(void* data)
+	{
+		uint32_t* result = static_cast<uint32_t*>(data);
+		*result = do_work(*result, state.work_iterations);
+	}
+
+	void scheduler_work_range(void* /*data*/, uint32_t start_index, uint32_t end_index)
+	{
+		for (uint32_t index = start_index; index < end_index; ++index)
+		{
+			state.results[index] = do_work(state.results[index], state.work_iterations);
+		}
+	}
+
+	void scheduler_spawn_children(void* data)
+	{
+		uint32_t* results = static_cast<uint32_t*>(data);
+		for (uint32_t index = 0; index < NESTED_CHILDREN; ++index)
+		{
+			state.scheduler->push_back(scheduler_work, &results[index], state.counter);
+		}
+	}
+
+	double jobs_per_second(uint64_t total_jobs, uint64_t elapsed_microseconds)
+	{
+		if (elapsed_microseconds == 0)
+		{
+			elapsed_microseconds = 1;
+		}
+		return (total_jobs * MicrosecondsPerSecond) / static_cast<double>(elapsed_microseconds);
+	}
+
+	double benchmark_jobqueue(Allocator& allocator, uint32_t threads)
+	{
+		JobQueue queue(allocator);
+		queue.create_workers(threads);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < TOTAL_ITERATIONS; ++iteration)
+		{
+			for (uint32_t index = 0; index < TOTAL_JOBS; index += JOBQUEUE_BATCH_SIZE)
+			{
+				uint32_t last = (index + JOBQUEUE_BATCH_SIZE < TOTAL_JOBS) ? (index + JOBQUEUE_BATCH_SIZE) : TOTAL_JOBS;
+				for (uint32_t job = index; job < last; ++job)
+				{
+					queue.push_back(jobqueue_work, reinterpret_cast<const char*>(&state.results[job]));
+				}
+
+				// The queue is full; wait for it to drain.
+				queue.wait_for_jobs_to_complete();
+			}
+		}
+		uint64_t elapsed = platform::microseconds() - start;
+
+		queue.destroy_workers();
+		return jobs_per_second(TOTAL_JOBS * TOTAL_ITERATIONS, elapsed);
+	}
+
+	double benchmark_scheduler(Allocator& allocator, uint32_t threads)
+	{
+		JobScheduler scheduler(allocator);
+		scheduler.create_workers(threads - 1);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < TOTAL_ITERATIONS; ++iteration)
+		{
+			JobCounter counter;
+			for (uint32_t job = 0; job < TOTAL_JOBS; ++job)
+			{
+				scheduler.push_back(scheduler_work, &state.results[job], &counter);
+			}
+			scheduler.wait(&counter);
+		}
+		uint64_t elapsed = platform::microseconds() - start;
+
+		scheduler.destroy_workers();
+		return jobs_per_second(TOTAL_JOBS * TOTAL_ITERATIONS, elapsed);
+	}
+
+	double benchmark_scheduler_nested(Allocator& allocator, uint32_t threads)
+	{
+		JobScheduler scheduler(allocator);
+		scheduler.create_workers(threads - 1);
+		state.scheduler = &scheduler;
+
+		const uint32_t total_parents = (TOTAL_JOBS / NESTED_CHILDREN);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < TOTAL_ITERATIONS; ++iteration)
+		{
+			JobCounter counter;
+			state.counter = &counter;
+			for (uint32_t parent = 0; parent < total_parents; ++parent)
+			{
+				scheduler.push_back(scheduler_spawn_children, &state.results[parent * NESTED_CHILDREN], &counter);
+			}
+			scheduler.wait(&counter);
+		}
+		uint64_t elapsed = platform::microseconds() - start;
+
+		state.scheduler = nullptr;
+		state.counter = nullptr;
+
+		scheduler.destroy_workers();
+		return jobs_per_second((total_parents + TOTAL_JOBS) * TOTAL_ITERATIONS, elapsed);
+	}
+
+	double benchmark_parallel_for(Allocator& allocator, uint32_t threads)
+	{
+		JobScheduler scheduler(allocator);
+		scheduler.create_workers(threads - 1);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < TOTAL_ITERATIONS; ++iteration)
+		{
+			JobCounter counter;
+			scheduler.parallel_for(scheduler_work_range, nullptr, TOTAL_JOBS, 64, &counter);
+			scheduler.wait(&counter);
+		}
+		uint64_t elapsed = platform::microseconds() - start;
+
+		scheduler.destroy_workers();
+
+		// report items/sec for parallel_for
+		return jobs_per_second(TOTAL_JOBS * TOTAL_ITERATIONS, elapsed);
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+		state.results = MEMORY2_NEW_ARRAY(allocator, uint32_t, TOTAL_JOBS);
+
+		const uint32_t max_threads = static_cast<uint32_t>(platform::system_processor_count());
+		const uint32_t workloads[] = { 16, 1024 };
+
+		for (uint32_t workload : workloads)
+		{
+			state.work_iterations = workload;
+			LOGV("workload: %u iterations per job, %u jobs x %u iterations\n", workload, TOTAL_JOBS, TOTAL_ITERATIONS);
+			LOGV("threads | jobqueue jobs/s (scale) | scheduler jobs/s (scale) | nested jobs/s (scale) | parallel_for items/s (scale)\n");
+
+			double base_jobqueue = 0.0;
+			double base_scheduler = 0.0;
+			double base_nested = 0.0;
+			double base_parallel_for = 0.0;
+			for (uint32_t threads = 1; threads <= max_threads; ++threads)
+			{
+				double jobqueue = benchmark_jobqueue(allocator, threads);
+				double scheduler = benchmark_scheduler(allocator, threads);
+				double nested = benchmark_scheduler_nested(allocator, threads);
+				double parallel_for = benchmark_parallel_for(allocator, threads);
+
+				if (threads == 1)
+				{
+					base_jobqueue = jobqueue;
+					base_scheduler = scheduler;
+					base_nested = nested;
+					base_parallel_for = parallel_for;
+				}
+
+				LOGV("%7u | %12.0f (%5.2fx) | %13.0f (%5.2fx) | %10.0f (%5.2fx) | %17.0f (%5.2fx)\n",
+					threads,
+					jobqueue, jobqueue / base_jobqueue,
+					scheduler, scheduler / base_scheduler,
+					nested, nested / base_nested,
+					parallel_for, parallel_for / base_parallel_for);
+			}
+		}
+
+		MEMORY2_DELETE_ARRAY(allocator, state.results);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
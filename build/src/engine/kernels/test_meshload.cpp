@@ -0,0 +1,270 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/array.h>
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mem.h>
+#include <core/str.h>
+
+#include <platform/platform.h>
+
+#include <runtime/configloader.h>
+#include <runtime/mesh_format.h>
+
+#include <stdarg.h>
+#include <string>
+
+// Compares mesh load times for a large skinned mesh:
+//	- JSON: read the .model, parse it, convert each element and interleave
+//	  the vertex stream (the work done by load_json_model and
+//	  render_scene_track_mesh before upload).
+//	- Compiled: map the .mesh container and validate the header. The vertex
+//	  and index streams are then ready for buffer_upload. A second timing
+//	  also reads every byte of those streams to account for page faults.
+//
+// Both files are written right before they're loaded, so these are
+// warm-cache numbers.
+
+using namespace gemini;
+
+namespace
+{
+	// 256x256 grid: 65536 vertices, 390150 indices.
+	const uint32_t GRID_SIZE = 256;
+	const uint32_t TOTAL_BONES = 32;
+	const uint32_t JSON_ITERATIONS = 4;
+	const uint32_t COMPILED_ITERATIONS = 64;
+
+	void append_format(std::string& output, const char* format, ...)
+	{
+		char buffer[256];
+		va_list args;
+		va_start(args, format);
+		core::str::vsnprintf(buffer, 256, format, args);
+		va_end(args);
+		output.append(buffer);
+	}
+
+	void append_matrix(std::string& output, float translate_x)
+	{
+		append_format(output, "[1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, %g, 0, 0, 1]", translate_x);
+	}
+
+	// Generates a skinned grid in the JSON .model format.
+	void generate_model(std::string& output)
+	{
+		const float step = 1.0f / static_cast<float>(GRID_SIZE - 1);
+
+		output.append("{\"materials\": [{\"id\": 0, \"name\": \"materials/default\"}],\n");
+		output.append("\"children\": [{\"name\": \"grid\", \"type\": \"mesh\", \"material_id\": 0,\n");
+		output.append("\"mins\": [0, 0, 0], \"maxs\": [1, 0, 1],\n");
+
+		output.append("\"skeleton\": [");
+		for (uint32_t bone = 0; bone < TOTAL_BONES; ++bone)
+		{
+			append_format(output, "%s{\"name\": \"bone%u\", \"parent\": %i}", (bone > 0) ? ", " : "", bone, static_cast<int32_t>(bone) - 1);
+		}
+		output.append("],\n\"bind_data\": [");
+		for (uint32_t bone = 0; bone < TOTAL_BONES; ++bone)
+		{
+			append_format(output, "%s{\"name\": \"bone%u\", \"bind_pose\": ", (bone > 0) ? ", " : "", bone);
+			append_matrix(output, bone * step);
+			output.append(", \"inverse_bind_pose\": ");
+			append_matrix(output, -(bone * step));
+			output.append("}");
+		}
+
+		output.append("],\n\"vertices\": [");
+		for (uint32_t index = 0; index < (GRID_SIZE * GRID_SIZE); ++index)
+		{
+			append_format(output, "%s[%g, 0, %g]", (index > 0) ? ", " : "", (index % GRID_SIZE) * step, (index / GRID_SIZE) * step);
+		}
+
+		output.append("],\n\"normals\": [");
+		for (uint32_t index = 0; index < (GRID_SIZE * GRID_SIZE); ++index)
+		{
+			output.append((index > 0) ? ", [0, 1, 0]" : "[0, 1, 0]");
+		}
+
+		output.append("],\n\"uv_sets\": [[");
+		for (uint32_t index = 0; index < (GRID_SIZE * GRID_SIZE); ++index)
+		{
+			append_format(output, "%s[%g, %g]", (index > 0) ? ", " : "", (index % GRID_SIZE) * step, (index / GRID_SIZE) * step);
+		}
+
+		output.append("]],\n\"blend_weights\": [");
+		for (uint32_t index = 0; index < (GRID_SIZE * GRID_SIZE); ++index)
+		{
+			const uint32_t bone = ((index % GRID_SIZE) * TOTAL_BONES) / GRID_SIZE;
+			const uint32_t next_bone = (bone + 1 < TOTAL_BONES) ? (bone + 1) : bone;
+			append_format(output, "%s[{\"bone\": \"bone%u\", \"value\": 0.75}, {\"bone\": \"bone%u\", \"value\": 0.25}]", (index > 0) ? ", " : "", bone, next_bone);
+		}
+
+		output.append("],\n\"indices\": [");
+		for (uint32_t row = 0; row < (GRID_SIZE - 1); ++row)
+		{
+			for (uint32_t column = 0; column < (GRID_SIZE - 1); ++column)
+			{
+				const uint32_t base = (row * GRID_SIZE) + column;
+				append_format(output, "%s%u, %u, %u, %u, %u, %u",
+					(row > 0 || column > 0) ? ", " : "",
+					base, base + GRID_SIZE, base + 1,
+					base + 1, base + GRID_SIZE, base + GRID_SIZE + 1);
+			}
+		}
+		output.append("]}]}\n");
+	}
+
+	bool write_file(const char* path, const void* data, size_t data_size)
+	{
+		platform::File handle = platform::fs_open(path, platform::FileMode_Write);
+		if (!handle.is_open())
+		{
+			return false;
+		}
+
+		platform::fs_write(handle, data, 1, data_size);
+		platform::fs_close(handle);
+		return true;
+	}
+
+	bool read_file(Array<unsigned char>& buffer, const char* path)
+	{
+		platform::File handle = platform::fs_open(path, platform::FileMode_Read);
+		if (!handle.is_open())
+		{
+			return false;
+		}
+
+		platform::fs_seek(handle, 0, platform::FileSeek_End);
+		size_t file_size = static_cast<size_t>(platform::fs_tell(handle));
+		platform::fs_seek(handle, 0, platform::FileSeek_Begin);
+		buffer.resize(file_size, 0);
+		platform::fs_read(handle, &buffer[0], 1, file_size);
+		platform::fs_close(handle);
+		return true;
+	}
+
+	bool load_json(Allocator& allocator, Array<unsigned char>& output, const char* path)
+	{
+		Array<unsigned char> source(allocator);
+		if (!read_file(source, path))
+		{
+			return false;
+		}
+
+		MeshFormatCompileState state;
+		state.allocator = &allocator;
+		state.output = &output;
+		return core::util::parse_json_string_with_callback(reinterpret_cast<const char*>(&source[0]), source.size(), mesh_format_compile_json, &state);
+	}
+
+	uint32_t load_compiled(const char* path, bool read_streams)
+	{
+		platform::FileMapping mapping = platform::fs_map_file(path);
+		const MeshFormatHeader* header = mesh_format_header(mapping.data, mapping.size);
+		assert(header);
+
+		uint32_t checksum = header->total_vertices;
+		if (read_streams)
+		{
+			const uint32_t* words = mesh_format_section<uint32_t>(header, header->vertices);
+			const size_t total_words = (header->vertices.size + header->indices.size) / sizeof(uint32_t);
+			for (size_t index = 0; index < total_words; ++index)
+			{
+				checksum += words[index];
+			}
+		}
+
+		platform::fs_unmap_file(mapping);
+		return checksum;
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+
+		platform::PathString model_path = platform::get_user_temp_directory();
+		model_path.append(PATH_SEPARATOR_STRING);
+		model_path.append("test_meshload.model");
+
+		platform::PathString compiled_path = platform::get_user_temp_directory();
+		compiled_path.append(PATH_SEPARATOR_STRING);
+		compiled_path.append("test_meshload" MESH_FORMAT_EXTENSION);
+
+		// write both versions of the mesh
+		{
+			std::string model;
+			generate_model(model);
+			write_file(model_path(), model.c_str(), model.size());
+
+			Array<unsigned char> compiled(allocator);
+			if (!load_json(allocator, compiled, model_path()))
+			{
+				LOGE("Unable to compile the test mesh!\n");
+				return -1;
+			}
+			write_file(compiled_path(), &compiled[0], compiled.size());
+
+			const MeshFormatHeader* header = reinterpret_cast<const MeshFormatHeader*>(&compiled[0]);
+			LOGV("mesh: %u vertices, %u indices, %u bones\n", header->total_vertices, header->total_indices, header->total_joints);
+			LOGV("json: %lu bytes, compiled: %lu bytes\n", (unsigned long)model.size(), (unsigned long)compiled.size());
+		}
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < JSON_ITERATIONS; ++iteration)
+		{
+			Array<unsigned char> output(allocator);
+			load_json(allocator, output, model_path());
+		}
+		const double json_ms = (platform::microseconds() - start) / (1000.0 * JSON_ITERATIONS);
+
+		uint32_t checksum = 0;
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < COMPILED_ITERATIONS; ++iteration)
+		{
+			checksum += load_compiled(compiled_path(), false);
+		}
+		const double map_ms = (platform::microseconds() - start) / (1000.0 * COMPILED_ITERATIONS);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < COMPILED_ITERATIONS; ++iteration)
+		{
+			checksum += load_compiled(compiled_path(), true);
+		}
+		const double read_ms = (platform::microseconds() - start) / (1000.0 * COMPILED_ITERATIONS);
+
+		LOGV("json parse + interleave:   %10.3f ms\n", json_ms);
+		LOGV("compiled map + validate:   %10.3f ms (%.0fx)\n", map_ms, json_ms / map_ms);
+		LOGV("compiled map + read data:  %10.3f ms (%.0fx) [checksum %u]\n", read_ms, json_ms / read_ms, checksum);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
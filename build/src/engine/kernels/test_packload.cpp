@@ -0,0 +1,263 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/array.h>
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mem.h>
+#include <core/str.h>
+
+#include <platform/platform.h>
+
+#include <runtime/filesystem_interface.h>
+#include <runtime/pack_filesystem.h>
+#include <runtime/pack_format.h>
+
+#include <stdarg.h>
+#include <string>
+#include <vector>
+
+// Compares startup loads of a content tree with many small files:
+//	- Loose: FileSystemInterface::virtual_load_file for each file; which
+//	  checks the file exists, opens it, seeks for the size and reads it.
+//	- Pack: mount the pack then virtual_load_file for each file.
+//	- Compressed pack: as above with LZ4 compressed entries.
+//	- Pack views: mount the pack then virtual_map_file for each file; no
+//	  copy is made. The data is summed to account for page faults.
+//
+// The tree and packs are written right before they're loaded, so these
+// are warm-cache numbers; a cold start favors the pack further.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t TOTAL_DIRECTORIES = 64;
+	const uint32_t FILES_PER_DIRECTORY = 64;
+	const uint32_t ITERATIONS = 8;
+
+	void append_format(std::string& output, const char* format, ...)
+	{
+		char buffer[256];
+		va_list args;
+		va_start(args, format);
+		core::str::vsnprintf(buffer, 256, format, args);
+		va_end(args);
+		output.append(buffer);
+	}
+
+	// Generates a material-like JSON file of roughly 150 bytes to 2 KiB.
+	void generate_file(std::string& output, uint32_t index)
+	{
+		const uint32_t total_parameters = 2 + ((index * 2654435761U) >> 27);
+		output = "{\n\t\"shader\": \"objects\",\n\t\"parameters\": [\n";
+		for (uint32_t parameter = 0; parameter < total_parameters; ++parameter)
+		{
+			append_format(output, "\t\t{\"name\": \"param%u\", \"value\": [%u, %u, %u]},\n", parameter, index, parameter, index ^ parameter);
+		}
+		output.append("\t]\n}\n");
+	}
+
+	bool write_file(const char* path, const void* data, size_t data_size)
+	{
+		platform::File handle = platform::fs_open(path, platform::FileMode_Write);
+		if (!handle.is_open())
+		{
+			return false;
+		}
+
+		platform::fs_write(handle, data, 1, data_size);
+		platform::fs_close(handle);
+		return true;
+	}
+
+	bool write_pack(Allocator& allocator, const char* path, const PackFormatSource* sources, size_t total_sources, uint32_t flags)
+	{
+		Array<unsigned char> output(allocator);
+		PackFormatWriteState state;
+		state.allocator = &allocator;
+		state.output = &output;
+		state.flags = flags;
+		state.total_compressed = 0;
+		if (!pack_format_write(state, sources, total_sources))
+		{
+			return false;
+		}
+
+		LOGV("%s: %lu bytes, %u compressed entries\n", path, (unsigned long)output.size(), state.total_compressed);
+		return write_file(path, &output[0], output.size());
+	}
+
+	uint32_t load_all(core::filesystem::IFileSystem* filesystem, Allocator& allocator, const std::vector<std::string>& paths)
+	{
+		uint32_t checksum = 0;
+		Array<unsigned char> buffer(allocator);
+		for (size_t index = 0; index < paths.size(); ++index)
+		{
+			buffer.clear();
+			filesystem->virtual_load_file(buffer, paths[index].c_str());
+			checksum += static_cast<uint32_t>(buffer.size()) + buffer[buffer.size() / 2];
+		}
+		return checksum;
+	}
+
+	uint32_t map_all(core::filesystem::IFileSystem* filesystem, const std::vector<std::string>& paths)
+	{
+		uint32_t checksum = 0;
+		for (size_t index = 0; index < paths.size(); ++index)
+		{
+			platform::FileMapping mapping;
+			if (filesystem->virtual_map_file(mapping, paths[index].c_str()))
+			{
+				const unsigned char* data = static_cast<const unsigned char*>(mapping.data);
+				for (size_t offset = 0; offset < mapping.size; ++offset)
+				{
+					checksum += data[offset];
+				}
+				filesystem->virtual_unmap_file(mapping);
+			}
+		}
+		return checksum;
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+
+		platform::PathString content_path = platform::get_user_temp_directory();
+		content_path.append(PATH_SEPARATOR_STRING);
+		content_path.append("test_packload");
+
+		platform::PathString pack_path = platform::get_user_temp_directory();
+		pack_path.append(PATH_SEPARATOR_STRING);
+		pack_path.append("test_packload" PACK_FORMAT_EXTENSION);
+
+		platform::PathString compressed_pack_path = platform::get_user_temp_directory();
+		compressed_pack_path.append(PATH_SEPARATOR_STRING);
+		compressed_pack_path.append("test_packload_compressed" PACK_FORMAT_EXTENSION);
+
+		// write the loose tree and both packs
+		std::vector<std::string> paths;
+		{
+			std::vector<std::string> contents;
+			size_t total_bytes = 0;
+			for (uint32_t directory = 0; directory < TOTAL_DIRECTORIES; ++directory)
+			{
+				platform::PathString directory_path = content_path;
+				directory_path.append(PATH_SEPARATOR_STRING);
+				directory_path.append(core::str::format("materials%u", directory));
+				directory_path.append(PATH_SEPARATOR_STRING);
+				directory_path.normalize(PATH_SEPARATOR);
+				platform::path::make_directories(directory_path());
+
+				for (uint32_t file = 0; file < FILES_PER_DIRECTORY; ++file)
+				{
+					std::string relative_path = core::str::format("materials%u/material%u.material", directory, file);
+					std::string data;
+					generate_file(data, (directory * FILES_PER_DIRECTORY) + file);
+
+					platform::PathString fullpath = content_path;
+					fullpath.append(PATH_SEPARATOR_STRING);
+					fullpath.append(relative_path.c_str());
+					fullpath.normalize(PATH_SEPARATOR);
+					write_file(fullpath(), data.c_str(), data.size());
+
+					paths.push_back(relative_path);
+					contents.push_back(data);
+					total_bytes += data.size();
+				}
+			}
+
+			Array<PackFormatSource> sources(allocator);
+			for (size_t index = 0; index < paths.size(); ++index)
+			{
+				PackFormatSource source;
+				source.path = paths[index].c_str();
+				source.data = contents[index].c_str();
+				source.size = contents[index].size();
+				sources.push_back(source);
+			}
+
+			LOGV("content: %lu files, %lu bytes\n", (unsigned long)paths.size(), (unsigned long)total_bytes);
+			if (!write_pack(allocator, pack_path(), &sources[0], sources.size(), 0) ||
+				!write_pack(allocator, compressed_pack_path(), &sources[0], sources.size(), PackFormatWrite_Compress))
+			{
+				LOGE("Unable to write the test packs!\n");
+				return -1;
+			}
+		}
+
+		uint32_t checksum = 0;
+
+		core::filesystem::FileSystemInterface loose;
+		loose.content_directory(content_path);
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			checksum += load_all(&loose, allocator, paths);
+		}
+		const double loose_ms = (platform::microseconds() - start) / (1000.0 * ITERATIONS);
+
+		core::filesystem::PackFileSystem packed;
+		packed.content_directory(content_path);
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			packed.mount(pack_path());
+			checksum += load_all(&packed, allocator, paths);
+			packed.unmount();
+		}
+		const double pack_ms = (platform::microseconds() - start) / (1000.0 * ITERATIONS);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			packed.mount(compressed_pack_path());
+			checksum += load_all(&packed, allocator, paths);
+			packed.unmount();
+		}
+		const double compressed_ms = (platform::microseconds() - start) / (1000.0 * ITERATIONS);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			packed.mount(pack_path());
+			checksum += map_all(&packed, paths);
+			packed.unmount();
+		}
+		const double view_ms = (platform::microseconds() - start) / (1000.0 * ITERATIONS);
+
+		LOGV("loose files:               %10.3f ms\n", loose_ms);
+		LOGV("pack:                      %10.3f ms (%.1fx)\n", pack_ms, loose_ms / pack_ms);
+		LOGV("compressed pack:           %10.3f ms (%.1fx)\n", compressed_ms, loose_ms / compressed_ms);
+		LOGV("pack views:                %10.3f ms (%.1fx) [checksum %u]\n", view_ms, loose_ms / view_ms, checksum);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
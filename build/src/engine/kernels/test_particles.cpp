@@ -0,0 +1,321 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mathlib.h>
+#include <core/mem.h>
+#include <core/util.h>
+
+#include <platform/platform.h>
+
+#include <runtime/job_scheduler.h>
+
+#include <engine/game/particlesystem.h>
+
+// Simulates a single emitter at steady state and reports particles/ms.
+//	- reference: the previous emitter; an array of Particle structs
+//	  stepped one particle at a time
+//	- streams: structure-of-arrays, vectorized on the calling thread
+//	- streams + jobs: the same, split across JobScheduler workers
+// Vertex writes are measured the same way; the output buffer stands
+// in for a mapped vertex buffer.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t PARTICLE_COUNTS[] = { 4096, 16384, 65536 };
+	const uint32_t TOTAL_PARTICLE_COUNTS = sizeof(PARTICLE_COUNTS) / sizeof(PARTICLE_COUNTS[0]);
+
+	const float STEP_SECONDS = (1.0f / 60.0f);
+	const uint32_t WARMUP_STEPS = 120;
+	const uint32_t TIMED_STEPS = 240;
+
+	volatile uint32_t sink = 0;
+
+	// The previous particle layout; its PhysicsState is reduced to the
+	// current position and curves are linear as in EmitterConfig.
+	struct ReferenceParticle
+	{
+		Color color;
+		glm::vec3 position;
+		glm::vec3 velocity;
+
+		float life_remaining;
+		float life_total;
+		float size;
+
+		ReferenceParticle()
+			: life_remaining(0.0f)
+			, life_total(0.0f)
+			, size(1.0f)
+		{
+		}
+	};
+
+	struct ReferenceEmitter
+	{
+		EmitterConfig* emitter_config;
+		glm::vec3 world_position;
+		ReferenceParticle* particle_list;
+		uint32_t num_particles_alive;
+		float next_spawn;
+	};
+
+	void reference_generate_particle(ReferenceEmitter& emitter, ReferenceParticle* p)
+	{
+		const EmitterConfig* config = emitter.emitter_config;
+		p->life_total = p->life_remaining = core::util::random_range(config->life_min, config->life_max) * MillisecondsPerSecond;
+		p->velocity = glm::vec3(core::util::random_range(config->velocity_min.x, config->velocity_max.x),
+								core::util::random_range(config->velocity_min.y, config->velocity_max.y),
+								core::util::random_range(config->velocity_min.z, config->velocity_max.z));
+		p->position = emitter.world_position;
+		p->color = config->color_start;
+		p->size = config->size_start;
+	}
+
+	void reference_step(ReferenceEmitter& emitter, float delta_seconds)
+	{
+		const EmitterConfig* config = emitter.emitter_config;
+		const float delta_msec = (delta_seconds * MillisecondsPerSecond);
+		Interpolator<Color> color_interpolator;
+
+		emitter.next_spawn -= delta_seconds;
+		uint32_t particles_to_spawn = 0;
+		if (emitter.next_spawn <= 0)
+		{
+			emitter.next_spawn = config->spawn_delay_seconds;
+			particles_to_spawn = glm::min(config->spawn_rate, config->max_particles - emitter.num_particles_alive);
+		}
+
+		emitter.num_particles_alive = 0;
+		for (uint32_t pid = 0; pid < config->max_particles; ++pid)
+		{
+			ReferenceParticle* p = &emitter.particle_list[pid];
+			p->life_remaining -= delta_msec;
+
+			if (p->life_remaining > 0.1)
+			{
+				float lifet = 1.0 - (p->life_remaining / p->life_total);
+				p->position += (p->velocity * delta_seconds);
+				p->color = color_interpolator(config->color_start, config->color_end, lifet);
+				p->size = lerp(config->size_start, config->size_end, lifet);
+				++emitter.num_particles_alive;
+			}
+			else if (particles_to_spawn > 0)
+			{
+				reference_generate_particle(emitter, p);
+				--particles_to_spawn;
+				++emitter.num_particles_alive;
+			}
+		}
+	}
+
+	// The previous emitter had no vertex output; this is what building
+	// quads from the Particle array looks like.
+	uint32_t reference_write_vertices(const ReferenceEmitter& emitter, ParticleVertex* vertices, const glm::vec3& right, const glm::vec3& up)
+	{
+		const glm::vec3 corners[4] = { (-right - up), (right - up), (right + up), (-right + up) };
+		const float uvs[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+		uint32_t total = 0;
+		for (uint32_t pid = 0; pid < emitter.emitter_config->max_particles; ++pid)
+		{
+			const ReferenceParticle& p = emitter.particle_list[pid];
+			if (p.life_remaining > 0.1)
+			{
+				const uint32_t color = p.color.as_uint32();
+				for (uint32_t corner = 0; corner < PARTICLE_VERTICES_PER_PARTICLE; ++corner)
+				{
+					const glm::vec3 position = p.position + (corners[corner] * p.size);
+					vertices->x = position.x;
+					vertices->y = position.y;
+					vertices->z = position.z;
+					vertices->color = color;
+					vertices->u = uvs[corner][0];
+					vertices->v = uvs[corner][1];
+					++vertices;
+				}
+				++total;
+			}
+		}
+		return total;
+	}
+
+	// particles stay alive for about a second; spawn enough to keep the
+	// emitter close to full.
+	void setup_config(EmitterConfig& config, uint32_t max_particles)
+	{
+		config.max_particles = max_particles;
+		config.spawn_rate = (max_particles / 40);
+		config.spawn_delay_seconds = 0.0f;
+		config.life_min = 0.75f;
+		config.life_max = 1.25f;
+		config.velocity_min = glm::vec3(-1.0f, 2.0f, -1.0f);
+		config.velocity_max = glm::vec3(1.0f, 4.0f, 1.0f);
+		config.color_start = Color(1.0f, 0.75f, 0.25f, 1.0f);
+		config.color_end = Color(0.25f, 0.0f, 0.0f, 0.0f);
+		config.size_start = 0.25f;
+		config.size_end = 1.0f;
+	}
+
+	double particles_per_msec(uint64_t total_particles, uint64_t elapsed_microseconds)
+	{
+		if (elapsed_microseconds == 0)
+		{
+			elapsed_microseconds = 1;
+		}
+		return (total_particles * MicrosecondsPerMillisecond) / static_cast<double>(elapsed_microseconds);
+	}
+
+	struct Result
+	{
+		double step;
+		double vertices;
+	};
+
+	Result run_reference(Allocator& allocator, EmitterConfig& config, ParticleVertex* vertices)
+	{
+		ReferenceEmitter emitter;
+		emitter.emitter_config = &config;
+		emitter.world_position = glm::vec3(0.0f);
+		emitter.particle_list = MEMORY2_NEW_ARRAY(allocator, ReferenceParticle, config.max_particles);
+		emitter.num_particles_alive = 0;
+		emitter.next_spawn = 0.0f;
+
+		for (uint32_t step = 0; step < WARMUP_STEPS; ++step)
+		{
+			reference_step(emitter, STEP_SECONDS);
+		}
+
+		uint64_t total_particles = 0;
+		uint64_t start = platform::microseconds();
+		for (uint32_t step = 0; step < TIMED_STEPS; ++step)
+		{
+			reference_step(emitter, STEP_SECONDS);
+			total_particles += emitter.num_particles_alive;
+		}
+		const uint64_t step_elapsed = platform::microseconds() - start;
+
+		const glm::vec3 right(1.0f, 0.0f, 0.0f);
+		const glm::vec3 up(0.0f, 1.0f, 0.0f);
+		uint64_t total_written = 0;
+		start = platform::microseconds();
+		for (uint32_t step = 0; step < TIMED_STEPS; ++step)
+		{
+			total_written += reference_write_vertices(emitter, vertices, right, up);
+			sink = sink + vertices[step % 4].color;
+		}
+		const uint64_t vertex_elapsed = platform::microseconds() - start;
+
+		MEMORY2_DELETE_ARRAY(allocator, emitter.particle_list);
+
+		Result result;
+		result.step = particles_per_msec(total_particles, step_elapsed);
+		result.vertices = particles_per_msec(total_written, vertex_elapsed);
+		return result;
+	}
+
+	Result run_streams(Allocator& allocator, EmitterConfig& config, ParticleVertex* vertices, JobScheduler* scheduler)
+	{
+		ParticleSystem system(allocator);
+		ParticleEmitter* emitter = system.add_emitter();
+		emitter->world_position = glm::vec3(0.0f);
+		emitter->load_from_emitter_config(&config);
+
+		for (uint32_t step = 0; step < WARMUP_STEPS; ++step)
+		{
+			system.step(STEP_SECONDS, scheduler);
+			memory_frame_advance();
+		}
+
+		uint64_t total_particles = 0;
+		uint64_t start = platform::microseconds();
+		for (uint32_t step = 0; step < TIMED_STEPS; ++step)
+		{
+			system.step(STEP_SECONDS, scheduler);
+			total_particles += system.total_particles();
+			memory_frame_advance();
+		}
+		const uint64_t step_elapsed = platform::microseconds() - start;
+
+		const glm::vec3 right(1.0f, 0.0f, 0.0f);
+		const glm::vec3 up(0.0f, 1.0f, 0.0f);
+		uint64_t total_written = 0;
+		start = platform::microseconds();
+		for (uint32_t step = 0; step < TIMED_STEPS; ++step)
+		{
+			total_written += system.write_vertices(vertices, config.max_particles, right, up, scheduler);
+			sink = sink + vertices[step % 4].color;
+			memory_frame_advance();
+		}
+		const uint64_t vertex_elapsed = platform::microseconds() - start;
+
+		system.purge();
+
+		Result result;
+		result.step = particles_per_msec(total_particles, step_elapsed);
+		result.vertices = particles_per_msec(total_written, vertex_elapsed);
+		return result;
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_GAME);
+
+		const uint32_t max_particles = PARTICLE_COUNTS[TOTAL_PARTICLE_COUNTS - 1];
+		ParticleVertex* vertices = static_cast<ParticleVertex*>(MEMORY2_ALLOC(allocator, sizeof(ParticleVertex) * PARTICLE_VERTICES_PER_PARTICLE * max_particles));
+
+		const uint32_t threads = static_cast<uint32_t>(platform::system_processor_count());
+		JobScheduler scheduler(allocator);
+		scheduler.create_workers(threads - 1);
+
+		LOGV("%u steps of %2.2f ms; streams + jobs uses %u threads\n", TIMED_STEPS, STEP_SECONDS * MillisecondsPerSecond, threads);
+		LOGV("particles |            step particles/ms            |          vertex particles/ms\n");
+		LOGV("          |  reference    streams  streams + jobs  |  reference    streams  streams + jobs\n");
+		for (uint32_t index = 0; index < TOTAL_PARTICLE_COUNTS; ++index)
+		{
+			EmitterConfig config;
+			setup_config(config, PARTICLE_COUNTS[index]);
+
+			const Result reference = run_reference(allocator, config, vertices);
+			const Result streams = run_streams(allocator, config, vertices, nullptr);
+			const Result jobs = run_streams(allocator, config, vertices, &scheduler);
+			LOGV("%9u | %10.0f %10.0f %15.0f  | %10.0f %10.0f %15.0f\n", config.max_particles,
+				reference.step, streams.step, jobs.step,
+				reference.vertices, streams.vertices, jobs.vertices);
+		}
+
+		scheduler.destroy_workers();
+		MEMORY2_DEALLOC(allocator, vertices);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
@@ -0,0 +1,158 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mem.h>
+#include <core/profiler.h>
+
+#include <platform/platform.h>
+
+// Measures the cost of a PROFILE_BEGIN/PROFILE_END pair:
+//	- baseline: the loop body without any scope
+//	- idle: profiler compiled in, capture disabled
+//	- capture: recording into the calling thread's buffer
+//	- contended: capture on every processor at once
+//
+// Build with --with-profiler (GEMINI_ENABLE_PROFILER) to measure the
+// profiler; otherwise the scopes compile out and match the baseline.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t TOTAL_SCOPES = 4 * 1024 * 1024;
+
+	volatile uint32_t sink = 0;
+
+	uint64_t run_baseline(uint32_t total_scopes)
+	{
+		uint64_t start = platform::time_ticks();
+		for (uint32_t index = 0; index < total_scopes; ++index)
+		{
+			sink = sink + index;
+		}
+		return platform::time_ticks() - start;
+	}
+
+	uint64_t run_scopes(uint32_t total_scopes)
+	{
+		uint64_t start = platform::time_ticks();
+		for (uint32_t index = 0; index < total_scopes; ++index)
+		{
+			PROFILE_BEGIN("benchmark_scope");
+			sink = sink + index;
+			PROFILE_END("benchmark_scope");
+		}
+		return platform::time_ticks() - start;
+	}
+
+	struct ThreadResult
+	{
+		uint64_t ticks;
+	};
+
+	void contended_thread(platform::Thread* thread)
+	{
+		ThreadResult* result = static_cast<ThreadResult*>(thread->user_data);
+		PROFILE_THREAD_NAME("benchmark worker");
+		result->ticks = run_scopes(TOTAL_SCOPES);
+	}
+
+	// convert ticks to nanoseconds using microseconds() as a reference
+	double nanoseconds_per_tick()
+	{
+		uint64_t start_ticks = platform::time_ticks();
+		uint64_t start_microseconds = platform::microseconds();
+		platform::thread_sleep(50);
+		uint64_t elapsed_ticks = platform::time_ticks() - start_ticks;
+		uint64_t elapsed_microseconds = platform::microseconds() - start_microseconds;
+		return (elapsed_microseconds * 1000.0) / static_cast<double>(elapsed_ticks);
+	}
+
+	void set_capture(bool enabled)
+	{
+#if defined(GEMINI_ENABLE_PROFILER)
+		profiler::set_capture(enabled);
+		profiler::next_frame();
+#else
+		(void)enabled;
+#endif
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+		const double tick_ns = nanoseconds_per_tick();
+
+#if defined(GEMINI_ENABLE_PROFILER)
+		LOGV("profiler: enabled\n");
+		PROFILE_THREAD_NAME("main");
+#else
+		LOGV("profiler: compiled out (build with --with-profiler to measure it)\n");
+#endif
+
+		const double baseline = run_baseline(TOTAL_SCOPES) * tick_ns / TOTAL_SCOPES;
+
+		set_capture(false);
+		const double idle = run_scopes(TOTAL_SCOPES) * tick_ns / TOTAL_SCOPES;
+
+		set_capture(true);
+		const double capture = run_scopes(TOTAL_SCOPES) * tick_ns / TOTAL_SCOPES;
+
+		// every processor records at once
+		const uint32_t total_threads = static_cast<uint32_t>(platform::system_processor_count());
+		ThreadResult* results = MEMORY2_NEW_ARRAY(allocator, ThreadResult, total_threads);
+		platform::Thread** threads = MEMORY2_NEW_ARRAY(allocator, platform::Thread*, total_threads);
+		for (uint32_t index = 0; index < total_threads; ++index)
+		{
+			threads[index] = platform::thread_create(contended_thread, &results[index]);
+		}
+
+		double contended = 0.0;
+		for (uint32_t index = 0; index < total_threads; ++index)
+		{
+			platform::thread_join(threads[index]);
+			platform::thread_destroy(threads[index]);
+			contended += results[index].ticks * tick_ns / TOTAL_SCOPES;
+		}
+		contended /= total_threads;
+
+		MEMORY2_DELETE_ARRAY(allocator, threads);
+		MEMORY2_DELETE_ARRAY(allocator, results);
+
+		LOGV("%u scopes per run\n", TOTAL_SCOPES);
+		LOGV("baseline:              %6.2f ns/iteration\n", baseline);
+		LOGV("idle (capture off):    %6.2f ns/scope (+%.2f)\n", idle, idle - baseline);
+		LOGV("capture:               %6.2f ns/scope (+%.2f)\n", capture, capture - baseline);
+		LOGV("capture x %2u threads:  %6.2f ns/scope (+%.2f)\n", total_threads, contended, contended - baseline);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
@@ -0,0 +1,275 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mathlib.h>
+#include <core/mem.h>
+
+#include <platform/platform.h>
+
+#include <renderer/commandbuffer.h>
+#include <renderer/renderer.h>
+#include <renderer/rqueue.h>
+#include <renderer/scene_renderer.h>
+
+#include <runtime/job_scheduler.h>
+#include <runtime/material.h>
+#include <runtime/mesh.h>
+
+#include <shared/shared_constants.h>
+
+#include <algorithm>
+#include <stdlib.h>
+
+// Measures the CPU side of drawing a scene with thousands of meshes;
+// without a GPU. Buffers and pipelines are placeholders that are only
+// recorded; never dereferenced.
+//	- Cull: frustum test and key generation on one thread and split
+//	  across JobScheduler workers.
+//	- Sort: std::sort with a comparator (the previous RenderQueue::sort)
+//	  against the radix sort.
+//	- Record: one command queue against one queue per worker.
+// Pipeline and material switches are reported for blocks recorded in
+// scene order (as render_scene_draw previously drew them) and in key order.
+
+using namespace gemini;
+
+namespace
+{
+	const uint32_t TOTAL_OBJECTS = 16384;
+	const uint32_t ANIMATED_OBJECT_RATIO = 8;
+	const uint32_t TOTAL_PROTOTYPES = 32;
+	const uint32_t MAX_GEOMETRY_PER_PROTOTYPE = 4;
+	const uint32_t TOTAL_MATERIALS = 64;
+	const uint32_t TRANSLUCENT_MATERIAL_RATIO = 16;
+	const float SCENE_EXTENTS = 200.0f;
+	const uint32_t ITERATIONS = 32;
+
+	struct Prototype
+	{
+		GeometryDefinition geometry[MAX_GEOMETRY_PER_PROTOTYPE];
+		uint32_t total_geometry;
+	};
+
+	struct BlockCompare
+	{
+		bool operator()(const renderer::RenderBlock& left, const renderer::RenderBlock& right) const
+		{
+			return left.key < right.key;
+		}
+	};
+
+	float random_float(float low, float high)
+	{
+		return low + ((high - low) * (static_cast<float>(rand()) / RAND_MAX));
+	}
+
+	double average_ms(uint64_t start)
+	{
+		return ((platform::microseconds() - start) / 1000.0) / ITERATIONS;
+	}
+} // namespace
+
+int main(int, char**)
+{
+	gemini::core_startup();
+
+	{
+		Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+
+		// placeholder GPU objects; only their addresses are recorded
+		char placeholders[TOTAL_PROTOTYPES * 2 + RenderScenePipeline_Count];
+
+		Prototype* prototypes = MEMORY2_NEW_ARRAY(allocator, Prototype, TOTAL_PROTOTYPES);
+		for (uint32_t index = 0; index < TOTAL_PROTOTYPES; ++index)
+		{
+			Prototype& prototype = prototypes[index];
+			prototype.total_geometry = 1 + (rand() % MAX_GEOMETRY_PER_PROTOTYPE);
+			for (uint32_t geometry = 0; geometry < prototype.total_geometry; ++geometry)
+			{
+				prototype.geometry[geometry].index_offset = geometry * 300;
+				prototype.geometry[geometry].total_indices = 300;
+				prototype.geometry[geometry].material_handle.index = 1 + (rand() % TOTAL_MATERIALS);
+			}
+		}
+
+		Material** materials = MEMORY2_NEW_ARRAY(allocator, Material*, TOTAL_MATERIALS);
+		for (uint32_t index = 0; index < TOTAL_MATERIALS; ++index)
+		{
+			materials[index] = MEMORY2_NEW(allocator, Material)(allocator);
+			materials[index]->flags = ((index % TRANSLUCENT_MATERIAL_RATIO) == 0) ? Material::BLENDING : 0;
+		}
+
+		glm::mat4* model_matrices = MEMORY2_NEW_ARRAY(allocator, glm::mat4, TOTAL_OBJECTS);
+		glm::mat3* normal_matrices = MEMORY2_NEW_ARRAY(allocator, glm::mat3, TOTAL_OBJECTS);
+		glm::mat4* bone_transforms = MEMORY2_NEW_ARRAY(allocator, glm::mat4, MAX_BONES);
+
+		RenderSceneDrawList list(allocator);
+		for (uint32_t index = 0; index < RenderScenePipeline_Count; ++index)
+		{
+			list.pipelines[index] = reinterpret_cast<render2::Pipeline*>(&placeholders[(TOTAL_PROTOTYPES * 2) + index]);
+		}
+
+		list.materials.resize(TOTAL_MATERIALS + 1, nullptr);
+		for (uint32_t index = 0; index < TOTAL_MATERIALS; ++index)
+		{
+			list.materials[index + 1] = materials[index];
+		}
+
+		for (uint32_t index = 0; index < TOTAL_OBJECTS; ++index)
+		{
+			const glm::vec3 position(random_float(-SCENE_EXTENTS, SCENE_EXTENTS), random_float(-SCENE_EXTENTS, SCENE_EXTENTS), random_float(-SCENE_EXTENTS, SCENE_EXTENTS));
+			model_matrices[index] = glm::translate(glm::mat4(1.0f), position);
+			normal_matrices[index] = glm::mat3(1.0f);
+
+			const uint32_t prototype_index = rand() % TOTAL_PROTOTYPES;
+			const bool is_animated = ((index % ANIMATED_OBJECT_RATIO) == 0);
+
+			RenderSceneObject object;
+			object.model_matrix = &model_matrices[index];
+			object.normal_matrix = &normal_matrices[index];
+			object.bone_transforms = is_animated ? bone_transforms : nullptr;
+			object.inverse_bind_poses = is_animated ? bone_transforms : nullptr;
+			object.vertex_buffer = reinterpret_cast<render2::Buffer*>(&placeholders[prototype_index * 2]);
+			object.index_buffer = reinterpret_cast<render2::Buffer*>(&placeholders[(prototype_index * 2) + 1]);
+			object.geometry = prototypes[prototype_index].geometry;
+			object.total_geometry = prototypes[prototype_index].total_geometry;
+			object.mins = glm::vec3(-1.0f, -1.0f, -1.0f);
+			object.maxs = glm::vec3(1.0f, 1.0f, 1.0f);
+			object.pipeline = is_animated ? RenderScenePipeline_Animated : RenderScenePipeline_Static;
+			list.objects.push_back(object);
+		}
+
+		// camera at the origin looking down -Z; about a tenth of the
+		// scene is inside the frustum.
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+		render2::Pass pass;
+
+		const uint32_t total_threads = static_cast<uint32_t>(platform::system_processor_count());
+		JobScheduler scheduler(allocator);
+		scheduler.create_workers(total_threads - 1);
+
+		uint64_t start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			render_scene_cull(&list, view, projection, nullptr);
+		}
+		const double serial_cull_ms = average_ms(start);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			render_scene_cull(&list, view, projection, &scheduler);
+		}
+		const double parallel_cull_ms = average_ms(start);
+
+		const size_t total_blocks = list.queue.size();
+		renderer::RenderBlock* unsorted = MEMORY2_NEW_ARRAY(allocator, renderer::RenderBlock, total_blocks);
+		renderer::RenderBlock* scratch = MEMORY2_NEW_ARRAY(allocator, renderer::RenderBlock, total_blocks);
+		renderer::RenderBlock* sorted = MEMORY2_NEW_ARRAY(allocator, renderer::RenderBlock, total_blocks);
+
+		// blocks are generated in scene order
+		memcpy(unsorted, &list.queue.render_list[0], sizeof(renderer::RenderBlock) * total_blocks);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			memcpy(sorted, unsorted, sizeof(renderer::RenderBlock) * total_blocks);
+			std::sort(sorted, sorted + total_blocks, BlockCompare());
+		}
+		const double std_sort_ms = average_ms(start);
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			memcpy(sorted, unsorted, sizeof(renderer::RenderBlock) * total_blocks);
+			renderer::render_queue_radix_sort(sorted, scratch, total_blocks);
+		}
+		const double radix_sort_ms = average_ms(start);
+
+		// record in scene order to count the switches without sorting
+		memcpy(&list.queue.render_list[0], unsorted, sizeof(renderer::RenderBlock) * total_blocks);
+		render_scene_record(&list, pass, nullptr);
+		const uint32_t unsorted_pipeline_switches = list.stat_pipeline_switches;
+		const uint32_t unsorted_material_switches = list.stat_material_switches;
+
+		list.queue.sort();
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			render_scene_record(&list, pass, nullptr);
+		}
+		const double serial_record_ms = average_ms(start);
+
+		size_t total_commands = 0;
+		for (uint32_t index = 0; index < list.total_command_queues; ++index)
+		{
+			total_commands += list.command_queues[index]->commands.size();
+		}
+
+		start = platform::microseconds();
+		for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+		{
+			render_scene_record(&list, pass, &scheduler);
+		}
+		const double parallel_record_ms = average_ms(start);
+		const uint32_t total_queues = list.total_command_queues;
+
+		scheduler.destroy_workers();
+
+		const double serial_frame_ms = serial_cull_ms + std_sort_ms + serial_record_ms;
+		const double parallel_frame_ms = parallel_cull_ms + radix_sort_ms + parallel_record_ms;
+
+		LOGV("%u objects, %u visible blocks, %u commands\n", TOTAL_OBJECTS, static_cast<uint32_t>(total_blocks), static_cast<uint32_t>(total_commands));
+		LOGV("cull + keys:        %10.3f ms\n", serial_cull_ms);
+		LOGV("cull + keys (%2u):   %10.3f ms (%.1fx)\n", total_threads, parallel_cull_ms, serial_cull_ms / parallel_cull_ms);
+		LOGV("std::sort:          %10.3f ms\n", std_sort_ms);
+		LOGV("radix sort:         %10.3f ms (%.1fx)\n", radix_sort_ms, std_sort_ms / radix_sort_ms);
+		LOGV("record:             %10.3f ms\n", serial_record_ms);
+		LOGV("record (%2u queues): %10.3f ms (%.1fx)\n", total_queues, parallel_record_ms, serial_record_ms / parallel_record_ms);
+		LOGV("frame:              %10.3f ms\n", serial_frame_ms);
+		LOGV("frame (%2u):         %10.3f ms (%.1fx)\n", total_threads, parallel_frame_ms, serial_frame_ms / parallel_frame_ms);
+		LOGV("switches in scene order: %u pipeline, %u material\n", unsorted_pipeline_switches, unsorted_material_switches);
+		LOGV("switches in key order:   %u pipeline, %u material\n", list.stat_pipeline_switches, list.stat_material_switches);
+
+		MEMORY2_DELETE_ARRAY(allocator, sorted);
+		MEMORY2_DELETE_ARRAY(allocator, scratch);
+		MEMORY2_DELETE_ARRAY(allocator, unsorted);
+		MEMORY2_DELETE_ARRAY(allocator, bone_transforms);
+		MEMORY2_DELETE_ARRAY(allocator, normal_matrices);
+		MEMORY2_DELETE_ARRAY(allocator, model_matrices);
+		for (uint32_t index = 0; index < TOTAL_MATERIALS; ++index)
+		{
+			MEMORY2_DELETE(allocator, materials[index]);
+		}
+		MEMORY2_DELETE_ARRAY(allocator, materials);
+		MEMORY2_DELETE_ARRAY(allocator, prototypes);
+	}
+
+	gemini::core_shutdown();
+	return 0;
+}
@@ -24,32 +24,80 @@
 // -------------------------------------------------------------
 #include "rqueue.h"
 
-#include <core/logging.h>
-
-#include <algorithm>
+#include <string.h> // for memset
 
 namespace renderer
 {
-	// this is a descending compare function used to traverse render commands
-	// where higher keys have priority
-	struct DescendingRenderBlockCompare
+	namespace detail
+	{
+		const uint32_t RADIX_BITS = 8;
+		const uint32_t RADIX_BUCKETS = (1 << RADIX_BITS);
+		const uint32_t RADIX_PASSES = (sizeof(RenderKey) * 8) / RADIX_BITS;
+	} // namespace detail
+
+	RenderBlock* render_queue_radix_sort(RenderBlock* blocks, RenderBlock* scratch, size_t total)
 	{
-		bool operator()(const RenderBlock& left, const RenderBlock& right)
+		using namespace detail;
+
+		if (total == 0)
+		{
+			return blocks;
+		}
+
+		// Build the histograms for every digit in one pass over the keys.
+		uint32_t histogram[RADIX_PASSES][RADIX_BUCKETS];
+		memset(histogram, 0, sizeof(histogram));
+		for (size_t index = 0; index < total; ++index)
+		{
+			RenderKey key = blocks[index].key;
+			for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+			{
+				++histogram[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)];
+			}
+		}
+
+		RenderBlock* source = blocks;
+		RenderBlock* destination = scratch;
+		for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
 		{
-			if ( left.key < right.key )
+			uint32_t* counts = histogram[pass];
+			const uint32_t shift = (pass * RADIX_BITS);
+
+			// Skip digits which are identical across all keys; this is
+			// common for the pass and pipeline bits.
+			if (counts[(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == total)
 			{
-				return 1;
+				continue;
 			}
 
-			// What kind of logic was this?
-			//else if ( left.key > right.key )
-			//{
-			//	return -1;
-			//}
+			// exclusive prefix sum to find the offset of each bucket
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket)
+			{
+				uint32_t count = counts[bucket];
+				counts[bucket] = offset;
+				offset += count;
+			}
 
-			return 0;
+			for (size_t index = 0; index < total; ++index)
+			{
+				const RenderBlock& block = source[index];
+				destination[counts[(block.key >> shift) & (RADIX_BUCKETS - 1)]++] = block;
+			}
+
+			RenderBlock* temp = source;
+			source = destination;
+			destination = temp;
 		}
-	};
+
+		return source;
+	} // render_queue_radix_sort
+
+	RenderQueue::RenderQueue(gemini::Allocator& allocator)
+		: render_list(allocator)
+		, scratch(allocator)
+	{
+	}
 
 	void RenderQueue::insert(const RenderBlock& block)
 	{
@@ -58,16 +106,74 @@ namespace renderer
 
 	void RenderQueue::sort()
 	{
-		std::sort(begin(render_list), end(render_list), DescendingRenderBlockCompare());
+		const size_t total_blocks = render_list.size();
+		if (total_blocks < 2)
+		{
+			return;
+		}
+
+		scratch.resize(total_blocks);
+		RenderBlock* sorted = render_queue_radix_sort(&render_list[0], &scratch[0], total_blocks);
+		if (sorted != &render_list[0])
+		{
+			memcpy(&render_list[0], sorted, sizeof(RenderBlock) * total_blocks);
+		}
 	}
 
 	void RenderQueue::clear()
 	{
-		render_list.clear();
+		render_list.resize(0);
 	}
 
 	size_t RenderQueue::size() const
 	{
 		return render_list.size();
 	}
+
+	void render_frustum_from_matrix(RenderFrustum& frustum, const glm::mat4& view_projection)
+	{
+		// Gribb/Hartmann: each plane is the fourth row plus or minus a
+		// row of the combined matrix. glm is column-major; so row r is
+		// (m[0][r], m[1][r], m[2][r], m[3][r]).
+		const glm::mat4& m = view_projection;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			glm::vec4 row(m[0][axis], m[1][axis], m[2][axis], m[3][axis]);
+			glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+			frustum.planes[(axis * 2) + 0] = w + row;
+			frustum.planes[(axis * 2) + 1] = w - row;
+		}
+	} // render_frustum_from_matrix
+
+	bool render_frustum_test_box(const RenderFrustum& frustum, const glm::mat4& model, const glm::vec3& mins, const glm::vec3& maxs)
+	{
+		const glm::vec3 local_center = (mins + maxs) * 0.5f;
+		const glm::vec3 local_extents = (maxs - mins) * 0.5f;
+
+		// Transform the box into world space as a center and
+		// extents along the world axes (Arvo).
+		glm::vec3 center(model[3][0], model[3][1], model[3][2]);
+		glm::vec3 extents(0.0f, 0.0f, 0.0f);
+		for (uint32_t column = 0; column < 3; ++column)
+		{
+			for (uint32_t row = 0; row < 3; ++row)
+			{
+				center[row] += model[column][row] * local_center[column];
+				extents[row] += fabsf(model[column][row]) * local_extents[column];
+			}
+		}
+
+		for (uint32_t plane_index = 0; plane_index < 6; ++plane_index)
+		{
+			const glm::vec4& plane = frustum.planes[plane_index];
+			const float distance = (plane.x * center.x) + (plane.y * center.y) + (plane.z * center.z) + plane.w;
+			const float radius = (fabsf(plane.x) * extents.x) + (fabsf(plane.y) * extents.y) + (fabsf(plane.z) * extents.z);
+			if ((distance + radius) < 0.0f)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	} // render_frustum_test_box
 } // namespace renderer
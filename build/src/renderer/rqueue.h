@@ -24,86 +24,110 @@
 // -------------------------------------------------------------
 #pragma once
 
-#include "renderer.h"
-
 #include <core/typedefs.h>
-#include <core/mem.h>
-
-#include <runtime/asset_handle.h>
-
-#include <vector>
+#include <core/array.h>
+#include <core/mathlib.h>
 
 namespace renderer
 {
-	typedef unsigned int RenderKey;
-
-	// This is used for sorting the texture/shader combination
-	struct RenderMaterial
+	// 64-bit sort key for a single draw.
+	// Opaque keys sort by state first and then front-to-back:
+	//	[63..60] pass | [59..52] pipeline | [51..32] material | [31..0] depth
+	// Translucent keys sort back-to-front before state:
+	//	[63..60] pass | [59..28] inverted depth | [27..20] pipeline | [19..0] material
+	typedef uint64_t RenderKey;
+
+	const uint32_t RENDER_KEY_PASS_BITS = 4;
+	const uint32_t RENDER_KEY_PIPELINE_BITS = 8;
+	const uint32_t RENDER_KEY_MATERIAL_BITS = 20;
+	const uint32_t RENDER_KEY_DEPTH_BITS = 32;
+
+	// Convert a view depth into an unsigned value which preserves ordering.
+	// Negative depths (behind the eye) are clamped to zero.
+	inline uint32_t render_key_depth(float depth)
 	{
-		uint16_t texture;
-		uint16_t shader;
-	};
+		union
+		{
+			float value;
+			uint32_t bits;
+		} convert;
 
-	// Contains necessary data needed in order to submit this to the renderer
-	typedef Geometry RenderObject;
+		// The bit pattern of a non-negative float is monotonic.
+		convert.value = (depth > 0.0f) ? depth : 0.0f;
+		return convert.bits;
+	} // render_key_depth
 
-	// An item in a queue/list that contains a sorting key and a pointer to a RenderObject
-	// A RenderBlock is created for each renderable scene graph node.
-	struct RenderBlock
+	inline RenderKey render_key_opaque(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
 	{
-		RenderKey key;
-
-		RenderObject* object;
-		glm::mat4* object_matrix;
-
-		unsigned int material_id;
-		gemini::AssetHandle shader_id;
-
-		glm::mat4* node_transforms;
-		glm::mat4* inverse_bind_transforms;
-		uint32_t total_transforms;
+		return (static_cast<RenderKey>(pass & ((1 << RENDER_KEY_PASS_BITS) - 1)) << 60)
+			| (static_cast<RenderKey>(pipeline & ((1 << RENDER_KEY_PIPELINE_BITS) - 1)) << 52)
+			| (static_cast<RenderKey>(material & ((1 << RENDER_KEY_MATERIAL_BITS) - 1)) << 32)
+			| static_cast<RenderKey>(render_key_depth(depth));
+	} // render_key_opaque
 
-		RenderBlock(RenderKey _key = 0, RenderObject* _object = 0) :
-			key(_key),
-			object(_object),
-			object_matrix(0),
-
-			material_id(0),
-			shader_id(gemini::AssetHandle()),
+	inline RenderKey render_key_translucent(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
+	{
+		return (static_cast<RenderKey>(pass & ((1 << RENDER_KEY_PASS_BITS) - 1)) << 60)
+			| (static_cast<RenderKey>(~render_key_depth(depth)) << 28)
+			| (static_cast<RenderKey>(pipeline & ((1 << RENDER_KEY_PIPELINE_BITS) - 1)) << 20)
+			| static_cast<RenderKey>(material & ((1 << RENDER_KEY_MATERIAL_BITS) - 1));
+	} // render_key_translucent
 
-			node_transforms(0),
-			inverse_bind_transforms(0),
-			total_transforms(0)
-		{
-		}
+	inline uint32_t render_key_pass(RenderKey key)
+	{
+		return static_cast<uint32_t>(key >> 60);
+	} // render_key_pass
 
-		RenderBlock& operator= (const RenderBlock& other)
-		{
-			key = other.key;
-			object = other.object;
+	// An item in a queue that contains a sorting key and the draw it refers to.
+	// Blocks are kept small so that sorting only moves 16 bytes per draw;
+	// the owner of the queue resolves object and geometry when recording.
+	struct RenderBlock
+	{
+		RenderKey key;
 
-			object_matrix = other.object_matrix;
-			node_transforms = other.node_transforms;
-			inverse_bind_transforms = other.inverse_bind_transforms;
-			total_transforms = other.total_transforms;
+		// index of the object which owns this draw
+		uint32_t object;
 
-			return *this;
-		}
-	};
+		// geometry index within the object
+		uint32_t geometry;
+	}; // RenderBlock
 
 	class RenderQueue
 	{
 	public:
-		typedef std::vector<RenderBlock> RenderList;
+		typedef Array<RenderBlock> RenderList;
 
 		RenderList render_list;
 
-		RenderQueue() {}
+		RenderQueue(gemini::Allocator& allocator);
 		~RenderQueue() {}
 
 		void insert(const RenderBlock& block);
+
+		// Stable least-significant-digit radix sort by key (ascending).
 		void sort();
 		void clear();
 		size_t size() const;
+
+	private:
+		// ping-pong buffer used while sorting
+		RenderList scratch;
 	};
+
+	// Sort total blocks by key; scratch must hold total blocks.
+	// Returns the buffer holding the sorted result (blocks or scratch).
+	RenderBlock* render_queue_radix_sort(RenderBlock* blocks, RenderBlock* scratch, size_t total);
+
+	// Frustum planes (ax + by + cz + d) extracted from a view-projection matrix.
+	// Normals point inward.
+	struct RenderFrustum
+	{
+		glm::vec4 planes[6];
+	}; // RenderFrustum
+
+	void render_frustum_from_matrix(RenderFrustum& frustum, const glm::mat4& view_projection);
+
+	// Returns false if the model-space box transformed by model lies
+	// entirely outside any plane.
+	bool render_frustum_test_box(const RenderFrustum& frustum, const glm::mat4& model, const glm::vec3& mins, const glm::vec3& maxs);
 } // namespace renderer
@@ -24,6 +24,7 @@
 // -------------------------------------------------------------
 #include <core/freelist.h>
 #include <core/logging.h>
+#include <core/str.h>
 
 #include <renderer/commandbuffer.h>
 #include <renderer/debug_draw.h>
@@ -34,6 +35,7 @@
 
 #include <runtime/animation.h>
 #include <runtime/assets.h>
+#include <runtime/job_scheduler.h>
 #include <runtime/material.h>
 #include <runtime/mesh.h>
 
@@ -173,19 +175,28 @@ namespace gemini
 			render_mesh->vertex_buffer = render_scene_state->device->create_vertex_buffer(vertex_buffer_size);
 			render_mesh->index_buffer = render_scene_state->device->create_index_buffer(index_buffer_size);
 
-			// interleave data for upload...
-			char* vertex_data = static_cast<char*>(MEMORY2_ALLOC(*scene->allocator, vertex_buffer_size));
-			if (!is_animated_mesh)
+			if (mesh->interleaved_vertices)
 			{
-				interleave_static_mesh(vertex_data, mesh, total_vertices);
+				// compiled meshes are already interleaved; upload directly.
+				assert(mesh->interleaved_stride == stride);
+				render_scene_state->device->buffer_upload(render_mesh->vertex_buffer, const_cast<void*>(mesh->interleaved_vertices), vertex_buffer_size);
 			}
 			else
 			{
-				interleave_animated_mesh(vertex_data, mesh, total_vertices);
-			}
+				// interleave data for upload...
+				char* vertex_data = static_cast<char*>(MEMORY2_ALLOC(*scene->allocator, vertex_buffer_size));
+				if (!is_animated_mesh)
+				{
+					interleave_static_mesh(vertex_data, mesh, total_vertices);
+				}
+				else
+				{
+					interleave_animated_mesh(vertex_data, mesh, total_vertices);
+				}
 
-			render_scene_state->device->buffer_upload(render_mesh->vertex_buffer, vertex_data, vertex_buffer_size);
-			MEMORY2_DEALLOC(*scene->allocator, vertex_data);
+				render_scene_state->device->buffer_upload(render_mesh->vertex_buffer, vertex_data, vertex_buffer_size);
+				MEMORY2_DEALLOC(*scene->allocator, vertex_data);
+			}
 
 			// upload index data
 			render_scene_state->device->buffer_upload(render_mesh->index_buffer, mesh->indices, index_buffer_size);
@@ -455,220 +466,530 @@ namespace gemini
 	} // render_scene_destroy
 
 
-	void render_scene_draw(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::RenderTarget* render_target)
+	namespace detail
 	{
-		if (!render_target)
+		// Worst case number of commands recorded for a block which changes
+		// pipeline and object: pipeline, vertex buffer, four constants and
+		// the draw. Material changes add two commands per parameter.
+		const uint32_t RENDER_BLOCK_MAX_COMMANDS = 7;
+
+		struct CullJob
 		{
-			render_target = device->default_render_target();
-		}
+			RenderSceneDrawList* list;
+			renderer::RenderFrustum frustum;
+			glm::mat4 view;
+			uint32_t objects_per_job;
+
+			// first block written by each job; followed by its visible blocks
+			uint32_t block_offset[RENDER_SCENE_MAX_JOBS];
+			uint32_t total_blocks[RENDER_SCENE_MAX_JOBS];
+			uint32_t visible_objects[RENDER_SCENE_MAX_JOBS][RenderScenePipeline_Count];
+		}; // CullJob
+
+		struct RecordJob
+		{
+			RenderSceneDrawList* list;
+			uint32_t blocks_per_job;
 
-		scene->stat_static_meshes_drawn = 0;
-		scene->stat_animated_meshes_drawn = 0;
+			uint32_t pipeline_switches[RENDER_SCENE_MAX_JOBS];
+			uint32_t material_switches[RENDER_SCENE_MAX_JOBS];
+		}; // RecordJob
 
-		Color clear_color = Color::from_rgba(128, 128, 128, 255);
+		uint32_t compute_total_jobs(JobScheduler* scheduler, uint32_t total_items, uint32_t minimum_items_per_job)
+		{
+			uint32_t total_jobs = scheduler ? (scheduler->worker_count() + 1) : 1;
+			const uint32_t max_jobs = (total_items + minimum_items_per_job - 1) / minimum_items_per_job;
+			if (total_jobs > max_jobs)
+			{
+				total_jobs = max_jobs;
+			}
 
-		// compute inverse projection and inverse view rotation matrix
-		scene->inverse_view_rotation = glm::inverse(glm::mat3(view));
-		scene->inverse_projection = glm::inverse(projection);
+			if (total_jobs > RENDER_SCENE_MAX_JOBS)
+			{
+				total_jobs = RENDER_SCENE_MAX_JOBS;
+			}
 
+			return (total_jobs > 0) ? total_jobs : 1;
+		} // compute_total_jobs
 
-		//glm::vec3 xaxis = scene->inverse_view_rotation * glm::vec3(1.0f, 0.0f, 0.0f);
-		//PRINT_VEC3(xaxis);
+		void cull_objects(void* data, uint32_t start_job, uint32_t end_job)
+		{
+			CullJob* job = static_cast<CullJob*>(data);
+			RenderSceneDrawList* list = job->list;
+			const uint32_t total_objects = static_cast<uint32_t>(list->objects.size());
 
-		render2::Pass sky_pass;
-		sky_pass.target = render_target;
-		sky_pass.color(clear_color.red, clear_color.blue, clear_color.green, clear_color.alpha);
-		sky_pass.clear_color = true;
-		sky_pass.clear_depth = true;
-		sky_pass.depth_test = false;
-		sky_pass.depth_write = true;
-		sky_pass.cull_mode = render2::CullMode::None;
-		render_sky(scene, device, view, projection, sky_pass);
+			for (uint32_t job_index = start_job; job_index < end_job; ++job_index)
+			{
+				renderer::RenderBlock* blocks = &list->queue.render_list[0] + job->block_offset[job_index];
+				uint32_t total_blocks = 0;
+				uint32_t* visible_objects = job->visible_objects[job_index];
 
-		render2::Pass render_pass;
-		render_pass.target = render_target;
-		render_pass.color(clear_color.red, clear_color.blue, clear_color.green, clear_color.alpha);
-		render_pass.clear_color = false;
-		render_pass.clear_depth = false;
-		render_pass.depth_test = true;
-		render_pass.depth_write = true;
-		render_pass.cull_mode = render2::CullMode::Backface;
-		render_static_meshes(scene, device, view, projection, render_pass);
-
-		render2::Pass animated_pass;
-		animated_pass.target = render_target;
-		animated_pass.clear_color = false;
-		animated_pass.clear_depth = false;
-		animated_pass.depth_test = true;
-		animated_pass.depth_write = true;
-		animated_pass.cull_mode = render2::CullMode::Backface;
-		render_animated_meshes(scene, device, view, projection, animated_pass);
-	} // render_scene_draw
+				const uint32_t first_object = (job_index * job->objects_per_job);
+				uint32_t last_object = first_object + job->objects_per_job;
+				if (last_object > total_objects)
+				{
+					last_object = total_objects;
+				}
 
+				for (uint32_t object_index = first_object; object_index < last_object; ++object_index)
+				{
+					const RenderSceneObject& object = list->objects[object_index];
+					const glm::mat4& model = *object.model_matrix;
 
-	void _render_setup_material(render2::CommandSerializer* serializer, AssetHandle material_handle)
-	{
-		Material* material = material_from_handle(material_handle);
-		for (size_t param_index = 0; param_index < material->parameters.size(); ++param_index)
+					const bool has_bounds = (object.maxs.x > object.mins.x) || (object.maxs.y > object.mins.y) || (object.maxs.z > object.mins.z);
+					if (has_bounds && !renderer::render_frustum_test_box(job->frustum, model, object.mins, object.maxs))
+					{
+						continue;
+					}
+
+					// distance along the view direction to the center of the bounds
+					const glm::vec3 center = mathlib::transform_point(model, (object.mins + object.maxs) * 0.5f);
+					const glm::mat4& view = job->view;
+					const float depth = -((view[0][2] * center.x) + (view[1][2] * center.y) + (view[2][2] * center.z) + view[3][2]);
+
+					for (uint32_t geometry_index = 0; geometry_index < object.total_geometry; ++geometry_index)
+					{
+						const uint32_t material_slot = render_scene_material_slot(object.geometry[geometry_index].material_handle);
+						const Material* material = (material_slot < list->materials.size()) ? list->materials[material_slot] : nullptr;
+
+						renderer::RenderBlock& block = blocks[total_blocks++];
+						if (material && (material->flags & Material::BLENDING))
+						{
+							block.key = renderer::render_key_translucent(RenderScenePass_Translucent, object.pipeline, material_slot, depth);
+						}
+						else
+						{
+							block.key = renderer::render_key_opaque(RenderScenePass_Opaque, object.pipeline, material_slot, depth);
+						}
+						block.object = object_index;
+						block.geometry = geometry_index;
+					}
+
+					++visible_objects[object.pipeline];
+				}
+
+				job->total_blocks[job_index] = total_blocks;
+			}
+		} // cull_objects
+
+		void record_constant(render2::CommandQueue* queue, const char* name, const void* data, size_t data_size)
 		{
-			renderer::MaterialParameter* parameter = &material->parameters[param_index];
-			if (parameter->type == renderer::MP_SAMPLER_2D)
+			// The name is referenced rather than copied; callers only
+			// pass literals or names owned by a material.
+			const size_t name_length = core::str::len(name) + 1;
+			queue->add_command(render2::Command(render2::COMMAND_CONSTANT, const_cast<char*>(name), const_cast<void*>(data), data_size, name_length));
+		} // record_constant
+
+		void record_material(render2::CommandQueue* queue, Material* material)
+		{
+			for (size_t param_index = 0; param_index < material->parameters.size(); ++param_index)
 			{
-				render2::Texture* texture = texture_from_handle(parameter->texture_handle);
-				serializer->constant(parameter->name.c_str(), &parameter->texture_unit, sizeof(uint32_t));
-				serializer->texture(texture, parameter->texture_unit);
+				renderer::MaterialParameter* parameter = &material->parameters[param_index];
+				if (parameter->type == renderer::MP_SAMPLER_2D)
+				{
+					render2::Texture* texture = texture_from_handle(parameter->texture_handle);
+					record_constant(queue, parameter->name.c_str(), &parameter->texture_unit, sizeof(uint32_t));
+					queue->add_command(render2::Command(render2::COMMAND_TEXTURE, texture, 0, parameter->texture_unit, 0));
+				}
 			}
-			else
+		} // record_material
+
+		void record_blocks(void* data, uint32_t start_job, uint32_t end_job)
+		{
+			RecordJob* job = static_cast<RecordJob*>(data);
+			RenderSceneDrawList* list = job->list;
+			const uint32_t total_blocks = static_cast<uint32_t>(list->queue.size());
+
+			for (uint32_t job_index = start_job; job_index < end_job; ++job_index)
 			{
-				LOGV("Unhandled material parameter: %i\n", parameter->type);
-			}
-		}
-	} // _render_setup_material
+				render2::CommandQueue* queue = list->command_queues[job_index];
+				uint32_t pipeline_switches = 0;
+				uint32_t material_switches = 0;
+
+				// Every queue starts without any bound state.
+				uint32_t current_pipeline = UINT32_MAX;
+				uint32_t current_object = UINT32_MAX;
+				uint32_t current_material = UINT32_MAX;
+
+				const uint32_t first_block = (job_index * job->blocks_per_job);
+				uint32_t last_block = first_block + job->blocks_per_job;
+				if (last_block > total_blocks)
+				{
+					last_block = total_blocks;
+				}
 
+				for (uint32_t block_index = first_block; block_index < last_block; ++block_index)
+				{
+					const renderer::RenderBlock& block = list->queue.render_list[block_index];
+					const RenderSceneObject& object = list->objects[block.object];
+					const GeometryDefinition* geometry = &object.geometry[block.geometry];
 
-	void render_static_meshes(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::Pass& pass)
-	{
-		render2::CommandQueue* queue = device->create_queue(pass);
-		render2::CommandSerializer* serializer = device->create_serializer(queue);
+					if (object.pipeline != current_pipeline)
+					{
+						queue->add_command(render2::Command(render2::COMMAND_PIPELINE, list->pipelines[object.pipeline]));
+						current_pipeline = object.pipeline;
 
-		// render static meshes
-		// setup the static mesh pipeline
-		serializer->pipeline(scene->static_mesh_pipeline);
-		scene->static_mesh_pipeline->constants().set("view_matrix", &view);
-		scene->static_mesh_pipeline->constants().set("projection_matrix", &projection);
-		scene->static_mesh_pipeline->constants().set("light_position_world", &scene->light_position_world);
-		scene->static_mesh_pipeline->constants().set("camera_position_world", &scene->camera_position_world);
-		scene->static_mesh_pipeline->constants().set("camera_view_direction", &scene->camera_view_direction);
+						// constants and textures belong to the previous pipeline
+						current_object = UINT32_MAX;
+						current_material = UINT32_MAX;
+						++pipeline_switches;
+					}
 
+					if (block.object != current_object)
+					{
+						queue->add_command(render2::Command(render2::COMMAND_SET_VERTEX_BUFFER, object.vertex_buffer));
+						record_constant(queue, "model_matrix", object.model_matrix, sizeof(glm::mat4));
+						record_constant(queue, "normal_matrix", object.normal_matrix, sizeof(glm::mat3));
+						if (object.bone_transforms)
+						{
+							record_constant(queue, "node_transforms[0]", object.bone_transforms, sizeof(glm::mat4) * MAX_BONES);
+							record_constant(queue, "inverse_bind_transforms[0]", object.inverse_bind_poses, sizeof(glm::mat4) * MAX_BONES);
+						}
+						current_object = block.object;
+					}
 
-		Freelist<StaticMeshComponent*>::Iterator iter = scene->static_meshes.begin();
-		for (; iter != scene->static_meshes.end(); ++iter)
+					const uint32_t material_slot = render_scene_material_slot(geometry->material_handle);
+					if (material_slot != current_material)
+					{
+						Material* material = (material_slot < list->materials.size()) ? list->materials[material_slot] : nullptr;
+						if (material)
+						{
+							record_material(queue, material);
+						}
+						current_material = material_slot;
+						++material_switches;
+					}
+
+					queue->add_command(render2::Command(render2::COMMAND_DRAW_INDEXED, object.index_buffer, 0, geometry->index_offset, geometry->total_indices, 0, 1));
+				}
+
+				job->pipeline_switches[job_index] = pipeline_switches;
+				job->material_switches[job_index] = material_switches;
+			}
+		} // record_blocks
+
+		void resolve_materials(RenderSceneDrawList* list, const Mesh* mesh)
 		{
-			StaticMeshComponent* static_mesh = iter.data();
-			assert(static_mesh);
-			Mesh* mesh = mesh_from_handle(static_mesh->mesh_handle);
-			if (mesh)
+			for (size_t geometry_index = 0; geometry_index < mesh->geometry.size(); ++geometry_index)
 			{
-				// If you hit this, the renderer has no reference to this mesh!
-				// Are you sure it was uploaded?
-				assert(render_scene_state->render_mesh_by_handle.has_key(static_mesh->mesh_handle));
+				const AssetHandle material_handle = mesh->geometry[geometry_index].material_handle;
+				const uint32_t material_slot = render_scene_material_slot(material_handle);
+				if (material_slot >= list->materials.size())
+				{
+					list->materials.resize(material_slot + 1, nullptr);
+				}
 
-				serializer->constant("model_matrix", &static_mesh->model_matrix, sizeof(glm::mat4));
-				serializer->constant("normal_matrix", &static_mesh->normal_matrix, sizeof(glm::mat3));
+				if (!list->materials[material_slot])
+				{
+					Material* material = material_from_handle(material_handle);
+					list->materials[material_slot] = material;
+					if (material && (material->parameters.size() > list->max_material_parameters))
+					{
+						list->max_material_parameters = static_cast<uint32_t>(material->parameters.size());
+					}
+				}
+			}
+		} // resolve_materials
+
+		bool gather_object(RenderSceneObject& object, const Mesh* mesh, AssetHandle mesh_handle)
+		{
+			if (!mesh || (mesh->geometry.size() == 0))
+			{
+				return false;
+			}
 
-				RenderMeshInfo* mesh_info = render_scene_state->render_mesh_by_handle[static_mesh->mesh_handle];
-				serializer->vertex_buffer(mesh_info->vertex_buffer);
+			// If you hit this, the renderer has no reference to this mesh!
+			// Are you sure it was uploaded?
+			assert(render_scene_state->render_mesh_by_handle.has_key(mesh_handle));
+			RenderMeshInfo* mesh_info = render_scene_state->render_mesh_by_handle[mesh_handle];
+
+			object.vertex_buffer = mesh_info->vertex_buffer;
+			object.index_buffer = mesh_info->index_buffer;
+			object.geometry = &mesh->geometry[0];
+			object.total_geometry = static_cast<uint32_t>(mesh->geometry.size());
+			object.mins = mesh->aabb_mins;
+			object.maxs = mesh->aabb_maxs;
+			return true;
+		} // gather_object
+
+		// Resolve this frame's mesh components; this must run on the
+		// thread which owns the asset libraries.
+		void gather_scene(RenderScene* scene, RenderSceneDrawList* list)
+		{
+			list->objects.resize(0);
+			for (size_t index = 0; index < list->materials.size(); ++index)
+			{
+				list->materials[index] = nullptr;
+			}
+			list->max_material_parameters = 0;
+
+			RenderSceneObject object;
+			Freelist<StaticMeshComponent*>::Iterator iter = scene->static_meshes.begin();
+			for (; iter != scene->static_meshes.end(); ++iter)
+			{
+				StaticMeshComponent* static_mesh = iter.data();
+				assert(static_mesh);
+				Mesh* mesh = mesh_from_handle(static_mesh->mesh_handle);
+				if (gather_object(object, mesh, static_mesh->mesh_handle))
+				{
+					object.model_matrix = &static_mesh->model_matrix;
+					object.normal_matrix = &static_mesh->normal_matrix;
+					object.bone_transforms = nullptr;
+					object.inverse_bind_poses = nullptr;
+					object.pipeline = RenderScenePipeline_Static;
+					list->objects.push_back(object);
+					resolve_materials(list, mesh);
+				}
+			}
 
-				// TODO: Convert into render blocks that can be re-sorted.
-				for (size_t geo = 0; geo < mesh->geometry.size(); ++geo)
+			for (size_t index = 0; index < scene->animated_meshes.size(); ++index)
+			{
+				AnimatedMeshComponent* instance = scene->animated_meshes[index];
+				if (!instance)
 				{
-					const GeometryDefinition* geometry = &mesh->geometry[geo];
-					_render_setup_material(serializer, geometry->material_handle);
-					serializer->draw_indexed_primitives(mesh_info->index_buffer, geometry->index_offset, geometry->total_indices);
+					continue;
 				}
 
-				++scene->stat_static_meshes_drawn;
+				Mesh* mesh = mesh_from_handle(instance->mesh_handle);
+				if (gather_object(object, mesh, instance->mesh_handle))
+				{
+					object.model_matrix = &instance->model_matrix;
+					object.normal_matrix = &instance->normal_matrix;
+					object.bone_transforms = instance->bone_transforms;
+					object.inverse_bind_poses = mesh->inverse_bind_poses;
+					object.pipeline = RenderScenePipeline_Animated;
+					list->objects.push_back(object);
+					resolve_materials(list, mesh);
+				}
 			}
+		} // gather_scene
+	} // namespace detail
+
+
+	RenderSceneDrawList::RenderSceneDrawList(Allocator& _allocator)
+		: allocator(&_allocator)
+		, objects(_allocator)
+		, materials(_allocator)
+		, max_material_parameters(0)
+		, queue(_allocator)
+		, command_queues(_allocator)
+		, total_command_queues(0)
+		, stat_pipeline_switches(0)
+		, stat_material_switches(0)
+	{
+		for (uint32_t index = 0; index < RenderScenePipeline_Count; ++index)
+		{
+			pipelines[index] = nullptr;
+			stat_visible_objects[index] = 0;
 		}
+	}
 
-		device->queue_buffers(queue, 1);
-		device->destroy_serializer(serializer);
-	} // render_static_meshes
+	RenderSceneDrawList::~RenderSceneDrawList()
+	{
+		for (size_t index = 0; index < command_queues.size(); ++index)
+		{
+			MEMORY2_DELETE(*allocator, command_queues[index]);
+		}
+		command_queues.clear();
+	}
 
 
-	void render_animated_meshes(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::Pass& pass)
+	void render_scene_cull(RenderSceneDrawList* list, const glm::mat4& view, const glm::mat4& projection, JobScheduler* scheduler)
 	{
-		render2::CommandQueue* queue = device->create_queue(pass);
-		render2::CommandSerializer* serializer = device->create_serializer(queue);
+		const uint32_t total_objects = static_cast<uint32_t>(list->objects.size());
 
-		// render static meshes
-		// setup the static mesh pipeline
-		serializer->pipeline(scene->animated_mesh_pipeline);
-		scene->animated_mesh_pipeline->constants().set("view_matrix", &view);
-		scene->animated_mesh_pipeline->constants().set("projection_matrix", &projection);
-		scene->animated_mesh_pipeline->constants().set("light_position_world", &scene->light_position_world);
-		scene->animated_mesh_pipeline->constants().set("camera_position_world", &scene->camera_position_world);
-		scene->animated_mesh_pipeline->constants().set("camera_view_direction", &scene->camera_view_direction);
+		detail::CullJob job;
+		job.list = list;
+		job.view = view;
+		renderer::render_frustum_from_matrix(job.frustum, projection * view);
 
-		for (size_t index = 0; index < scene->animated_meshes.size(); ++index)
+		const uint32_t total_jobs = detail::compute_total_jobs(scheduler, total_objects, RENDER_SCENE_MIN_OBJECTS_PER_JOB);
+		job.objects_per_job = (total_objects + total_jobs - 1) / total_jobs;
+
+		// Reserve room for every geometry; each job writes its visible
+		// blocks contiguously from its own offset.
+		uint32_t total_geometry = 0;
+		for (uint32_t job_index = 0; job_index < total_jobs; ++job_index)
 		{
-			AnimatedMeshComponent* instance = scene->animated_meshes[index];
-			if (!instance)
+			job.block_offset[job_index] = total_geometry;
+			job.total_blocks[job_index] = 0;
+			for (uint32_t pipeline = 0; pipeline < RenderScenePipeline_Count; ++pipeline)
 			{
-				continue;
+				job.visible_objects[job_index][pipeline] = 0;
 			}
 
-			Mesh* mesh = mesh_from_handle(instance->mesh_handle);
-			if (mesh)
+			const uint32_t first_object = (job_index * job.objects_per_job);
+			const uint32_t last_object = ((first_object + job.objects_per_job) < total_objects) ? (first_object + job.objects_per_job) : total_objects;
+			for (uint32_t object_index = first_object; object_index < last_object; ++object_index)
 			{
-				// If you hit this, the renderer has no reference to this mesh!
-				// Are you sure it was uploaded?
-				assert(render_scene_state->render_mesh_by_handle.has_key(instance->mesh_handle));
+				total_geometry += list->objects[object_index].total_geometry;
+			}
+		}
 
-				serializer->constant("model_matrix", &instance->model_matrix, sizeof(glm::mat4));
-				serializer->constant("normal_matrix", &instance->normal_matrix, sizeof(glm::mat3));
-				serializer->constant("node_transforms[0]", instance->bone_transforms, sizeof(glm::mat4) * MAX_BONES);
-				serializer->constant("inverse_bind_transforms[0]", mesh->inverse_bind_poses, sizeof(glm::mat4) * MAX_BONES);
+		list->queue.render_list.resize(total_geometry);
+		if (total_geometry > 0)
+		{
+			if (scheduler && (total_jobs > 1))
+			{
+				JobCounter counter;
+				scheduler->parallel_for(detail::cull_objects, &job, total_jobs, 1, &counter);
+				scheduler->wait(&counter);
+			}
+			else
+			{
+				detail::cull_objects(&job, 0, total_jobs);
+			}
+		}
 
-				RenderMeshInfo* mesh_info = render_scene_state->render_mesh_by_handle[instance->mesh_handle];
-				serializer->vertex_buffer(mesh_info->vertex_buffer);
+		// compact the visible blocks from each job
+		uint32_t total_visible = 0;
+		for (uint32_t pipeline = 0; pipeline < RenderScenePipeline_Count; ++pipeline)
+		{
+			list->stat_visible_objects[pipeline] = 0;
+		}
 
-				// TODO: Convert into render blocks that can be re-sorted.
-				for (size_t geo = 0; geo < mesh->geometry.size(); ++geo)
-				{
-					const GeometryDefinition* geometry = &mesh->geometry[geo];
-					_render_setup_material(serializer, geometry->material_handle);
-					serializer->draw_indexed_primitives(mesh_info->index_buffer, geometry->index_offset, geometry->total_indices);
-				}
+		for (uint32_t job_index = 0; job_index < total_jobs; ++job_index)
+		{
+			const uint32_t total_blocks = job.total_blocks[job_index];
+			if (total_blocks > 0 && (job.block_offset[job_index] != total_visible))
+			{
+				memmove(&list->queue.render_list[total_visible], &list->queue.render_list[job.block_offset[job_index]], sizeof(renderer::RenderBlock) * total_blocks);
+			}
+			total_visible += total_blocks;
 
-				++scene->stat_animated_meshes_drawn;
+			for (uint32_t pipeline = 0; pipeline < RenderScenePipeline_Count; ++pipeline)
+			{
+				list->stat_visible_objects[pipeline] += job.visible_objects[job_index][pipeline];
+			}
+		}
 
-				// Enable this to debug bone transforms
-#if 0
-				if (mesh->skeleton.size() > 0)
-				{
-					glm::vec3 position; // render position
-					glm::vec3 last_origin;
-					glm::vec3 origins[MAX_BONES];
-					const glm::mat4* model_poses = instance->bone_transforms;
-					//const glm::vec3* hitboxes = model_instance->get_hitboxes();
-
-					// draw individual links for each bone to represent the skeleton
-					for (size_t bone_index = 0; bone_index < mesh->skeleton.size(); ++bone_index)
-					{
-						size_t transform_index = mesh->skeleton.size() + bone_index;
-						Joint* joint = &mesh->skeleton[bone_index];
-						if (joint->parent_index != -1)
-						{
-							last_origin = origins[joint->parent_index];
-						}
-						else
-						{
-							last_origin = glm::vec3(instance->model_matrix * glm::vec4(position, 1.0f));
-						}
+		list->queue.render_list.resize(total_visible);
+	} // render_scene_cull
 
-						const glm::mat4 world_pose = instance->model_matrix * model_poses[transform_index];
-						glm::vec3 origin = glm::vec3(glm::column(world_pose, 3));
 
-						debugdraw::line(last_origin, origin, Color::from_rgba(255, 128, 0, 255));
-						last_origin = origin;
-						origins[bone_index] = origin;
+	uint32_t render_scene_record(RenderSceneDrawList* list, const render2::Pass& pass, JobScheduler* scheduler)
+	{
+		const uint32_t total_blocks = static_cast<uint32_t>(list->queue.size());
+		list->stat_pipeline_switches = 0;
+		list->stat_material_switches = 0;
+		list->total_command_queues = 0;
+		if (total_blocks == 0)
+		{
+			return 0;
+		}
 
-						// this only displays local transforms
-						debugdraw::axes(world_pose, 0.15f, 0.0f);
+		detail::RecordJob job;
+		job.list = list;
 
-						//glm::vec3 box_center = origin;
-						//const glm::vec3& positive_extents = hitboxes[bone_index];
-						//debugdraw::box(box_center - positive_extents, box_center + positive_extents, gemini::Color(0.0f, 0.5f, 0.5f));
-					}
-				}
-#endif
-			}
+		const uint32_t total_jobs = detail::compute_total_jobs(scheduler, total_blocks, RENDER_SCENE_MIN_BLOCKS_PER_JOB);
+		job.blocks_per_job = (total_blocks + total_jobs - 1) / total_jobs;
+
+		// Jobs must not allocate; so each queue is reserved for the worst
+		// case before any are recorded.
+		const uint32_t commands_per_block = detail::RENDER_BLOCK_MAX_COMMANDS + (2 * list->max_material_parameters);
+		while (list->command_queues.size() < total_jobs)
+		{
+			list->command_queues.push_back(MEMORY2_NEW(*list->allocator, render2::CommandQueue)(*list->allocator, pass));
 		}
 
-		device->queue_buffers(queue, 1);
-		device->destroy_serializer(serializer);
-	} // render_animated_meshes
+		for (uint32_t job_index = 0; job_index < total_jobs; ++job_index)
+		{
+			render2::CommandQueue* queue = list->command_queues[job_index];
+			queue->pass = pass;
+			queue->reset();
+			queue->commands.reserve(job.blocks_per_job * commands_per_block);
+		}
+
+		if (scheduler && (total_jobs > 1))
+		{
+			JobCounter counter;
+			scheduler->parallel_for(detail::record_blocks, &job, total_jobs, 1, &counter);
+			scheduler->wait(&counter);
+		}
+		else
+		{
+			detail::record_blocks(&job, 0, total_jobs);
+		}
+
+		for (uint32_t job_index = 0; job_index < total_jobs; ++job_index)
+		{
+			list->stat_pipeline_switches += job.pipeline_switches[job_index];
+			list->stat_material_switches += job.material_switches[job_index];
+		}
+
+		list->total_command_queues = total_jobs;
+		return total_jobs;
+	} // render_scene_record
+
+
+	void render_scene_draw(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::RenderTarget* render_target)
+	{
+		if (!render_target)
+		{
+			render_target = device->default_render_target();
+		}
+
+		scene->stat_static_meshes_drawn = 0;
+		scene->stat_animated_meshes_drawn = 0;
+
+		Color clear_color = Color::from_rgba(128, 128, 128, 255);
+
+		// compute inverse projection and inverse view rotation matrix
+		scene->inverse_view_rotation = glm::inverse(glm::mat3(view));
+		scene->inverse_projection = glm::inverse(projection);
+
+
+		//glm::vec3 xaxis = scene->inverse_view_rotation * glm::vec3(1.0f, 0.0f, 0.0f);
+		//PRINT_VEC3(xaxis);
+
+		render2::Pass sky_pass;
+		sky_pass.target = render_target;
+		sky_pass.color(clear_color.red, clear_color.blue, clear_color.green, clear_color.alpha);
+		sky_pass.clear_color = true;
+		sky_pass.clear_depth = true;
+		sky_pass.depth_test = false;
+		sky_pass.depth_write = true;
+		sky_pass.cull_mode = render2::CullMode::None;
+		render_sky(scene, device, view, projection, sky_pass);
+
+		render2::Pass render_pass;
+		render_pass.target = render_target;
+		render_pass.color(clear_color.red, clear_color.blue, clear_color.green, clear_color.alpha);
+		render_pass.clear_color = false;
+		render_pass.clear_depth = false;
+		render_pass.depth_test = true;
+		render_pass.depth_write = true;
+		render_pass.cull_mode = render2::CullMode::Backface;
+
+		// Static and animated meshes share the render pass; their blocks
+		// are sorted together by pipeline, material and depth.
+		render2::Pipeline* pipelines[RenderScenePipeline_Count] = { scene->static_mesh_pipeline, scene->animated_mesh_pipeline };
+		for (uint32_t index = 0; index < RenderScenePipeline_Count; ++index)
+		{
+			render2::Pipeline* pipeline = pipelines[index];
+			pipeline->constants().set("view_matrix", &view);
+			pipeline->constants().set("projection_matrix", &projection);
+			pipeline->constants().set("light_position_world", &scene->light_position_world);
+			pipeline->constants().set("camera_position_world", &scene->camera_position_world);
+			pipeline->constants().set("camera_view_direction", &scene->camera_view_direction);
+			scene->draw_list.pipelines[index] = pipeline;
+		}
+
+		RenderSceneDrawList* list = &scene->draw_list;
+		detail::gather_scene(scene, list);
+		render_scene_cull(list, view, projection, scene->job_scheduler);
+		list->queue.sort();
+
+		const uint32_t total_queues = render_scene_record(list, render_pass, scene->job_scheduler);
+		for (uint32_t index = 0; index < total_queues; ++index)
+		{
+			device->queue_buffers(list->command_queues[index], 1);
+		}
+
+		scene->stat_static_meshes_drawn = list->stat_visible_objects[RenderScenePipeline_Static];
+		scene->stat_animated_meshes_drawn = list->stat_visible_objects[RenderScenePipeline_Animated];
+	} // render_scene_draw
+
 
 	void render_scene_remove_static_mesh(RenderScene* scene, uint32_t component_id)
 	{
@@ -29,6 +29,8 @@
 #include <core/mathlib.h>
 #include <core/typedefs.h>
 
+#include <renderer/rqueue.h>
+
 #include <runtime/asset_handle.h>
 #include <runtime/animation.h>
 
@@ -38,12 +40,17 @@ namespace render2
 	class Device;
 	class Pipeline;
 	struct Buffer;
+	struct CommandQueue;
 	struct Pass;
 	struct RenderTarget;
 } // namespace render2
 
 namespace gemini
 {
+	class JobScheduler;
+	struct GeometryDefinition;
+	struct Material;
+
 	struct StaticMeshComponent
 	{
 		AssetHandle mesh_handle;
@@ -81,6 +88,99 @@ namespace gemini
 		Array<animation::AnimatedInstance*> sequence_instances;
 	}; // AnimatedMeshComponent
 
+	enum RenderScenePipeline
+	{
+		RenderScenePipeline_Static,
+		RenderScenePipeline_Animated,
+
+		RenderScenePipeline_Count
+	}; // RenderScenePipeline
+
+	// Stored in the pass bits of each render key.
+	enum RenderScenePass
+	{
+		RenderScenePass_Opaque,
+		RenderScenePass_Translucent
+	}; // RenderScenePass
+
+	// Upper bounds for splitting culling and recording across workers.
+	const uint32_t RENDER_SCENE_MAX_JOBS = 32;
+	const uint32_t RENDER_SCENE_MIN_OBJECTS_PER_JOB = 128;
+	const uint32_t RENDER_SCENE_MIN_BLOCKS_PER_JOB = 256;
+
+	// A mesh component resolved for a single frame.
+	// These are gathered on the calling thread so that culling and
+	// recording jobs never touch the asset libraries for meshes.
+	struct RenderSceneObject
+	{
+		const glm::mat4* model_matrix;
+		const glm::mat3* normal_matrix;
+
+		// skinning transforms; null for static meshes
+		const glm::mat4* bone_transforms;
+		const glm::mat4* inverse_bind_poses;
+
+		render2::Buffer* vertex_buffer;
+		render2::Buffer* index_buffer;
+
+		const GeometryDefinition* geometry;
+		uint32_t total_geometry;
+
+		// model-space bounds; empty bounds are never culled.
+		glm::vec3 mins;
+		glm::vec3 maxs;
+
+		// RenderScenePipeline
+		uint32_t pipeline;
+	}; // RenderSceneObject
+
+	// Per-frame draw data for a scene: objects are culled into render
+	// blocks, radix sorted by key and recorded into one command queue per
+	// job. The command queues are owned by the draw list and must be
+	// submitted before the list is recorded again.
+	struct RenderSceneDrawList
+	{
+		RenderSceneDrawList(Allocator& allocator);
+		~RenderSceneDrawList();
+
+		Allocator* allocator;
+		Array<RenderSceneObject> objects;
+
+		// resolved materials indexed by render_scene_material_slot.
+		Array<Material*> materials;
+
+		// largest parameter count of any resolved material
+		uint32_t max_material_parameters;
+
+		render2::Pipeline* pipelines[RenderScenePipeline_Count];
+
+		renderer::RenderQueue queue;
+
+		Array<render2::CommandQueue*> command_queues;
+
+		// number of command_queues recorded this frame
+		uint32_t total_command_queues;
+
+		uint32_t stat_visible_objects[RenderScenePipeline_Count];
+		uint32_t stat_pipeline_switches;
+		uint32_t stat_material_switches;
+	}; // RenderSceneDrawList
+
+	inline uint32_t render_scene_material_slot(AssetHandle material_handle)
+	{
+		// Invalid handles share slot zero with other out of range indices.
+		return (material_handle.index < (1 << renderer::RENDER_KEY_MATERIAL_BITS)) ? material_handle.index : 0;
+	} // render_scene_material_slot
+
+	// Cull objects against the view frustum and fill the draw list's
+	// queue with one render block per visible geometry.
+	// If scheduler is null; this runs on the calling thread.
+	void render_scene_cull(RenderSceneDrawList* list, const glm::mat4& view, const glm::mat4& projection, JobScheduler* scheduler);
+
+	// Record the render blocks (sorted by the caller) into command queues; one per job.
+	// Returns the number of command queues; submit them in order.
+	uint32_t render_scene_record(RenderSceneDrawList* list, const render2::Pass& pass, JobScheduler* scheduler);
+
 	struct RenderScene
 	{
 		Allocator* allocator;
@@ -91,6 +191,10 @@ namespace gemini
 		uint32_t stat_static_meshes_drawn;
 		uint32_t stat_animated_meshes_drawn;
 
+		// Optional; when set culling and recording are split across its workers.
+		JobScheduler* job_scheduler;
+		RenderSceneDrawList draw_list;
+
 		render2::Pipeline* static_mesh_pipeline;
 		render2::Pipeline* animated_mesh_pipeline;
 		render2::Pipeline* sky_pipeline;
@@ -110,6 +214,10 @@ namespace gemini
 			: static_meshes(_allocator)
 			, animated_meshes(_allocator)
 			, allocator(&_allocator)
+			, stat_static_meshes_drawn(0)
+			, stat_animated_meshes_drawn(0)
+			, job_scheduler(nullptr)
+			, draw_list(_allocator)
 			, static_mesh_pipeline(nullptr)
 			, animated_mesh_pipeline(nullptr)
 			, sky_pipeline(nullptr)
@@ -145,8 +253,6 @@ namespace gemini
 	RenderScene* render_scene_create(Allocator& allocator, render2::Device* device);
 	void render_scene_destroy(RenderScene* scene, render2::Device* device);
 	void render_scene_draw(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::RenderTarget* render_target = nullptr);
-	void render_static_meshes(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::Pass& pass);
-	void render_animated_meshes(RenderScene* scene, render2::Device* device, const glm::mat4& view, const glm::mat4& projection, render2::Pass& pass);
 
 	void render_scene_remove_static_mesh(RenderScene* scene, uint32_t component_id);
 	void render_scene_remove_animated_mesh(RenderScene* scene, uint32_t component_id);
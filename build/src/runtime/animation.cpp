@@ -37,6 +37,7 @@
 #include <hashset.h>
 
 #include <runtime/configloader.h>
+#include <runtime/job_scheduler.h>
 #include <runtime/mesh.h>
 
 #include <renderer/debug_draw.h>
@@ -44,6 +45,14 @@
 
 #include <vector>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define GEMINI_ANIMATION_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define GEMINI_ANIMATION_NEON 1
+#endif
+
 using gemini::animation::Keyframe;
 
 using namespace platform;
@@ -60,11 +69,23 @@ namespace gemini
 			SequenceFreelist sequences;
 			AnimatedInstanceFreelist instances;
 
+			// AnimatedInstances are created and destroyed with meshes
+			void* instance_memory;
+			Allocator instance_pool;
+
 			AnimationState(Allocator& in_allocator)
 				: allocator(&in_allocator)
 				, sequences(in_allocator)
 				, instances(in_allocator)
 			{
+				const size_t pool_size = memory_pool_size(sizeof(AnimatedInstance), alignof(AnimatedInstance), ANIMATION_MAX_POOLED_INSTANCES);
+				instance_memory = MEMORY2_ALLOC(in_allocator, pool_size);
+				instance_pool = memory_allocator_pool(in_allocator.zone, instance_memory, pool_size, sizeof(AnimatedInstance), alignof(AnimatedInstance));
+			}
+
+			~AnimationState()
+			{
+				MEMORY2_DEALLOC(*allocator, instance_memory);
 			}
 		};
 
@@ -81,6 +102,7 @@ namespace gemini
 			, keys(0)
 			, total_keys(0)
 			, duration_seconds(0.0f)
+			, uniform(false)
 		{
 		}
 
@@ -107,6 +129,47 @@ namespace gemini
 			keys[index].value = value;
 		}
 
+		void KeyframeList::compute_spacing(float frame_delay_seconds)
+		{
+			// Allow for rounding in exported key times; find_key corrects
+			// the directly indexed key so the result is always exact.
+			const float tolerance = frame_delay_seconds * 0.01f;
+
+			uniform = (total_keys > 1) && (frame_delay_seconds > 0.0f);
+			for (uint32_t key = 1; uniform && (key < total_keys); ++key)
+			{
+				const float expected = keys[0].seconds + (key * frame_delay_seconds);
+				uniform = (fabs(keys[key].seconds - expected) <= tolerance);
+			}
+		}
+
+		uint32_t KeyframeList::find_key(float t_seconds, float frame_delay_seconds, uint32_t hint) const
+		{
+			uint32_t key = hint;
+			if (uniform)
+			{
+				key = static_cast<uint32_t>((t_seconds - keys[0].seconds) / frame_delay_seconds);
+			}
+
+			if (key > (total_keys - 2))
+			{
+				key = (total_keys - 2);
+			}
+
+			while ((key > 0) && (t_seconds < keys[key].seconds))
+			{
+				--key;
+			}
+
+			// t_seconds is before the last key; so this stops there.
+			while (t_seconds >= keys[key + 1].seconds)
+			{
+				++key;
+			}
+
+			return key;
+		}
+
 		//
 		// Channel
 		//
@@ -115,6 +178,7 @@ namespace gemini
 		{
 			keyframelist = 0;
 			wrap = should_wrap;
+			cursor = 0;
 		}
 
 		Channel::~Channel()
@@ -124,74 +188,73 @@ namespace gemini
 		void Channel::set_keyframe_list(KeyframeList* source_keyframe_list)
 		{
 			keyframelist = source_keyframe_list;
+			cursor = 0;
 		}
 
 		float Channel::evaluate(float t_seconds, float frame_delay_seconds) const
 		{
-			if (keyframelist->duration_seconds == 0)
+			if (keyframelist->duration_seconds == 0 || keyframelist->total_keys == 0)
 			{
 				return 0.0f;
 			}
 
-			uint32_t last_key = (keyframelist->total_keys - 1);
-
-			// TODO: Perform a direct lookup into the array with some math.
-			// this hasn't been a performance problem yet, fix it when it comes up.
-			float delta;
-			float value_a;
-			float value_b;
-			for (uint32_t key = 0; key < keyframelist->total_keys; ++key)
-			{
-				// alpha is calculated by dividing the deltas: (a/b)
-				// a. The delta between the current simulation time and the last key frame's time
-				// b. The delta between the next key frame's time and the last key frame's time.
-				Keyframe* keyframe = &keyframelist->keys[key];
-				uint32_t next_key = key + 1;
-				if (t_seconds < keyframe->seconds)
-				{
-					if (key == 0)
-					{
-						// can't get previous; lerp forward
-						Keyframe* next = &keyframelist->keys[next_key];
-						delta = (next->seconds - keyframe->seconds);
-						value_a = next->value;
-						value_b = keyframe->value;
-
-						float alpha = (delta / frame_delay_seconds);
-						return gemini::lerp(value_a, value_b, alpha);
-					}
-					else
-					{
-						// This assumes that the animation is evenly sampled
-						// across key frames by frame_delay_seconds.
-						// If it isn't, we could use
-						// (keyframe->seconds - prev_keyframe->seconds) as
-						// the denominator instead of frame_delay_seconds.
-						Keyframe* prev_keyframe = &keyframelist->keys[key - 1];
-						float alpha = (t_seconds - prev_keyframe->seconds) / frame_delay_seconds;
-						return gemini::lerp(prev_keyframe->value, keyframe->value, alpha);
-					}
-				}
-				else if (last_key == key)
+			const Keyframe* keys = keyframelist->keys;
+			const uint32_t last_key = (keyframelist->total_keys - 1);
+
+			if (t_seconds < keys[0].seconds)
+			{
+				if (last_key == 0)
 				{
-					// next key would wrap: We may just be able to
-					// return the last/first value.
-					next_key = 0;
-					Keyframe* next = &keyframelist->keys[last_key];
-					return next->value;
+					return keys[0].value;
 				}
+
+				// can't get previous; lerp forward
+				const Keyframe* next = &keys[1];
+				float delta = (next->seconds - keys[0].seconds);
+				float alpha = (delta / frame_delay_seconds);
+				return gemini::lerp(next->value, keys[0].value, alpha);
+			}
+			else if (t_seconds >= keys[last_key].seconds)
+			{
+				// next key would wrap: We may just be able to
+				// return the last/first value.
+				return keys[last_key].value;
 			}
 
-			return 0.0f;
+			// alpha is calculated by dividing the deltas: (a/b)
+			// a. The delta between the current simulation time and the last key frame's time
+			// b. The delta between the next key frame's time and the last key frame's time.
+			//
+			// This assumes that the animation is evenly sampled
+			// across key frames by frame_delay_seconds.
+			// If it isn't, we could use
+			// (keyframe->seconds - prev_keyframe->seconds) as
+			// the denominator instead of frame_delay_seconds.
+			cursor = keyframelist->find_key(t_seconds, frame_delay_seconds, cursor);
+			const Keyframe* prev_keyframe = &keys[cursor];
+			const Keyframe* keyframe = &keys[cursor + 1];
+			float alpha = (t_seconds - prev_keyframe->seconds) / frame_delay_seconds;
+			return gemini::lerp(prev_keyframe->value, keyframe->value, alpha);
 		} // evaluate
 
 		// Sequence
 		Sequence::Sequence(gemini::Allocator& _allocator)
 			: allocator(_allocator)
 			, animation_set(allocator)
+			, samples(nullptr)
+			, total_samples(0)
+			, sample_joint_stride(0)
 		{
 		}
 
+		Sequence::~Sequence()
+		{
+			if (samples)
+			{
+				MEMORY2_DEALLOC(allocator, samples);
+			}
+		}
+
 		// AnimatedInstance
 		AnimatedInstance::AnimatedInstance(gemini::Allocator& allocator)
 			: local_time_seconds(0.0)
@@ -458,17 +521,164 @@ namespace gemini
 
 				return core::util::ConfigLoad_Success;
 			}
-		} // namespace detail
 
-		Sequence* load_sequence_from_file(gemini::Allocator& allocator, const char* name, Mesh* mesh)
-		{
-			if (_sequences_by_name->has_key(name))
+			// Resample every channel into rows for animated_instance_get_pose.
+			// Channels must share the same uniformly spaced key times; so each
+			// row can be blended with a single alpha.
+			static void build_samples(Sequence* sequence)
 			{
-				Sequence* data = 0;
-				data = _sequences_by_name->get(name);
-				return data;
-			}
+				const size_t total_channels = sequence->animation_set.size();
+				const size_t total_joints = total_channels / ANIMATION_KEYFRAME_VALUES_MAX;
+				if ((total_joints == 0) || (total_joints > MAX_BONES))
+				{
+					return;
+				}
+
+				const KeyframeList& reference = sequence->animation_set[0];
+				if (!reference.uniform || (reference.duration_seconds == 0))
+				{
+					return;
+				}
+
+				for (size_t channel = 1; channel < total_channels; ++channel)
+				{
+					const KeyframeList& list = sequence->animation_set[channel];
+					if ((list.total_keys != reference.total_keys) || (list.duration_seconds != reference.duration_seconds))
+					{
+						return;
+					}
+
+					for (uint32_t key = 0; key < list.total_keys; ++key)
+					{
+						if (list.keys[key].seconds != reference.keys[key].seconds)
+						{
+							return;
+						}
+					}
+				}
+
+				// pad each component to a multiple of four joints for SIMD
+				const uint32_t joint_stride = static_cast<uint32_t>((total_joints + 3) & ~3);
+				const uint32_t row_size = joint_stride * ANIMATION_KEYFRAME_VALUES_MAX;
 
+				sequence->total_samples = reference.total_keys;
+				sequence->sample_joint_stride = joint_stride;
+				sequence->samples = static_cast<float*>(MEMORY2_ALLOC(sequence->allocator, sizeof(float) * row_size * sequence->total_samples));
+				memset(sequence->samples, 0, sizeof(float) * row_size * sequence->total_samples);
+
+				for (uint32_t key = 0; key < sequence->total_samples; ++key)
+				{
+					float* row = sequence->samples + (key * row_size);
+					for (size_t joint = 0; joint < total_joints; ++joint)
+					{
+						for (size_t component = 0; component < ANIMATION_KEYFRAME_VALUES_MAX; ++component)
+						{
+							const KeyframeList& list = sequence->animation_set[(joint * ANIMATION_KEYFRAME_VALUES_MAX) + component];
+							row[(component * joint_stride) + joint] = list.keys[key].value;
+						}
+					}
+				}
+			} // build_samples
+
+			// output = (first * (1 - alpha)) + (second * alpha); count must
+			// be a multiple of four.
+			static void blend_rows(float* output, const float* first, const float* second, float alpha, uint32_t count)
+			{
+#if defined(GEMINI_ANIMATION_SSE)
+				const __m128 first_weight = _mm_set1_ps(1.0f - alpha);
+				const __m128 second_weight = _mm_set1_ps(alpha);
+				for (uint32_t index = 0; index < count; index += 4)
+				{
+					const __m128 a = _mm_mul_ps(_mm_loadu_ps(first + index), first_weight);
+					const __m128 b = _mm_mul_ps(_mm_loadu_ps(second + index), second_weight);
+					_mm_storeu_ps(output + index, _mm_add_ps(a, b));
+				}
+#elif defined(GEMINI_ANIMATION_NEON)
+				const float32x4_t first_weight = vdupq_n_f32(1.0f - alpha);
+				const float32x4_t second_weight = vdupq_n_f32(alpha);
+				for (uint32_t index = 0; index < count; index += 4)
+				{
+					const float32x4_t a = vmulq_f32(vld1q_f32(first + index), first_weight);
+					const float32x4_t b = vmulq_f32(vld1q_f32(second + index), second_weight);
+					vst1q_f32(output + index, vaddq_f32(a, b));
+				}
+#else
+				for (uint32_t index = 0; index < count; ++index)
+				{
+					output[index] = (first[index] * (1.0f - alpha)) + (second[index] * alpha);
+				}
+#endif
+			} // blend_rows
+
+			// Evaluate every joint of an instance from the sequence's samples.
+			// This matches Channel::evaluate for each channel.
+			static void get_sampled_pose(AnimatedInstance* instance, Sequence* sequence, Pose& pose)
+			{
+				const KeyframeList& reference = sequence->animation_set[0];
+				const Keyframe* keys = reference.keys;
+				const uint32_t last_key = (reference.total_keys - 1);
+				const float t_seconds = instance->local_time_seconds;
+				const float frame_delay_seconds = sequence->frame_delay_seconds;
+
+				uint32_t first_key;
+				uint32_t second_key;
+				float alpha;
+				if (t_seconds < keys[0].seconds)
+				{
+					// lerp forward from the second key
+					first_key = 1;
+					second_key = 0;
+					alpha = (keys[1].seconds - keys[0].seconds) / frame_delay_seconds;
+				}
+				else if (t_seconds >= keys[last_key].seconds)
+				{
+					first_key = last_key;
+					second_key = last_key;
+					alpha = 0.0f;
+				}
+				else
+				{
+					first_key = reference.find_key(t_seconds, frame_delay_seconds, 0);
+					second_key = first_key + 1;
+					alpha = (t_seconds - keys[first_key].seconds) / frame_delay_seconds;
+				}
+
+				const uint32_t stride = sequence->sample_joint_stride;
+				const uint32_t row_size = stride * ANIMATION_KEYFRAME_VALUES_MAX;
+				float values[MAX_BONES * ANIMATION_KEYFRAME_VALUES_MAX];
+				blend_rows(values,
+					sequence->samples + (first_key * row_size),
+					sequence->samples + (second_key * row_size),
+					alpha,
+					row_size);
+
+				const size_t total_joints = sequence->animation_set.size() / ANIMATION_KEYFRAME_VALUES_MAX;
+				const float* tx = values;
+				const float* ty = tx + stride;
+				const float* tz = ty + stride;
+				const float* rx = tz + stride;
+				const float* ry = rx + stride;
+				const float* rz = ry + stride;
+				const float* rw = rz + stride;
+				for (size_t joint = 0; joint < total_joints; ++joint)
+				{
+					pose.pos[joint] = glm::vec3(tx[joint], ty[joint], tz[joint]);
+					pose.rot[joint] = glm::quat(rw[joint], rx[joint], ry[joint], rz[joint]);
+				}
+			} // get_sampled_pose
+
+			static void get_poses_range(void* data, uint32_t start_index, uint32_t end_index)
+			{
+				PoseEvaluation* evaluation = static_cast<PoseEvaluation*>(data);
+				for (uint32_t index = start_index; index < end_index; ++index)
+				{
+					animated_instance_get_pose(evaluation->instances[index], evaluation->poses[index]);
+				}
+			} // get_poses_range
+		} // namespace detail
+
+		Sequence* read_sequence(gemini::Allocator& allocator, const char* name, Mesh* mesh)
+		{
 			Sequence* sequence = MEMORY2_NEW(allocator, Sequence)(allocator);
 			platform::PathString filepath = name;
 			filepath.append(".animation");
@@ -477,20 +687,49 @@ namespace gemini
 			data.sequence = sequence;
 			sequence->name = name;
 			LOGV("loading animation %s\n", filepath());
-			if (core::util::ConfigLoad_Success == core::util::json_load_with_callback(filepath(), detail::load_animation_from_json, &data, true))
+			if (!core::util::json_load_with_callback(filepath(), detail::load_animation_from_json, &data, true))
 			{
-				sequence->index = _animation_state->sequences.acquire();
-				_sequences_by_name->insert(SequenceHash::value_type(name, sequence));
-				_animation_state->sequences.set(sequence->index, sequence);
+				LOGW("Unable to load animation %s\n", filepath());
+				MEMORY2_DELETE(allocator, sequence);
+				return nullptr;
 			}
-			else
+
+			return sequence;
+		} // read_sequence
+
+		Sequence* load_sequence_from_file(gemini::Allocator& allocator, const char* name, Mesh* mesh)
+		{
+			if (_sequences_by_name->has_key(name))
 			{
-				MEMORY2_DELETE(allocator, sequence);
+				Sequence* data = 0;
+				data = _sequences_by_name->get(name);
+				return data;
+			}
+
+			Sequence* sequence = read_sequence(allocator, name, mesh);
+			if (sequence)
+			{
+				add_sequence(sequence);
 			}
 
 			return sequence;
 		} // load_sequence_from_file
 
+		SequenceId add_sequence(Sequence* sequence)
+		{
+			for (size_t index = 0; index < sequence->animation_set.size(); ++index)
+			{
+				sequence->animation_set[index].compute_spacing(sequence->frame_delay_seconds);
+			}
+
+			detail::build_samples(sequence);
+
+			sequence->index = _animation_state->sequences.acquire();
+			_sequences_by_name->insert(SequenceHash::value_type(sequence->name(), sequence));
+			_animation_state->sequences.set(sequence->index, sequence);
+			return sequence->index;
+		} // add_sequence
+
 		void startup(gemini::Allocator& allocator)
 		{
 			_allocator = &allocator;
@@ -510,7 +749,7 @@ namespace gemini
 			for (size_t index = 0; index < _animation_state->instances.size(); ++index)
 			{
 				AnimatedInstance* instance = _animation_state->instances.at(index);
-				MEMORY2_DELETE(*_allocator, instance);
+				MEMORY2_DELETE(_animation_state->instance_pool, instance);
 			}
 
 			MEMORY2_DELETE(*_allocator, _sequences_by_name);
@@ -562,16 +801,19 @@ namespace gemini
 		AnimatedInstance* create_sequence_instance(gemini::Allocator& allocator, SequenceId index)
 		{
 			Sequence* source = get_sequence_by_index(index);
-			AnimatedInstance* instance = MEMORY2_NEW(allocator, AnimatedInstance)(allocator);
+			AnimatedInstance* instance = MEMORY2_NEW(_animation_state->instance_pool, AnimatedInstance)(allocator);
 			instance->initialize(source);
 			instance->index = _animation_state->instances.acquire();
 			_animation_state->instances.set(instance->index, instance);
 			return instance;
 		}
 
-		void destroy_sequence_instance(gemini::Allocator& allocator, AnimatedInstance* instance)
+		void destroy_sequence_instance(gemini::Allocator& /*allocator*/, AnimatedInstance* instance)
 		{
+			// clear the slot so shutdown won't destroy it again
+			_animation_state->instances.set(instance->index, nullptr);
 			_animation_state->instances.release(instance->index);
+			MEMORY2_DELETE(_animation_state->instance_pool, instance);
 		}
 
 		AnimatedInstance* get_instance_by_index(SequenceId index)
@@ -595,12 +837,20 @@ namespace gemini
 			const size_t total_joints = instance->animation_set.size() / ANIMATION_KEYFRAME_VALUES_MAX;
 
 			// If you hit this, there are more joints than expected in this animation_set.
-			assert(total_joints < MAX_BONES);
+			assert(total_joints <= MAX_BONES);
 
 			Sequence* sequence = _animation_state->sequences.from_handle(instance->sequence_index);
 			assert(sequence);
 			float frame_delay_seconds = sequence->frame_delay_seconds;
 
+#if !defined(GEMINI_DEBUG_BONES)
+			if (sequence->samples)
+			{
+				detail::get_sampled_pose(instance, sequence, pose);
+				return;
+			}
+#endif
+
 			for (size_t bone_index = 0; bone_index < total_joints; ++bone_index)
 			{
 				animation::Channel* channel = &instance->channel_set[bone_index * ANIMATION_KEYFRAME_VALUES_MAX];
@@ -634,6 +884,19 @@ namespace gemini
 			}
 		} // animation_instance_get_pose
 
+		void animated_instance_get_poses(AnimatedInstance** instances, Pose* poses, uint32_t total_instances)
+		{
+			for (uint32_t index = 0; index < total_instances; ++index)
+			{
+				animated_instance_get_pose(instances[index], poses[index]);
+			}
+		} // animated_instance_get_poses
+
+		void animated_instance_get_poses_async(JobScheduler& scheduler, PoseEvaluation& evaluation, JobCounter* counter, uint32_t batch_size)
+		{
+			scheduler.parallel_for(detail::get_poses_range, &evaluation, evaluation.total_instances, batch_size, counter);
+		} // animated_instance_get_poses_async
+
 		//void animation_interpolate_pose(Pose& out, Pose& last_pose, Pose& curr_pose, float t)
 		//{
 		//	for (size_t index = 0; index < MAX_BONES; ++index)
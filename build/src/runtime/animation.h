@@ -36,9 +36,17 @@ namespace gemini
 {
 	struct Allocator;
 	struct Mesh;
+	struct JobCounter;
+	class JobScheduler;
 
 	const size_t ANIMATION_KEYFRAME_VALUES_MAX = 7;
 
+	// instances evaluated per job by animated_instance_get_poses_async
+	const uint32_t ANIMATION_POSE_BATCH_SIZE = 16;
+
+	// instances held in the animation pool; more fall back to the heap
+	const size_t ANIMATION_MAX_POOLED_INSTANCES = 512;
+
 	namespace animation
 	{
 		struct Keyframe
@@ -57,12 +65,23 @@ namespace gemini
 			float duration_seconds;
 			gemini::Allocator& allocator;
 
+			// keys are evenly spaced by frame_delay_seconds; set by compute_spacing.
+			bool uniform;
+
 			KeyframeList(gemini::Allocator& _allocator);
 			~KeyframeList();
 
 			void allocate(size_t key_count);
 			void deallocate();
 			void set_key(const size_t index, const float seconds, const float value);
+
+			// Determine if keys are uniformly spaced; call after setting keys.
+			void compute_spacing(float frame_delay_seconds);
+
+			// Returns the index of the last key at or before t_seconds.
+			// Uniform lists index directly; otherwise the search walks from
+			// hint. t_seconds must be within [first key, last key).
+			uint32_t find_key(float t_seconds, float frame_delay_seconds, uint32_t hint) const;
 		}; // KeyframeList
 
 		// This contains a stateful representation of a KeyframeList.
@@ -77,6 +96,9 @@ namespace gemini
 			// because keyframe[first] == keyframe[last]
 			bool wrap;
 
+			// key found by the last evaluate; the search hint for non-uniform keys
+			mutable uint32_t cursor;
+
 		public:
 			Channel(float* target = 0, bool should_wrap = true);
 			~Channel();
@@ -111,7 +133,18 @@ namespace gemini
 
 			FixedArray<KeyframeList> animation_set;
 
+			// Keyframe values resampled for batch evaluation; one row per key.
+			// Each row holds the values of every joint for one component
+			// (tx, ty, tz, rx, ry, rz, rw) in turn; sample_joint_stride apart.
+			// Only built when every channel shares the same uniformly spaced
+			// key times; otherwise this is null and channels are evaluated
+			// one at a time.
+			float* samples;
+			uint32_t total_samples;
+			uint32_t sample_joint_stride;
+
 			Sequence(gemini::Allocator& allocator);
+			~Sequence();
 		}; // Sequence
 
 		struct AnimatedInstance
@@ -147,7 +180,18 @@ namespace gemini
 		void shutdown();
 		void update(float delta_seconds);
 
+		// Read a sequence's keyframes from file without registering it.
+		// This doesn't touch the animation system; so it may be called
+		// from a streaming thread. Returns nullptr on failure.
+		Sequence* read_sequence(gemini::Allocator& allocator, const char* name, Mesh* mesh);
+
+		// Return the registered sequence named name; or read and register it.
+		// Returns nullptr on failure.
 		Sequence* load_sequence_from_file(gemini::Allocator& allocator, const char* name, Mesh* mesh);
+
+		// Register a sequence whose keyframes have been set; the animation
+		// system owns the sequence afterwards.
+		SequenceId add_sequence(Sequence* sequence);
 		SequenceId load_sequence(gemini::Allocator& allocator, const char* name, Mesh* mesh);
 		SequenceId find_sequence(const char* name);
 		Sequence* get_sequence_by_index(SequenceId index);
@@ -159,6 +203,21 @@ namespace gemini
 
 		void animated_instance_get_pose(AnimatedInstance* instance, Pose& pose);
 
+		// Evaluate poses[i] for instances[i].
+		void animated_instance_get_poses(AnimatedInstance** instances, Pose* poses, uint32_t total_instances);
+
+		struct PoseEvaluation
+		{
+			AnimatedInstance** instances;
+			Pose* poses;
+			uint32_t total_instances;
+		}; // PoseEvaluation
+
+		// Evaluate poses in batches across the scheduler's workers.
+		// This does not block; evaluation must remain valid until counter
+		// reaches zero.
+		void animated_instance_get_poses_async(JobScheduler& scheduler, PoseEvaluation& evaluation, JobCounter* counter, uint32_t batch_size = ANIMATION_POSE_BATCH_SIZE);
+
 		//void animation_interpolate_pose(Pose& out, Pose& last_pose, Pose& curr_pose, float t);
 	}
 } // namespace gemini
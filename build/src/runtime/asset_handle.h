@@ -45,4 +45,26 @@ namespace gemini
 	};
 
 	const AssetHandle InvalidAssetHandle = { UINT32_MAX };
+
+	// Status of an asset requested with load_async.
+	enum AssetStatus
+	{
+		// The handle does not refer to an asset.
+		AssetStatus_Invalid,
+
+		// Waiting to be read; or being read on a streaming thread.
+		AssetStatus_Loading,
+
+		// Reading has finished; waiting to be finalized on the main thread.
+		AssetStatus_Finalizing,
+
+		// The asset is loaded and ready to use.
+		AssetStatus_Ready,
+
+		// The asset could not be loaded.
+		AssetStatus_Failed,
+
+		// The load was cancelled before it finished.
+		AssetStatus_Cancelled
+	}; // AssetStatus
 } // namespace gemini
@@ -33,6 +33,7 @@
 #include <platform/platform.h>
 
 #include <runtime/asset_handle.h>
+#include <runtime/asset_streamer.h>
 
 #if 0
 // Design Goals
@@ -66,6 +67,11 @@ namespace gemini
 	}; // AssetLoadStatus
 
 
+	// Assets may be loaded synchronously with load, or streamed with
+	// load_async. A streamed asset is read on a streaming thread by
+	// read_asset, then finalized on the main thread by finalize_asset.
+	// By default read_asset does nothing and finalize_asset calls
+	// load_asset; libraries override both to move work off the main thread.
 	template <class T, class D>
 	class AssetLibrary2
 	{
@@ -83,6 +89,23 @@ namespace gemini
 
 			// path of the current asset on disk
 			platform::PathString asset_uri;
+
+			// Data passed from read_asset to finalize_asset. finalize_asset
+			// must release it; destroy_asset releases it if the load was
+			// cancelled or failed before it was finalized.
+			void* stream_data;
+
+			// This asset is being streamed; dependent assets should be
+			// requested with load_async as well.
+			bool is_streaming;
+
+			LoadState()
+				: allocator(nullptr)
+				, asset(nullptr)
+				, stream_data(nullptr)
+				, is_streaming(false)
+			{
+			}
 		}; // AssetLoadState
 
 		Allocator& allocator;
@@ -92,6 +115,27 @@ namespace gemini
 		platform::PathString prefix_uri;
 
 	private:
+		struct StreamRequest : public AssetStreamRequest
+		{
+			AssetLibrary2* library;
+			LoadState load_state;
+			platform::PathString fullpath;
+			void* parameters;
+			HandleIndex handle_index;
+			AssetLoadStatus read_status;
+		}; // StreamRequest
+
+		AssetStreamer* asset_streamer;
+
+		// The active request for each asset; or nullptr.
+		Array<StreamRequest*> requests;
+
+		// Every request which has been submitted and not yet finalized.
+		// This includes cancelled requests no longer referenced by requests.
+		Array<StreamRequest*> submitted_requests;
+
+		Array<AssetStatus> statuses;
+
 		D* instance()
 		{
 			return static_cast<D*>(this);
@@ -102,6 +146,102 @@ namespace gemini
 			return *instance();
 		}
 
+		AssetHandle handle_from_index(HandleIndex handle_index) const
+		{
+			AssetHandle handle;
+			handle.index = handle_index;
+			return handle;
+		}
+
+		platform::PathString fullpath_from_relative(const char* relative_path) const
+		{
+			platform::PathString fullpath = prefix_uri;
+			fullpath.append(relative_path);
+			platform::path::normalize(&fullpath[0]);
+			return fullpath;
+		}
+
+		static void read_request(AssetStreamRequest* stream_request)
+		{
+			// This is called on a streaming thread.
+			StreamRequest* request = static_cast<StreamRequest*>(stream_request);
+			request->read_status = request->library->instance_reference().read_asset(request->load_state, request->fullpath, request->parameters);
+		} // read_request
+
+		static void finalize_request(AssetStreamRequest* stream_request)
+		{
+			StreamRequest* request = static_cast<StreamRequest*>(stream_request);
+			request->library->finalize_stream_request(request);
+		} // finalize_request
+
+		void submit_request(HandleIndex handle_index, const platform::PathString& fullpath, int32_t priority, void* parameters)
+		{
+			StreamRequest* request = MEMORY2_NEW(allocator, StreamRequest);
+			request->read = read_request;
+			request->finalize = finalize_request;
+			request->priority = priority;
+			request->library = this;
+			request->load_state.allocator = &allocator;
+			request->load_state.asset_uri = fullpath;
+			request->load_state.is_streaming = true;
+			request->fullpath = fullpath;
+			request->parameters = parameters;
+			request->handle_index = handle_index;
+			request->read_status = AssetLoad_Failure;
+
+			instance_reference().create_asset(request->load_state, parameters);
+
+			requests[handle_index - 1] = request;
+			statuses[handle_index - 1] = AssetStatus_Loading;
+			submitted_requests.push_back(request);
+			asset_streamer->submit(request);
+		} // submit_request
+
+		void finalize_stream_request(StreamRequest* request)
+		{
+			const size_t index = static_cast<size_t>(request->handle_index - 1);
+
+			// Cancelled requests are no longer referenced by their asset.
+			if (requests[index] == request)
+			{
+				requests[index] = nullptr;
+
+				AssetLoadStatus load_result = request->read_status;
+				if (load_result == AssetLoad_Success)
+				{
+					load_result = instance_reference().finalize_asset(request->load_state, request->fullpath, request->parameters);
+				}
+
+				if (load_result == AssetLoad_Success)
+				{
+					// Swap in the new asset; the old one (if this was a
+					// reload) is destroyed below.
+					T* old_asset = assets[index];
+					assets[index] = request->load_state.asset;
+					request->load_state.asset = old_asset;
+					statuses[index] = AssetStatus_Ready;
+				}
+				else
+				{
+					LOGW("FAILED to load asset [%s]\n", request->fullpath());
+
+					// A failed reload keeps the previous asset.
+					if (!assets[index])
+					{
+						statuses[index] = AssetStatus_Failed;
+					}
+				}
+			}
+
+			if (request->load_state.asset || request->load_state.stream_data)
+			{
+				instance_reference().destroy_asset(request->load_state);
+			}
+
+			submitted_requests.erase(request);
+			MEMORY2_DELETE(allocator, request);
+		} // finalize_stream_request
+
 	public:
 
 		AssetLibrary2(gemini::Allocator& asset_allocator)
@@ -109,6 +249,10 @@ namespace gemini
 			, assets(asset_allocator)
 			, default_asset_pointer(nullptr)
 			, handle_by_name(asset_allocator)
+			, asset_streamer(nullptr)
+			, requests(asset_allocator)
+			, submitted_requests(asset_allocator)
+			, statuses(asset_allocator)
 		{
 		}
 
@@ -148,7 +292,31 @@ namespace gemini
 			return default_asset_pointer;
 		}
 
-		bool handle_is_valid(AssetHandle handle)
+		// Set the streamer used by load_async. Without a streamer,
+		// load_async loads synchronously.
+		void streamer(AssetStreamer* streamer)
+		{
+			asset_streamer = streamer;
+		}
+
+		AssetStreamer* streamer() const
+		{
+			return asset_streamer;
+		}
+
+		// Called on a streaming thread; this must not touch the library.
+		AssetLoadStatus read_asset(LoadState& /*state*/, platform::PathString& /*fullpath*/, void* /*parameters*/)
+		{
+			return AssetLoad_Success;
+		} // read_asset
+
+		// Called on the main thread after read_asset succeeded.
+		AssetLoadStatus finalize_asset(LoadState& state, platform::PathString& fullpath, void* parameters)
+		{
+			return instance_reference().load_asset(state, fullpath, parameters);
+		} // finalize_asset
+
+		bool handle_is_valid(AssetHandle handle) const
 		{
 			return (handle.index > 0) && (handle.index <= assets.size());
 		} // handle_is_valid
@@ -156,29 +324,42 @@ namespace gemini
 		AssetHandle load(const char* relative_path, bool ignore_cache = false, void* parameters = nullptr)
 		{
 			// 1. Check to see if the asset is already loaded...
-			platform::PathString fullpath = prefix_uri;
-			fullpath.append(relative_path);
+			platform::PathString fullpath = fullpath_from_relative(relative_path);
 			uint8_t asset_is_new = 1;
 			HandleIndex handle_index;
 			handle_index = 0;
 
-			platform::path::normalize(&fullpath[0]);
 			if (handle_by_name.has_key(fullpath()))
 			{
 				HandleIndex index_to_check = handle_by_name[fullpath()];
-				AssetHandle asset_handle;
-				asset_handle.index = index_to_check;
-				T* asset = lookup(asset_handle);
+				StreamRequest* request = requests[index_to_check - 1];
+				if (request)
+				{
+					// This asset is being streamed; finish that request
+					// rather than loading it a second time.
+					if (!ignore_cache)
+					{
+						asset_streamer->complete(request);
+						return handle_from_index(index_to_check);
+					}
+
+					cancel(handle_from_index(index_to_check));
+				}
+
+				T* asset = assets[index_to_check - 1];
 
 				// Some asset types require parameters to validate that they
-				// are indeed the same asset.
-				if (instance_reference().is_same_asset(asset, parameters))
+				// are indeed the same asset. Cancelled and failed assets
+				// have nothing to compare against.
+				if (!asset || instance_reference().is_same_asset(asset, parameters))
 				{
 					asset_is_new = 0;
 					handle_index = index_to_check;
 
 					// An entry exists for it: return it.
-					if (!ignore_cache)
+					// Cancelled and failed entries are loaded again.
+					const AssetStatus status = statuses[index_to_check - 1];
+					if (!ignore_cache && (status != AssetStatus_Cancelled) && (status != AssetStatus_Failed))
 					{
 						AssetHandle handle;
 						handle.index = handle_index;
@@ -208,10 +389,15 @@ namespace gemini
 
 					T* old_asset = assets[static_cast<int>(handle_index - 1)];
 					assets[handle_index - 1] = load_state.asset;
+					statuses[handle_index - 1] = AssetStatus_Ready;
+					handle.index = handle_index;
 
 					// delete the old asset
-					load_state.asset = old_asset;
-					instance_reference().destroy_asset(load_state);
+					if (old_asset)
+					{
+						load_state.asset = old_asset;
+						instance_reference().destroy_asset(load_state);
+					}
 				}
 
 				return handle;
@@ -228,9 +414,105 @@ namespace gemini
 			return handle;
 		} // load
 
-		T* lookup(AssetHandle handle)
+		// Request an asset to be streamed. This returns immediately; the
+		// handle resolves to the default asset until the asset is ready.
+		// Requests for an asset which is already loaded or streaming
+		// return the existing handle. Higher priority requests are read
+		// and finalized first. parameters must remain valid until the
+		// asset is finalized.
+		AssetHandle load_async(const char* relative_path, int32_t priority = 0, bool ignore_cache = false, void* parameters = nullptr)
+		{
+			if (!asset_streamer)
+			{
+				return load(relative_path, ignore_cache, parameters);
+			}
+
+			platform::PathString fullpath = fullpath_from_relative(relative_path);
+			HandleIndex handle_index = 0;
+
+			if (handle_by_name.has_key(fullpath()))
+			{
+				handle_index = handle_by_name[fullpath()];
+				StreamRequest* request = requests[handle_index - 1];
+				T* asset = assets[handle_index - 1];
+
+				if (request)
+				{
+					if (!ignore_cache)
+					{
+						if (priority > request->priority)
+						{
+							asset_streamer->reprioritize(request, priority);
+						}
+						return handle_from_index(handle_index);
+					}
+
+					// A reload supersedes the pending request.
+					cancel(handle_from_index(handle_index));
+				}
+				else if (asset && !instance_reference().is_same_asset(asset, parameters))
+				{
+					handle_index = static_cast<HandleIndex>(take_ownership(fullpath, nullptr, false).index);
+				}
+				else if (!ignore_cache && (statuses[handle_index - 1] != AssetStatus_Cancelled) && (statuses[handle_index - 1] != AssetStatus_Failed))
+				{
+					return handle_from_index(handle_index);
+				}
+			}
+			else
+			{
+				handle_index = static_cast<HandleIndex>(take_ownership(fullpath, nullptr, false).index);
+			}
+
+			submit_request(handle_index, fullpath, priority, parameters);
+			return handle_from_index(handle_index);
+		} // load_async
+
+		AssetStatus status(AssetHandle handle) const
 		{
 			if (!handle_is_valid(handle))
+			{
+				return AssetStatus_Invalid;
+			}
+
+			const StreamRequest* request = requests[handle.index - 1];
+			if (request && (request->state == AssetStream_Finalizing))
+			{
+				return AssetStatus_Finalizing;
+			}
+
+			return statuses[handle.index - 1];
+		} // status
+
+		// Block until a streamed asset has finished loading.
+		AssetStatus wait(AssetHandle handle)
+		{
+			if (handle_is_valid(handle) && requests[handle.index - 1])
+			{
+				asset_streamer->complete(requests[handle.index - 1]);
+			}
+
+			return status(handle);
+		} // wait
+
+		// Cancel streaming an asset. The handle continues to resolve to
+		// the default asset; or to the previous asset for a reload.
+		void cancel(AssetHandle handle)
+		{
+			if (!handle_is_valid(handle) || !requests[handle.index - 1])
+			{
+				return;
+			}
+
+			const size_t index = static_cast<size_t>(handle.index - 1);
+			asset_streamer->cancel(requests[index]);
+			requests[index] = nullptr;
+			statuses[index] = assets[index] ? AssetStatus_Ready : AssetStatus_Cancelled;
+		} // cancel
+
+		T* lookup(AssetHandle handle)
+		{
+			if (!handle_is_valid(handle) || !assets[handle.index - 1])
 			{
 				return default_asset();
 			}
@@ -240,14 +522,32 @@ namespace gemini
 
 		void purge()
 		{
+			// Cancel and release all outstanding requests first.
+			for (size_t index = 0; index < requests.size(); ++index)
+			{
+				cancel(handle_from_index(static_cast<HandleIndex>(index + 1)));
+			}
+
+			while (!submitted_requests.empty())
+			{
+				asset_streamer->complete(submitted_requests[0]);
+			}
+
 			for (size_t index = 0; index < assets.size(); ++index)
 			{
+				if (!assets[index])
+				{
+					continue;
+				}
+
 				LoadState load_state;
 				load_state.allocator = &allocator;
 				load_state.asset = assets[index];
 				instance_reference().destroy_asset(load_state);
 			}
 			assets.clear();
+			requests.clear();
+			statuses.clear();
 			handle_by_name.clear();
 		} // purge
 
@@ -265,6 +565,9 @@ namespace gemini
 			return prefix_uri;
 		} // prefix_path
 
+		// Take ownership of asset and associate it with path.
+		// The asset may be null to reserve a handle for an asset which
+		// is being streamed.
 		AssetHandle take_ownership(const platform::PathString& path, T* asset, bool verify_unique = true)
 		{
 			AssetHandle handle;
@@ -278,6 +581,8 @@ namespace gemini
 				uint16_t index = static_cast<uint16_t>(assets.size());
 				handle_by_name[normalized_path] = index + 1;
 				assets.push_back(asset);
+				requests.push_back(nullptr);
+				statuses.push_back(asset ? AssetStatus_Ready : AssetStatus_Loading);
 
 				handle.index = (index + 1);
 				return handle;
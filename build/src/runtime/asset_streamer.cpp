@@ -0,0 +1,416 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <runtime/asset_streamer.h>
+
+#include <platform/platform.h>
+#include <core/logging.h>
+#include <core/profiler.h>
+
+namespace gemini
+{
+	// Returns true if first should be read or finalized before second.
+	static bool stream_request_before(const AssetStreamRequest* first, const AssetStreamRequest* second)
+	{
+		if (first->priority != second->priority)
+		{
+			return first->priority > second->priority;
+		}
+
+		// earlier submissions first; this is safe across sequence wrap.
+		return static_cast<int32_t>(first->sequence - second->sequence) < 0;
+	}
+
+	static void stream_heap_sift_up(Array<AssetStreamRequest*>& heap, size_t index)
+	{
+		while (index > 0)
+		{
+			const size_t parent = (index - 1) / 2;
+			if (!stream_request_before(heap[index], heap[parent]))
+			{
+				break;
+			}
+
+			heap.swap(index, parent);
+			index = parent;
+		}
+	}
+
+	static void stream_heap_sift_down(Array<AssetStreamRequest*>& heap, size_t index)
+	{
+		const size_t total_items = heap.size();
+		for (;;)
+		{
+			const size_t left = (index * 2) + 1;
+			const size_t right = left + 1;
+			size_t first = index;
+
+			if (left < total_items && stream_request_before(heap[left], heap[first]))
+			{
+				first = left;
+			}
+
+			if (right < total_items && stream_request_before(heap[right], heap[first]))
+			{
+				first = right;
+			}
+
+			if (first == index)
+			{
+				break;
+			}
+
+			heap.swap(index, first);
+			index = first;
+		}
+	}
+
+	static void stream_heap_push(Array<AssetStreamRequest*>& heap, AssetStreamRequest* request)
+	{
+		heap.push_back(request);
+		stream_heap_sift_up(heap, heap.size() - 1);
+	}
+
+	static AssetStreamRequest* stream_heap_remove(Array<AssetStreamRequest*>& heap, size_t index)
+	{
+		AssetStreamRequest* request = heap[index];
+		const size_t last = heap.size() - 1;
+		if (index != last)
+		{
+			heap.swap(index, last);
+		}
+		heap.pop_back();
+
+		if (index < heap.size())
+		{
+			stream_heap_sift_up(heap, index);
+			stream_heap_sift_down(heap, index);
+		}
+
+		return request;
+	}
+
+	// Returns heap.size() if the request isn't in the heap.
+	static size_t stream_heap_find(const Array<AssetStreamRequest*>& heap, const AssetStreamRequest* request)
+	{
+		for (size_t index = 0; index < heap.size(); ++index)
+		{
+			if (heap[index] == request)
+			{
+				return index;
+			}
+		}
+
+		return heap.size();
+	}
+
+	static void asset_streamer_worker(platform::Thread* thread)
+	{
+		AssetStreamer::worker_data* worker = static_cast<AssetStreamer::worker_data*>(thread->user_data);
+		PROFILE_THREAD_NAME("asset_streamer");
+		worker->streamer->worker_main(worker);
+	}
+
+	AssetStreamer::AssetStreamer(gemini::Allocator& _allocator)
+		: allocator(_allocator)
+		, queued(_allocator)
+		, queued_lock(0)
+		, completed(_allocator)
+		, completed_lock(0)
+		, workers(_allocator)
+		, semaphore(nullptr)
+		, outstanding(0)
+		, next_sequence(0)
+	{
+	}
+
+	AssetStreamer::~AssetStreamer()
+	{
+		// If you hit this, destroy_workers was not called.
+		assert(workers.empty());
+
+		// If you hit this, requests were never finalized.
+		assert(outstanding == 0);
+	}
+
+	void AssetStreamer::create_workers(uint32_t max_workers)
+	{
+		// If you hit this, create_workers was called more than once.
+		assert(semaphore == nullptr);
+
+		// Each submit signals the semaphore once and destroy_workers
+		// signals once per worker.
+		semaphore = platform::semaphore_create(0, MAX_REQUESTS + max_workers);
+		assert(semaphore);
+
+		// worker_data is shared with the threads; size it up front.
+		workers.resize(max_workers);
+		for (uint32_t index = 0; index < max_workers; ++index)
+		{
+			worker_data* data = &workers[index];
+			data->worker_index = index;
+			data->streamer = this;
+			data->is_active = 1;
+
+			data->thread = platform::thread_create(asset_streamer_worker, data);
+			assert(data->thread);
+		}
+	}
+
+	void AssetStreamer::destroy_workers()
+	{
+		// If you hit this, requests were still pending at shutdown.
+		assert(outstanding == 0);
+
+		for (uint32_t index = 0; index < workers.size(); ++index)
+		{
+			workers[index].is_active = 0;
+		}
+
+		if (semaphore)
+		{
+			platform::semaphore_signal(semaphore, static_cast<uint32_t>(workers.size()));
+		}
+
+		for (worker_data& worker : workers)
+		{
+			platform::thread_join(worker.thread, 2500);
+			platform::thread_destroy(worker.thread);
+			worker.streamer = nullptr;
+		}
+		workers.clear();
+
+		if (semaphore)
+		{
+			platform::semaphore_destroy(semaphore);
+			semaphore = nullptr;
+		}
+	}
+
+	uint32_t AssetStreamer::worker_count() const
+	{
+		return static_cast<uint32_t>(workers.size());
+	}
+
+	void AssetStreamer::read_request(AssetStreamRequest* request)
+	{
+		if (!request->cancelled)
+		{
+			PROFILE_BEGIN("asset_read");
+			request->read(request);
+			PROFILE_END("asset_read");
+		}
+
+		// The request must be visible in the completed heap before its
+		// state changes; complete() relies on this.
+		atom_spin_lock(&completed_lock);
+		stream_heap_push(completed, request);
+		request->state = AssetStream_Finalizing;
+		atom_spin_unlock(&completed_lock);
+	}
+
+	void AssetStreamer::finalize_request(AssetStreamRequest* request)
+	{
+		// The request may be released by finalize.
+		request->finalize(request);
+		atom_decrement32(&outstanding);
+	}
+
+	void AssetStreamer::submit(AssetStreamRequest* request)
+	{
+		assert(request->read && request->finalize);
+		request->state = AssetStream_Queued;
+		request->cancelled = 0;
+		request->sequence = next_sequence++;
+
+		// If you hit this, too many requests are in flight.
+		assert(outstanding < MAX_REQUESTS);
+		atom_increment32(&outstanding);
+
+		atom_spin_lock(&queued_lock);
+		stream_heap_push(queued, request);
+		atom_spin_unlock(&queued_lock);
+
+		if (semaphore)
+		{
+			platform::semaphore_signal(semaphore);
+		}
+	}
+
+	void AssetStreamer::cancel(AssetStreamRequest* request)
+	{
+		request->cancelled = 1;
+	}
+
+	void AssetStreamer::reprioritize(AssetStreamRequest* request, int32_t priority)
+	{
+		atom_spin_lock(&queued_lock);
+		const size_t index = stream_heap_find(queued, request);
+		if (index < queued.size())
+		{
+			request->priority = priority;
+			stream_heap_sift_up(queued, index);
+			stream_heap_sift_down(queued, index);
+		}
+		atom_spin_unlock(&queued_lock);
+	}
+
+	void AssetStreamer::complete(AssetStreamRequest* request)
+	{
+		// If the request hasn't been picked up yet; read it here.
+		bool is_queued = false;
+		atom_spin_lock(&queued_lock);
+		const size_t index = stream_heap_find(queued, request);
+		if (index < queued.size())
+		{
+			stream_heap_remove(queued, index);
+			request->state = AssetStream_Reading;
+			is_queued = true;
+		}
+		atom_spin_unlock(&queued_lock);
+
+		if (is_queued)
+		{
+			if (!request->cancelled)
+			{
+				PROFILE_BEGIN("asset_read");
+				request->read(request);
+				PROFILE_END("asset_read");
+			}
+			request->state = AssetStream_Finalizing;
+			finalize_request(request);
+			return;
+		}
+
+		// A streaming thread is reading it; wait for it to finish.
+		while (request->state != AssetStream_Finalizing)
+		{
+			platform::thread_sleep(1);
+		}
+
+		atom_spin_lock(&completed_lock);
+		const size_t completed_index = stream_heap_find(completed, request);
+		assert(completed_index < completed.size());
+		stream_heap_remove(completed, completed_index);
+		atom_spin_unlock(&completed_lock);
+
+		finalize_request(request);
+	}
+
+	uint32_t AssetStreamer::finalize(float budget_milliseconds)
+	{
+		PROFILE_BEGIN("asset_finalize");
+		const uint64_t start_time = platform::microseconds();
+		const uint64_t budget_microseconds = static_cast<uint64_t>(budget_milliseconds * 1000.0f);
+		uint32_t total_finalized = 0;
+
+		for (;;)
+		{
+			// Without streaming threads; read the next request here.
+			if (workers.empty())
+			{
+				AssetStreamRequest* request = nullptr;
+				atom_spin_lock(&queued_lock);
+				if (!queued.empty())
+				{
+					request = stream_heap_remove(queued, 0);
+					request->state = AssetStream_Reading;
+				}
+				atom_spin_unlock(&queued_lock);
+
+				if (request)
+				{
+					read_request(request);
+				}
+			}
+
+			AssetStreamRequest* request = nullptr;
+			atom_spin_lock(&completed_lock);
+			if (!completed.empty())
+			{
+				request = stream_heap_remove(completed, 0);
+			}
+			atom_spin_unlock(&completed_lock);
+
+			if (!request)
+			{
+				break;
+			}
+
+			finalize_request(request);
+			++total_finalized;
+
+			if ((platform::microseconds() - start_time) >= budget_microseconds)
+			{
+				break;
+			}
+		}
+
+		PROFILE_END("asset_finalize");
+		return total_finalized;
+	}
+
+	void AssetStreamer::flush()
+	{
+		while (outstanding > 0)
+		{
+			if (finalize(1000.0f) == 0)
+			{
+				platform::thread_sleep(1);
+			}
+		}
+	}
+
+	uint32_t AssetStreamer::pending() const
+	{
+		return outstanding;
+	}
+
+	void AssetStreamer::worker_main(worker_data* worker)
+	{
+		while (worker->is_active)
+		{
+			platform::semaphore_wait(semaphore);
+			if (!worker->is_active)
+			{
+				break;
+			}
+
+			AssetStreamRequest* request = nullptr;
+			atom_spin_lock(&queued_lock);
+			if (!queued.empty())
+			{
+				request = stream_heap_remove(queued, 0);
+				request->state = AssetStream_Reading;
+			}
+			atom_spin_unlock(&queued_lock);
+
+			// The request may have been completed on the main thread.
+			if (request)
+			{
+				read_request(request);
+			}
+		}
+	}
+} // namespace gemini
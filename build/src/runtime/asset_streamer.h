@@ -0,0 +1,162 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#pragma once
+
+#include <core/typedefs.h>
+#include <core/array.h>
+#include <core/atomic.h>
+
+namespace platform
+{
+	struct Semaphore;
+	struct Thread;
+} // namespace platform
+
+namespace gemini
+{
+	enum AssetStreamState
+	{
+		// Waiting in the queue for a streaming thread.
+		AssetStream_Queued,
+
+		// Being read and decoded on a streaming thread.
+		AssetStream_Reading,
+
+		// Reading has finished; waiting to be finalized on the main thread.
+		AssetStream_Finalizing
+	}; // AssetStreamState
+
+	// A request is owned by the code which submits it; it must remain
+	// valid until its finalize function is called.
+	struct AssetStreamRequest
+	{
+		// Reads and decodes the asset. This is called on a streaming thread;
+		// or on the main thread when a request is completed early.
+		// This is not called for requests cancelled before they are read.
+		void(*read)(AssetStreamRequest* request);
+
+		// Called on the main thread once reading has finished. This performs
+		// any work which must happen on the main thread (GPU uploads) and
+		// releases the request. Cancelled requests are finalized as well.
+		void(*finalize)(AssetStreamRequest* request);
+
+		// Requests with higher priority are read and finalized first.
+		int32_t priority;
+
+		// Submission order; used to break ties between equal priorities.
+		uint32_t sequence;
+
+		volatile uint32_t state;
+		volatile uint32_t cancelled;
+	}; // AssetStreamRequest
+
+	// Reads assets on background threads in priority order.
+	// Requests are submitted and finalized on the main thread; finalize
+	// is called once per frame with a time budget.
+	class AssetStreamer
+	{
+	public:
+		// maximum number of requests submitted but not yet finalized
+		static const uint32_t MAX_REQUESTS = 4096;
+
+		struct worker_data
+		{
+			uint32_t worker_index;
+			platform::Thread* thread;
+			AssetStreamer* streamer;
+			volatile int32_t is_active;
+		};
+
+	private:
+		gemini::Allocator& allocator;
+
+		// Binary heap of requests waiting to be read.
+		Array<AssetStreamRequest*> queued;
+		volatile uint32_t queued_lock;
+
+		// Binary heap of requests waiting to be finalized.
+		Array<AssetStreamRequest*> completed;
+		volatile uint32_t completed_lock;
+
+		Array<worker_data> workers;
+		platform::Semaphore* semaphore;
+
+		// number of requests submitted but not yet finalized
+		atomic<uint32_t> outstanding;
+		uint32_t next_sequence;
+
+		void read_request(AssetStreamRequest* request);
+		void finalize_request(AssetStreamRequest* request);
+
+	public:
+		AssetStreamer(gemini::Allocator& allocator);
+		~AssetStreamer();
+
+		AssetStreamer(const AssetStreamer& other) = delete;
+		AssetStreamer& operator=(const AssetStreamer& other) = delete;
+
+		// Create max_workers streaming threads.
+		// Zero workers is valid: requests are then read inside finalize.
+		void create_workers(uint32_t max_workers);
+
+		// Destroys all streaming threads.
+		// All requests must be finalized before this is called.
+		void destroy_workers();
+
+		// returns the number of streaming threads
+		uint32_t worker_count() const;
+
+		// Queue a request to be read. At most MAX_REQUESTS may be
+		// outstanding. Main thread only.
+		void submit(AssetStreamRequest* request);
+
+		// Flag a request as cancelled. A request which has not started
+		// reading will not be read. The request is still finalized so that
+		// its owner can release it.
+		void cancel(AssetStreamRequest* request);
+
+		// Change the priority of a request which has not started reading.
+		void reprioritize(AssetStreamRequest* request, int32_t priority);
+
+		// Read (if needed) and finalize a single request; blocking until
+		// it has finished. Main thread only.
+		void complete(AssetStreamRequest* request);
+
+		// Finalize requests in priority order until budget_milliseconds
+		// have elapsed. At least one request is finalized if any are ready.
+		// Returns the number of requests finalized. Main thread only.
+		uint32_t finalize(float budget_milliseconds);
+
+		// Block until every submitted request has been finalized.
+		// Main thread only.
+		void flush();
+
+		// returns the number of requests submitted but not yet finalized
+		uint32_t pending() const;
+
+		// entry point for streaming threads
+		void worker_main(worker_data* worker);
+	}; // class AssetStreamer
+} // namespace gemini
@@ -38,6 +38,7 @@
 #include <runtime/texture_library.h>
 #include <renderer/shader_library.h>
 #include <runtime/audio_library.h>
+#include <runtime/asset_streamer.h>
 
 using namespace renderer;
 
@@ -52,8 +53,13 @@ namespace gemini
 		AudioLibrary* sounds;
 		TextureLibrary* textures;
 		render2::Device* device;
+		AssetStreamer* streamer;
 	};
 
+	// Streaming threads spend most of their time waiting on I/O
+	// or decoding; a few are enough to keep the queue moving.
+	const uint32_t MAX_STREAMING_THREADS = 4;
+
 	AssetState* _asset_state = nullptr;
 
 	namespace assets
@@ -121,6 +127,21 @@ namespace gemini
 			_asset_state->sounds		= MEMORY2_NEW(asset_allocator, gemini::AudioLibrary)(asset_allocator);
 			_asset_state->textures		= MEMORY2_NEW(asset_allocator, gemini::TextureLibrary)(asset_allocator, device);
 
+			// Meshes, materials, sounds and textures can be streamed.
+			const uint32_t total_processors = static_cast<uint32_t>(platform::system_processor_count());
+			uint32_t total_streaming_threads = (total_processors > 1) ? (total_processors - 1) : 1;
+			if (total_streaming_threads > MAX_STREAMING_THREADS)
+			{
+				total_streaming_threads = MAX_STREAMING_THREADS;
+			}
+
+			_asset_state->streamer = MEMORY2_NEW(asset_allocator, gemini::AssetStreamer)(asset_allocator);
+			_asset_state->streamer->create_workers(total_streaming_threads);
+			_asset_state->materials->streamer(_asset_state->streamer);
+			_asset_state->meshes->streamer(_asset_state->streamer);
+			_asset_state->sounds->streamer(_asset_state->streamer);
+			_asset_state->textures->streamer(_asset_state->streamer);
+
 			_asset_state->fonts->prefix_path("fonts");
 			_asset_state->materials->prefix_path("materials");
 			_asset_state->shaders->prefix_path(shader_root);
@@ -141,11 +162,29 @@ namespace gemini
 			MEMORY2_DELETE(asset_allocator, _asset_state->sounds);
 			MEMORY2_DELETE(asset_allocator, _asset_state->textures);
 
+			// Libraries release their outstanding requests when purged.
+			_asset_state->streamer->destroy_workers();
+			MEMORY2_DELETE(asset_allocator, _asset_state->streamer);
+
 			// Delete base asset state
 			MEMORY2_DELETE(asset_allocator, _asset_state);
 			_asset_state = nullptr;
 		} // shutdown
 
+		void update(float budget_milliseconds)
+		{
+			_asset_state->streamer->finalize(budget_milliseconds);
+		} // update
+
+		void flush()
+		{
+			_asset_state->streamer->flush();
+		} // flush
+
+		uint32_t pending()
+		{
+			return _asset_state->streamer->pending();
+		} // pending
 	} // namespace assets
 
 	AssetHandle mesh_load(const char* path, bool ignore_cache, void* parameters)
@@ -153,6 +192,21 @@ namespace gemini
 		return _asset_state->meshes->load(path, ignore_cache, parameters);
 	} // mesh_load
 
+	AssetHandle mesh_load_async(const char* path, int32_t priority)
+	{
+		return _asset_state->meshes->load_async(path, priority);
+	} // mesh_load_async
+
+	AssetStatus mesh_status(AssetHandle handle)
+	{
+		return _asset_state->meshes->status(handle);
+	} // mesh_status
+
+	void mesh_cancel(AssetHandle handle)
+	{
+		_asset_state->meshes->cancel(handle);
+	} // mesh_cancel
+
 	Mesh* mesh_from_handle(AssetHandle handle)
 	{
 		return _asset_state->meshes->lookup(handle);
@@ -173,6 +227,21 @@ namespace gemini
 		return _asset_state->textures->load(path, ignore_cache, parameters);
 	} // texture_load
 
+	AssetHandle texture_load_async(const char* path, int32_t priority)
+	{
+		return _asset_state->textures->load_async(path, priority);
+	} // texture_load_async
+
+	AssetStatus texture_status(AssetHandle handle)
+	{
+		return _asset_state->textures->status(handle);
+	} // texture_status
+
+	void texture_cancel(AssetHandle handle)
+	{
+		_asset_state->textures->cancel(handle);
+	} // texture_cancel
+
 	render2::Texture* texture_from_handle(AssetHandle handle)
 	{
 		return _asset_state->textures->lookup(handle);
@@ -183,6 +252,21 @@ namespace gemini
 		return _asset_state->materials->load(path, ignore_cache, parameters);
 	} // material_load
 
+	AssetHandle material_load_async(const char* path, int32_t priority)
+	{
+		return _asset_state->materials->load_async(path, priority);
+	} // material_load_async
+
+	AssetStatus material_status(AssetHandle handle)
+	{
+		return _asset_state->materials->status(handle);
+	} // material_status
+
+	void material_cancel(AssetHandle handle)
+	{
+		_asset_state->materials->cancel(handle);
+	} // material_cancel
+
 	Material* material_from_handle(AssetHandle handle)
 	{
 		return _asset_state->materials->lookup(handle);
@@ -228,6 +312,21 @@ namespace gemini
 		return _asset_state->sounds->load(path, ignore_cache, parameters);
 	} // sound_load
 
+	AssetHandle sound_load_async(const char* path, int32_t priority)
+	{
+		return _asset_state->sounds->load_async(path, priority);
+	} // sound_load_async
+
+	AssetStatus sound_status(AssetHandle handle)
+	{
+		return _asset_state->sounds->status(handle);
+	} // sound_status
+
+	void sound_cancel(AssetHandle handle)
+	{
+		_asset_state->sounds->cancel(handle);
+	} // sound_cancel
+
 	Sound* sound_from_handle(AssetHandle handle)
 	{
 		return _asset_state->sounds->lookup(handle);
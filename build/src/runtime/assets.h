@@ -66,18 +66,37 @@ namespace gemini
 
 		// purge all assets and reclaim unused memory
 		void shutdown();
+
+		// Finalize streamed assets; spending at most budget_milliseconds.
+		// This must be called once per frame from the main thread.
+		void update(float budget_milliseconds);
+
+		// Block until all streamed assets have finished loading.
+		void flush();
+
+		// returns the number of streamed assets which haven't finished loading
+		uint32_t pending();
 	} // namespace assets
 
 	AssetHandle mesh_load(const char* path, bool ignore_cache = false, void* parameters = nullptr);
+	AssetHandle mesh_load_async(const char* path, int32_t priority = 0);
+	AssetStatus mesh_status(AssetHandle handle);
+	void mesh_cancel(AssetHandle handle);
 	Mesh* mesh_from_handle(AssetHandle handle);
 
 	AssetHandle shader_load(const char* path, bool ignore_cache = false, void* parameters = nullptr);
 	render2::Shader* shader_from_handle(AssetHandle handle);
 
 	AssetHandle texture_load(const char* path, bool ignore_cache = false, void* parameters = nullptr);
+	AssetHandle texture_load_async(const char* path, int32_t priority = 0);
+	AssetStatus texture_status(AssetHandle handle);
+	void texture_cancel(AssetHandle handle);
 	render2::Texture* texture_from_handle(AssetHandle handle);
 
 	AssetHandle material_load(const char* path, bool ignore_cache = false, void* parameters = nullptr);
+	AssetHandle material_load_async(const char* path, int32_t priority = 0);
+	AssetStatus material_status(AssetHandle handle);
+	void material_cancel(AssetHandle handle);
 	Material* material_from_handle(AssetHandle handle);
 
 	/// @returns The number of vertices required to render string with
@@ -99,5 +118,8 @@ namespace gemini
 
 
 	AssetHandle sound_load(const char* path, bool ignore_cache, void* parameters = nullptr);
+	AssetHandle sound_load_async(const char* path, int32_t priority = 0);
+	AssetStatus sound_status(AssetHandle handle);
+	void sound_cancel(AssetHandle handle);
 	Sound* sound_from_handle(AssetHandle handle);
 } // namespace gemini
@@ -290,6 +290,16 @@ namespace gemini
 	}
 
 	AssetLoadStatus AudioLibrary::load_asset(LoadState& state, platform::PathString& fullpath, void* parameters)
+	{
+		if (read_asset(state, fullpath, parameters) != AssetLoad_Success)
+		{
+			return AssetLoad_Failure;
+		}
+
+		return finalize_asset(state, fullpath, parameters);
+	}
+
+	AssetLoadStatus AudioLibrary::read_asset(LoadState& state, platform::PathString& fullpath, void* /*parameters*/)
 	{
 		LOGV("loading audio \"%s\"\n", fullpath());
 
@@ -318,6 +328,11 @@ namespace gemini
 		return AssetLoad_Success;
 	}
 
+	AssetLoadStatus AudioLibrary::finalize_asset(LoadState& /*state*/, platform::PathString& /*fullpath*/, void* /*parameters*/)
+	{
+		return AssetLoad_Success;
+	}
+
 	void AudioLibrary::destroy_asset(LoadState& state)
 	{
 		MEMORY2_DELETE(*state.allocator, state.asset);
@@ -60,5 +60,9 @@ namespace gemini
 		inline bool is_same_asset(AssetClass*, void*) { return true; }
 		AssetLoadStatus load_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
 		void destroy_asset(LoadState& state);
+
+		// Sounds are entirely decoded on the streaming thread.
+		AssetLoadStatus read_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
+		AssetLoadStatus finalize_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
 	}; // AudioLibrary
 } // namespace gemini
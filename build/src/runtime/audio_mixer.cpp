@@ -26,49 +26,161 @@
 #include <runtime/audio_library.h>
 
 #include <core/array.h>
+#include <core/atomic.h>
 #include <core/logging.h>
 #include <core/mathlib.h>
-#include <core/linearfreelist.h>
 
 #include <platform/audio.h>
 #include <platform/platform.h>
 
+#include <algorithm> // for std::nth_element
 
-// enable this to add locks in with mixing and audio functions.
-//#define AUDIO_USE_LOCK 1
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GEMINI_AUDIO_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define GEMINI_AUDIO_NEON 1
+#endif
 
 namespace gemini
 {
 	namespace audio
 	{
-		struct SoundInstance
+		// Voices are mixed in blocks of at most this many frames.
+		const uint32_t MIX_BLOCK_FRAMES = 256;
+
+		// Must be a power of two.
+		const uint32_t MAX_MIXER_COMMANDS = 1024;
+
+		// Space kept for stop requests so a flood of other requests can't
+		// leave sounds playing.
+		const uint32_t RESERVED_STOP_COMMANDS = 64;
+
+		// Play positions are 32.32 fixed point source frames.
+		const uint32_t POSITION_FRACTION_BITS = 32;
+		const uint64_t POSITION_ONE = (1ULL << POSITION_FRACTION_BITS);
+		const uint64_t POSITION_FRACTION_MASK = (POSITION_ONE - 1);
+
+		// fractions drop their lowest bit to convert as signed integers
+		const float POSITION_FRACTION_SCALE = (1.0f / 2147483648.0f);
+
+		// Handles are (generation << 16 | slot index); zero is never valid.
+		const uint32_t HANDLE_INDEX_BITS = 16;
+		const uint32_t HANDLE_INDEX_MASK = ((1 << HANDLE_INDEX_BITS) - 1);
+		const uint32_t HANDLE_GENERATION_MASK = 0xFFFF;
+
+		const float MIN_PITCH = 0.0625f;
+		const float MAX_PITCH = 16.0f;
+
+		enum class MixerCommandType : uint32_t
 		{
-			enum class State
-			{
-				// An invalid instance.
-				Inactive,
+			Play,
+			Stop,
+			StopAll,
+			SetGain,
+			SetPan,
+			SetPitch,
+			SetAudibleVoices
+		}; // MixerCommandType
+
+		struct MixerCommand
+		{
+			MixerCommandType type;
+			SoundHandle_t handle;
 
-				// A handle which has finished playing.
-				Stopped,
+			// Play
+			const float* samples;
+			uint32_t total_frames;
+			int32_t repeats;
 
-				// An instance which is currently playing.
-				Playing
-			};
+			// SetGain, SetPan, SetPitch
+			float value;
 
-			Sound* sound_asset;
-			uint64_t frames_buffered;
-			uint64_t total_frames;
-			uint64_t sample_count_started; // sample count this started playing
-			State state;
-		};
+			// SetAudibleVoices
+			uint32_t max_voices;
+		}; // MixerCommand
 
-		//
-		// audio_mixer state
-		size_t total_active_sounds = 0;
+		// Single producer (the game thread), single consumer (the audio thread).
+		struct CommandRing
+		{
+			MixerCommand commands[MAX_MIXER_COMMANDS];
+
+			// total commands written
+			volatile uint32_t head;
 
-		LinearFreeList<SoundInstance>* sound_list;
+			// keep the read and write positions on separate cache lines
+			char padding[64 - sizeof(uint32_t)];
 
-		platform::Mutex* audio_lock = nullptr;
+			// total commands read
+			volatile uint32_t tail;
+		}; // CommandRing
+
+		// A slot is owned by the game thread while it is inactive and by
+		// the audio thread from when its voice is queued until it finishes.
+		struct VoiceSlot
+		{
+			volatile uint32_t active;
+
+			// written by the audio thread after each block
+			volatile uint32_t frames_played;
+
+			// written by the game thread before the slot is activated
+			uint32_t generation;
+			uint32_t total_frames;
+		}; // VoiceSlot
+
+		// Only touched by the audio thread.
+		struct Voice
+		{
+			const float* samples;
+			SoundHandle_t handle;
+			uint32_t total_frames;
+
+			// negative repeats loop until stopped
+			int32_t repeats;
+
+			uint64_t position;
+			uint64_t end;
+
+			float gain;
+			float pan;
+			float pitch;
+
+			// gains applied at the end of the last block; changes are
+			// ramped across a block to avoid clicks.
+			float current_left;
+			float current_right;
+
+			bool audible;
+		}; // Voice
+
+		struct MixerState
+		{
+			CommandRing commands;
+
+			VoiceSlot slots[AUDIO_MAX_VOICES];
+
+			// indexed by slot
+			Voice voices[AUDIO_MAX_VOICES];
+
+			// slot indices of playing voices
+			uint16_t active_voices[AUDIO_MAX_VOICES];
+			uint32_t total_active_voices;
+			uint32_t max_audible_voices;
+
+			// where the game thread starts looking for a free slot
+			uint32_t next_slot;
+
+			// incremented by the game thread, decremented by the audio thread
+			volatile uint32_t total_playing;
+
+			float mix_buffer[MIX_BLOCK_FRAMES * AUDIO_MAX_OUTPUT_CHANNELS];
+		}; // MixerState
+
+		//
+		// audio_mixer state
+		MixerState* mixer = nullptr;
 
 		float master_gain = 1.0f;
 
@@ -95,73 +207,395 @@ namespace gemini
 			return static_cast<int16_t>(s * short_multiplier);
 		} // generate_sine_wave
 
-		void audio_fill_buffer(void* data, size_t frames_available, size_t sample_rate_hz, void* context)
+		// Accumulate interleaved stereo frames from source into output.
+		// The channel gains advance by their step each frame.
+		void mix_frames(float* output, const float* source, uint32_t frames, float left, float right, float left_step, float right_step)
 		{
-			int16_t* output = reinterpret_cast<int16_t*>(data);
-			uint64_t current_frame = platform::audio_frame_position();
+			uint32_t frame = 0;
 
-#if defined(AUDIO_USE_LOCKS)
-			platform::mutex_lock(audio_lock);
+#if defined(GEMINI_AUDIO_SSE)
+			// two frames per vector
+			__m128 gains = _mm_setr_ps(left, right, left + left_step, right + right_step);
+			const __m128 gain_step = _mm_setr_ps(left_step * 2.0f, right_step * 2.0f, left_step * 2.0f, right_step * 2.0f);
+			for (; (frame + 1) < frames; frame += 2)
+			{
+				const __m128 samples = _mm_loadu_ps(source + (frame * 2));
+				const __m128 mixed = _mm_add_ps(_mm_loadu_ps(output + (frame * 2)), _mm_mul_ps(samples, gains));
+				_mm_storeu_ps(output + (frame * 2), mixed);
+				gains = _mm_add_ps(gains, gain_step);
+			}
+#elif defined(GEMINI_AUDIO_NEON)
+			const float initial_gains[4] = { left, right, left + left_step, right + right_step };
+			const float step_gains[4] = { left_step * 2.0f, right_step * 2.0f, left_step * 2.0f, right_step * 2.0f };
+			float32x4_t gains = vld1q_f32(initial_gains);
+			const float32x4_t gain_step = vld1q_f32(step_gains);
+			for (; (frame + 1) < frames; frame += 2)
+			{
+				const float32x4_t samples = vld1q_f32(source + (frame * 2));
+				vst1q_f32(output + (frame * 2), vmlaq_f32(vld1q_f32(output + (frame * 2)), samples, gains));
+				gains = vaddq_f32(gains, gain_step);
+			}
 #endif
 
-			for (size_t frame = 0; frame < frames_available; ++frame)
+			for (; frame < frames; ++frame)
 			{
-				const size_t frame_index = frame * AUDIO_MAX_OUTPUT_CHANNELS;
+				output[(frame * 2) + 0] += source[(frame * 2) + 0] * (left + (left_step * frame));
+				output[(frame * 2) + 1] += source[(frame * 2) + 1] * (right + (right_step * frame));
+			}
+		} // mix_frames
+
+		// Same as mix_frames, but source frames are linearly interpolated
+		// starting at position, which advances by step each output frame.
+		// The caller guarantees position stays within the source.
+		void mix_frames_resampled(float* output, const float* source, uint32_t total_frames, uint32_t frames, uint64_t position, uint64_t step, float left, float right, float left_step, float right_step)
+		{
+			// the final source frame interpolates against itself
+			const uint32_t last_frame = (total_frames - 1);
+			uint32_t frame = 0;
+
+#if defined(GEMINI_AUDIO_SSE) || defined(GEMINI_AUDIO_NEON)
+			// Frames before the last source frame can load a source frame
+			// and the one following it together.
+			const uint64_t last_position = (static_cast<uint64_t>(last_frame) << POSITION_FRACTION_BITS);
+			uint32_t paired_frames = 0;
+			if (position < last_position)
+			{
+				const uint64_t frames_to_last = ((last_position - position) + (step - 1)) / step;
+				paired_frames = (frames_to_last < frames) ? static_cast<uint32_t>(frames_to_last) : frames;
+			}
 
-				// loop through all active instances and sum the output for this frame
-				float channels[AUDIO_MAX_OUTPUT_CHANNELS] = { 0.0f, 0.0f };
+	#if defined(GEMINI_AUDIO_SSE)
+			__m128 gains = _mm_setr_ps(left, right, left + left_step, right + right_step);
+			const __m128 gain_step = _mm_setr_ps(left_step * 2.0f, right_step * 2.0f, left_step * 2.0f, right_step * 2.0f);
+	#else
+			const float initial_gains[4] = { left, right, left + left_step, right + right_step };
+			const float step_gains[4] = { left_step * 2.0f, right_step * 2.0f, left_step * 2.0f, right_step * 2.0f };
+			float32x4_t gains = vld1q_f32(initial_gains);
+			const float32x4_t gain_step = vld1q_f32(step_gains);
+	#endif
+			for (; (frame + 1) < paired_frames; frame += 2)
+			{
+				const uint64_t second_position = (position + step);
+				const float* first = source + ((position >> POSITION_FRACTION_BITS) * 2);
+				const float* second = source + ((second_position >> POSITION_FRACTION_BITS) * 2);
+				const float first_fraction = static_cast<int32_t>((position & POSITION_FRACTION_MASK) >> 1) * POSITION_FRACTION_SCALE;
+				const float second_fraction = static_cast<int32_t>((second_position & POSITION_FRACTION_MASK) >> 1) * POSITION_FRACTION_SCALE;
+
+	#if defined(GEMINI_AUDIO_SSE)
+				// [a.left, a.right, b.left, b.right] for each output frame
+				const __m128 first_pair = _mm_loadu_ps(first);
+				const __m128 second_pair = _mm_loadu_ps(second);
+				const __m128 a = _mm_movelh_ps(first_pair, second_pair);
+				const __m128 b = _mm_movehl_ps(second_pair, first_pair);
+				const __m128 fraction = _mm_setr_ps(first_fraction, first_fraction, second_fraction, second_fraction);
+				const __m128 samples = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction));
+				const __m128 mixed = _mm_add_ps(_mm_loadu_ps(output + (frame * 2)), _mm_mul_ps(samples, gains));
+				_mm_storeu_ps(output + (frame * 2), mixed);
+				gains = _mm_add_ps(gains, gain_step);
+	#else
+				const float32x4_t first_pair = vld1q_f32(first);
+				const float32x4_t second_pair = vld1q_f32(second);
+				const float32x4_t a = vcombine_f32(vget_low_f32(first_pair), vget_low_f32(second_pair));
+				const float32x4_t b = vcombine_f32(vget_high_f32(first_pair), vget_high_f32(second_pair));
+				const float32x4_t fraction = vcombine_f32(vdup_n_f32(first_fraction), vdup_n_f32(second_fraction));
+				const float32x4_t samples = vmlaq_f32(a, vsubq_f32(b, a), fraction);
+				vst1q_f32(output + (frame * 2), vmlaq_f32(vld1q_f32(output + (frame * 2)), samples, gains));
+				gains = vaddq_f32(gains, gain_step);
+	#endif
+				position = (second_position + step);
+			}
+#endif
+
+			for (; frame < frames; ++frame)
+			{
+				const uint32_t index = static_cast<uint32_t>(position >> POSITION_FRACTION_BITS);
+				const uint32_t next = index + (index < last_frame);
+				const float fraction = static_cast<int32_t>((position & POSITION_FRACTION_MASK) >> 1) * POSITION_FRACTION_SCALE;
+				const float sample_left = source[(index * 2) + 0] + ((source[(next * 2) + 0] - source[(index * 2) + 0]) * fraction);
+				const float sample_right = source[(index * 2) + 1] + ((source[(next * 2) + 1] - source[(index * 2) + 1]) * fraction);
+				output[(frame * 2) + 0] += sample_left * (left + (left_step * frame));
+				output[(frame * 2) + 1] += sample_right * (right + (right_step * frame));
+				position += step;
+			}
+		} // mix_frames_resampled
 
-				for (size_t index = 0; index < sound_list->size(); ++index)
+		// Convert mixed samples to 16-bit output; anything beyond full scale is clipped.
+		void write_output(int16_t* output, const float* mixed, uint32_t total_samples, float gain)
+		{
+			const float scale = (InMemorySampleValueMax * gain);
+			uint32_t sample = 0;
+
+#if defined(GEMINI_AUDIO_SSE)
+			const __m128 scale4 = _mm_set1_ps(scale);
+			const __m128 maximum = _mm_set1_ps(InMemorySampleValueMax);
+			const __m128 minimum = _mm_set1_ps(-InMemorySampleValueMax);
+			for (; (sample + 8) <= total_samples; sample += 8)
+			{
+				const __m128 first = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(mixed + sample), scale4), maximum), minimum);
+				const __m128 second = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(mixed + sample + 4), scale4), maximum), minimum);
+				const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(first), _mm_cvtps_epi32(second));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + sample), packed);
+			}
+#elif defined(GEMINI_AUDIO_NEON)
+			const float32x4_t scale4 = vdupq_n_f32(scale);
+			const float32x4_t maximum = vdupq_n_f32(InMemorySampleValueMax);
+			const float32x4_t minimum = vdupq_n_f32(-InMemorySampleValueMax);
+			for (; (sample + 4) <= total_samples; sample += 4)
+			{
+				const float32x4_t value = vmaxq_f32(vminq_f32(vmulq_f32(vld1q_f32(mixed + sample), scale4), maximum), minimum);
+				vst1_s16(output + sample, vqmovn_s32(vcvtq_s32_f32(value)));
+			}
+#endif
+
+			for (; sample < total_samples; ++sample)
+			{
+				output[sample] = static_cast<int16_t>(glm::clamp(mixed[sample] * scale, -InMemorySampleValueMax, InMemorySampleValueMax));
+			}
+		} // write_output
+
+		// Balance law for stereo sources: a centered sound plays at unity
+		// and panning attenuates the opposite channel.
+		void voice_target_gains(const Voice& voice, float& left, float& right)
+		{
+			if (voice.audible)
+			{
+				left = voice.gain * glm::clamp(1.0f - voice.pan, 0.0f, 1.0f);
+				right = voice.gain * glm::clamp(1.0f + voice.pan, 0.0f, 1.0f);
+			}
+			else
+			{
+				left = 0.0f;
+				right = 0.0f;
+			}
+		} // voice_target_gains
+
+		// Mix a voice into output, or only advance it if it is virtual.
+		// Returns false once the voice has finished.
+		bool voice_render(Voice& voice, float* output, uint32_t frames, uint64_t step)
+		{
+			float target_left;
+			float target_right;
+			voice_target_gains(voice, target_left, target_right);
+
+			// virtual voices fade out over one block and are then skipped
+			const bool silent = (voice.current_left == 0.0f) && (voice.current_right == 0.0f)
+				&& (target_left == 0.0f) && (target_right == 0.0f);
+
+			const float left_step = (target_left - voice.current_left) / frames;
+			const float right_step = (target_right - voice.current_right) / frames;
+			float left = voice.current_left;
+			float right = voice.current_right;
+
+			bool playing = true;
+			uint32_t offset = 0;
+			while (offset < frames)
+			{
+				if (voice.position >= voice.end)
 				{
-					if (sound_list->is_valid(index))
+					if (voice.repeats == 0)
 					{
-						SoundInstance* instance = sound_list->from_handle(index);
-						if (instance->state != SoundInstance::State::Playing)
-						{
-							continue;
-						}
+						playing = false;
+						break;
+					}
+					else if (voice.repeats > 0)
+					{
+						--voice.repeats;
+					}
 
-						// The sound will finish buffering before it finishes playing. We need to catch this.
-						const bool is_finished_playing = (current_frame - instance->sample_count_started) >= instance->total_frames;
+					voice.position -= voice.end;
+					continue;
+				}
 
-						if (is_finished_playing)
-						{
-							// return to the free list
-							sound_list->release(index);
-							--total_active_sounds;
-							continue;
-						}
+				// mix up to the end of the source
+				const uint64_t frames_to_end = ((voice.end - voice.position) + (step - 1)) / step;
+				const uint32_t count = (frames_to_end < (frames - offset)) ? static_cast<uint32_t>(frames_to_end) : (frames - offset);
 
-						// check if we can continue buffering this instance
-						if (instance->frames_buffered < instance->total_frames)
+				if (!silent)
+				{
+					float* destination = output + (offset * AUDIO_MAX_OUTPUT_CHANNELS);
+					if (step == POSITION_ONE && (voice.position & POSITION_FRACTION_MASK) == 0)
+					{
+						const float* source = voice.samples + ((voice.position >> POSITION_FRACTION_BITS) * InMemoryChannelCount);
+						mix_frames(destination, source, count, left, right, left_step, right_step);
+					}
+					else
+					{
+						mix_frames_resampled(destination, voice.samples, voice.total_frames, count, voice.position, step, left, right, left_step, right_step);
+					}
+					left += (left_step * count);
+					right += (right_step * count);
+				}
+
+				voice.position += (step * count);
+				offset += count;
+			}
+
+			voice.current_left = target_left;
+			voice.current_right = target_right;
+			return playing;
+		} // voice_render
+
+		// Remove the voice at index in the active list and hand its slot
+		// back to the game thread.
+		void voice_finish(uint32_t active_index)
+		{
+			const uint16_t slot_index = mixer->active_voices[active_index];
+			mixer->voices[slot_index].handle = 0;
+			mixer->active_voices[active_index] = mixer->active_voices[--mixer->total_active_voices];
+
+			VoiceSlot& slot = mixer->slots[slot_index];
+			slot.frames_played = slot.total_frames;
+			PLATFORM_MEMORY_FENCE();
+			slot.active = 0;
+			atom_decrement32(&mixer->total_playing);
+		} // voice_finish
+
+		// Returns the voice for handle if it is still playing.
+		Voice* voice_from_handle(SoundHandle_t handle)
+		{
+			const size_t index = (handle & HANDLE_INDEX_MASK);
+			if (index >= AUDIO_MAX_VOICES || mixer->voices[index].handle != handle)
+			{
+				return nullptr;
+			}
+
+			return &mixer->voices[index];
+		} // voice_from_handle
+
+		void process_commands()
+		{
+			CommandRing& ring = mixer->commands;
+			const uint32_t head = ring.head;
+			PLATFORM_MEMORY_FENCE();
+
+			uint32_t tail = ring.tail;
+			for (; tail != head; ++tail)
+			{
+				const MixerCommand& command = ring.commands[tail & (MAX_MIXER_COMMANDS - 1)];
+				if (command.type == MixerCommandType::Play)
+				{
+					const uint16_t slot_index = static_cast<uint16_t>(command.handle & HANDLE_INDEX_MASK);
+					Voice& voice = mixer->voices[slot_index];
+					voice.samples = command.samples;
+					voice.handle = command.handle;
+					voice.total_frames = command.total_frames;
+					voice.repeats = command.repeats;
+					voice.position = 0;
+					voice.end = (static_cast<uint64_t>(command.total_frames) << POSITION_FRACTION_BITS);
+					voice.gain = 1.0f;
+					voice.pan = 0.0f;
+					voice.pitch = 1.0f;
+					voice.audible = true;
+
+					// start at full volume to keep the attack intact
+					voice_target_gains(voice, voice.current_left, voice.current_right);
+
+					mixer->active_voices[mixer->total_active_voices++] = slot_index;
+				}
+				else if (command.type == MixerCommandType::Stop)
+				{
+					for (uint32_t index = 0; index < mixer->total_active_voices; ++index)
+					{
+						if (mixer->voices[mixer->active_voices[index]].handle == command.handle)
 						{
-							const size_t instance_frame = (instance->frames_buffered * audio::InMemoryChannelCount);
-							assert(instance->sound_asset);
-							float current_sample[2];
-							instance->sound_asset->get_frame(instance->frames_buffered, current_sample);
-							channels[0] += current_sample[0];
-							channels[1] += current_sample[1];
-							++instance->frames_buffered;
+							voice_finish(index);
+							break;
 						}
 					}
 				}
+				else if (command.type == MixerCommandType::StopAll)
+				{
+					while (mixer->total_active_voices > 0)
+					{
+						voice_finish(mixer->total_active_voices - 1);
+					}
+				}
+				else if (command.type == MixerCommandType::SetAudibleVoices)
+				{
+					mixer->max_audible_voices = command.max_voices;
+				}
+				else if (Voice* voice = voice_from_handle(command.handle))
+				{
+					if (command.type == MixerCommandType::SetGain)
+					{
+						voice->gain = command.value;
+					}
+					else if (command.type == MixerCommandType::SetPan)
+					{
+						voice->pan = command.value;
+					}
+					else if (command.type == MixerCommandType::SetPitch)
+					{
+						voice->pitch = command.value;
+					}
+				}
+			}
 
-				// prevent clipping
-				channels[0] = glm::clamp(channels[0], -1.0f, 1.0f);
-				channels[1] = glm::clamp(channels[1], -1.0f, 1.0f);
+			// finish reading before the game thread can reuse these commands
+			PLATFORM_MEMORY_FENCE();
+			ring.tail = tail;
+		} // process_commands
 
-				output[frame_index + 0] = static_cast<int16_t>(channels[0] * InMemorySampleValueMax * master_gain);
-				output[frame_index + 1] = static_cast<int16_t>(channels[1] * InMemorySampleValueMax * master_gain);
+		// Keep the loudest voices audible and virtualize the rest.
+		void update_audible_voices()
+		{
+			uint16_t* first = mixer->active_voices;
+			uint16_t* last = mixer->active_voices + mixer->total_active_voices;
+			if (mixer->total_active_voices > mixer->max_audible_voices)
+			{
+				Voice* voices = mixer->voices;
+				std::nth_element(first, first + mixer->max_audible_voices, last, [voices](uint16_t a, uint16_t b) {
+					return voices[a].gain > voices[b].gain;
+				});
 			}
 
-#if defined(AUDIO_USE_LOCKS)
-			platform::mutex_unlock(audio_lock);
-#endif
+			for (uint32_t index = 0; index < mixer->total_active_voices; ++index)
+			{
+				mixer->voices[first[index]].audible = (index < mixer->max_audible_voices);
+			}
+		} // update_audible_voices
+
+		void audio_fill_buffer(void* data, size_t frames_available, size_t sample_rate_hz, void* context)
+		{
+			int16_t* output = reinterpret_cast<int16_t*>(data);
+
+			process_commands();
+			update_audible_voices();
+
+			// source frames per output frame at unity pitch
+			const double sample_rate_ratio = (AUDIO_FREQUENCY_HZ / static_cast<double>(sample_rate_hz));
+			const float gain = master_gain;
+
+			for (size_t frame = 0; frame < frames_available; frame += MIX_BLOCK_FRAMES)
+			{
+				const uint32_t frames = static_cast<uint32_t>(glm::min(frames_available - frame, static_cast<size_t>(MIX_BLOCK_FRAMES)));
+				float* mixed = mixer->mix_buffer;
+				memset(mixed, 0, sizeof(float) * frames * AUDIO_MAX_OUTPUT_CHANNELS);
+
+				for (uint32_t index = 0; index < mixer->total_active_voices; )
+				{
+					const uint16_t slot_index = mixer->active_voices[index];
+					Voice& voice = mixer->voices[slot_index];
+					const uint64_t step = static_cast<uint64_t>(sample_rate_ratio * voice.pitch * POSITION_ONE);
+					if (voice_render(voice, mixed, frames, step))
+					{
+						mixer->slots[slot_index].frames_played = static_cast<uint32_t>(voice.position >> POSITION_FRACTION_BITS);
+						++index;
+					}
+					else
+					{
+						voice_finish(index);
+					}
+				}
+
+				write_output(output + (frame * AUDIO_MAX_OUTPUT_CHANNELS), mixed, frames * AUDIO_MAX_OUTPUT_CHANNELS, gain);
+			}
 		} // audio_fill_buffer
 	} // namespace audio
 
 } // namespace gemini
 
+
 #include <runtime/filesystem.h>
 
 
@@ -201,76 +635,150 @@ namespace gemini
 	}
 #endif
 
+
 namespace gemini
 {
 	namespace audio
 	{
 		gemini::Allocator* audio_allocator = nullptr;
+		bool output_device_started = false;
+
+		bool command_push(const MixerCommand& command)
+		{
+			CommandRing& ring = mixer->commands;
+			const uint32_t head = ring.head;
+			const bool is_stop = (command.type == MixerCommandType::Stop) || (command.type == MixerCommandType::StopAll);
+			const uint32_t capacity = is_stop ? MAX_MIXER_COMMANDS : (MAX_MIXER_COMMANDS - RESERVED_STOP_COMMANDS);
+			if ((head - ring.tail) >= capacity)
+			{
+				LOGW("Audio command queue is full; dropping request.\n");
+				return false;
+			}
+
+			ring.commands[head & (MAX_MIXER_COMMANDS - 1)] = command;
+
+			// publish the command before advancing the head
+			PLATFORM_MEMORY_FENCE();
+			ring.head = head + 1;
+			return true;
+		} // command_push
+
+		void command_push_value(MixerCommandType type, SoundHandle_t handle, float value)
+		{
+			MixerCommand command;
+			command.type = type;
+			command.handle = handle;
+			command.value = value;
+			command_push(command);
+		} // command_push_value
+
+		// Returns the slot for handle if it hasn't been reused.
+		VoiceSlot* slot_from_handle(SoundHandle_t handle)
+		{
+			const size_t index = (handle & HANDLE_INDEX_MASK);
+			if (index >= AUDIO_MAX_VOICES)
+			{
+				return nullptr;
+			}
+
+			VoiceSlot* slot = &mixer->slots[index];
+			return (slot->generation == (handle >> HANDLE_INDEX_BITS)) ? slot : nullptr;
+		} // slot_from_handle
 
 		SoundHandle_t play_sound(Sound* sound, int32_t repeats)
 		{
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_lock(audio_lock);
-#endif
+			if (!sound || sound->get_total_frames() == 0)
+			{
+				return 0;
+			}
 
-			SoundHandle_t handle = sound_list->acquire();
-			SoundInstance* instance = sound_list->from_handle(handle);
-			assert(instance);
+			uint32_t slot_index = 0;
+			VoiceSlot* slot = nullptr;
+			for (uint32_t attempt = 0; attempt < AUDIO_MAX_VOICES; ++attempt)
+			{
+				slot_index = (mixer->next_slot + attempt) % AUDIO_MAX_VOICES;
+				if (mixer->slots[slot_index].active == 0)
+				{
+					slot = &mixer->slots[slot_index];
+					break;
+				}
+			}
 
-			// only if the sound wasn't previously playing.
-			instance->state = SoundInstance::State::Playing;
-			instance->frames_buffered = 0;
-			instance->sample_count_started = platform::audio_frame_position();
-			instance->sound_asset = sound;
-			instance->total_frames = sound->get_total_frames();
-			++total_active_sounds;
+			if (!slot)
+			{
+				LOGW("Unable to play sound; all %i voices are in use.\n", AUDIO_MAX_VOICES);
+				return 0;
+			}
 
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_unlock(audio_lock);
-#endif
+			// the audio thread is done with this slot
+			PLATFORM_MEMORY_FENCE();
+
+			mixer->next_slot = (slot_index + 1);
+
+			slot->generation = (slot->generation + 1) & HANDLE_GENERATION_MASK;
+			if (slot->generation == 0)
+			{
+				slot->generation = 1;
+			}
+			slot->total_frames = static_cast<uint32_t>(sound->get_total_frames());
+			slot->frames_played = 0;
+			slot->active = 1;
+			atom_increment32(&mixer->total_playing);
+
+			MixerCommand command;
+			command.type = MixerCommandType::Play;
+			command.handle = (static_cast<SoundHandle_t>(slot->generation) << HANDLE_INDEX_BITS) | slot_index;
+			command.samples = &sound->pcmdata[0];
+			command.total_frames = slot->total_frames;
+			command.repeats = repeats;
+			if (!command_push(command))
+			{
+				slot->active = 0;
+				atom_decrement32(&mixer->total_playing);
+				return 0;
+			}
 
-			return handle;
+			return command.handle;
 		}
 
 		void stop_sound(SoundHandle_t handle)
 		{
-			SoundInstance* instance = sound_list->from_handle(handle);
-			assert(instance);
-			instance->state = SoundInstance::State::Inactive;
-			instance->frames_buffered = 0;
-			instance->sound_asset = nullptr;
-
-			--total_active_sounds;
+			MixerCommand command;
+			command.type = MixerCommandType::Stop;
+			command.handle = handle;
+			command_push(command);
 		}
 
 		void stop_all_sounds()
 		{
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_lock(audio_lock);
-#endif
-			for (size_t index = 0; index < sound_list->size(); ++index)
-			{
-				if (sound_list->is_valid(index))
-				{
-					SoundInstance* instance = sound_list->from_handle(index);
-					if (instance->state == SoundInstance::State::Playing)
-					{
-						instance->state = SoundInstance::State::Stopped;
-						instance->frames_buffered = 0;
-						instance->sample_count_started = 0;
-						instance->sound_asset = nullptr;
-					}
-					else
-					{
-						instance->state = SoundInstance::State::Inactive;
-					}
-				}
-			}
-			total_active_sounds = 0;
+			MixerCommand command;
+			command.type = MixerCommandType::StopAll;
+			command.handle = 0;
+			command_push(command);
+		}
 
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_unlock(audio_lock);
-#endif
+		void set_sound_gain(SoundHandle_t handle, float gain)
+		{
+			command_push_value(MixerCommandType::SetGain, handle, glm::max(gain, 0.0f));
+		}
+
+		void set_sound_pan(SoundHandle_t handle, float pan)
+		{
+			command_push_value(MixerCommandType::SetPan, handle, glm::clamp(pan, -1.0f, 1.0f));
+		}
+
+		void set_sound_pitch(SoundHandle_t handle, float pitch)
+		{
+			command_push_value(MixerCommandType::SetPitch, handle, glm::clamp(pitch, MIN_PITCH, MAX_PITCH));
+		}
+
+		void set_max_audible_voices(uint32_t max_voices)
+		{
+			MixerCommand command;
+			command.type = MixerCommandType::SetAudibleVoices;
+			command.handle = 0;
+			command.max_voices = max_voices;
+			command_push(command);
 		}
 
 		void set_master_volume(float new_volume)
@@ -283,16 +791,21 @@ namespace gemini
 			return master_gain;
 		}
 
-		void startup(gemini::Allocator& allocator)
+		void startup(gemini::Allocator& allocator, bool open_output_device)
 		{
 			audio_allocator = &allocator;
 
-#if defined(AUDIO_USE_LOCK)
-			audio_lock = platform::mutex_create();
-#endif
-			sound_list = MEMORY2_NEW(allocator, LinearFreeList<SoundInstance>)(allocator);
+			mixer = MEMORY2_NEW(allocator, MixerState);
+			memset(mixer, 0, sizeof(MixerState));
+			mixer->max_audible_voices = AUDIO_DEFAULT_AUDIBLE_VOICES;
+
+			if (!open_output_device)
+			{
+				return;
+			}
 
 			platform::audio_startup(*audio_allocator);
+			output_device_started = true;
 
 			Array<platform::audio_device*> devices(*audio_allocator);
 			audio_enumerate_devices(devices);
@@ -318,51 +831,44 @@ namespace gemini
 		{
 			stop_all_sounds();
 
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_lock(audio_lock);
-#endif
-			platform::audio_close_output_device();
-
-			platform::audio_shutdown();
-
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_unlock(audio_lock);
-#endif
+			if (output_device_started)
+			{
+				platform::audio_close_output_device();
 
-			// clear free lists and used lists
-			MEMORY2_DELETE(*audio_allocator, sound_list);
+				platform::audio_shutdown();
+				output_device_started = false;
+			}
 
-#if defined(AUDIO_USE_LOCK)
-			platform::mutex_destroy(audio_lock);
-#endif
+			// the audio thread has stopped; nothing references the mixer
+			MEMORY2_DELETE(*audio_allocator, mixer);
+			mixer = nullptr;
 		}
 
 		size_t get_total_playing_sounds()
 		{
-			return total_active_sounds;
+			return mixer->total_playing;
 		}
 
 		float get_total_time_seconds(SoundHandle_t handle)
 		{
-			SoundInstance* instance = sound_list->from_handle(handle);
-			assert(instance);
+			VoiceSlot* slot = slot_from_handle(handle);
+			if (slot)
+			{
+				return (slot->total_frames / static_cast<float>(AUDIO_FREQUENCY_HZ));
+			}
 
-			return (instance->total_frames / static_cast<float>(AUDIO_FREQUENCY_HZ));
+			return 0.0f;
 		}
 
 		float get_current_playhead(SoundHandle_t handle)
 		{
-			if (sound_list->is_valid(handle))
+			VoiceSlot* slot = slot_from_handle(handle);
+			if (slot && slot->active)
 			{
-				SoundInstance* instance = sound_list->from_handle(handle);
-				assert(instance);
-				assert(instance->state != SoundInstance::State::Stopped);
-
-				uint64_t current_frame = platform::audio_frame_position();
-				return (current_frame - instance->sample_count_started) / static_cast<float>(AUDIO_FREQUENCY_HZ);
+				return (slot->frames_played / static_cast<float>(AUDIO_FREQUENCY_HZ));
 			}
 
 			return 0.0f;
 		}
 	} // namespace audio
-} // namespace gemini
+} // namespace gemini
\ No newline at end of file
@@ -99,7 +99,19 @@ namespace gemini
 		const float InMemorySampleValueMax = 32767.0f;
 		const size_t InMemoryChannelCount = 2;
 
-		// start playing sound [repeats]
+		// Maximum number of sounds which can be playing at once.
+		const size_t AUDIO_MAX_VOICES = 256;
+
+		// Only the loudest voices up to this limit are mixed. The rest are
+		// virtualized; they keep their play position but are not heard.
+		const uint32_t AUDIO_DEFAULT_AUDIBLE_VOICES = 32;
+
+		// Functions which control playback must be called from a single
+		// thread. Requests are queued and applied by the audio thread at
+		// the start of its next mix, so the mixer never blocks.
+
+		// start playing sound [repeats]; negative repeats loop until stopped.
+		// returns 0 if the sound could not be played.
 		SoundHandle_t play_sound(Sound* sound, int32_t repeats = 0);
 
 		// stop playing sound
@@ -108,13 +120,31 @@ namespace gemini
 		// stop playing ALL sounds
 		void stop_all_sounds();
 
+		// set gain for a sound; 1.0 is unity.
+		void set_sound_gain(SoundHandle_t handle, float gain);
+
+		// set stereo pan for a sound; -1.0 is left, 1.0 is right.
+		void set_sound_pan(SoundHandle_t handle, float pan);
+
+		// set playback rate for a sound; 1.0 is the original pitch.
+		void set_sound_pitch(SoundHandle_t handle, float pitch);
+
+		// set the number of voices which are mixed
+		void set_max_audible_voices(uint32_t max_voices);
+
 		// set master volume/gain
 		void set_master_volume(float new_volume);
 		float get_master_volume();
 
-		void startup(gemini::Allocator& allocator);
+		// Without an output device, audio_fill_buffer can be called
+		// directly to render offline.
+		void startup(gemini::Allocator& allocator, bool open_output_device = true);
 		void shutdown();
 
+		// Mix frames of interleaved 16-bit stereo into data.
+		// This is the output device callback.
+		void audio_fill_buffer(void* data, size_t frames_available, size_t sample_rate_hz, void* context);
+
 		// returns the number of sounds currently playing.
 		size_t get_total_playing_sounds();
 
@@ -77,5 +77,25 @@ namespace core
 
 			return is_success;
 		} // json_load_with_callback
+
+		bool json_load_file(const char* filename, Json::Value& root)
+		{
+			size_t buffer_size = 0;
+			char* buffer = core::filesystem::instance()->virtual_load_file(filename, 0, &buffer_size);
+			if (!buffer)
+			{
+				return false;
+			}
+
+			Json::Reader reader;
+			bool is_success = reader.parse(buffer, buffer + buffer_size, root);
+			if (!is_success)
+			{
+				LOGV("json parsing failed: %s\n", reader.getFormattedErrorMessages().c_str());
+			}
+
+			core::filesystem::instance()->free_file_memory(buffer);
+			return is_success;
+		} // json_load_file
 	} // mamespace util
 } // namespace core
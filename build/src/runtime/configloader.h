@@ -39,6 +39,11 @@ namespace core
 		}; // ConfigLoadStatus
 
 		typedef ConfigLoadStatus (JsonLoaderCallback)(const Json::Value& root, void* data);
+		bool parse_json_string_with_callback(const char* buffer, size_t buffer_length, JsonLoaderCallback callback, void* context);
 		bool json_load_with_callback(const char* filename, JsonLoaderCallback callback, void* context, bool path_is_relative);
+
+		// Load and parse filename into root without invoking a callback.
+		// This allows parsing on one thread and consuming on another.
+		bool json_load_file(const char* filename, Json::Value& root);
 	} // namespace util
 } // namespace core
@@ -72,6 +72,12 @@ namespace core
 
 			virtual void virtual_load_file(Array<unsigned char>& buffer, const char* relative_path) = 0;
 
+			// Map a file into memory for reading without copying it.
+			// The mapping stays valid until virtual_unmap_file is called.
+			// Returns false if the file does not exist or cannot be mapped.
+			virtual bool virtual_map_file(::platform::FileMapping& mapping, const char* relative_path) = 0;
+			virtual void virtual_unmap_file(::platform::FileMapping& mapping) = 0;
+
 			virtual void free_file_memory(void* memory) = 0;
 		};
 
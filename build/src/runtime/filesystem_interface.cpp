@@ -203,6 +203,24 @@ namespace core
 			}
 		} // virtual_load_file
 
+		bool FileSystemInterface::virtual_map_file(::platform::FileMapping& mapping, const char* relative_path)
+		{
+			platform::PathString fullpath;
+			absolute_path_from_relative(fullpath, relative_path, content_directory());
+			if (!file_exists(fullpath(), false))
+			{
+				return false;
+			}
+
+			mapping = platform::fs_map_file(fullpath());
+			return mapping.is_mapped();
+		} // virtual_map_file
+
+		void FileSystemInterface::virtual_unmap_file(::platform::FileMapping& mapping)
+		{
+			platform::fs_unmap_file(mapping);
+		} // virtual_unmap_file
+
 		void FileSystemInterface::free_file_memory(void* memory)
 		{
 			MEMORY2_DEALLOC(allocator, memory);
@@ -39,7 +39,9 @@ namespace core
 			::platform::PathString user_application_path;
 			::platform::PathString content_path;
 
+		protected:
 			gemini::Allocator allocator;
+
 		public:
 			FileSystemInterface();
 			virtual ~FileSystemInterface();
@@ -63,6 +65,8 @@ namespace core
 			virtual bool virtual_directory_exists(const char* relative_path) const;
 			virtual char* virtual_load_file(const char* relative_path, char* buffer, size_t* buffer_length);
 			virtual void virtual_load_file(Array<unsigned char>& buffer, const char* relative_path);
+			virtual bool virtual_map_file(::platform::FileMapping& mapping, const char* relative_path);
+			virtual void virtual_unmap_file(::platform::FileMapping& mapping);
 
 			virtual void free_file_memory(void* memory);
 		};
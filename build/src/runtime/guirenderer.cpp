@@ -274,8 +274,9 @@ void GUIRenderer::draw_commands(gui::render::CommandList* command_list, Array<gu
 	font_pipeline->constants().set("projection_matrix", &projection_matrix);
 	font_pipeline->constants().set("diffuse", &diffuse_texture);
 
-	GUIVertex vertices[MAX_VERTICES];
-	memset(vertices, 0, sizeof(GUIVertex) * MAX_VERTICES);
+	// converted vertices only live until the upload below
+	Allocator frame_allocator = memory_allocator_frame(allocator.zone);
+	GUIVertex* vertices = static_cast<GUIVertex*>(MEMORY2_ALLOC_ALIGNED(frame_allocator, alignof(GUIVertex), sizeof(GUIVertex) * total_vertices));
 
 	// loop through all vertices in the source vertex_buffer
 	// and convert them to our buffer
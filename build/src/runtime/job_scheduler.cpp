@@ -0,0 +1,458 @@
+// -------------------------------------------------------------
+// Copyright (C) 2016- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <runtime/job_scheduler.h>
+
+#include <platform/platform.h>
+#include <core/logging.h>
+#include <core/profiler.h>
+
+#define JSDEBUG(...) NULL_MACRO
+//#define JSDEBUG LOGV
+
+namespace gemini
+{
+	// The scheduler which owns the calling thread and the index of its deque.
+	// Threads which are not workers use the shared (last) deque.
+	static PLATFORM_THREAD_LOCAL JobScheduler* tls_scheduler = nullptr;
+	static PLATFORM_THREAD_LOCAL uint32_t tls_deque_index = 0;
+	static PLATFORM_THREAD_LOCAL uint32_t tls_random_state = 2463534242U;
+
+	// number of failed attempts to find work before a worker sleeps
+	static const uint32_t MAX_IDLE_SPINS = 64;
+
+	static uint32_t job_random_next()
+	{
+		// xorshift32
+		uint32_t value = tls_random_state;
+		value ^= value << 13;
+		value ^= value >> 17;
+		value ^= value << 5;
+		tls_random_state = value;
+		return value;
+	}
+
+	static void job_counter_increment(JobCounter* counter)
+	{
+		while (counter)
+		{
+			atom_increment32(&counter->pending);
+			counter = counter->parent;
+		}
+	}
+
+	static void job_counter_decrement(JobCounter* counter)
+	{
+		while (counter)
+		{
+			// The counter may live on a waiting thread's stack; it can be
+			// destroyed as soon as pending reaches zero, so read parent first.
+			JobCounter* parent = counter->parent;
+			atom_decrement32(&counter->pending);
+			counter = parent;
+		}
+	}
+
+	static void job_scheduler_worker(platform::Thread* thread)
+	{
+		JobScheduler::worker_data* worker = static_cast<JobScheduler::worker_data*>(thread->user_data);
+		JSDEBUG("---------------> enter job_scheduler_worker, thread: 0x%x\n", platform::thread_id());
+
+		tls_scheduler = worker->scheduler;
+		tls_deque_index = worker->worker_index;
+		tls_random_state = (worker->worker_index + 1) * 2654435761U;
+
+		PROFILE_THREAD_NAME("job_worker");
+
+		worker->scheduler->worker_main(worker);
+
+		tls_scheduler = nullptr;
+		JSDEBUG("---------------> exit job_scheduler_worker, thread: 0x%x\n", platform::thread_id());
+	}
+
+	JobScheduler::JobScheduler(gemini::Allocator& _allocator)
+		: allocator(_allocator)
+		, deques(_allocator)
+		, workers(_allocator)
+		, sleeping_workers(0)
+		, pending_wakes(0)
+		, semaphore(nullptr)
+		, allocator_lock(0)
+	{
+	}
+
+	JobScheduler::~JobScheduler()
+	{
+		// If you hit this, destroy_workers was not called.
+		assert(deques.empty());
+	}
+
+	void JobScheduler::create_workers(uint32_t max_workers)
+	{
+		// If you hit this, create_workers was called more than once.
+		assert(semaphore == nullptr);
+
+		// The semaphore's maximum count must be at least one, even without workers.
+		semaphore = platform::semaphore_create(0, (max_workers > 0) ? max_workers : 1);
+		assert(semaphore);
+
+		// One deque per worker plus the shared deque for all other threads.
+		// Both arrays must be sized up front; their contents are shared
+		// with the worker threads and cannot be moved once they start.
+		JobDeque empty_deque;
+		memset(&empty_deque, 0, sizeof(JobDeque));
+		deques.resize(max_workers + 1, empty_deque);
+		for (size_t index = 0; index < deques.size(); ++index)
+		{
+			JobDeque& deque = deques[index];
+			deque.capacity = INITIAL_DEQUE_CAPACITY;
+			deque.jobs = MEMORY2_NEW_ARRAY(allocator, Job, deque.capacity);
+		}
+
+		workers.resize(max_workers);
+		for (uint32_t index = 0; index < max_workers; ++index)
+		{
+			worker_data* data = &workers[index];
+			data->worker_index = index;
+			data->scheduler = this;
+			data->is_active = 1;
+
+			data->thread = platform::thread_create(job_scheduler_worker, data);
+			assert(data->thread);
+		}
+	}
+
+	void JobScheduler::destroy_workers()
+	{
+		for (uint32_t index = 0; index < workers.size(); ++index)
+		{
+			workers[index].is_active = 0;
+		}
+
+		// is_active must be visible before sleeping_workers is read.
+		PLATFORM_MEMORY_FENCE();
+
+		// wake ALL workers (in case they were sleeping)
+		wake_workers(static_cast<uint32_t>(workers.size()));
+
+		for (worker_data& worker : workers)
+		{
+			platform::thread_join(worker.thread, 2500);
+			platform::thread_destroy(worker.thread);
+			worker.scheduler = nullptr;
+		}
+		workers.clear();
+
+		for (size_t index = 0; index < deques.size(); ++index)
+		{
+			JobDeque& deque = deques[index];
+
+			// If you hit this, jobs were still queued at shutdown.
+			assert(deque.head == deque.tail);
+			MEMORY2_DELETE_ARRAY(allocator, deque.jobs);
+		}
+		deques.clear();
+
+		assert(semaphore);
+		platform::semaphore_destroy(semaphore);
+		semaphore = nullptr;
+	}
+
+	uint32_t JobScheduler::worker_count() const
+	{
+		return static_cast<uint32_t>(workers.size());
+	}
+
+	uint32_t JobScheduler::current_deque_index() const
+	{
+		if (tls_scheduler == this)
+		{
+			return tls_deque_index;
+		}
+
+		return static_cast<uint32_t>(workers.size());
+	}
+
+	void JobScheduler::grow_deque(JobDeque& deque)
+	{
+		// This is called with the deque locked. Growth is rare; so
+		// serializing access to the allocator is acceptable here.
+		const uint32_t new_capacity = deque.capacity * 2;
+		JSDEBUG("growing deque to %u jobs\n", new_capacity);
+
+		atom_spin_lock(&allocator_lock);
+		Job* jobs = MEMORY2_NEW_ARRAY(allocator, Job, new_capacity);
+		atom_spin_unlock(&allocator_lock);
+
+		for (uint32_t index = deque.head; index != deque.tail; ++index)
+		{
+			jobs[index & (new_capacity - 1)] = deque.jobs[index & (deque.capacity - 1)];
+		}
+
+		atom_spin_lock(&allocator_lock);
+		MEMORY2_DELETE_ARRAY(allocator, deque.jobs);
+		atom_spin_unlock(&allocator_lock);
+
+		deque.jobs = jobs;
+		deque.capacity = new_capacity;
+	}
+
+	void JobScheduler::push_job(const Job& job)
+	{
+		// If you hit this, create_workers was not called.
+		assert(!deques.empty());
+
+		JobDeque& deque = deques[current_deque_index()];
+		atom_spin_lock(&deque.lock);
+		if ((deque.tail - deque.head) == deque.capacity)
+		{
+			grow_deque(deque);
+		}
+
+		deque.jobs[deque.tail & (deque.capacity - 1)] = job;
+		++deque.tail;
+
+		// the unlock is a full barrier; sleeping_workers must not be read
+		// ahead of the push.
+		atom_spin_unlock(&deque.lock);
+
+		if (sleeping_workers > 0)
+		{
+			wake_workers(1);
+		}
+	}
+
+	bool JobScheduler::find_job(uint32_t deque_index, Job& job)
+	{
+		// Pop from the back of our own deque first; the most recently
+		// pushed job is the most likely to still be in cache.
+		JobDeque& own = deques[deque_index];
+		if (own.tail != own.head)
+		{
+			atom_spin_lock(&own.lock);
+			if (own.tail != own.head)
+			{
+				--own.tail;
+				job = own.jobs[own.tail & (own.capacity - 1)];
+				atom_spin_unlock(&own.lock);
+				return true;
+			}
+			atom_spin_unlock(&own.lock);
+		}
+
+		// Steal from the front of another deque; starting at a random
+		// victim to spread contention across the workers.
+		const uint32_t total_deques = static_cast<uint32_t>(deques.size());
+		const uint32_t first_victim = job_random_next() % total_deques;
+		for (uint32_t offset = 0; offset < total_deques; ++offset)
+		{
+			const uint32_t victim_index = (first_victim + offset) % total_deques;
+			JobDeque& victim = deques[victim_index];
+			if (victim_index == deque_index || victim.tail == victim.head)
+			{
+				continue;
+			}
+
+			atom_spin_lock(&victim.lock);
+			if (victim.tail != victim.head)
+			{
+				job = victim.jobs[victim.head & (victim.capacity - 1)];
+				++victim.head;
+				atom_spin_unlock(&victim.lock);
+				return true;
+			}
+			atom_spin_unlock(&victim.lock);
+		}
+
+		return false;
+	}
+
+	void JobScheduler::execute_job(Job& job)
+	{
+		if (job.execute_range)
+		{
+			// Split off the upper half of the range until the remainder fits
+			// in a single batch. Split halves can be stolen by idle workers.
+			while ((job.range_end - job.range_start) > job.batch_size)
+			{
+				const uint32_t middle = job.range_start + ((job.range_end - job.range_start) / 2);
+				Job split = job;
+				split.range_start = middle;
+				job.range_end = middle;
+
+				// The counter is incremented before this job completes, so
+				// waiters cannot observe zero until every split is done.
+				job_counter_increment(split.counter);
+				push_job(split);
+			}
+
+			job.execute_range(job.data, job.range_start, job.range_end);
+		}
+		else
+		{
+			assert(job.execute);
+			job.execute(job.data);
+		}
+
+		job_counter_decrement(job.counter);
+	}
+
+	void JobScheduler::wake_workers(uint32_t count)
+	{
+		if (!semaphore)
+		{
+			return;
+		}
+
+		// Only signal workers which are sleeping and have not already been
+		// signaled. This keeps the semaphore's count within max_workers.
+		for (;;)
+		{
+			const uint32_t pending = pending_wakes;
+			const uint32_t sleeping = sleeping_workers;
+			const uint32_t idle = (sleeping > pending) ? (sleeping - pending) : 0;
+			const uint32_t total = (count < idle) ? count : idle;
+			if (total == 0)
+			{
+				return;
+			}
+
+			if (atom_compare_and_swap32(&pending_wakes, pending + total, pending))
+			{
+				platform::semaphore_signal(semaphore, total);
+				return;
+			}
+		}
+	}
+
+	void JobScheduler::push_back(JobFunction execute_function, void* data, JobCounter* counter)
+	{
+		assert(execute_function);
+
+		Job job;
+		memset(&job, 0, sizeof(Job));
+		job.execute = execute_function;
+		job.data = data;
+		job.counter = counter ? counter : &default_counter;
+
+		job_counter_increment(job.counter);
+		push_job(job);
+	}
+
+	void JobScheduler::parallel_for(ParallelForFunction execute_function, void* data, uint32_t total_items, uint32_t batch_size, JobCounter* counter)
+	{
+		assert(execute_function);
+		if (total_items == 0)
+		{
+			return;
+		}
+
+		Job job;
+		memset(&job, 0, sizeof(Job));
+		job.execute_range = execute_function;
+		job.range_start = 0;
+		job.range_end = total_items;
+		job.batch_size = (batch_size > 0) ? batch_size : 1;
+		job.data = data;
+		job.counter = counter ? counter : &default_counter;
+
+		job_counter_increment(job.counter);
+		push_job(job);
+	}
+
+	void JobScheduler::wait(JobCounter* counter)
+	{
+		assert(counter);
+		uint32_t idle_spins = 0;
+		while (counter->pending != 0)
+		{
+			if (execute_one())
+			{
+				idle_spins = 0;
+			}
+			else if (++idle_spins >= MAX_IDLE_SPINS)
+			{
+				// remaining jobs are running on workers; give up our time slice.
+				platform::thread_yield();
+			}
+		}
+	}
+
+	void JobScheduler::wait_for_jobs_to_complete()
+	{
+		wait(&default_counter);
+	}
+
+	bool JobScheduler::execute_one()
+	{
+		Job job;
+		if (find_job(current_deque_index(), job))
+		{
+			execute_job(job);
+			return true;
+		}
+
+		return false;
+	}
+
+	void JobScheduler::worker_main(worker_data* worker)
+	{
+		uint32_t idle_spins = 0;
+		Job job;
+		while (worker->is_active)
+		{
+			if (find_job(worker->worker_index, job))
+			{
+				execute_job(job);
+				idle_spins = 0;
+				continue;
+			}
+
+			if (++idle_spins < MAX_IDLE_SPINS)
+			{
+				continue;
+			}
+
+			// Announce the intent to sleep, then check once more.
+			// A producer which missed this increment has already made its
+			// job visible; one which sees it will signal the semaphore.
+			atom_increment32(&sleeping_workers);
+			bool found_job = find_job(worker->worker_index, job);
+			if (!found_job && worker->is_active)
+			{
+				JSDEBUG("---------------> thread 0x%x going to sleep...\n", platform::thread_id());
+				platform::semaphore_wait(semaphore);
+				atom_decrement32(&pending_wakes);
+				JSDEBUG("---------------> thread 0x%x waking up...\n", platform::thread_id());
+			}
+			atom_decrement32(&sleeping_workers);
+			idle_spins = 0;
+
+			if (found_job)
+			{
+				execute_job(job);
+			}
+		}
+	}
+} // namespace gemini
@@ -0,0 +1,171 @@
+// -------------------------------------------------------------
+// Copyright (C) 2016- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#pragma once
+
+#include <core/typedefs.h>
+#include <core/array.h>
+#include <core/atomic.h>
+
+namespace platform
+{
+	struct Semaphore;
+	struct Thread;
+} // namespace platform
+
+namespace gemini
+{
+	// Tracks the number of outstanding jobs in a group.
+	// A counter may be linked to a parent; the parent then also tracks
+	// every job submitted against the child. This allows waiting on
+	// a sub-group of work or on the entire tree.
+	struct JobCounter
+	{
+		atomic<uint32_t> pending;
+		JobCounter* parent;
+
+		JobCounter(JobCounter* parent_counter = nullptr)
+			: pending(0)
+			, parent(parent_counter)
+		{
+		}
+	}; // struct JobCounter
+
+	typedef void(*JobFunction)(void* user_data);
+	typedef void(*ParallelForFunction)(void* user_data, uint32_t start_index, uint32_t end_index);
+
+	// Work-stealing job scheduler.
+	// Each worker owns a deque: the owner pushes and pops from the back
+	// while idle workers steal from the front of other deques.
+	// Jobs can be submitted from any thread; including from inside a job.
+	// Threads which are not workers share one additional deque.
+	class JobScheduler
+	{
+	public:
+		struct Job
+		{
+			JobFunction execute;
+
+			// only valid for parallel_for jobs
+			ParallelForFunction execute_range;
+			uint32_t range_start;
+			uint32_t range_end;
+			uint32_t batch_size;
+
+			void* data;
+			JobCounter* counter;
+		};
+
+		struct JobDeque
+		{
+			// spin lock protecting this deque
+			volatile uint32_t lock;
+
+			// ring buffer of jobs; capacity must be a power of two.
+			Job* jobs;
+			uint32_t capacity;
+
+			// owner pushes/pops at tail; thieves steal at head.
+			volatile uint32_t head;
+			volatile uint32_t tail;
+		};
+
+		struct worker_data
+		{
+			uint32_t worker_index;
+			platform::Thread* thread;
+			JobScheduler* scheduler;
+			volatile int32_t is_active;
+		};
+
+	private:
+		// initial capacity for each deque; this must be a power of two.
+		static const uint32_t INITIAL_DEQUE_CAPACITY = 256;
+		static_assert(((INITIAL_DEQUE_CAPACITY - 1) & INITIAL_DEQUE_CAPACITY) == 0, "INITIAL_DEQUE_CAPACITY must be a power of two!");
+
+		gemini::Allocator& allocator;
+
+		// one deque per worker; plus one shared by non-worker threads.
+		Array<JobDeque> deques;
+		Array<worker_data> workers;
+
+		// tracks jobs which were submitted without a counter
+		JobCounter default_counter;
+
+		// number of workers currently waiting on the semaphore.
+		atomic<uint32_t> sleeping_workers;
+
+		// number of semaphore signals not yet consumed by a worker.
+		atomic<uint32_t> pending_wakes;
+
+		platform::Semaphore* semaphore;
+
+		// Spin lock guarding the allocator when a deque grows on a worker.
+		volatile uint32_t allocator_lock;
+
+		uint32_t current_deque_index() const;
+		void grow_deque(JobDeque& deque);
+		void push_job(const Job& job);
+		bool find_job(uint32_t deque_index, Job& job);
+		void execute_job(Job& job);
+		void wake_workers(uint32_t count);
+
+	public:
+		JobScheduler(gemini::Allocator& allocator);
+		~JobScheduler();
+
+		// Create max_workers; this must be called before jobs are submitted.
+		// Zero workers is valid: jobs then run on threads calling wait.
+		void create_workers(uint32_t max_workers);
+
+		// destroys all workers
+		void destroy_workers();
+
+		// returns the number of worker threads
+		uint32_t worker_count() const;
+
+		// Push a new job; this can be called from any thread.
+		// If counter is not null, it will be incremented until the job completes.
+		void push_back(JobFunction execute_function, void* data, JobCounter* counter = nullptr);
+
+		// Split [0, total_items) into batches of at most batch_size items and
+		// execute them across the workers. This does not block; wait on
+		// counter to know when all batches have completed.
+		void parallel_for(ParallelForFunction execute_function, void* data, uint32_t total_items, uint32_t batch_size, JobCounter* counter);
+
+		// Block until the counter reaches zero.
+		// The calling thread executes pending jobs while it waits.
+		void wait(JobCounter* counter);
+
+		// Block waiting for all jobs submitted without a counter to complete.
+		void wait_for_jobs_to_complete();
+
+		// Try to execute a single pending job on the calling thread.
+		// Returns true if a job was executed.
+		bool execute_one();
+
+		// entry point for worker threads
+		void worker_main(worker_data* worker);
+	}; // class JobScheduler
+} // namespace gemini
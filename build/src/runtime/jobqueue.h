@@ -36,6 +36,8 @@ namespace gemini
 {
 	// Single producer, multi-consumer job queue.
 	// This creates a number of threads and executes jobs on them.
+	// Prefer JobScheduler (runtime/job_scheduler.h) for new code; it
+	// has no queue limit and supports waiting on groups of jobs.
 	class JobQueue
 	{
 	public:
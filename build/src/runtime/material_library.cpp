@@ -196,7 +196,15 @@ namespace gemini
 						////						LOGV( "texture unit: %i\n", parameter->texture_unit );
 
 						LOGV("TODO: support texture parameters when loading from materials\n");
-						parameter->texture_handle = texture_load(texture_param.asString().c_str());
+						// Streamed materials stream their textures as well.
+						if (state->is_streaming)
+						{
+							parameter->texture_handle = texture_load_async(texture_param.asString().c_str());
+						}
+						else
+						{
+							parameter->texture_handle = texture_load(texture_param.asString().c_str());
+						}
 						parameter->texture_unit = texture_unit.asInt();
 					}
 					else
@@ -368,21 +376,54 @@ namespace gemini
 	}
 
 	AssetLoadStatus MaterialLibrary::load_asset(LoadState& state, platform::PathString& fullpath, void* parameters)
+	{
+		if (read_asset(state, fullpath, parameters) != AssetLoad_Success)
+		{
+			return AssetLoad_Failure;
+		}
+
+		return finalize_asset(state, fullpath, parameters);
+	}
+
+	AssetLoadStatus MaterialLibrary::read_asset(LoadState& state, platform::PathString& fullpath, void* /*parameters*/)
 	{
 		LOGV("loading material \"%s\"\n", fullpath());
 
 		platform::PathString asset_uri = fullpath;
 		asset_uri.append(".material");
 
-		if (core::util::json_load_with_callback(asset_uri(), material_load_from_json, &state, true) == core::util::ConfigLoad_Success)
+		Json::Value* root = MEMORY2_NEW(*state.allocator, Json::Value);
+		if (core::util::json_load_file(asset_uri(), *root))
 		{
+			state.stream_data = root;
 			return AssetLoad_Success;
 		}
+
+		MEMORY2_DELETE(*state.allocator, root);
 		return AssetLoad_Failure;
 	}
 
+	AssetLoadStatus MaterialLibrary::finalize_asset(LoadState& state, platform::PathString& /*fullpath*/, void* /*parameters*/)
+	{
+		// Textures are loaded from here; so this must run on the main thread.
+		Json::Value* root = static_cast<Json::Value*>(state.stream_data);
+		core::util::ConfigLoadStatus result = material_load_from_json(*root, &state);
+
+		MEMORY2_DELETE(*state.allocator, root);
+		state.stream_data = nullptr;
+
+		return (result == core::util::ConfigLoad_Success) ? AssetLoad_Success : AssetLoad_Failure;
+	}
+
 	void MaterialLibrary::destroy_asset(LoadState& state)
 	{
+		if (state.stream_data)
+		{
+			Json::Value* root = static_cast<Json::Value*>(state.stream_data);
+			MEMORY2_DELETE(*state.allocator, root);
+			state.stream_data = nullptr;
+		}
+
 		MEMORY2_DELETE(*state.allocator, state.asset);
 	}
 } // namespace gemini
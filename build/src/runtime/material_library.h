@@ -45,6 +45,12 @@ namespace gemini
 		AssetLoadStatus load_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
 		void destroy_asset(LoadState& state);
 
+		// read and parse the material file
+		AssetLoadStatus read_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
+
+		// build the material; this loads its textures
+		AssetLoadStatus finalize_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
+
 	private:
 		render2::Device* device;
 	}; // MaterialLibrary
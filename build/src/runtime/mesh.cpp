@@ -23,6 +23,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // -------------------------------------------------------------
 #include <runtime/mesh.h>
+#include <runtime/filesystem.h>
 
 namespace gemini
 {
@@ -32,6 +33,8 @@ namespace gemini
 		, uvs(nullptr)
 		, blend_indices(nullptr)
 		, blend_weights(nullptr)
+		, interleaved_vertices(nullptr)
+		, interleaved_stride(0)
 		, indices(nullptr)
 		, bind_poses(nullptr)
 		, inverse_bind_poses(nullptr)
@@ -107,6 +110,12 @@ namespace gemini
 
 	void mesh_destroy(Allocator& allocator, Mesh* mesh)
 	{
+		if (mesh->mapping.is_mapped())
+		{
+			// only the interleaved vertex stream lives in the mapping
+			core::filesystem::instance()->virtual_unmap_file(mesh->mapping);
+		}
+
 		if (mesh->collision_geometry)
 		{
 			MEMORY2_DEALLOC(allocator, mesh->collision_geometry->vertices);
@@ -34,6 +34,8 @@
 #include <core/stackstring.h>
 #include <core/typedefs.h>
 
+#include <platform/platform.h>
+
 
 namespace gemini
 {
@@ -56,10 +58,10 @@ namespace gemini
 
 	struct GeometryDefinition
 	{
-		uint16_t vertex_offset;
-		uint16_t total_vertices;
-		uint16_t index_offset;
-		uint16_t total_indices;
+		uint32_t vertex_offset;
+		uint32_t total_vertices;
+		uint32_t index_offset;
+		uint32_t total_indices;
 
 		AssetHandle material_handle;
 		AssetHandle shader_handle;
@@ -74,8 +76,8 @@ namespace gemini
 		glm::vec3* normals;
 		index_t* indices;
 
-		uint16_t total_vertices;
-		uint16_t total_indices;
+		uint32_t total_vertices;
+		uint32_t total_indices;
 	}; // CollisionGeometry
 
 	struct Mesh
@@ -88,6 +90,12 @@ namespace gemini
 		glm::vec4* blend_indices;
 		glm::vec4* blend_weights;
 
+		// Interleaved vertex stream (StaticMeshVertex or AnimatedMeshVertex)
+		// from a compiled mesh. When this is set, the per-attribute arrays
+		// above are null and the stream is uploaded as-is.
+		const void* interleaved_vertices;
+		uint32_t interleaved_stride;
+
 		glm::mat4* bind_poses;
 		glm::mat4* inverse_bind_poses;
 
@@ -113,6 +121,10 @@ namespace gemini
 
 		// collision geometry
 		CollisionGeometry* collision_geometry;
+
+		// Compiled meshes point into this read-only mapping
+		// instead of owning their vertex data.
+		platform::FileMapping mapping;
 	}; // Mesh
 
 	// initialize a mesh by allocating memory
@@ -0,0 +1,532 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <runtime/mesh_format.h>
+#include <runtime/mesh.h>
+
+#include <renderer/renderer.h>
+
+#include <core/logging.h>
+#include <core/mem.h>
+
+// for MAX_BONES, MAX_INFLUENCES_PER_VERTEX
+#include <shared/shared_constants.h>
+
+#include <map>
+#include <string>
+#include <string.h>
+
+namespace gemini
+{
+	namespace detail
+	{
+		typedef std::map<int, std::string> MaterialByIdContainer;
+		typedef std::map<std::string, int32_t> JointIndexByName;
+
+		static uint32_t mesh_format_align(uint32_t offset)
+		{
+			return (offset + (MESH_FORMAT_ALIGNMENT - 1)) & ~(MESH_FORMAT_ALIGNMENT - 1);
+		}
+
+		static void mesh_format_add_section(MeshFormatSection& section, uint32_t& offset, size_t size)
+		{
+			section.offset = (size > 0) ? offset : 0;
+			section.size = static_cast<uint32_t>(size);
+			offset = mesh_format_align(offset + section.size);
+		}
+
+		static void mesh_format_copy_name(char* destination, const std::string& name)
+		{
+			if (name.size() >= MESH_FORMAT_MAX_NAME)
+			{
+				LOGW("Name \"%s\" is too long and will be truncated!\n", name.c_str());
+			}
+
+			strncpy(destination, name.c_str(), MESH_FORMAT_MAX_NAME - 1);
+			destination[MESH_FORMAT_MAX_NAME - 1] = '\0';
+		}
+
+		static bool mesh_format_name_valid(const char* name)
+		{
+			return memchr(name, '\0', MESH_FORMAT_MAX_NAME) != nullptr;
+		}
+
+		static bool mesh_format_section_holds(const MeshFormatSection& section, uint32_t total, size_t element_size)
+		{
+			return static_cast<uint64_t>(section.size) == (static_cast<uint64_t>(total) * element_size);
+		}
+
+		static glm::vec3 mesh_format_vec3(const Json::Value& value)
+		{
+			return glm::vec3(value[0].asFloat(), value[1].asFloat(), value[2].asFloat());
+		}
+
+		static glm::mat4 mesh_format_mat4(const Json::Value& value)
+		{
+			assert(value.size() == 16);
+			float m[16] = { 0 };
+			for (Json::ArrayIndex index = 0; index < value.size() && index < 16; ++index)
+			{
+				m[index] = value[index].asFloat();
+			}
+
+			return glm::make_mat4(m);
+		}
+
+		static void mesh_format_collect_nodes(const Json::Value& node, Array<const Json::Value*>& mesh_nodes)
+		{
+			if (node["type"].asString() == "mesh")
+			{
+				mesh_nodes.push_back(&node);
+			}
+
+			const Json::Value& children = node["children"];
+			for (Json::ArrayIndex index = 0; index < children.size(); ++index)
+			{
+				mesh_format_collect_nodes(children[index], mesh_nodes);
+			}
+		}
+
+		static void mesh_format_write_vertices(uint8_t* output, uint32_t stride, const Json::Value& node, uint32_t total_vertices, bool is_animated, const JointIndexByName& joints)
+		{
+			const Json::Value& vertex_array = node["vertices"];
+			const Json::Value& normal_array = node["normals"];
+			const Json::Value& uv_array = node["uv_sets"][0];
+			const Json::Value& blend_weights = node["blend_weights"];
+
+			if (is_animated)
+			{
+				// blend weight array must match the total vertices
+				assert(blend_weights.size() == total_vertices);
+			}
+
+			for (uint32_t vertex_index = 0; vertex_index < total_vertices; ++vertex_index, output += stride)
+			{
+				// AnimatedMeshVertex begins with the same layout as StaticMeshVertex
+				renderer::StaticMeshVertex* vertex = reinterpret_cast<renderer::StaticMeshVertex*>(output);
+				vertex->position = mesh_format_vec3(vertex_array[vertex_index]);
+				vertex->normal = mesh_format_vec3(normal_array[vertex_index]);
+
+				const Json::Value& in_uv = uv_array[vertex_index];
+				vertex->uvs = glm::vec2(in_uv[0].asFloat(), in_uv[1].asFloat());
+
+				if (!is_animated)
+				{
+					continue;
+				}
+
+				renderer::AnimatedMeshVertex* animated = reinterpret_cast<renderer::AnimatedMeshVertex*>(output);
+
+				float bone_indices[MAX_INFLUENCES_PER_VERTEX] = { 0 };
+				float bone_weights[MAX_INFLUENCES_PER_VERTEX] = { 0 };
+
+				const Json::Value& weight_pairs = blend_weights[vertex_index];
+				assert(weight_pairs.size() <= MAX_INFLUENCES_PER_VERTEX);
+				for (Json::ArrayIndex blend_index = 0; blend_index < weight_pairs.size() && blend_index < MAX_INFLUENCES_PER_VERTEX; ++blend_index)
+				{
+					const Json::Value& weightblock = weight_pairs[blend_index];
+					JointIndexByName::const_iterator it = joints.find(weightblock["bone"].asString());
+					assert(it != joints.end());
+					if (it != joints.end())
+					{
+						bone_indices[blend_index] = static_cast<float>(it->second);
+						bone_weights[blend_index] = weightblock["value"].asFloat();
+					}
+				}
+
+				animated->blend_indices = glm::vec4(bone_indices[0], bone_indices[1], bone_indices[2], bone_indices[3]);
+				animated->blend_weights = glm::vec4(bone_weights[0], bone_weights[1], bone_weights[2], bone_weights[3]);
+			}
+		}
+	} // namespace detail
+
+
+	const MeshFormatHeader* mesh_format_header(const void* data, size_t data_size)
+	{
+		if (!data || data_size < sizeof(MeshFormatHeader))
+		{
+			return nullptr;
+		}
+
+		const MeshFormatHeader* header = static_cast<const MeshFormatHeader*>(data);
+		if (header->magic != MESH_FORMAT_MAGIC || header->version != MESH_FORMAT_VERSION)
+		{
+			return nullptr;
+		}
+
+		if (header->file_size > data_size)
+		{
+			return nullptr;
+		}
+
+		const MeshFormatSection* sections[] = {
+			&header->vertices,
+			&header->indices,
+			&header->geometry,
+			&header->joints,
+			&header->bind_poses,
+			&header->inverse_bind_poses,
+			&header->sequences,
+			&header->collision_vertices,
+			&header->collision_normals,
+			&header->collision_indices
+		};
+
+		for (size_t index = 0; index < sizeof(sections) / sizeof(sections[0]); ++index)
+		{
+			const MeshFormatSection* section = sections[index];
+			if ((section->offset % MESH_FORMAT_ALIGNMENT) != 0)
+			{
+				return nullptr;
+			}
+
+			if (static_cast<uint64_t>(section->offset) + section->size > header->file_size)
+			{
+				return nullptr;
+			}
+		}
+
+		// sections must agree with the counts in the header
+		const bool is_animated = (header->flags & MeshFormat_Animated) != 0;
+		const bool has_collision = (header->flags & MeshFormat_Collision) != 0;
+		const uint32_t bone_count = is_animated ? MAX_BONES : 0;
+		const uint32_t vertex_stride = static_cast<uint32_t>(is_animated ? sizeof(renderer::AnimatedMeshVertex) : sizeof(renderer::StaticMeshVertex));
+		if ((header->vertex_stride != vertex_stride) ||
+			(header->total_joints > MAX_BONES) ||
+			(!has_collision && (header->total_collision_vertices > 0 || header->total_collision_indices > 0)) ||
+			!detail::mesh_format_section_holds(header->vertices, header->total_vertices, header->vertex_stride) ||
+			!detail::mesh_format_section_holds(header->indices, header->total_indices, sizeof(index_t)) ||
+			!detail::mesh_format_section_holds(header->geometry, header->total_geometry, sizeof(MeshFormatGeometry)) ||
+			!detail::mesh_format_section_holds(header->joints, header->total_joints, sizeof(MeshFormatJoint)) ||
+			!detail::mesh_format_section_holds(header->bind_poses, bone_count, sizeof(glm::mat4)) ||
+			!detail::mesh_format_section_holds(header->inverse_bind_poses, bone_count, sizeof(glm::mat4)) ||
+			!detail::mesh_format_section_holds(header->sequences, header->total_sequences, sizeof(MeshFormatName)) ||
+			!detail::mesh_format_section_holds(header->collision_vertices, header->total_collision_vertices, sizeof(glm::vec3)) ||
+			!detail::mesh_format_section_holds(header->collision_normals, header->total_collision_vertices, sizeof(glm::vec3)) ||
+			!detail::mesh_format_section_holds(header->collision_indices, header->total_collision_indices, sizeof(index_t)))
+		{
+			return nullptr;
+		}
+
+		// geometry must reference vertices and indices inside their sections
+		const MeshFormatGeometry* geometry = mesh_format_section<MeshFormatGeometry>(header, header->geometry);
+		for (uint32_t index = 0; index < header->total_geometry; ++index)
+		{
+			if ((static_cast<uint64_t>(geometry[index].vertex_offset) + geometry[index].total_vertices > header->total_vertices) ||
+				(static_cast<uint64_t>(geometry[index].index_offset) + geometry[index].total_indices > header->total_indices) ||
+				!detail::mesh_format_name_valid(geometry[index].material))
+			{
+				return nullptr;
+			}
+		}
+
+		const MeshFormatJoint* joints = mesh_format_section<MeshFormatJoint>(header, header->joints);
+		for (uint32_t index = 0; index < header->total_joints; ++index)
+		{
+			if ((joints[index].parent_index < -1) ||
+				(joints[index].parent_index >= static_cast<int32_t>(header->total_joints)) ||
+				(joints[index].parent_index == static_cast<int32_t>(index)) ||
+				!detail::mesh_format_name_valid(joints[index].name))
+			{
+				return nullptr;
+			}
+		}
+
+		const MeshFormatName* sequences = mesh_format_section<MeshFormatName>(header, header->sequences);
+		for (uint32_t index = 0; index < header->total_sequences; ++index)
+		{
+			if (!detail::mesh_format_name_valid(sequences[index].name))
+			{
+				return nullptr;
+			}
+		}
+
+		// collision geometry is read on the CPU; indices must be in range
+		const index_t* collision_indices = mesh_format_section<index_t>(header, header->collision_indices);
+		for (uint32_t index = 0; index < header->total_collision_indices; ++index)
+		{
+			if (collision_indices[index] >= header->total_collision_vertices)
+			{
+				return nullptr;
+			}
+		}
+
+		return header;
+	} // mesh_format_header
+
+
+	core::util::ConfigLoadStatus mesh_format_compile_json(const Json::Value& root, void* data)
+	{
+		MeshFormatCompileState* state = reinterpret_cast<MeshFormatCompileState*>(data);
+		assert(state->allocator && state->output);
+
+		const Json::Value& node_root = root["children"];
+		if (node_root.isNull())
+		{
+			LOGE("Model has no nodes!\n");
+			return core::util::ConfigLoad_Failure;
+		}
+
+		detail::MaterialByIdContainer materials_by_id;
+		const Json::Value& materials = root["materials"];
+		for (Json::ArrayIndex index = 0; index < materials.size(); ++index)
+		{
+			const Json::Value& material = materials[index];
+			materials_by_id.insert(detail::MaterialByIdContainer::value_type(material["id"].asInt(), material["name"].asString()));
+		}
+
+		Array<const Json::Value*> mesh_nodes(*state->allocator);
+		for (Json::ArrayIndex index = 0; index < node_root.size(); ++index)
+		{
+			detail::mesh_format_collect_nodes(node_root[index], mesh_nodes);
+		}
+
+		if (mesh_nodes.empty())
+		{
+			LOGE("Model has no mesh nodes!\n");
+			return core::util::ConfigLoad_Failure;
+		}
+
+		// The skeleton is consistent for a single model file;
+		// use the first one found.
+		const Json::Value* skeleton = nullptr;
+		uint32_t total_vertices = 0;
+		uint32_t total_indices = 0;
+		for (size_t index = 0; index < mesh_nodes.size(); ++index)
+		{
+			const Json::Value& node = *mesh_nodes[index];
+			total_vertices += node["vertices"].size();
+			total_indices += node["indices"].size();
+
+			if (!skeleton && node["skeleton"].size() > 0)
+			{
+				skeleton = &node["skeleton"];
+			}
+		}
+
+		const bool is_animated = (skeleton != nullptr);
+		if (is_animated && skeleton->size() > MAX_BONES)
+		{
+			LOGE("Model has %i bones; only %i are supported!\n", skeleton->size(), MAX_BONES);
+			return core::util::ConfigLoad_Failure;
+		}
+
+		const Json::Value& animations = root["animations"];
+		const Json::Value& collision_geometry = root["collision_geometry"];
+		const Json::Value& collision_vertices = collision_geometry["vertices"];
+		const Json::Value& collision_normals = collision_geometry["normals"];
+		const Json::Value& collision_indices = collision_geometry["indices"];
+
+		// Sanity check that vertices are 1:1 with normals.
+		if (collision_vertices.size() != collision_normals.size())
+		{
+			LOGE("Collision geometry has %i vertices but %i normals!\n", collision_vertices.size(), collision_normals.size());
+			return core::util::ConfigLoad_Failure;
+		}
+
+		MeshFormatHeader header;
+		memset(&header, 0, sizeof(MeshFormatHeader));
+		header.magic = MESH_FORMAT_MAGIC;
+		header.version = MESH_FORMAT_VERSION;
+		header.flags = (is_animated ? MeshFormat_Animated : 0) | (collision_geometry.isNull() ? 0 : MeshFormat_Collision);
+		header.vertex_stride = static_cast<uint32_t>(is_animated ? sizeof(renderer::AnimatedMeshVertex) : sizeof(renderer::StaticMeshVertex));
+		header.total_vertices = total_vertices;
+		header.total_indices = total_indices;
+		header.total_geometry = static_cast<uint32_t>(mesh_nodes.size());
+		header.total_joints = is_animated ? skeleton->size() : 0;
+		header.total_sequences = animations.size();
+		header.total_collision_vertices = collision_vertices.size();
+		header.total_collision_indices = collision_indices.size();
+
+		// lay out sections
+		const size_t bind_pose_size = is_animated ? (sizeof(glm::mat4) * MAX_BONES) : 0;
+		uint32_t offset = detail::mesh_format_align(sizeof(MeshFormatHeader));
+		detail::mesh_format_add_section(header.vertices, offset, header.vertex_stride * total_vertices);
+		detail::mesh_format_add_section(header.indices, offset, sizeof(index_t) * total_indices);
+		detail::mesh_format_add_section(header.geometry, offset, sizeof(MeshFormatGeometry) * header.total_geometry);
+		detail::mesh_format_add_section(header.joints, offset, sizeof(MeshFormatJoint) * header.total_joints);
+		detail::mesh_format_add_section(header.bind_poses, offset, bind_pose_size);
+		detail::mesh_format_add_section(header.inverse_bind_poses, offset, bind_pose_size);
+		detail::mesh_format_add_section(header.sequences, offset, sizeof(MeshFormatName) * header.total_sequences);
+		detail::mesh_format_add_section(header.collision_vertices, offset, sizeof(glm::vec3) * header.total_collision_vertices);
+		detail::mesh_format_add_section(header.collision_normals, offset, sizeof(glm::vec3) * header.total_collision_vertices);
+		detail::mesh_format_add_section(header.collision_indices, offset, sizeof(index_t) * header.total_collision_indices);
+		header.file_size = offset;
+
+		Array<unsigned char>& output = *state->output;
+		output.resize(header.file_size, 0);
+		uint8_t* base = &output[0];
+
+		// skeleton
+		detail::JointIndexByName joint_index_by_name;
+		if (is_animated)
+		{
+			MeshFormatJoint* joints = reinterpret_cast<MeshFormatJoint*>(base + header.joints.offset);
+			for (uint32_t index = 0; index < header.total_joints; ++index)
+			{
+				const Json::Value& skeleton_entry = (*skeleton)[index];
+				const Json::Value& parent = skeleton_entry["parent"];
+				const std::string name = skeleton_entry["name"].asString();
+
+				joints[index].parent_index = parent.isNull() ? -1 : parent.asInt();
+				detail::mesh_format_copy_name(joints[index].name, name);
+				joint_index_by_name[name] = static_cast<int32_t>(index);
+			}
+
+			// unused bones keep an identity bind pose
+			glm::mat4* bind_poses = reinterpret_cast<glm::mat4*>(base + header.bind_poses.offset);
+			glm::mat4* inverse_bind_poses = reinterpret_cast<glm::mat4*>(base + header.inverse_bind_poses.offset);
+			for (uint32_t index = 0; index < MAX_BONES; ++index)
+			{
+				bind_poses[index] = glm::mat4(1.0f);
+				inverse_bind_poses[index] = glm::mat4(1.0f);
+			}
+		}
+
+		// geometry, vertices and indices
+		MeshFormatGeometry* geometry = reinterpret_cast<MeshFormatGeometry*>(base + header.geometry.offset);
+		index_t* indices = reinterpret_cast<index_t*>(base + header.indices.offset);
+		uint32_t vertex_offset = 0;
+		uint32_t index_offset = 0;
+		bool has_bounds = false;
+		for (size_t geometry_index = 0; geometry_index < mesh_nodes.size(); ++geometry_index)
+		{
+			const Json::Value& node = *mesh_nodes[geometry_index];
+			const Json::Value& index_array = node["indices"];
+
+			MeshFormatGeometry& definition = geometry[geometry_index];
+			definition.vertex_offset = vertex_offset;
+			definition.total_vertices = node["vertices"].size();
+			definition.index_offset = index_offset;
+			definition.total_indices = index_array.size();
+
+			const Json::Value& material_id = node["material_id"];
+			if (material_id.isNull())
+			{
+				detail::mesh_format_copy_name(definition.material, "default");
+			}
+			else
+			{
+				detail::MaterialByIdContainer::iterator it = materials_by_id.find(material_id.asInt());
+				if (it != materials_by_id.end())
+				{
+					detail::mesh_format_copy_name(definition.material, it->second);
+				}
+			}
+
+			detail::mesh_format_write_vertices(base + header.vertices.offset + (vertex_offset * header.vertex_stride),
+				header.vertex_stride,
+				node,
+				definition.total_vertices,
+				is_animated,
+				joint_index_by_name);
+
+			for (uint32_t index = 0; index < definition.total_indices; ++index)
+			{
+				indices[index_offset + index] = vertex_offset + index_array[index].asUInt();
+			}
+
+			if (is_animated)
+			{
+				glm::mat4* bind_poses = reinterpret_cast<glm::mat4*>(base + header.bind_poses.offset);
+				glm::mat4* inverse_bind_poses = reinterpret_cast<glm::mat4*>(base + header.inverse_bind_poses.offset);
+
+				const Json::Value& bind_data = node["bind_data"];
+				for (Json::ArrayIndex index = 0; index < bind_data.size(); ++index)
+				{
+					const Json::Value& skeleton_entry = bind_data[index];
+					detail::JointIndexByName::iterator it = joint_index_by_name.find(skeleton_entry["name"].asString());
+					assert(it != joint_index_by_name.end());
+					if (it != joint_index_by_name.end())
+					{
+						bind_poses[it->second] = detail::mesh_format_mat4(skeleton_entry["bind_pose"]);
+						inverse_bind_poses[it->second] = detail::mesh_format_mat4(skeleton_entry["inverse_bind_pose"]);
+					}
+				}
+			}
+
+			const Json::Value& bbox_mins = node["mins"];
+			const Json::Value& bbox_maxs = node["maxs"];
+			if (!bbox_mins.isNull() && !bbox_maxs.isNull())
+			{
+				const glm::vec3 mins = detail::mesh_format_vec3(bbox_mins);
+				const glm::vec3 maxs = detail::mesh_format_vec3(bbox_maxs);
+				memcpy(header.aabb_mins, &mins[0], sizeof(float) * 3);
+				memcpy(header.aabb_maxs, &maxs[0], sizeof(float) * 3);
+				has_bounds = true;
+			}
+
+			const Json::Value& center_mass_offset = node["mass_center_offset"];
+			if (!center_mass_offset.isNull())
+			{
+				const glm::vec3 center = detail::mesh_format_vec3(center_mass_offset);
+				memcpy(header.mass_center_offset, &center[0], sizeof(float) * 3);
+			}
+
+			vertex_offset += definition.total_vertices;
+			index_offset += definition.total_indices;
+		}
+
+		// compute bounds from the vertex stream if the model didn't provide them
+		if (!has_bounds && total_vertices > 0)
+		{
+			const uint8_t* vertex_data = base + header.vertices.offset;
+			glm::vec3 mins = reinterpret_cast<const renderer::StaticMeshVertex*>(vertex_data)->position;
+			glm::vec3 maxs = mins;
+			for (uint32_t index = 1; index < total_vertices; ++index)
+			{
+				const glm::vec3& position = reinterpret_cast<const renderer::StaticMeshVertex*>(vertex_data + (index * header.vertex_stride))->position;
+				mins = glm::min(mins, position);
+				maxs = glm::max(maxs, position);
+			}
+			memcpy(header.aabb_mins, &mins[0], sizeof(float) * 3);
+			memcpy(header.aabb_maxs, &maxs[0], sizeof(float) * 3);
+		}
+
+		// animation names
+		MeshFormatName* sequences = reinterpret_cast<MeshFormatName*>(base + header.sequences.offset);
+		for (uint32_t index = 0; index < header.total_sequences; ++index)
+		{
+			detail::mesh_format_copy_name(sequences[index].name, animations[index].asString());
+		}
+
+		// collision geometry
+		glm::vec3* out_vertices = reinterpret_cast<glm::vec3*>(base + header.collision_vertices.offset);
+		glm::vec3* out_normals = reinterpret_cast<glm::vec3*>(base + header.collision_normals.offset);
+		for (uint32_t index = 0; index < header.total_collision_vertices; ++index)
+		{
+			out_vertices[index] = detail::mesh_format_vec3(collision_vertices[index]);
+			out_normals[index] = detail::mesh_format_vec3(collision_normals[index]);
+		}
+
+		index_t* out_indices = reinterpret_cast<index_t*>(base + header.collision_indices.offset);
+		for (uint32_t index = 0; index < header.total_collision_indices; ++index)
+		{
+			out_indices[index] = collision_indices[index].asUInt();
+		}
+
+		memcpy(base, &header, sizeof(MeshFormatHeader));
+		return core::util::ConfigLoad_Success;
+	} // mesh_format_compile_json
+} // namespace gemini
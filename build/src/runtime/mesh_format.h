@@ -0,0 +1,161 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#pragma once
+
+#include <runtime/configloader.h>
+
+#include <core/array.h>
+#include <core/typedefs.h>
+
+namespace gemini
+{
+	// Compiled mesh container.
+	// asset_compiler writes these from JSON .model files. At runtime the file
+	// is mapped read-only and the vertex, index and bind pose sections are
+	// used in place: no per-element parsing is done on load.
+	//
+	// All section offsets are relative to the start of the file and are
+	// aligned to MESH_FORMAT_ALIGNMENT.
+	const uint32_t MESH_FORMAT_MAGIC = 0x4853454d; // "MESH"
+	const uint32_t MESH_FORMAT_VERSION = 1;
+	const uint32_t MESH_FORMAT_ALIGNMENT = 16;
+	const uint32_t MESH_FORMAT_MAX_NAME = 128;
+
+	// extension appended to the asset path by MeshLibrary
+	#define MESH_FORMAT_EXTENSION ".mesh"
+
+	enum MeshFormatFlags
+	{
+		// vertex stream is AnimatedMeshVertex instead of StaticMeshVertex
+		MeshFormat_Animated		= (1 << 0),
+
+		// collision_* sections are present
+		MeshFormat_Collision	= (1 << 1)
+	}; // MeshFormatFlags
+
+	struct MeshFormatSection
+	{
+		uint32_t offset;
+		uint32_t size;
+	}; // MeshFormatSection
+
+	struct MeshFormatGeometry
+	{
+		uint32_t vertex_offset;
+		uint32_t total_vertices;
+		uint32_t index_offset;
+		uint32_t total_indices;
+
+		// material path passed to material_load; empty if none was resolved.
+		char material[MESH_FORMAT_MAX_NAME];
+	}; // MeshFormatGeometry
+
+	struct MeshFormatJoint
+	{
+		int32_t parent_index;
+		char name[MESH_FORMAT_MAX_NAME];
+	}; // MeshFormatJoint
+
+	struct MeshFormatName
+	{
+		char name[MESH_FORMAT_MAX_NAME];
+	}; // MeshFormatName
+
+	struct MeshFormatHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t flags;
+		uint32_t vertex_stride;
+
+		uint32_t total_vertices;
+		uint32_t total_indices;
+		uint32_t total_geometry;
+		uint32_t total_joints;
+
+		uint32_t total_sequences;
+		uint32_t total_collision_vertices;
+		uint32_t total_collision_indices;
+		uint32_t file_size;
+
+		float aabb_mins[3];
+		float aabb_maxs[3];
+		float mass_center_offset[3];
+		float reserved[3];
+
+		// StaticMeshVertex or AnimatedMeshVertex; see MeshFormat_Animated
+		MeshFormatSection vertices;
+
+		// index_t; already offset by each geometry's vertex_offset
+		MeshFormatSection indices;
+
+		// MeshFormatGeometry
+		MeshFormatSection geometry;
+
+		// MeshFormatJoint
+		MeshFormatSection joints;
+
+		// glm::mat4 * MAX_BONES each; only present for animated meshes
+		MeshFormatSection bind_poses;
+		MeshFormatSection inverse_bind_poses;
+
+		// MeshFormatName; animation names relative to the model's directory
+		MeshFormatSection sequences;
+
+		// glm::vec3, glm::vec3, index_t
+		MeshFormatSection collision_vertices;
+		MeshFormatSection collision_normals;
+		MeshFormatSection collision_indices;
+	}; // MeshFormatHeader
+
+	// Validates a compiled mesh container.
+	// @returns The header if data is a valid container of this version,
+	// otherwise nullptr.
+	const MeshFormatHeader* mesh_format_header(const void* data, size_t data_size);
+
+	template <class T>
+	const T* mesh_format_section(const MeshFormatHeader* header, const MeshFormatSection& section)
+	{
+		if (section.size == 0)
+		{
+			return nullptr;
+		}
+
+		return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(header) + section.offset);
+	}
+
+	struct MeshFormatCompileState
+	{
+		// used for temporary storage while compiling
+		gemini::Allocator* allocator;
+
+		// receives the compiled container
+		Array<unsigned char>* output;
+	}; // MeshFormatCompileState
+
+	// JsonLoaderCallback that compiles a JSON .model into a mesh container.
+	// data must point to a MeshFormatCompileState.
+	core::util::ConfigLoadStatus mesh_format_compile_json(const Json::Value& root, void* data);
+} // namespace gemini
@@ -26,6 +26,7 @@
 #include <runtime/configloader.h>
 #include <runtime/filesystem.h>
 #include <runtime/geometry.h>
+#include <runtime/mesh_format.h>
 #include <runtime/mesh_library.h>
 #include <runtime/mesh.h>
 #include <runtime/assets.h>
@@ -86,16 +87,31 @@ namespace gemini
 		size_t current_geometry;
 		Mesh* mesh;
 		gemini::Allocator& allocator;
+		bool is_streaming;
 
 		MeshLoaderState(gemini::Allocator& _allocator, Mesh* input)
 			: allocator(_allocator)
 			, current_geometry(0)
 			, mesh(input)
+			, is_streaming(false)
 		{
 		}
 	}; // MeshLoaderState
 
-	void traverse_nodes(MeshLoaderState& state, const Json::Value& node, MaterialByIdContainer& materials)
+	AssetHandle mesh_load_material(bool is_streaming, const char* path)
+	{
+		// Streamed meshes stream their materials as well.
+		if (is_streaming)
+		{
+			return material_load_async(path);
+		}
+
+		return material_load(path);
+	} // mesh_load_material
+
+	// Convert the mesh nodes' vertex, index, skeleton and blend data.
+	// This doesn't load any other assets; so it may run on a streaming thread.
+	void traverse_nodes(MeshLoaderState& state, const Json::Value& node)
 	{
 		const std::string node_type = node["type"].asString();
 		if (node_type == "mesh")
@@ -170,10 +186,6 @@ namespace gemini
 				*uv = glm::vec2(in_uv[0].asFloat(), in_uv[1].asFloat());
 			}
 
-			// If you hit this assert, we need to finally split
-			// large batches of geometry into batches no larger than 65k.
-			assert(geometry->total_indices < USHRT_MAX);
-
 			// read all indices
 			index_t* indices = &state.mesh->indices[geometry->index_offset];
 			for (uint32_t index = 0; index < geometry->total_indices; ++index)
@@ -181,23 +193,6 @@ namespace gemini
 				indices[index] = geometry->vertex_offset + index_array[index].asInt();
 			}
 
-			// assign material to this geometry
-			Json::Value material_id = node["material_id"];
-			if (!material_id.isNull())
-			{
-				MaterialByIdContainer::iterator it = materials.find(material_id.asInt());
-				if (it != materials.end())
-				{
-					std::string material_path = it->second;
-					geometry->material_handle = material_load(material_path.c_str());
-				}
-			}
-			else
-			{
-				// no material specified; load default material
-				geometry->material_handle = material_load("default");
-			}
-
 			// If this has a skeleton...
 			if (!state.mesh->skeleton.empty())
 			{
@@ -308,11 +303,50 @@ namespace gemini
 			Json::ValueIterator child_iter = children.begin();
 			for (; child_iter != children.end(); ++child_iter)
 			{
-				traverse_nodes(state, (*child_iter), materials);
+				traverse_nodes(state, (*child_iter));
 			}
 		}
 	}
 
+	// Load the material for each mesh node; visiting nodes in the same
+	// order as traverse_nodes. Main thread only.
+	void assign_materials(MeshLoaderState& state, const Json::Value& node, MaterialByIdContainer& materials)
+	{
+		const std::string node_type = node["type"].asString();
+		if (node_type == "mesh")
+		{
+			GeometryDefinition* geometry = &state.mesh->geometry[state.current_geometry];
+
+			const Json::Value& material_id = node["material_id"];
+			if (!material_id.isNull())
+			{
+				MaterialByIdContainer::iterator it = materials.find(material_id.asInt());
+				if (it != materials.end())
+				{
+					std::string material_path = it->second;
+					geometry->material_handle = mesh_load_material(state.is_streaming, material_path.c_str());
+				}
+			}
+			else
+			{
+				// no material specified; load default material
+				geometry->material_handle = mesh_load_material(state.is_streaming, "default");
+			}
+
+			++state.current_geometry;
+		}
+
+		const Json::Value& children = node["children"];
+		if (!children.isNull())
+		{
+			Json::ValueIterator child_iter = children.begin();
+			for (; child_iter != children.end(); ++child_iter)
+			{
+				assign_materials(state, (*child_iter), materials);
+			}
+		}
+	} // assign_materials
+
 	void count_nodes(const Json::Value& node, size_t& total_nodes, size_t& total_meshes)
 	{
 		assert(!node["name"].isNull());
@@ -402,29 +436,128 @@ namespace gemini
 	} // collect_scene_Data
 
 
-	core::util::ConfigLoadStatus load_json_model(const Json::Value& root, void* data)
+	// Data read on a streaming thread which finalize_asset consumes.
+	struct MeshStreamData
 	{
-		MeshLibrary::LoadState* load_state = reinterpret_cast<MeshLibrary::LoadState*>(data);
-		Mesh* mesh = load_state->asset;
+		// the parsed JSON model; null for compiled meshes
+		Json::Value* root;
 
-		Json::Value node_root = root["children"];
+		// sequences which are registered with the animation system in finalize
+		FixedArray<animation::Sequence*> sequences;
 
-		// The model has no nodes. What have you done?
-		assert(!node_root.isNull());
+		MeshStreamData(gemini::Allocator& allocator)
+			: root(nullptr)
+			, sequences(allocator)
+		{
+		}
+	}; // MeshStreamData
 
-		MaterialByIdContainer materials_by_id;
+	void mesh_stream_data_destroy(MeshLibrary::LoadState& load_state)
+	{
+		MeshStreamData* stream_data = static_cast<MeshStreamData*>(load_state.stream_data);
+		for (size_t index = 0; index < stream_data->sequences.size(); ++index)
+		{
+			// sequences which were never registered
+			if (stream_data->sequences[index])
+			{
+				MEMORY2_DELETE(*load_state.allocator, stream_data->sequences[index]);
+			}
+		}
 
-		// read in materials
-		Json::Value materials = root["materials"];
-		if (!materials.isNull())
+		if (stream_data->root)
 		{
-			Json::ValueIterator miter = materials.begin();
-			for (; miter != materials.end(); ++miter)
+			MEMORY2_DELETE(*load_state.allocator, stream_data->root);
+		}
+
+		MEMORY2_DELETE(*load_state.allocator, stream_data);
+		load_state.stream_data = nullptr;
+	} // mesh_stream_data_destroy
+
+	// Read and parse an animation sequence; this requires the mesh's skeleton.
+	bool read_mesh_sequence(MeshLibrary::LoadState& load_state, uint32_t animation_index, const char* name)
+	{
+		Mesh* mesh = load_state.asset;
+		MeshStreamData* stream_data = static_cast<MeshStreamData*>(load_state.stream_data);
+
+		platform::PathString animation_sequence_uri = load_state.asset_uri.dirname();
+		animation_sequence_uri.append(PATH_SEPARATOR_STRING);
+		animation_sequence_uri.append(name);
+		stream_data->sequences[animation_index] = animation::read_sequence(*load_state.allocator, animation_sequence_uri(), mesh);
+		if (!stream_data->sequences[animation_index])
+		{
+			return false;
+		}
+
+		platform::PathString basename = animation_sequence_uri.basename();
+		assert(basename.size() < 32);
+		mesh->sequence_index_by_name[basename()] = animation_index;
+		return true;
+	} // read_mesh_sequence
+
+	// Register the sequences read for a mesh. Main thread only.
+	void register_mesh_sequences(MeshLibrary::LoadState& load_state)
+	{
+		Mesh* mesh = load_state.asset;
+		MeshStreamData* stream_data = static_cast<MeshStreamData*>(load_state.stream_data);
+
+		for (size_t index = 0; index < stream_data->sequences.size(); ++index)
+		{
+			animation::Sequence* sequence = stream_data->sequences[index];
+			stream_data->sequences[index] = nullptr;
+
+			// Meshes may share sequences; keep the one already registered.
+			animation::SequenceId sequence_id = animation::find_sequence(sequence->name());
+			if (sequence_id == -1)
 			{
-				Json::Value material = (*miter);
-				materials_by_id.insert(MaterialByIdContainer::value_type(material["id"].asInt(), material["name"].asString()));
+				sequence_id = animation::add_sequence(sequence);
 			}
+			else
+			{
+				MEMORY2_DELETE(*load_state.allocator, sequence);
+			}
+
+			mesh->sequences[index] = sequence_id;
 		}
+	} // register_mesh_sequences
+
+	bool read_json_sequences(MeshLibrary::LoadState& load_state, const Json::Value& root)
+	{
+		MeshStreamData* stream_data = static_cast<MeshStreamData*>(load_state.stream_data);
+
+		const Json::Value& animation_list = root["animations"];
+		if (animation_list.isNull())
+		{
+			return true;
+		}
+
+		const uint32_t total_sequences = animation_list.size();
+		load_state.asset->sequences.allocate(total_sequences);
+		stream_data->sequences.allocate(total_sequences, nullptr);
+
+		Json::ValueIterator it = animation_list.begin();
+		uint32_t animation_index = 0;
+		for (; it != animation_list.end(); ++it, ++animation_index)
+		{
+			const Json::Value& animation_name = (*it);
+			std::string name = animation_name.asString();
+			if (!read_mesh_sequence(load_state, animation_index, name.c_str()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	} // read_json_sequences
+
+	core::util::ConfigLoadStatus load_json_model(const Json::Value& root, void* data)
+	{
+		MeshLibrary::LoadState* load_state = reinterpret_cast<MeshLibrary::LoadState*>(data);
+		Mesh* mesh = load_state->asset;
+
+		Json::Value node_root = root["children"];
+
+		// The model has no nodes. What have you done?
+		assert(!node_root.isNull());
 
 		SceneInfo scene_info(*load_state->allocator);
 		{
@@ -448,34 +581,7 @@ namespace gemini
 		for (; node_iter != node_root.end(); ++node_iter)
 		{
 			Json::Value node = (*node_iter);
-			traverse_nodes(state, node, materials_by_id);
-		}
-
-		// try to load animations
-		Json::Value animation_list = root["animations"];
-		if (!animation_list.isNull())
-		{
-			Json::ValueIterator it = animation_list.begin();
-
-			uint32_t total_sequences = animation_list.size();
-			mesh->sequences.allocate(total_sequences);
-
-			uint32_t animation_index = 0;
-			for (; it != animation_list.end(); ++it, ++animation_index)
-			{
-				const Json::Value& animation_name = (*it);
-				std::string name = animation_name.asString();
-
-				platform::PathString animation_sequence_uri = load_state->asset_uri.dirname();
-				animation_sequence_uri.append(PATH_SEPARATOR_STRING);
-				animation_sequence_uri.append(name.c_str());
-				animation::Sequence* sequence = animation::load_sequence_from_file(*load_state->allocator, animation_sequence_uri(), mesh);
-				mesh->sequences[animation_index] = sequence->index;
-
-				platform::PathString basename = animation_sequence_uri.basename();
-				assert(basename.size() < 32);
-				mesh->sequence_index_by_name[basename()] = animation_index;
-			}
+			traverse_nodes(state, node);
 		}
 
 		// try loading embedded collision geometry
@@ -487,12 +593,11 @@ namespace gemini
 			Json::Value collision_indices = collision_geometry["indices"];
 
 			// Sanity check that vertices are 1:1 with normals.
-			assert(collision_vertices.size() == collision_normals.size());
-
-			// If you hit this assert, we need to finally split
-			// large batches of geometry into batches no larger than 65k.
-			// As a collision mesh, this limit should never be hit, question mark?
-			assert(collision_indices.size() < USHRT_MAX);
+			if (collision_vertices.size() != collision_normals.size())
+			{
+				LOGE("Collision geometry has %i vertices but %i normals!\n", collision_vertices.size(), collision_normals.size());
+				return core::util::ConfigLoad_Failure;
+			}
 
 			LOGV("> Load mesh collision: verts: %i, indices: %i\n", collision_vertices.size(), collision_indices.size());
 
@@ -523,6 +628,162 @@ namespace gemini
 		return core::util::ConfigLoad_Success;
 	}
 
+	// Load the materials referenced by a JSON model converted with
+	// load_json_model. Main thread only.
+	void load_json_model_references(MeshLibrary::LoadState& load_state, const Json::Value& root)
+	{
+		Mesh* mesh = load_state.asset;
+
+		MaterialByIdContainer materials_by_id;
+
+		// read in materials
+		const Json::Value& materials = root["materials"];
+		if (!materials.isNull())
+		{
+			Json::ValueIterator miter = materials.begin();
+			for (; miter != materials.end(); ++miter)
+			{
+				const Json::Value& material = (*miter);
+				materials_by_id.insert(MaterialByIdContainer::value_type(material["id"].asInt(), material["name"].asString()));
+			}
+		}
+
+		MeshLoaderState state(*load_state.allocator, mesh);
+		state.is_streaming = load_state.is_streaming;
+
+		const Json::Value& node_root = root["children"];
+		Json::ValueIterator node_iter = node_root.begin();
+		for (; node_iter != node_root.end(); ++node_iter)
+		{
+			assign_materials(state, (*node_iter), materials_by_id);
+		}
+	} // load_json_model_references
+
+	bool map_compiled_model(MeshLibrary::LoadState& load_state, const char* asset_uri)
+	{
+		Mesh* mesh = load_state.asset;
+		core::filesystem::IFileSystem* filesystem = core::filesystem::instance();
+
+		if (!filesystem->virtual_map_file(mesh->mapping, asset_uri))
+		{
+			return false;
+		}
+
+		const MeshFormatHeader* header = mesh_format_header(mesh->mapping.data, mesh->mapping.size);
+		if (!header)
+		{
+			LOGW("\"%s\" is not a valid compiled mesh (expected version %i)\n", asset_uri, MESH_FORMAT_VERSION);
+			filesystem->virtual_unmap_file(mesh->mapping);
+			return false;
+		}
+
+		return true;
+	} // map_compiled_model
+
+	// Touch each page of the mapping so that page faults are taken
+	// here (on a streaming thread) rather than while rendering.
+	void touch_compiled_model(MeshLibrary::LoadState& load_state)
+	{
+		const platform::FileMapping& mapping = load_state.asset->mapping;
+		const volatile uint8_t* bytes = static_cast<const volatile uint8_t*>(mapping.data);
+		uint32_t checksum = 0;
+		for (size_t offset = 0; offset < mapping.size; offset += 4096)
+		{
+			checksum += bytes[offset];
+		}
+		(void)checksum;
+	} // touch_compiled_model
+
+	// Read the skeleton and animation sequences of a compiled mesh.
+	bool read_compiled_sequences(MeshLibrary::LoadState& load_state)
+	{
+		Mesh* mesh = load_state.asset;
+		MeshStreamData* stream_data = static_cast<MeshStreamData*>(load_state.stream_data);
+		const MeshFormatHeader* header = mesh_format_header(mesh->mapping.data, mesh->mapping.size);
+		assert(header);
+
+		const MeshFormatJoint* joints = mesh_format_section<MeshFormatJoint>(header, header->joints);
+		mesh->skeleton.allocate(header->total_joints);
+		for (uint32_t index = 0; index < header->total_joints; ++index)
+		{
+			Joint& joint = mesh->skeleton[index];
+			joint.index = static_cast<int32_t>(index);
+			joint.parent_index = joints[index].parent_index;
+			joint.name = joints[index].name;
+		}
+
+		const MeshFormatName* sequences = mesh_format_section<MeshFormatName>(header, header->sequences);
+		mesh->sequences.allocate(header->total_sequences);
+		stream_data->sequences.allocate(header->total_sequences, nullptr);
+		for (uint32_t index = 0; index < header->total_sequences; ++index)
+		{
+			if (!read_mesh_sequence(load_state, index, sequences[index].name))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	} // read_compiled_sequences
+
+	void load_compiled_model(MeshLibrary::LoadState& load_state)
+	{
+		Mesh* mesh = load_state.asset;
+		const MeshFormatHeader* header = mesh_format_header(mesh->mapping.data, mesh->mapping.size);
+		assert(header);
+
+		// Vertex data is used in place. The mapping is read-only, so index,
+		// bind pose and collision data are copied into memory the mesh owns.
+		mesh->interleaved_vertices = mesh_format_section<uint8_t>(header, header->vertices);
+		mesh->interleaved_stride = header->vertex_stride;
+
+		const size_t index_data_size = sizeof(index_t) * header->total_indices;
+		mesh->indices = static_cast<index_t*>(MEMORY2_ALLOC(*load_state.allocator, index_data_size));
+		memcpy(mesh->indices, mesh_format_section<index_t>(header, header->indices), index_data_size);
+
+		if (header->flags & MeshFormat_Animated)
+		{
+			// same layout as mesh_init; both sections hold MAX_BONES poses.
+			const size_t pose_data_size = sizeof(glm::mat4) * MAX_BONES;
+			uint8_t* data = static_cast<uint8_t*>(MEMORY2_ALLOC(*load_state.allocator, pose_data_size * 2));
+			mesh->bind_poses = reinterpret_cast<glm::mat4*>(data);
+			mesh->inverse_bind_poses = reinterpret_cast<glm::mat4*>(data + pose_data_size);
+			memcpy(mesh->bind_poses, mesh_format_section<glm::mat4>(header, header->bind_poses), pose_data_size);
+			memcpy(mesh->inverse_bind_poses, mesh_format_section<glm::mat4>(header, header->inverse_bind_poses), pose_data_size);
+		}
+
+		mesh->aabb_mins = glm::make_vec3(header->aabb_mins);
+		mesh->aabb_maxs = glm::make_vec3(header->aabb_maxs);
+		mesh->mass_center_offset = glm::make_vec3(header->mass_center_offset);
+
+		const MeshFormatGeometry* geometry = mesh_format_section<MeshFormatGeometry>(header, header->geometry);
+		mesh->geometry.allocate(header->total_geometry);
+		for (uint32_t index = 0; index < header->total_geometry; ++index)
+		{
+			GeometryDefinition& definition = mesh->geometry[index];
+			definition.vertex_offset = geometry[index].vertex_offset;
+			definition.total_vertices = geometry[index].total_vertices;
+			definition.index_offset = geometry[index].index_offset;
+			definition.total_indices = geometry[index].total_indices;
+			definition.shader_handle = InvalidAssetHandle;
+			definition.material_handle = InvalidAssetHandle;
+			if (geometry[index].material[0] != '\0')
+			{
+				definition.material_handle = mesh_load_material(load_state.is_streaming, geometry[index].material);
+			}
+		}
+
+		if (header->flags & MeshFormat_Collision)
+		{
+			mesh_create_collision(*load_state.allocator, mesh, header->total_collision_vertices, header->total_collision_indices);
+
+			CollisionGeometry* collision = mesh->collision_geometry;
+			memcpy(collision->vertices, mesh_format_section<glm::vec3>(header, header->collision_vertices), sizeof(glm::vec3) * collision->total_vertices);
+			memcpy(collision->normals, mesh_format_section<glm::vec3>(header, header->collision_normals), sizeof(glm::vec3) * collision->total_vertices);
+			memcpy(collision->indices, mesh_format_section<index_t>(header, header->collision_indices), sizeof(index_t) * collision->total_indices);
+		}
+	} // load_compiled_model
+
 
 	MeshLibrary::MeshLibrary(Allocator& allocator)
 		: AssetLibrary2(allocator)
@@ -535,13 +796,44 @@ namespace gemini
 	}
 
 	AssetLoadStatus MeshLibrary::load_asset(LoadState& state, platform::PathString& fullpath, void* parameters)
+	{
+		if (read_asset(state, fullpath, parameters) != AssetLoad_Success)
+		{
+			return AssetLoad_Failure;
+		}
+
+		return finalize_asset(state, fullpath, parameters);
+	}
+
+	AssetLoadStatus MeshLibrary::read_asset(LoadState& state, platform::PathString& fullpath, void* /*parameters*/)
 	{
 		LOGV("loading mesh \"%s\"\n", fullpath());
 
+		// Released by finalize_asset; or destroy_asset if the load fails.
+		MeshStreamData* stream_data = MEMORY2_NEW(*state.allocator, MeshStreamData)(*state.allocator);
+		state.stream_data = stream_data;
+
+		// prefer the compiled mesh; fall back to the JSON model if there isn't one.
+		platform::PathString compiled_uri = fullpath;
+		compiled_uri.append(MESH_FORMAT_EXTENSION);
+		if (map_compiled_model(state, compiled_uri()))
+		{
+			if (state.is_streaming)
+			{
+				touch_compiled_model(state);
+			}
+			return read_compiled_sequences(state) ? AssetLoad_Success : AssetLoad_Failure;
+		}
+
 		platform::PathString asset_uri = fullpath;
 		asset_uri.append(".model");
 
-		if (core::util::json_load_with_callback(asset_uri(), load_json_model, &state, true) == core::util::ConfigLoad_Success)
+		// Convert the vertex and index data here; the parsed model is
+		// kept until finalize to load its materials.
+		stream_data->root = MEMORY2_NEW(*state.allocator, Json::Value);
+		if (core::util::json_load_file(asset_uri(), *stream_data->root) &&
+			(load_json_model(*stream_data->root, &state) == core::util::ConfigLoad_Success) &&
+			read_json_sequences(state, *stream_data->root))
 		{
 			return AssetLoad_Success;
 		}
@@ -549,8 +841,33 @@ namespace gemini
 		return AssetLoad_Failure;
 	}
 
+	AssetLoadStatus MeshLibrary::finalize_asset(LoadState& state, platform::PathString& /*fullpath*/, void* /*parameters*/)
+	{
+		// Materials are loaded and animation sequences are registered
+		// from here; so this must run on the main thread.
+		if (state.asset->mapping.is_mapped())
+		{
+			load_compiled_model(state);
+		}
+		else
+		{
+			MeshStreamData* stream_data = static_cast<MeshStreamData*>(state.stream_data);
+			load_json_model_references(state, *stream_data->root);
+		}
+
+		register_mesh_sequences(state);
+		mesh_stream_data_destroy(state);
+
+		return AssetLoad_Success;
+	}
+
 	void MeshLibrary::destroy_asset(LoadState& state)
 	{
+		if (state.stream_data)
+		{
+			mesh_stream_data_destroy(state);
+		}
+
 		mesh_destroy(*state.allocator, state.asset);
 
 		MEMORY2_DELETE(*state.allocator, state.asset);
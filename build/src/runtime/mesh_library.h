@@ -39,5 +39,12 @@ namespace gemini
 		inline bool is_same_asset(AssetClass*, void*) { return true; }
 		AssetLoadStatus load_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
 		void destroy_asset(LoadState& state);
+
+		// map the compiled mesh; or parse and convert the JSON model.
+		// animation sequences are read here as well.
+		AssetLoadStatus read_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
+
+		// load the mesh's materials and register its animations
+		AssetLoadStatus finalize_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
 	}; // MeshLibrary
 } // namespace gemini
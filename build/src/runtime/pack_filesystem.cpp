@@ -0,0 +1,241 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include "pack_filesystem.h"
+
+#include <core/logging.h>
+#include <core/mem.h>
+
+#include <string.h>
+
+namespace core
+{
+	namespace filesystem
+	{
+		PackFileSystem::PackFileSystem()
+			: pack_header(nullptr)
+			, loose_overrides(false)
+		{
+		}
+
+		PackFileSystem::~PackFileSystem()
+		{
+			unmount();
+		}
+
+		const gemini::PackFormatEntry* PackFileSystem::find_entry(const char* relative_path) const
+		{
+			if (!pack_header)
+			{
+				return nullptr;
+			}
+
+			if (loose_overrides && FileSystemInterface::virtual_file_exists(relative_path))
+			{
+				return nullptr;
+			}
+
+			return gemini::pack_format_find(pack_header, relative_path);
+		} // find_entry
+
+		bool PackFileSystem::mount(const char* absolute_path)
+		{
+			unmount();
+
+			pack_mapping = platform::fs_map_file(absolute_path);
+			if (!pack_mapping.is_mapped())
+			{
+				LOGE("Unable to map pack \"%s\"\n", absolute_path);
+				return false;
+			}
+
+			pack_header = gemini::pack_format_header(pack_mapping.data, pack_mapping.size);
+			if (!pack_header)
+			{
+				LOGE("Invalid pack \"%s\"\n", absolute_path);
+				platform::fs_unmap_file(pack_mapping);
+				return false;
+			}
+
+			LOGV("mounted pack \"%s\" (%u entries)\n", absolute_path, pack_header->total_entries);
+			return true;
+		} // mount
+
+		void PackFileSystem::unmount()
+		{
+			if (pack_mapping.is_mapped())
+			{
+				platform::fs_unmap_file(pack_mapping);
+			}
+			pack_header = nullptr;
+		} // unmount
+
+		bool PackFileSystem::is_mounted() const
+		{
+			return (pack_header != nullptr);
+		} // is_mounted
+
+		void PackFileSystem::loose_files_override(bool enabled)
+		{
+			loose_overrides = enabled;
+		} // loose_files_override
+
+		bool PackFileSystem::loose_files_override() const
+		{
+			return loose_overrides;
+		} // loose_files_override
+
+		void PackFileSystem::shutdown()
+		{
+			unmount();
+			FileSystemInterface::shutdown();
+		} // shutdown
+
+		bool PackFileSystem::virtual_file_exists(const char* relative_path) const
+		{
+			if (pack_header && gemini::pack_format_find(pack_header, relative_path))
+			{
+				return true;
+			}
+
+			return FileSystemInterface::virtual_file_exists(relative_path);
+		} // virtual_file_exists
+
+		char* PackFileSystem::virtual_load_file(const char* relative_path, char* buffer, size_t* buffer_length)
+		{
+			const gemini::PackFormatEntry* entry = find_entry(relative_path);
+			if (!entry || !buffer_length)
+			{
+				return FileSystemInterface::virtual_load_file(relative_path, buffer, buffer_length);
+			}
+
+			const size_t file_size = static_cast<size_t>(entry->original_size);
+			if (buffer && *buffer_length > 0 && file_size > *buffer_length)
+			{
+				LOGE("Request to read file size larger than buffer! (%lu > %lu)\n",
+					(unsigned long)file_size,
+					(unsigned long)*buffer_length
+				);
+
+				// decode the whole entry and keep what fits
+				char* temp = static_cast<char*>(MEMORY2_ALLOC(allocator, file_size));
+				gemini::pack_format_read_entry(pack_header, entry, temp, file_size);
+				memcpy(buffer, temp, *buffer_length);
+				MEMORY2_DEALLOC(allocator, temp);
+				return buffer;
+			}
+
+			*buffer_length = file_size;
+			if (!buffer)
+			{
+				buffer = static_cast<char*>(MEMORY2_ALLOC(allocator, file_size + 1));
+				buffer[file_size] = '\0';
+			}
+
+			if (!gemini::pack_format_read_entry(pack_header, entry, buffer, file_size))
+			{
+				LOGE("Unable to read packed file \"%s\"\n", relative_path);
+			}
+
+			return buffer;
+		} // virtual_load_file
+
+		void PackFileSystem::virtual_load_file(Array<unsigned char>& buffer, const char* relative_path)
+		{
+			const gemini::PackFormatEntry* entry = find_entry(relative_path);
+			if (!entry)
+			{
+				FileSystemInterface::virtual_load_file(buffer, relative_path);
+				return;
+			}
+
+			const size_t file_size = static_cast<size_t>(entry->original_size);
+			if (file_size > 0)
+			{
+				buffer.resize(file_size, 0);
+				if (!gemini::pack_format_read_entry(pack_header, entry, &buffer[0], file_size))
+				{
+					LOGE("Unable to read packed file \"%s\"\n", relative_path);
+				}
+			}
+		} // virtual_load_file
+
+		bool PackFileSystem::virtual_map_file(::platform::FileMapping& mapping, const char* relative_path)
+		{
+			const gemini::PackFormatEntry* entry = find_entry(relative_path);
+			if (!entry)
+			{
+				return FileSystemInterface::virtual_map_file(mapping, relative_path);
+			}
+
+			if (entry->original_size == 0)
+			{
+				return false;
+			}
+
+			mapping = platform::FileMapping();
+			if (!(entry->flags & gemini::PackFormatEntry_Compressed))
+			{
+				// a view into the pack's mapping
+				mapping.data = gemini::pack_format_entry_data(pack_header, entry);
+				mapping.size = static_cast<size_t>(entry->size);
+				return true;
+			}
+
+			const size_t file_size = static_cast<size_t>(entry->original_size);
+			void* data = MEMORY2_ALLOC(allocator, file_size);
+			if (!gemini::pack_format_read_entry(pack_header, entry, data, file_size))
+			{
+				LOGE("Unable to read packed file \"%s\"\n", relative_path);
+				MEMORY2_DEALLOC(allocator, data);
+				return false;
+			}
+
+			// mapping_handle marks the data as decoded by this file system
+			mapping.data = data;
+			mapping.size = file_size;
+			mapping.mapping_handle = this;
+			return true;
+		} // virtual_map_file
+
+		void PackFileSystem::virtual_unmap_file(::platform::FileMapping& mapping)
+		{
+			const uint8_t* data = static_cast<const uint8_t*>(mapping.data);
+			const uint8_t* pack_data = static_cast<const uint8_t*>(pack_mapping.data);
+			if (pack_data && data >= pack_data && data < (pack_data + pack_mapping.size))
+			{
+				mapping = platform::FileMapping();
+			}
+			else if (mapping.mapping_handle == this)
+			{
+				MEMORY2_DEALLOC(allocator, const_cast<void*>(mapping.data));
+				mapping = platform::FileMapping();
+			}
+			else
+			{
+				FileSystemInterface::virtual_unmap_file(mapping);
+			}
+		} // virtual_unmap_file
+	} // namespace filesystem
+} // namespace core
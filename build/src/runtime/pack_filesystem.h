@@ -0,0 +1,78 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#pragma once
+
+#include "filesystem_interface.h"
+
+#include <runtime/pack_format.h>
+
+namespace core
+{
+	namespace filesystem
+	{
+		// Serves virtual file requests from a content pack written by
+		// asset_compiler. Lookups are a hash search in the mapped pack; so
+		// loading a packed file costs no file system calls.
+		//
+		// Files that aren't in the pack fall through to the content
+		// directory. With loose_files_override enabled, loose files in the
+		// content directory take precedence over packed ones; this is meant
+		// for development and hotloading as it checks the disk each time.
+		//
+		// virtual_map_file returns a view into the pack for uncompressed
+		// entries; compressed entries are decoded into a new buffer which is
+		// released by virtual_unmap_file.
+		class PackFileSystem : public FileSystemInterface
+		{
+			::platform::FileMapping pack_mapping;
+			const gemini::PackFormatHeader* pack_header;
+			bool loose_overrides;
+
+			const gemini::PackFormatEntry* find_entry(const char* relative_path) const;
+
+		public:
+			PackFileSystem();
+			virtual ~PackFileSystem();
+
+			// Map the pack at absolute_path. Any previously mounted pack is
+			// unmounted first; mappings from it must be released before then.
+			// @returns false if the pack is missing or invalid.
+			bool mount(const char* absolute_path);
+			void unmount();
+			bool is_mounted() const;
+
+			void loose_files_override(bool enabled);
+			bool loose_files_override() const;
+
+			virtual void shutdown();
+
+			virtual bool virtual_file_exists(const char* relative_path) const;
+			virtual char* virtual_load_file(const char* relative_path, char* buffer, size_t* buffer_length);
+			virtual void virtual_load_file(Array<unsigned char>& buffer, const char* relative_path);
+			virtual bool virtual_map_file(::platform::FileMapping& mapping, const char* relative_path);
+			virtual void virtual_unmap_file(::platform::FileMapping& mapping);
+		}; // class PackFileSystem
+	} // namespace filesystem
+} // namespace core
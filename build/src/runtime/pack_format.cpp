@@ -0,0 +1,574 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include <runtime/pack_format.h>
+
+#include <core/logging.h>
+#include <core/mem.h>
+#include <core/str.h>
+#include <core/util.h>
+
+#include <platform/platform.h>
+
+#include <algorithm> // for std::sort
+#include <string.h>
+
+namespace gemini
+{
+	namespace detail
+	{
+		// LZ4 block format parameters
+		const size_t PACK_LZ_MIN_MATCH = 4;
+		const size_t PACK_LZ_LAST_LITERALS = 5;
+		const size_t PACK_LZ_MATCH_LIMIT = 12;
+		const size_t PACK_LZ_MAX_OFFSET = 65535;
+		const uint32_t PACK_LZ_HASH_BITS = 12;
+
+		// entries smaller than this are never compressed
+		const size_t PACK_FORMAT_MIN_COMPRESS_SIZE = 64;
+
+		static uint64_t pack_format_align(uint64_t offset)
+		{
+			return (offset + (PACK_FORMAT_ALIGNMENT - 1)) & ~static_cast<uint64_t>(PACK_FORMAT_ALIGNMENT - 1);
+		}
+
+		// Copies path to destination in the form used by the path table.
+		// @returns The length of the normalized path; or 0 if it won't fit.
+		static size_t pack_format_normalize_path(char* destination, size_t destination_size, const char* path)
+		{
+			for (;;)
+			{
+				if (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+				{
+					path += 2;
+				}
+				else if (path[0] == '/' || path[0] == '\\')
+				{
+					++path;
+				}
+				else
+				{
+					break;
+				}
+			}
+
+			size_t length = 0;
+			for (; path[length]; ++length)
+			{
+				if ((length + 1) >= destination_size)
+				{
+					return 0;
+				}
+				destination[length] = (path[length] == '\\') ? '/' : path[length];
+			}
+
+			destination[length] = '\0';
+			return length;
+		}
+
+		static uint32_t pack_lz_read32(const uint8_t* data)
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(uint32_t));
+			return value;
+		}
+
+		static uint32_t pack_lz_hash(uint32_t sequence)
+		{
+			return (sequence * 2654435761U) >> (32 - PACK_LZ_HASH_BITS);
+		}
+
+		// Writes an LZ4 length continuation: 255s followed by the remainder.
+		static uint8_t* pack_lz_write_length(uint8_t* output, size_t length)
+		{
+			while (length >= 255)
+			{
+				*output++ = 255;
+				length -= 255;
+			}
+			*output++ = static_cast<uint8_t>(length);
+			return output;
+		}
+
+		// Emits a sequence of literals followed by an optional match.
+		// A match_length of zero marks the last sequence in the block.
+		static uint8_t* pack_lz_write_sequence(uint8_t* output, const uint8_t* output_end, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length)
+		{
+			const size_t required = 1 + (literal_length / 255) + 1 + literal_length + 2 + (match_length / 255) + 1;
+			if (required > static_cast<size_t>(output_end - output))
+			{
+				return nullptr;
+			}
+
+			uint8_t* token = output++;
+			*token = static_cast<uint8_t>(((literal_length < 15) ? literal_length : 15) << 4);
+			if (literal_length >= 15)
+			{
+				output = pack_lz_write_length(output, literal_length - 15);
+			}
+
+			if (literal_length > 0)
+			{
+				memcpy(output, literals, literal_length);
+				output += literal_length;
+			}
+
+			if (match_length > 0)
+			{
+				*output++ = static_cast<uint8_t>(offset & 0xff);
+				*output++ = static_cast<uint8_t>((offset >> 8) & 0xff);
+
+				const size_t encoded_length = match_length - PACK_LZ_MIN_MATCH;
+				*token |= static_cast<uint8_t>((encoded_length < 15) ? encoded_length : 15);
+				if (encoded_length >= 15)
+				{
+					output = pack_lz_write_length(output, encoded_length - 15);
+				}
+			}
+
+			return output;
+		}
+
+		// @returns The extended length or SIZE_MAX on malformed input.
+		static size_t pack_lz_read_length(const uint8_t*& input, const uint8_t* input_end, size_t length)
+		{
+			if (length != 15)
+			{
+				return length;
+			}
+
+			uint8_t value;
+			do
+			{
+				if (input >= input_end)
+				{
+					return SIZE_MAX;
+				}
+				value = *input++;
+				length += value;
+			} while (value == 255);
+
+			return length;
+		}
+
+		struct PackFormatPathOrder
+		{
+			const Array<PackFormatEntry>* entries;
+			const Array<char>* paths;
+
+			bool operator()(uint32_t first, uint32_t second) const
+			{
+				const PackFormatEntry& a = (*entries)[first];
+				const PackFormatEntry& b = (*entries)[second];
+				if (a.path_hash != b.path_hash)
+				{
+					return a.path_hash < b.path_hash;
+				}
+
+				return strcmp(&(*paths)[a.path_offset], &(*paths)[b.path_offset]) < 0;
+			}
+		}; // PackFormatPathOrder
+	} // namespace detail
+
+	uint32_t pack_format_hash_path(const char* path)
+	{
+		char normalized[MAX_PATH_SIZE];
+		const size_t length = detail::pack_format_normalize_path(normalized, MAX_PATH_SIZE, path);
+		return core::util::hash_32bit(normalized, length, 0);
+	} // pack_format_hash_path
+
+	const PackFormatHeader* pack_format_header(const void* data, size_t data_size)
+	{
+		if (!data || data_size < sizeof(PackFormatHeader))
+		{
+			return nullptr;
+		}
+
+		const PackFormatHeader* header = static_cast<const PackFormatHeader*>(data);
+		if (header->magic != PACK_FORMAT_MAGIC)
+		{
+			LOGW("Invalid pack magic\n");
+			return nullptr;
+		}
+
+		if (header->version != PACK_FORMAT_VERSION)
+		{
+			LOGW("Pack version mismatch (found %u, expected %u)\n", header->version, PACK_FORMAT_VERSION);
+			return nullptr;
+		}
+
+		const uint64_t entries_size = static_cast<uint64_t>(header->total_entries) * sizeof(PackFormatEntry);
+		if ((header->file_size > data_size) ||
+			(header->entries_offset % sizeof(uint64_t)) != 0 ||
+			(header->entries_offset > header->file_size) ||
+			(entries_size > (header->file_size - header->entries_offset)) ||
+			(header->paths_offset > header->file_size) ||
+			(header->paths_size > (header->file_size - header->paths_offset)) ||
+			(header->paths_size > 0 && static_cast<const char*>(data)[header->paths_offset + header->paths_size - 1] != '\0'))
+		{
+			LOGW("Pack is truncated or has an invalid table\n");
+			return nullptr;
+		}
+
+		const PackFormatEntry* entries = reinterpret_cast<const PackFormatEntry*>(static_cast<const uint8_t*>(data) + header->entries_offset);
+		for (uint32_t index = 0; index < header->total_entries; ++index)
+		{
+			const PackFormatEntry& entry = entries[index];
+			if ((entry.path_offset >= header->paths_size) ||
+				(entry.offset > header->file_size) ||
+				(entry.size > (header->file_size - entry.offset)) ||
+				(!(entry.flags & PackFormatEntry_Compressed) && (entry.size != entry.original_size)) ||
+				(index > 0 && entries[index - 1].path_hash > entry.path_hash))
+			{
+				LOGW("Pack entry %u is invalid\n", index);
+				return nullptr;
+			}
+		}
+
+		return header;
+	} // pack_format_header
+
+	const PackFormatEntry* pack_format_find(const PackFormatHeader* header, const char* path)
+	{
+		char normalized[MAX_PATH_SIZE];
+		const size_t length = detail::pack_format_normalize_path(normalized, MAX_PATH_SIZE, path);
+		if (length == 0)
+		{
+			return nullptr;
+		}
+
+		const uint32_t path_hash = core::util::hash_32bit(normalized, length, 0);
+		const PackFormatEntry* entries = reinterpret_cast<const PackFormatEntry*>(reinterpret_cast<const uint8_t*>(header) + header->entries_offset);
+
+		// lower bound of path_hash
+		uint32_t first = 0;
+		uint32_t count = header->total_entries;
+		while (count > 0)
+		{
+			const uint32_t step = count / 2;
+			if (entries[first + step].path_hash < path_hash)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+
+		for (; (first < header->total_entries) && (entries[first].path_hash == path_hash); ++first)
+		{
+			if (strcmp(pack_format_entry_path(header, &entries[first]), normalized) == 0)
+			{
+				return &entries[first];
+			}
+		}
+
+		return nullptr;
+	} // pack_format_find
+
+	const char* pack_format_entry_path(const PackFormatHeader* header, const PackFormatEntry* entry)
+	{
+		return reinterpret_cast<const char*>(header) + header->paths_offset + entry->path_offset;
+	} // pack_format_entry_path
+
+	const void* pack_format_entry_data(const PackFormatHeader* header, const PackFormatEntry* entry)
+	{
+		return reinterpret_cast<const uint8_t*>(header) + entry->offset;
+	} // pack_format_entry_data
+
+	bool pack_format_read_entry(const PackFormatHeader* header, const PackFormatEntry* entry, void* destination, size_t destination_size)
+	{
+		if (destination_size != entry->original_size)
+		{
+			return false;
+		}
+
+		const void* data = pack_format_entry_data(header, entry);
+		if (entry->flags & PackFormatEntry_Compressed)
+		{
+			return pack_format_decompress(data, static_cast<size_t>(entry->size), destination, destination_size);
+		}
+
+		memcpy(destination, data, destination_size);
+		return true;
+	} // pack_format_read_entry
+
+	size_t pack_format_compress_bound(size_t source_size)
+	{
+		return source_size + (source_size / 255) + 16;
+	} // pack_format_compress_bound
+
+	size_t pack_format_compress(const void* source, size_t source_size, void* destination, size_t destination_size)
+	{
+		using namespace detail;
+
+		const uint8_t* input = static_cast<const uint8_t*>(source);
+		uint8_t* output = static_cast<uint8_t*>(destination);
+		const uint8_t* output_end = output + destination_size;
+
+		// Greedy parse with a single hash table of previous positions.
+		// The last match starts at least PACK_LZ_MATCH_LIMIT bytes before
+		// the end and the last PACK_LZ_LAST_LITERALS bytes are literals; as
+		// required by the block format.
+		uint32_t table[1 << PACK_LZ_HASH_BITS];
+		memset(table, 0, sizeof(table));
+
+		size_t anchor = 0;
+		size_t position = 0;
+		uint32_t misses = 0;
+		while ((position + PACK_LZ_MATCH_LIMIT) <= source_size)
+		{
+			const uint32_t sequence = pack_lz_read32(input + position);
+			const uint32_t hash = pack_lz_hash(sequence);
+			const size_t candidate = table[hash];
+			table[hash] = static_cast<uint32_t>(position);
+
+			if ((candidate < position) &&
+				((position - candidate) <= PACK_LZ_MAX_OFFSET) &&
+				(pack_lz_read32(input + candidate) == sequence))
+			{
+				const size_t match_end = source_size - PACK_LZ_LAST_LITERALS;
+				size_t length = PACK_LZ_MIN_MATCH;
+				while (((position + length) < match_end) && (input[candidate + length] == input[position + length]))
+				{
+					++length;
+				}
+
+				output = pack_lz_write_sequence(output, output_end, input + anchor, position - anchor, position - candidate, length);
+				if (!output)
+				{
+					return 0;
+				}
+
+				position += length;
+				anchor = position;
+				misses = 0;
+				continue;
+			}
+
+			// skip faster through data which doesn't compress
+			position += 1 + (misses++ >> 6);
+		}
+
+		output = pack_lz_write_sequence(output, output_end, input + anchor, source_size - anchor, 0, 0);
+		if (!output)
+		{
+			return 0;
+		}
+
+		return static_cast<size_t>(output - static_cast<uint8_t*>(destination));
+	} // pack_format_compress
+
+	bool pack_format_decompress(const void* source, size_t source_size, void* destination, size_t destination_size)
+	{
+		using namespace detail;
+
+		const uint8_t* input = static_cast<const uint8_t*>(source);
+		const uint8_t* input_end = input + source_size;
+		uint8_t* output = static_cast<uint8_t*>(destination);
+		uint8_t* output_end = output + destination_size;
+
+		for (;;)
+		{
+			if (input >= input_end)
+			{
+				return false;
+			}
+
+			const uint8_t token = *input++;
+			const size_t literal_length = pack_lz_read_length(input, input_end, token >> 4);
+			if ((literal_length > static_cast<size_t>(input_end - input)) ||
+				(literal_length > static_cast<size_t>(output_end - output)))
+			{
+				return false;
+			}
+
+			memcpy(output, input, literal_length);
+			input += literal_length;
+			output += literal_length;
+
+			// the last sequence has no match
+			if (input == input_end)
+			{
+				break;
+			}
+
+			if ((input_end - input) < 2)
+			{
+				return false;
+			}
+
+			const size_t offset = static_cast<size_t>(input[0]) | (static_cast<size_t>(input[1]) << 8);
+			input += 2;
+			if ((offset == 0) || (offset > static_cast<size_t>(output - static_cast<uint8_t*>(destination))))
+			{
+				return false;
+			}
+
+			size_t match_length = pack_lz_read_length(input, input_end, token & 15);
+			if (match_length == SIZE_MAX)
+			{
+				return false;
+			}
+
+			match_length += PACK_LZ_MIN_MATCH;
+			if (match_length > static_cast<size_t>(output_end - output))
+			{
+				return false;
+			}
+
+			// matches may overlap the bytes they produce
+			const uint8_t* match = output - offset;
+			if (offset >= match_length)
+			{
+				memcpy(output, match, match_length);
+				output += match_length;
+			}
+			else
+			{
+				for (size_t index = 0; index < match_length; ++index)
+				{
+					*output++ = *match++;
+				}
+			}
+		}
+
+		return (output == output_end);
+	} // pack_format_decompress
+
+	bool pack_format_write(PackFormatWriteState& state, const PackFormatSource* sources, size_t total_sources)
+	{
+		using namespace detail;
+
+		gemini::Allocator& allocator = *state.allocator;
+		Array<unsigned char>& output = *state.output;
+		state.total_compressed = 0;
+
+		Array<PackFormatEntry> entries(allocator);
+		Array<char> paths(allocator);
+		Array<uint32_t> order(allocator);
+		entries.resize(total_sources);
+		order.resize(total_sources);
+
+		for (size_t index = 0; index < total_sources; ++index)
+		{
+			char normalized[MAX_PATH_SIZE];
+			const size_t length = pack_format_normalize_path(normalized, MAX_PATH_SIZE, sources[index].path);
+			if (length == 0)
+			{
+				LOGE("Invalid pack path: \"%s\"\n", sources[index].path);
+				return false;
+			}
+
+			PackFormatEntry& entry = entries[index];
+			memset(&entry, 0, sizeof(PackFormatEntry));
+			entry.path_hash = core::util::hash_32bit(normalized, length, 0);
+			entry.path_offset = static_cast<uint32_t>(paths.size());
+			entry.original_size = sources[index].size;
+			for (size_t character = 0; character <= length; ++character)
+			{
+				paths.push_back(normalized[character]);
+			}
+
+			order[index] = static_cast<uint32_t>(index);
+		}
+
+		PackFormatPathOrder path_order;
+		path_order.entries = &entries;
+		path_order.paths = &paths;
+		if (!order.empty())
+		{
+			std::sort(&order[0], &order[0] + order.size(), path_order);
+		}
+
+		for (size_t index = 1; index < total_sources; ++index)
+		{
+			if (!path_order(order[index - 1], order[index]))
+			{
+				LOGE("Duplicate pack path: \"%s\"\n", &paths[entries[order[index]].path_offset]);
+				return false;
+			}
+		}
+
+		const uint64_t entries_offset = pack_format_align(sizeof(PackFormatHeader));
+		const uint64_t paths_offset = entries_offset + (total_sources * sizeof(PackFormatEntry));
+		output.clear();
+		output.resize(static_cast<size_t>(paths_offset + paths.size()), 0);
+
+		Array<unsigned char> compressed(allocator);
+		for (size_t index = 0; index < total_sources; ++index)
+		{
+			const PackFormatSource& source = sources[order[index]];
+			PackFormatEntry& entry = entries[order[index]];
+
+			const void* data = source.data;
+			entry.size = source.size;
+
+			if ((state.flags & PackFormatWrite_Compress) && (source.size >= PACK_FORMAT_MIN_COMPRESS_SIZE))
+			{
+				compressed.resize(pack_format_compress_bound(source.size));
+				const size_t compressed_size = pack_format_compress(source.data, source.size, &compressed[0], compressed.size());
+				if ((compressed_size > 0) && (compressed_size <= (source.size - (source.size / 8))))
+				{
+					data = &compressed[0];
+					entry.size = compressed_size;
+					entry.flags |= PackFormatEntry_Compressed;
+					++state.total_compressed;
+				}
+			}
+
+			entry.offset = pack_format_align(output.size());
+			output.resize(static_cast<size_t>(entry.offset + entry.size), 0);
+			if (entry.size > 0)
+			{
+				memcpy(&output[static_cast<size_t>(entry.offset)], data, static_cast<size_t>(entry.size));
+			}
+		}
+
+		PackFormatHeader header;
+		memset(&header, 0, sizeof(PackFormatHeader));
+		header.magic = PACK_FORMAT_MAGIC;
+		header.version = PACK_FORMAT_VERSION;
+		header.total_entries = static_cast<uint32_t>(total_sources);
+		header.file_size = output.size();
+		header.entries_offset = entries_offset;
+		header.paths_offset = paths_offset;
+		header.paths_size = paths.size();
+		memcpy(&output[0], &header, sizeof(PackFormatHeader));
+
+		for (size_t index = 0; index < total_sources; ++index)
+		{
+			memcpy(&output[static_cast<size_t>(entries_offset + (index * sizeof(PackFormatEntry)))], &entries[order[index]], sizeof(PackFormatEntry));
+		}
+
+		if (!paths.empty())
+		{
+			memcpy(&output[static_cast<size_t>(paths_offset)], &paths[0], paths.size());
+		}
+
+		return true;
+	} // pack_format_write
+} // namespace gemini
@@ -0,0 +1,154 @@
+// -------------------------------------------------------------
+// Copyright (C) 2017- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#pragma once
+
+#include <core/array.h>
+#include <core/typedefs.h>
+
+namespace gemini
+{
+	// Content pack.
+	// asset_compiler writes these from a list of content files. At runtime
+	// the pack is mapped read-only by PackFileSystem; uncompressed entries
+	// are used in place and compressed entries are decoded straight into
+	// the caller's buffer.
+	//
+	// Entries are sorted by path_hash so lookups are a binary search over
+	// the entry table. Entry data is aligned to PACK_FORMAT_ALIGNMENT; mapped
+	// views of packed mesh containers keep their section alignment.
+	const uint32_t PACK_FORMAT_MAGIC = 0x4b434150; // "PACK"
+	const uint32_t PACK_FORMAT_VERSION = 1;
+	const uint32_t PACK_FORMAT_ALIGNMENT = 16;
+
+	#define PACK_FORMAT_EXTENSION ".pack"
+
+	enum PackFormatEntryFlags
+	{
+		// data is an LZ4 block; see pack_format_decompress
+		PackFormatEntry_Compressed = (1 << 0)
+	}; // PackFormatEntryFlags
+
+	struct PackFormatEntry
+	{
+		// pack_format_hash_path of the entry's path
+		uint32_t path_hash;
+
+		// offset of the null terminated path into the path table
+		uint32_t path_offset;
+
+		uint32_t flags;
+		uint32_t reserved;
+
+		// data offset relative to the start of the file
+		uint64_t offset;
+
+		// size of the data stored in the pack
+		uint64_t size;
+
+		// size of the data once decompressed; equals size if uncompressed.
+		uint64_t original_size;
+	}; // PackFormatEntry
+
+	struct PackFormatHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t total_entries;
+		uint32_t reserved;
+
+		uint64_t file_size;
+
+		// PackFormatEntry; sorted by path_hash
+		uint64_t entries_offset;
+
+		// null terminated, normalized paths
+		uint64_t paths_offset;
+		uint64_t paths_size;
+	}; // PackFormatHeader
+
+	// Hash a content relative path. Backslashes are treated as forward
+	// slashes and a leading "./" or "/" is ignored.
+	uint32_t pack_format_hash_path(const char* path);
+
+	// Validates a pack and each of its entries.
+	// @returns The header if data is a valid pack of this version,
+	// otherwise nullptr.
+	const PackFormatHeader* pack_format_header(const void* data, size_t data_size);
+
+	// @returns The entry for path or nullptr if it isn't in the pack.
+	const PackFormatEntry* pack_format_find(const PackFormatHeader* header, const char* path);
+
+	const char* pack_format_entry_path(const PackFormatHeader* header, const PackFormatEntry* entry);
+	const void* pack_format_entry_data(const PackFormatHeader* header, const PackFormatEntry* entry);
+
+	// Copy or decompress an entry into destination.
+	// destination_size must equal the entry's original_size.
+	bool pack_format_read_entry(const PackFormatHeader* header, const PackFormatEntry* entry, void* destination, size_t destination_size);
+
+	// LZ4 block compression.
+	// @returns The compressed size; or 0 if the output would not fit in
+	// destination_size. pack_format_compress_bound(source_size) is always
+	// enough to hold the output.
+	size_t pack_format_compress(const void* source, size_t source_size, void* destination, size_t destination_size);
+	size_t pack_format_compress_bound(size_t source_size);
+
+	// Decompress an LZ4 block. Malformed input is rejected.
+	// @returns true if exactly destination_size bytes were decoded.
+	bool pack_format_decompress(const void* source, size_t source_size, void* destination, size_t destination_size);
+
+	enum PackFormatWriteFlags
+	{
+		// compress entries which shrink by at least one eighth
+		PackFormatWrite_Compress = (1 << 0)
+	}; // PackFormatWriteFlags
+
+	struct PackFormatSource
+	{
+		// content relative path
+		const char* path;
+
+		const void* data;
+		size_t size;
+	}; // PackFormatSource
+
+	struct PackFormatWriteState
+	{
+		// used for temporary storage while writing
+		gemini::Allocator* allocator;
+
+		// receives the pack
+		Array<unsigned char>* output;
+
+		// PackFormatWriteFlags
+		uint32_t flags;
+
+		// number of entries stored compressed
+		uint32_t total_compressed;
+	}; // PackFormatWriteState
+
+	// Write a pack containing sources.
+	// @returns false if a path is empty or appears more than once.
+	bool pack_format_write(PackFormatWriteState& state, const PackFormatSource* sources, size_t total_sources);
+} // namespace gemini
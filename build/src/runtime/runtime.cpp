@@ -39,7 +39,7 @@
 
 #include <renderer/renderer.h>
 
-#include "filesystem_interface.h"
+#include "pack_filesystem.h"
 
 #include <rapid/rapid.h>
 
@@ -108,7 +108,7 @@ namespace gemini
 		LOGV("content_path: %s\n", content_path());
 
 		// create file system instance
-		core::filesystem::IFileSystem* filesystem = MEMORY2_NEW(detail::_state->allocator, core::filesystem::FileSystemInterface);
+		core::filesystem::PackFileSystem* filesystem = MEMORY2_NEW(detail::_state->allocator, core::filesystem::PackFileSystem);
 		core::filesystem::set_instance(filesystem);
 		if (!filesystem)
 		{
@@ -128,6 +128,17 @@ namespace gemini
 			core::filesystem::instance()->user_application_directory(application_path);
 		}
 
+		// mount the content pack, if one was built for this content directory
+		platform::PathString pack_path = core::filesystem::instance()->content_directory();
+		pack_path.append(PATH_SEPARATOR_STRING);
+		pack_path.append(RUNTIME_CONTENT_PACK);
+		pack_path.normalize(PATH_SEPARATOR);
+		if (platform::fs_file_exists(pack_path()))
+		{
+			filesystem->mount(pack_path());
+			filesystem->loose_files_override((runtime_flags & RF_LOOSE_FILES_OVERRIDE) != 0);
+		}
+
 #if defined(PLATFORM_FILESYSTEM_SUPPORT)
 		if (runtime_flags & RF_SAVE_LOGS_TO_DISK)
 		{
@@ -72,6 +72,11 @@ namespace gemini
 		}
 	};
 
+	// Content pack mounted by runtime_startup when it's present in the
+	// content directory. Built by asset_compiler. Files read during the
+	// custom path setup (such as the application config) are always loose.
+	#define RUNTIME_CONTENT_PACK "content.pack"
+
 	enum RuntimeFlags
 	{
 		// core functionality
@@ -83,6 +88,10 @@ namespace gemini
 		// Initialize the window sub-system
 		RF_WINDOW_SYSTEM		= 8,
 
+		// Loose files in the content directory override files in the
+		// content pack (development builds).
+		RF_LOOSE_FILES_OVERRIDE	= 16,
+
 	};
 
 	// runtime startup sequence
@@ -46,7 +46,27 @@ namespace gemini
 		// nothing to do here -- image is created in load_asset only.
 	}
 
-	AssetLoadStatus TextureLibrary::load_asset(LoadState& state, platform::PathString& fullpath, void* /*parameters*/)
+	// Releases the decoded image passed from read_asset to finalize_asset.
+	static void texture_free_stream_data(TextureLibrary::LoadState& state)
+	{
+		image::Image* image = static_cast<image::Image*>(state.stream_data);
+		image::free_image(&image->pixels[0]);
+		image->pixels = 0;
+		MEMORY2_DELETE(*state.allocator, image);
+		state.stream_data = nullptr;
+	} // texture_free_stream_data
+
+	AssetLoadStatus TextureLibrary::load_asset(LoadState& state, platform::PathString& fullpath, void* parameters)
+	{
+		if (read_asset(state, fullpath, parameters) != AssetLoad_Success)
+		{
+			return AssetLoad_Failure;
+		}
+
+		return finalize_asset(state, fullpath, parameters);
+	}
+
+	AssetLoadStatus TextureLibrary::read_asset(LoadState& state, platform::PathString& fullpath, void* /*parameters*/)
 	{
 		LOGV("loading texture \"%s\"\n", fullpath());
 
@@ -60,23 +80,18 @@ namespace gemini
 		core::filesystem::instance()->virtual_load_file(buffer, asset_uri());
 		if (!buffer.empty())
 		{
-			image::Image image(*state.allocator);
-			unsigned char* pixels = image::load_image_from_memory(&buffer[0], buffer.size(), &image.width, &image.height, &image.channels);
+			image::Image* image = MEMORY2_NEW(*state.allocator, image::Image)(*state.allocator);
+			unsigned char* pixels = image::load_image_from_memory(&buffer[0], buffer.size(), &image->width, &image->height, &image->channels);
 			if (pixels)
 			{
-				image.pixels = pixels;
-				image.filter = image::FILTER_LINEAR;
-
-				state.asset = device->create_texture(image);
-
-				LOGV("Loaded texture \"%s\"; (%i x %i @ %ibpp)\n", asset_uri(), image.width, image.height, image.channels);
-
-				image::free_image(pixels);
-				image.pixels = 0;
+				image->pixels = pixels;
+				image->filter = image::FILTER_LINEAR;
+				state.stream_data = image;
 				return AssetLoad_Success;
 			}
 			else
 			{
+				MEMORY2_DELETE(*state.allocator, image);
 				LOGE("Unable to load image %s\n", asset_uri());
 			}
 		}
@@ -88,8 +103,28 @@ namespace gemini
 		return AssetLoad_Failure;
 	}
 
+	AssetLoadStatus TextureLibrary::finalize_asset(LoadState& state, platform::PathString& fullpath, void* /*parameters*/)
+	{
+		image::Image* image = static_cast<image::Image*>(state.stream_data);
+		assert(image);
+
+		state.asset = device->create_texture(*image);
+		LOGV("Loaded texture \"%s\"; (%i x %i @ %ibpp)\n", fullpath(), image->width, image->height, image->channels);
+
+		texture_free_stream_data(state);
+		return AssetLoad_Success;
+	}
+
 	void TextureLibrary::destroy_asset(LoadState& state)
 	{
-		device->destroy_texture(state.asset);
+		if (state.stream_data)
+		{
+			texture_free_stream_data(state);
+		}
+
+		if (state.asset)
+		{
+			device->destroy_texture(state.asset);
+		}
 	}
 } // namespace gemini
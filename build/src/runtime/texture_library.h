@@ -52,6 +52,12 @@ namespace gemini
 		AssetLoadStatus load_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
 		void destroy_asset(LoadState& state);
 
+		// read and decode the image
+		AssetLoadStatus read_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
+
+		// create the texture from the decoded image
+		AssetLoadStatus finalize_asset(LoadState& state, platform::PathString& fullpath, void* parameters);
+
 	protected:
 		render2::Device* device;
 	}; // TextureLibrary
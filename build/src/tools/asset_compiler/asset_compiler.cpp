@@ -23,11 +23,17 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // -------------------------------------------------------------
 #include <core/argumentparser.h>
+#include <core/array.h>
 #include <core/core.h>
 #include <core/logging.h>
+#include <core/mem.h>
 #include <core/stackstring.h>
+#include <core/str.h>
 #include <core/typedefs.h>
 
+#include <runtime/configloader.h>
+#include <runtime/mesh_format.h>
+#include <runtime/pack_format.h>
 #include <runtime/runtime.h>
 
 enum AssetCompilerError
@@ -46,9 +52,195 @@ struct AssetCompilerSettings
 	platform::PathString source;
 	platform::PathString destination;
 	core::StackString<64> target_platform;
+	bool compress;
 };
 
-void asset_compiler_convert(AssetCompilerSettings* settings)
+bool asset_compiler_read_file(Array<unsigned char>& buffer, const char* path)
+{
+	platform::File handle = platform::fs_open(path, platform::FileMode_Read);
+	if (!handle.is_open())
+	{
+		return false;
+	}
+
+	platform::fs_seek(handle, 0, platform::FileSeek_End);
+	size_t file_size = static_cast<size_t>(platform::fs_tell(handle));
+	platform::fs_seek(handle, 0, platform::FileSeek_Begin);
+
+	buffer.resize(file_size, 0);
+	if (file_size > 0)
+	{
+		platform::fs_read(handle, &buffer[0], 1, file_size);
+	}
+	platform::fs_close(handle);
+	return true;
+}
+
+bool asset_compiler_write_file(const char* path, Array<unsigned char>& buffer)
+{
+	platform::File handle = platform::fs_open(path, platform::FileMode_Write);
+	if (!handle.is_open())
+	{
+		return false;
+	}
+
+	platform::fs_write(handle, &buffer[0], 1, buffer.size());
+	platform::fs_close(handle);
+	return true;
+}
+
+// Compile a JSON .model into a mesh container (runtime/mesh_format.h)
+// If the destination is a directory, <model name>.mesh is written there.
+int asset_compiler_compile_mesh(AssetCompilerSettings* settings)
+{
+	platform::PathString destination = settings->destination;
+	if (platform::fs_directory_exists(destination()))
+	{
+		platform::PathString basename = settings->source.basename();
+		basename.remove_extension();
+		destination.append(PATH_SEPARATOR_STRING);
+		destination.append(basename);
+		destination.append(MESH_FORMAT_EXTENSION);
+	}
+
+	gemini::Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+	int result = AssetCompilerError_Generic;
+	{
+		Array<unsigned char> source(allocator);
+		Array<unsigned char> output(allocator);
+
+		if (!asset_compiler_read_file(source, settings->source()) || source.empty())
+		{
+			LOGE("Unable to read \"%s\"\n", settings->source());
+			return AssetCompilerError_Generic;
+		}
+
+		MeshFormatCompileState state;
+		state.allocator = &allocator;
+		state.output = &output;
+		const char* json_data = reinterpret_cast<const char*>(&source[0]);
+		if (!core::util::parse_json_string_with_callback(json_data, source.size(), mesh_format_compile_json, &state))
+		{
+			LOGE("Unable to compile \"%s\"\n", settings->source());
+		}
+		else if (!asset_compiler_write_file(destination(), output))
+		{
+			LOGE("Unable to write \"%s\"\n", destination());
+		}
+		else
+		{
+			const MeshFormatHeader* header = reinterpret_cast<const MeshFormatHeader*>(&output[0]);
+			LOGV("wrote \"%s\" (vertices: %i, indices: %i, joints: %i, bytes: %i)\n",
+				destination(),
+				header->total_vertices,
+				header->total_indices,
+				header->total_joints,
+				header->file_size);
+			result = AssetCompilerError_None;
+		}
+	}
+
+	return result;
+}
+
+// Build a content pack (runtime/pack_format.h) from a manifest.
+// Each line of the manifest is a file path relative to the manifest's
+// directory; blank lines and lines starting with '#' are skipped.
+int asset_compiler_build_pack(AssetCompilerSettings* settings)
+{
+	gemini::Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+	int result = AssetCompilerError_Generic;
+	{
+		Array<unsigned char> manifest(allocator);
+		if (!asset_compiler_read_file(manifest, settings->source()))
+		{
+			LOGE("Unable to read \"%s\"\n", settings->source());
+			return AssetCompilerError_Generic;
+		}
+
+		const std::string manifest_data(manifest.empty() ? "" : reinterpret_cast<const char*>(&manifest[0]), manifest.size());
+		std::vector<std::string> paths;
+		std::vector<std::string> lines = core::str::split(manifest_data, "\n");
+		for (size_t index = 0; index < lines.size(); ++index)
+		{
+			std::string line = core::str::trim_left(lines[index], "\t ");
+			line.erase(line.find_last_not_of("\t\r ") + 1);
+			if (!line.empty() && line[0] != '#')
+			{
+				paths.push_back(line);
+			}
+		}
+
+		platform::PathString content_root = settings->source.dirname();
+
+		// sources reference these buffers; which must outlive the write.
+		std::vector<Array<unsigned char>*> contents;
+		Array<PackFormatSource> sources(allocator);
+		size_t total_bytes = 0;
+		bool read_all = true;
+		for (size_t index = 0; index < paths.size(); ++index)
+		{
+			platform::PathString fullpath = content_root;
+			fullpath.append(PATH_SEPARATOR_STRING);
+			fullpath.append(paths[index].c_str());
+			fullpath.normalize(PATH_SEPARATOR);
+
+			Array<unsigned char>* data = MEMORY2_NEW(allocator, Array<unsigned char>)(allocator);
+			contents.push_back(data);
+			if (!asset_compiler_read_file(*data, fullpath()))
+			{
+				LOGE("Unable to read \"%s\"\n", fullpath());
+				read_all = false;
+				break;
+			}
+
+			PackFormatSource source;
+			source.path = paths[index].c_str();
+			source.data = data->empty() ? nullptr : &(*data)[0];
+			source.size = data->size();
+			sources.push_back(source);
+			total_bytes += source.size;
+		}
+
+		Array<unsigned char> output(allocator);
+		PackFormatWriteState state;
+		state.allocator = &allocator;
+		state.output = &output;
+		state.flags = settings->compress ? PackFormatWrite_Compress : 0;
+		state.total_compressed = 0;
+
+		if (read_all)
+		{
+			if (!pack_format_write(state, sources.empty() ? nullptr : &sources[0], sources.size()))
+			{
+				LOGE("Unable to build pack from \"%s\"\n", settings->source());
+			}
+			else if (!asset_compiler_write_file(settings->destination(), output))
+			{
+				LOGE("Unable to write \"%s\"\n", settings->destination());
+			}
+			else
+			{
+				LOGV("wrote \"%s\" (entries: %i, compressed: %i, source bytes: %lu, bytes: %lu)\n",
+					settings->destination(),
+					static_cast<int>(sources.size()),
+					state.total_compressed,
+					(unsigned long)total_bytes,
+					(unsigned long)output.size());
+				result = AssetCompilerError_None;
+			}
+		}
+
+		for (size_t index = 0; index < contents.size(); ++index)
+		{
+			MEMORY2_DELETE(allocator, contents[index]);
+		}
+	}
+
+	return result;
+}
+
+int asset_compiler_convert(AssetCompilerSettings* settings)
 {
 	LOGV("source_asset_path = %s\n", settings->source());
 	LOGV("destination_asset_path = %s\n", settings->destination());
@@ -57,6 +249,19 @@ void asset_compiler_convert(AssetCompilerSettings* settings)
 	{
 		LOGV("target platform = %s\n", settings->target_platform());
 	}
+
+	const char* extension = settings->source.extension();
+	if (core::str::case_insensitive_compare(extension, "model", 0) == 0)
+	{
+		return asset_compiler_compile_mesh(settings);
+	}
+	else if (core::str::case_insensitive_compare(extension, "manifest", 0) == 0)
+	{
+		return asset_compiler_build_pack(settings);
+	}
+
+	LOGE("No compiler for asset type: \"%s\"\n", extension);
+	return AssetCompilerError_Generic;
 }
 
 
@@ -78,13 +283,14 @@ int asset_compiler_main()
 	core::argparse::VariableMap vm;
 	const char* docstring = R"(
 Usage:
-	[--platform <platform>] <source_asset_path> <destination_asset_path>
+	[--platform <platform>] [--compress] <source_asset_path> <destination_asset_path>
 
 
 Options:
 	-h, --help				Show this help screen
 	--version				Display the version number
 	--platform <platform>	Target platform: [windows, linux, macosx, ios, android, raspberrypi]
+	--compress				Compress entries when building a pack from a .manifest
 	)";
 
 	if (!parser.parse(docstring, arguments, vm, "1.0.0-alpha"))
@@ -100,10 +306,11 @@ Options:
 	settings.source = source_asset_path.c_str();
 	settings.destination = destination_asset_path.c_str();
 	settings.target_platform = target_platform.c_str();
-	asset_compiler_convert(&settings);
+	settings.compress = (vm["--compress"] == "true");
+	int error = asset_compiler_convert(&settings);
 
 	core_shutdown();
-	return AssetCompilerError_None;
+	return error;
 }
 
 PLATFORM_MAIN
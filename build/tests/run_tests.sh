@@ -16,4 +16,5 @@ execute_test()
 execute_test test_core
 execute_test test_platform
 execute_test test_runtime
+execute_test test_engine
 execute_test test_render --assets="../assets"
\ No newline at end of file
@@ -739,6 +739,77 @@ UNITTEST(memory_allocator_linear)
 	MEMORY2_DELETE_ARRAY(s2, items2);
 }
 
+UNITTEST(memory_allocator_frame)
+{
+	Allocator frame = memory_allocator_frame(MEMORY_ZONE_DEFAULT);
+
+	// 1. Allocations are aligned and don't overlap.
+	AlignedStructTest* first = MEMORY2_NEW(frame, AlignedStructTest);
+	AlignedStructTest* second = MEMORY2_NEW(frame, AlignedStructTest);
+	TEST_ASSERT_TRUE(memory_is_aligned(first, 16));
+	TEST_ASSERT_TRUE(memory_is_aligned(second, 16));
+	TEST_ASSERT_TRUE(second >= first + 1);
+	MEMORY2_DELETE(frame, first);
+
+	// 2. Memory survives the next frame, then is recycled.
+	int* values = MEMORY2_NEW_ARRAY(frame, int, 16);
+	values[15] = 42;
+	memory_frame_advance();
+	int* next_values = MEMORY2_NEW_ARRAY(frame, int, 16);
+	TEST_ASSERT_TRUE(next_values != values);
+	TEST_ASSERT_EQUALS(values[15], 42);
+	memory_frame_advance();
+	int* recycled = static_cast<int*>(MEMORY2_ALLOC(frame, sizeof(int)));
+	TEST_ASSERT_TRUE(reinterpret_cast<void*>(recycled) <= reinterpret_cast<void*>(first));
+
+	// 3. Requests larger than the arena spill to the heap.
+	char* large = static_cast<char*>(MEMORY2_ALLOC(frame, MEMORY_FRAME_ARENA_SIZE + 1));
+	TEST_ASSERT_TRUE(large != nullptr);
+	large[MEMORY_FRAME_ARENA_SIZE] = 1;
+
+	// 4. Frame allocations are reported once the frame completes.
+	memory_frame_advance();
+	ZoneStats* stats = memory_zone_tracking_stats();
+	TEST_ASSERT_EQUALS(stats[MEMORY_ZONE_DEFAULT].last_frame_allocations, 2);
+	TEST_ASSERT_TRUE(stats[MEMORY_ZONE_DEFAULT].last_frame_peak_bytes >= MEMORY_FRAME_ARENA_SIZE + sizeof(int) + 1);
+}
+
+UNITTEST(memory_allocator_pool)
+{
+	const size_t total_elements = 4;
+	Allocator sa = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+	const size_t pool_size = memory_pool_size(sizeof(AlignedStructTest), alignof(AlignedStructTest), total_elements);
+	void* memory = MEMORY2_ALLOC_ALIGNED(sa, alignof(AlignedStructTest), pool_size);
+	Allocator pool = memory_allocator_pool(MEMORY_ZONE_DEFAULT, memory, pool_size, sizeof(AlignedStructTest), alignof(AlignedStructTest));
+
+	// 1. Every element is unique and aligned.
+	AlignedStructTest* items[total_elements];
+	for (size_t index = 0; index < total_elements; ++index)
+	{
+		items[index] = MEMORY2_NEW(pool, AlignedStructTest);
+		TEST_ASSERT_TRUE(memory_is_aligned(items[index], 16));
+		TEST_ASSERT_TRUE(index == 0 || items[index] != items[index - 1]);
+	}
+
+	// 2. An exhausted pool falls back to the heap.
+	AlignedStructTest* overflow = MEMORY2_NEW(pool, AlignedStructTest);
+	TEST_ASSERT_TRUE(overflow != nullptr);
+	TEST_ASSERT_TRUE(memory_is_aligned(overflow, 16));
+	MEMORY2_DELETE(pool, overflow);
+
+	// 3. Freed elements are reused.
+	MEMORY2_DELETE(pool, items[2]);
+	AlignedStructTest* reused = MEMORY2_NEW(pool, AlignedStructTest);
+	TEST_ASSERT_TRUE(reused == items[2]);
+	items[2] = reused;
+
+	for (size_t index = 0; index < total_elements; ++index)
+	{
+		MEMORY2_DELETE(pool, items[index]);
+	}
+	MEMORY2_DEALLOC(sa, memory);
+}
+
 
 UNITTEST(memory_alignment)
 {
@@ -0,0 +1,333 @@
+// -------------------------------------------------------------
+// Copyright (C) 2015- Adam Petrone
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//		* Redistributions of source code must retain the above copyright notice,
+//		this list of conditions and the following disclaimer.
+
+//		* Redistributions in binary form must reproduce the above copyright notice,
+//		this list of conditions and the following disclaimer in the documentation
+//		and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//		 SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -------------------------------------------------------------
+#include "unit_test.h"
+
+#include <core/core.h>
+#include <core/logging.h>
+#include <core/mathlib.h>
+#include <core/mem.h>
+
+#include <runtime/job_scheduler.h>
+#include <runtime/runtime.h>
+
+#include <engine/game/particlesystem.h>
+
+#include <stdlib.h> // for qsort
+#include <string.h>
+
+using namespace gemini;
+
+// ---------------------------------------------------------------------
+// particles
+// ---------------------------------------------------------------------
+struct ReferenceParticle
+{
+	float velocity[3];
+	float position[3];
+	float life;
+};
+
+// order by velocity; which is random and never changes
+int reference_particle_compare(const void* first, const void* second)
+{
+	const ReferenceParticle* a = static_cast<const ReferenceParticle*>(first);
+	const ReferenceParticle* b = static_cast<const ReferenceParticle*>(second);
+	for (uint32_t component = 0; component < 3; ++component)
+	{
+		if (a->velocity[component] != b->velocity[component])
+		{
+			return (a->velocity[component] < b->velocity[component]) ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+ReferenceParticle reference_particle_from_emitter(const ParticleEmitter& emitter, uint32_t index)
+{
+	const ParticleStreams& streams = emitter.streams;
+	ReferenceParticle particle;
+	particle.velocity[0] = streams.velocity_x[index];
+	particle.velocity[1] = streams.velocity_y[index];
+	particle.velocity[2] = streams.velocity_z[index];
+	particle.position[0] = streams.position_x[index];
+	particle.position[1] = streams.position_y[index];
+	particle.position[2] = streams.position_z[index];
+	particle.life = streams.life_remaining[index];
+	return particle;
+}
+
+bool particle_streams_equal(const ParticleEmitter& first, const ParticleEmitter& second)
+{
+	if (first.num_particles_alive != second.num_particles_alive)
+	{
+		return false;
+	}
+
+	const size_t float_bytes = sizeof(float) * first.num_particles_alive;
+	return (memcmp(first.streams.position_x, second.streams.position_x, float_bytes) == 0)
+		&& (memcmp(first.streams.position_y, second.streams.position_y, float_bytes) == 0)
+		&& (memcmp(first.streams.position_z, second.streams.position_z, float_bytes) == 0)
+		&& (memcmp(first.streams.velocity_x, second.streams.velocity_x, float_bytes) == 0)
+		&& (memcmp(first.streams.velocity_y, second.streams.velocity_y, float_bytes) == 0)
+		&& (memcmp(first.streams.velocity_z, second.streams.velocity_z, float_bytes) == 0)
+		&& (memcmp(first.streams.life_remaining, second.streams.life_remaining, float_bytes) == 0)
+		&& (memcmp(first.streams.size, second.streams.size, float_bytes) == 0)
+		&& (memcmp(first.streams.color, second.streams.color, sizeof(uint32_t) * first.num_particles_alive) == 0);
+}
+
+UNITTEST(particles)
+{
+	gemini::Allocator allocator = gemini::memory_allocator_default(gemini::MEMORY_ZONE_DEFAULT);
+	const float delta_seconds = (1.0f / 60.0f);
+
+	// integrate and compact against a scalar reference
+	{
+		EmitterConfig config;
+		config.max_particles = 509;
+		config.spawn_rate = 37;
+		config.spawn_delay_seconds = 0.05f;
+		config.life_min = 0.1f;
+		config.life_max = 1.0f;
+		config.velocity_min = glm::vec3(-1.0f, 0.0f, -1.0f);
+		config.velocity_max = glm::vec3(1.0f, 4.0f, 1.0f);
+
+		ParticleEmitter emitter(allocator);
+		emitter.load_from_emitter_config(&config);
+		emitter.world_position = glm::vec3(1.0f, 2.0f, 3.0f);
+
+		Array<ReferenceParticle> reference(allocator);
+		Array<ReferenceParticle> simulated(allocator);
+		bool counts_match = true;
+		bool no_dead_particles = true;
+		bool values_match = true;
+		for (uint32_t frame = 0; frame < 120; ++frame)
+		{
+			emitter.integrate(delta_seconds, 0, emitter.num_particles_alive);
+			emitter.compact();
+
+			size_t total_alive = 0;
+			for (size_t index = 0; index < reference.size(); ++index)
+			{
+				ReferenceParticle particle = reference[index];
+				particle.life -= delta_seconds;
+				for (uint32_t component = 0; component < 3; ++component)
+				{
+					particle.position[component] += particle.velocity[component] * delta_seconds;
+				}
+
+				if (particle.life > 0.0f)
+				{
+					reference[total_alive++] = particle;
+				}
+			}
+			reference.resize(total_alive);
+
+			counts_match = counts_match && (emitter.num_particles_alive == reference.size());
+
+			simulated.resize(emitter.num_particles_alive);
+			for (uint32_t index = 0; index < emitter.num_particles_alive; ++index)
+			{
+				no_dead_particles = no_dead_particles && (emitter.streams.life_remaining[index] > 0.0f);
+				simulated[index] = reference_particle_from_emitter(emitter, index);
+			}
+
+			// compaction reorders particles; compare them by identity
+			if (counts_match && !reference.empty())
+			{
+				qsort(&reference[0], reference.size(), sizeof(ReferenceParticle), reference_particle_compare);
+				qsort(&simulated[0], simulated.size(), sizeof(ReferenceParticle), reference_particle_compare);
+				for (size_t index = 0; index < reference.size(); ++index)
+				{
+					const ReferenceParticle& expected = reference[index];
+					const ReferenceParticle& actual = simulated[index];
+					values_match = values_match
+						&& (reference_particle_compare(&expected, &actual) == 0)
+						&& (glm::abs(expected.life - actual.life) < 1e-5f)
+						&& (glm::abs(expected.position[0] - actual.position[0]) < 1e-4f)
+						&& (glm::abs(expected.position[1] - actual.position[1]) < 1e-4f)
+						&& (glm::abs(expected.position[2] - actual.position[2]) < 1e-4f);
+				}
+			}
+
+			// new particles are appended to the live range
+			const uint32_t first_spawned = emitter.num_particles_alive;
+			emitter.spawn(delta_seconds);
+			for (uint32_t index = first_spawned; index < emitter.num_particles_alive; ++index)
+			{
+				reference.push_back(reference_particle_from_emitter(emitter, index));
+			}
+		}
+
+		TEST_ASSERT_TRUE(counts_match);
+		TEST_ASSERT_TRUE(no_dead_particles);
+		TEST_ASSERT_TRUE(values_match);
+
+		// particles expire; the emitter stays within its limit
+		TEST_ASSERT_TRUE(emitter.num_particles_alive > 0);
+		TEST_ASSERT_TRUE(emitter.num_particles_alive <= config.max_particles);
+	}
+
+	// vertex output for a single particle
+	{
+		EmitterConfig config;
+		config.max_particles = 1;
+		config.spawn_rate = 1;
+		config.spawn_delay_seconds = 10.0f;
+		config.color_start = Color(1.0f, 0.0f, 1.0f, 1.0f);
+		config.color_end = config.color_start;
+		config.size_start = 2.0f;
+		config.size_end = 2.0f;
+
+		ParticleSystem system(allocator);
+		ParticleEmitter* emitter = system.add_emitter();
+		emitter->load_from_emitter_config(&config);
+		emitter->world_position = glm::vec3(1.0f, 2.0f, 3.0f);
+
+		// the first step spawns
+		system.step(0.0f);
+		TEST_ASSERT_EQUALS(system.total_particles(), 1);
+
+		ParticleVertex vertices[PARTICLE_VERTICES_PER_PARTICLE * 2];
+		memset(vertices, 0, sizeof(vertices));
+		const uint32_t total_written = system.write_vertices(vertices, 2, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		TEST_ASSERT_EQUALS(total_written, 1);
+
+		const float expected[PARTICLE_VERTICES_PER_PARTICLE][5] = {
+			{ -1.0f, 2.0f, 1.0f, 0.0f, 0.0f },
+			{ 3.0f, 2.0f, 1.0f, 1.0f, 0.0f },
+			{ 3.0f, 2.0f, 5.0f, 1.0f, 1.0f },
+			{ -1.0f, 2.0f, 5.0f, 0.0f, 1.0f }
+		};
+
+		bool vertices_match = true;
+		for (uint32_t index = 0; index < PARTICLE_VERTICES_PER_PARTICLE; ++index)
+		{
+			const ParticleVertex& vertex = vertices[index];
+			vertices_match = vertices_match
+				&& (vertex.x == expected[index][0])
+				&& (vertex.y == expected[index][1])
+				&& (vertex.z == expected[index][2])
+				&& (vertex.u == expected[index][3])
+				&& (vertex.v == expected[index][4])
+				&& (vertex.color == 0xffff00ff);
+		}
+		TEST_ASSERT_TRUE(vertices_match);
+
+		uint16_t indices[PARTICLE_INDICES_PER_PARTICLE];
+		particle_fill_indices(indices, 1);
+		TEST_ASSERT_EQUALS(indices[0], 0);
+		TEST_ASSERT_EQUALS(indices[2], 2);
+		TEST_ASSERT_EQUALS(indices[3], 2);
+		TEST_ASSERT_EQUALS(indices[5], 0);
+	}
+
+	// stepping on the job scheduler matches the serial step
+	{
+		gemini::JobScheduler scheduler(allocator);
+		scheduler.create_workers(3);
+
+		EmitterConfig configs[2];
+
+		// large enough to be split into several batches
+		configs[0].max_particles = (PARTICLE_JOB_BATCH_SIZE * 3) + 7;
+		configs[0].spawn_rate = 2049;
+		configs[0].spawn_delay_seconds = 0.0f;
+		configs[0].life_min = 0.05f;
+		configs[0].life_max = 0.5f;
+		configs[0].velocity_min = glm::vec3(-1.0f, 0.0f, -1.0f);
+		configs[0].velocity_max = glm::vec3(1.0f, 4.0f, 1.0f);
+		configs[0].size_end = 0.0f;
+		configs[0].color_end = Color(0.0f, 0.0f, 0.0f, 0.0f);
+
+		configs[1].max_particles = 61;
+		configs[1].spawn_rate = 5;
+		configs[1].spawn_delay_seconds = 0.02f;
+		configs[1].life_min = 0.1f;
+		configs[1].life_max = 0.3f;
+
+		ParticleSystem serial(allocator);
+		ParticleSystem threaded(allocator);
+		for (uint32_t index = 0; index < 2; ++index)
+		{
+			ParticleEmitter* emitters[] = { serial.add_emitter(), threaded.add_emitter() };
+			for (ParticleEmitter* emitter : emitters)
+			{
+				emitter->load_from_emitter_config(&configs[index]);
+				emitter->world_position = glm::vec3(static_cast<float>(index), 0.0f, 0.0f);
+				for (uint32_t lane = 0; lane < PARTICLE_GROUP_SIZE; ++lane)
+				{
+					emitter->random_state[lane] = (index * 7919) + (lane * 104729) + 1;
+				}
+			}
+		}
+
+		bool streams_match = true;
+		uint32_t most_particles = 0;
+		for (uint32_t frame = 0; frame < 30; ++frame)
+		{
+			serial.step(delta_seconds);
+			threaded.step(delta_seconds, &scheduler);
+			memory_frame_advance();
+
+			for (size_t index = 0; index < serial.emitters.size(); ++index)
+			{
+				streams_match = streams_match && particle_streams_equal(*serial.emitters[index], *threaded.emitters[index]);
+			}
+			most_particles = glm::max(most_particles, serial.emitters[0]->num_particles_alive);
+		}
+		TEST_ASSERT_TRUE(streams_match);
+		TEST_ASSERT_TRUE(most_particles > PARTICLE_JOB_BATCH_SIZE);
+
+		const uint32_t total_particles = serial.total_particles();
+		Array<ParticleVertex> serial_vertices(allocator);
+		Array<ParticleVertex> threaded_vertices(allocator);
+		serial_vertices.resize(total_particles * PARTICLE_VERTICES_PER_PARTICLE);
+		threaded_vertices.resize(total_particles * PARTICLE_VERTICES_PER_PARTICLE);
+
+		const glm::vec3 right(1.0f, 0.0f, 0.0f);
+		const glm::vec3 up(0.0f, 1.0f, 0.0f);
+		TEST_ASSERT_EQUALS(serial.write_vertices(&serial_vertices[0], total_particles, right, up), total_particles);
+		TEST_ASSERT_EQUALS(threaded.write_vertices(&threaded_vertices[0], total_particles, right, up, &scheduler), total_particles);
+		TEST_ASSERT_TRUE(memcmp(&serial_vertices[0], &threaded_vertices[0], sizeof(ParticleVertex) * serial_vertices.size()) == 0);
+		memory_frame_advance();
+		memory_frame_advance();
+
+		serial.purge();
+		threaded.purge();
+		scheduler.destroy_workers();
+	}
+}
+
+
+int main(int, char**)
+{
+	gemini::core_startup();
+	gemini::runtime_startup("arcfusion.net/gemini/test_engine");
+
+	unittest::UnitTest::execute();
+	gemini::runtime_shutdown();
+	gemini::core_shutdown();
+	return 0;
+}
@@ -42,6 +42,7 @@
 #include <renderer/vertexbuffer.h>
 
 #include <renderer/color.h>
+#include <renderer/rqueue.h>
 
 #include <assert.h>
 
@@ -72,6 +73,65 @@ UNITTEST(Color)
 	TEST_ASSERT(ubyte_color == ubyte_test, from_ubyte);
 }
 
+// ---------------------------------------------------------------------
+// RenderQueue
+// ---------------------------------------------------------------------
+UNITTEST(RenderQueue)
+{
+	using namespace renderer;
+
+	// opaque keys sort by state; then front-to-back
+	TEST_ASSERT(render_key_opaque(0, 0, 1, 100.0f) < render_key_opaque(0, 0, 2, 1.0f), opaque_material_before_depth);
+	TEST_ASSERT(render_key_opaque(0, 1, 0, 0.0f) > render_key_opaque(0, 0, 5, 50.0f), opaque_pipeline_before_material);
+	TEST_ASSERT(render_key_opaque(0, 0, 1, 1.0f) < render_key_opaque(0, 0, 1, 2.0f), opaque_front_to_back);
+	TEST_ASSERT(render_key_opaque(0, 0, 1, -5.0f) == render_key_opaque(0, 0, 1, 0.0f), negative_depth_clamped);
+
+	// translucent keys sort back-to-front; after all opaque keys
+	TEST_ASSERT(render_key_translucent(1, 0, 1, 10.0f) < render_key_translucent(1, 0, 1, 2.0f), translucent_back_to_front);
+	TEST_ASSERT(render_key_translucent(1, 0, 0, 10.0f) > render_key_opaque(0, 255, 1000, 1000.0f), pass_before_state);
+	TEST_ASSERT(render_key_pass(render_key_translucent(1, 3, 7, 1.0f)) == 1, pass_bits);
+
+	gemini::Allocator allocator = gemini::memory_allocator_default(gemini::MEMORY_ZONE_DEFAULT);
+	{
+		RenderQueue queue(allocator);
+		const uint32_t total_blocks = 1000;
+		for (uint32_t index = 0; index < total_blocks; ++index)
+		{
+			RenderBlock block;
+			block.key = render_key_opaque(0, index % 3, (index * 7) % 11, static_cast<float>((index * 37) % 101));
+			block.object = index;
+			block.geometry = 0;
+			queue.insert(block);
+		}
+		queue.sort();
+
+		bool is_sorted = true;
+		bool is_stable = true;
+		for (uint32_t index = 1; index < queue.size(); ++index)
+		{
+			const RenderBlock& previous = queue.render_list[index - 1];
+			const RenderBlock& current = queue.render_list[index];
+			is_sorted = is_sorted && (previous.key <= current.key);
+			is_stable = is_stable && ((previous.key != current.key) || (previous.object < current.object));
+		}
+		TEST_ASSERT(queue.size() == total_blocks, radix_sort_size);
+		TEST_ASSERT(is_sorted, radix_sort_order);
+		TEST_ASSERT(is_stable, radix_sort_stable);
+	}
+
+	// an orthographic box from -10 to 10 on each axis
+	glm::mat4 view_projection(1.0f);
+	view_projection[0][0] = view_projection[1][1] = view_projection[2][2] = 0.1f;
+	RenderFrustum frustum;
+	render_frustum_from_matrix(frustum, view_projection);
+
+	const glm::vec3 mins(-1.0f, -1.0f, -1.0f);
+	const glm::vec3 maxs(1.0f, 1.0f, 1.0f);
+	TEST_ASSERT(render_frustum_test_box(frustum, glm::mat4(1.0f), mins, maxs), box_inside);
+	TEST_ASSERT(render_frustum_test_box(frustum, glm::translate(glm::mat4(1.0f), glm::vec3(10.5f, 0.0f, 0.0f)), mins, maxs), box_intersecting);
+	TEST_ASSERT(!render_frustum_test_box(frustum, glm::translate(glm::mat4(1.0f), glm::vec3(12.0f, 0.0f, 0.0f)), mins, maxs), box_outside);
+}
+
 #define TEST_RENDER_GRAPHICS 1
 
 // ---------------------------------------------------------------------
@@ -26,17 +26,25 @@
 
 #include <core/core.h>
 #include <core/logging.h>
+#include <core/str.h>
 
 #include <platform/platform.h>
 
+#include <renderer/renderer.h>
+
+#include <runtime/animation.h>
 #include <runtime/asset_handle.h>
 #include <runtime/asset_library.h>
+#include <runtime/asset_streamer.h>
 #include <runtime/assets.h>
 #include <runtime/debug_event.h>
 #include <runtime/runtime.h>
 #include <runtime/filesystem.h>
 #include <runtime/jobqueue.h>
+#include <runtime/job_scheduler.h>
 #include <runtime/geometry.h>
+#include <runtime/mesh_format.h>
+#include <runtime/pack_format.h>
 #include <runtime/http.h>
 
 #include <assert.h>
@@ -58,8 +66,16 @@ struct CustomAsset
 class CustomAssetLibrary : public AssetLibrary2<CustomAsset, CustomAssetLibrary>
 {
 public:
+	// number of times read_asset was called; from any thread
+	volatile uint32_t total_reads;
+
+	// when non-zero, read_asset fails
+	volatile uint32_t fail_reads;
+
 	CustomAssetLibrary(Allocator& allocator)
 		: AssetLibrary2(allocator)
+		, total_reads(0)
+		, fail_reads(0)
 	{
 	}
 
@@ -73,6 +89,12 @@ public:
 		return true;
 	}
 
+	AssetLoadStatus read_asset(LoadState& state, platform::PathString& fullpath, void* parameters)
+	{
+		atom_increment32(&total_reads);
+		return fail_reads ? AssetLoad_Failure : AssetLoad_Success;
+	}
+
 	AssetLoadStatus load_asset(LoadState& state, const platform::PathString& fullpath, void* parameters)
 	{
 		state.asset->uri = fullpath;
@@ -114,6 +136,244 @@ UNITTEST(asset_library)
 	TEST_ASSERT_EQUALS(asset1->uri, fullpath);
 }
 
+UNITTEST(asset_streamer)
+{
+	Allocator allocator = memory_allocator_default(MEMORY_ZONE_ASSETS);
+
+	// no streaming threads: requests are read during finalize
+	AssetStreamer streamer(allocator);
+	streamer.create_workers(0);
+
+	CustomAssetLibrary lib(allocator);
+	CustomAsset default_asset;
+	default_asset.id = 42;
+	lib.default_asset(&default_asset);
+	lib.streamer(&streamer);
+
+	// handles resolve to the default asset until finalized
+	AssetHandle low = lib.load_async("low", 0);
+	AssetHandle high = lib.load_async("high", 10);
+	TEST_ASSERT_TRUE(lib.lookup(low) == &default_asset);
+	TEST_ASSERT_EQUALS(lib.status(high), AssetStatus_Loading);
+
+	// duplicate requests share a handle
+	TEST_ASSERT_TRUE(lib.load_async("low") == low);
+	TEST_ASSERT_EQUALS(streamer.pending(), 2);
+
+	AssetHandle cancelled = lib.load_async("cancelled");
+	lib.cancel(cancelled);
+	TEST_ASSERT_EQUALS(lib.status(cancelled), AssetStatus_Cancelled);
+
+	// a zero budget finalizes a single request; highest priority first
+	TEST_ASSERT_EQUALS(streamer.finalize(0.0f), 1);
+	TEST_ASSERT_EQUALS(lib.status(high), AssetStatus_Ready);
+	TEST_ASSERT_EQUALS(lib.status(low), AssetStatus_Loading);
+
+	streamer.flush();
+	TEST_ASSERT_EQUALS(streamer.pending(), 0);
+	TEST_ASSERT_EQUALS(lib.status(low), AssetStatus_Ready);
+	TEST_ASSERT_TRUE(lib.lookup(low) != &default_asset);
+	TEST_ASSERT_TRUE(lib.lookup(cancelled) == &default_asset);
+
+	// failed loads are retried by the next request
+	lib.fail_reads = 1;
+	AssetHandle failed = lib.load_async("failed");
+	streamer.flush();
+	TEST_ASSERT_EQUALS(lib.status(failed), AssetStatus_Failed);
+	TEST_ASSERT_TRUE(lib.load_async("failed") == failed);
+	TEST_ASSERT_EQUALS(lib.status(failed), AssetStatus_Loading);
+	lib.fail_reads = 0;
+	streamer.flush();
+	TEST_ASSERT_EQUALS(lib.status(failed), AssetStatus_Ready);
+	TEST_ASSERT_TRUE(lib.lookup(failed) != &default_asset);
+
+	lib.purge();
+	streamer.destroy_workers();
+}
+
+struct TestStreamRequest : public AssetStreamRequest
+{
+	uint32_t id;
+
+	// the read blocks until this is non-zero
+	volatile uint32_t* gate;
+
+	// written by the single streaming thread
+	Array<uint32_t>* read_order;
+};
+
+void test_stream_read(AssetStreamRequest* stream_request)
+{
+	TestStreamRequest* request = static_cast<TestStreamRequest*>(stream_request);
+	while (request->gate && (*request->gate == 0))
+	{
+		platform::thread_sleep(1);
+	}
+	request->read_order->push_back(request->id);
+}
+
+void test_stream_finalize(AssetStreamRequest* /*stream_request*/)
+{
+}
+
+UNITTEST(asset_streamer_threaded)
+{
+	Allocator allocator = memory_allocator_default(MEMORY_ZONE_ASSETS);
+
+	// a single streaming thread reads requests in priority order
+	{
+		AssetStreamer streamer(allocator);
+		streamer.create_workers(1);
+
+		volatile uint32_t gate = 0;
+		Array<uint32_t> read_order(allocator);
+
+		const int32_t priorities[] = { 100, 0, 5, 10, 5 };
+		const uint32_t TOTAL_REQUESTS = sizeof(priorities) / sizeof(priorities[0]);
+		TestStreamRequest requests[TOTAL_REQUESTS];
+		for (uint32_t index = 0; index < TOTAL_REQUESTS; ++index)
+		{
+			requests[index].read = test_stream_read;
+			requests[index].finalize = test_stream_finalize;
+			requests[index].priority = priorities[index];
+			requests[index].id = index;
+			requests[index].gate = (index == 0) ? &gate : nullptr;
+			requests[index].read_order = &read_order;
+		}
+
+		// hold the streaming thread on the first request while the
+		// others are queued behind it
+		streamer.submit(&requests[0]);
+		while (requests[0].state != AssetStream_Reading)
+		{
+			platform::thread_sleep(1);
+		}
+
+		for (uint32_t index = 1; index < TOTAL_REQUESTS; ++index)
+		{
+			streamer.submit(&requests[index]);
+		}
+		streamer.reprioritize(&requests[1], 20);
+		gate = 1;
+
+		streamer.flush();
+		TEST_ASSERT_EQUALS(read_order.size(), TOTAL_REQUESTS);
+
+		// equal priorities are read in submission order
+		const uint32_t expected_order[] = { 0, 1, 3, 2, 4 };
+		for (uint32_t index = 0; index < TOTAL_REQUESTS; ++index)
+		{
+			TEST_ASSERT_EQUALS(read_order[index], expected_order[index]);
+		}
+
+		streamer.destroy_workers();
+	}
+
+	// requests for an asset which is streaming are merged
+	{
+		AssetStreamer streamer(allocator);
+		streamer.create_workers(4);
+
+		CustomAssetLibrary lib(allocator);
+		CustomAsset default_asset;
+		default_asset.id = 42;
+		lib.default_asset(&default_asset);
+		lib.streamer(&streamer);
+
+		const uint32_t TOTAL_ASSETS = 16;
+		AssetHandle handles[TOTAL_ASSETS];
+		char name[32];
+		for (uint32_t index = 0; index < TOTAL_ASSETS; ++index)
+		{
+			core::str::sprintf(name, sizeof(name), "asset%u", index);
+			handles[index] = lib.load_async(name, 0);
+		}
+
+		// the second pass arrives while the first may still be reading
+		for (uint32_t index = 0; index < TOTAL_ASSETS; ++index)
+		{
+			core::str::sprintf(name, sizeof(name), "asset%u", index);
+			TEST_ASSERT_TRUE(lib.load_async(name, 10) == handles[index]);
+		}
+		TEST_ASSERT_TRUE(streamer.pending() <= TOTAL_ASSETS);
+
+		streamer.flush();
+		TEST_ASSERT_EQUALS(lib.total_reads, TOTAL_ASSETS);
+		for (uint32_t index = 0; index < TOTAL_ASSETS; ++index)
+		{
+			TEST_ASSERT_EQUALS(lib.status(handles[index]), AssetStatus_Ready);
+			TEST_ASSERT_TRUE(lib.lookup(handles[index]) != &default_asset);
+		}
+
+		lib.purge();
+		streamer.destroy_workers();
+	}
+}
+
+
+// ---------------------------------------------------------------------
+// animation
+// ---------------------------------------------------------------------
+UNITTEST(animation)
+{
+	using namespace animation;
+
+	Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+	animation::startup(allocator);
+
+	// two joints; key values are (channel * 10) + key
+	Sequence* sequence = MEMORY2_NEW(allocator, Sequence)(allocator);
+	sequence->name = "test_animation";
+	sequence->frame_delay_seconds = 0.5f;
+	sequence->duration_seconds = 2.0f;
+	sequence->animation_set.allocate(2 * ANIMATION_KEYFRAME_VALUES_MAX, KeyframeList(allocator));
+	for (size_t channel = 0; channel < sequence->animation_set.size(); ++channel)
+	{
+		KeyframeList& list = sequence->animation_set[channel];
+		list.allocate(5);
+		list.duration_seconds = sequence->duration_seconds;
+		for (uint32_t key = 0; key < 5; ++key)
+		{
+			list.set_key(key, key * 0.5f, static_cast<float>((channel * 10) + key));
+		}
+	}
+
+	SequenceId sequence_id = add_sequence(sequence);
+	TEST_ASSERT_TRUE(sequence->animation_set[0].uniform);
+	TEST_ASSERT_TRUE(sequence->samples != nullptr);
+
+	AnimatedInstance* instance = create_sequence_instance(allocator, sequence_id);
+
+	// halfway between the second and third keys
+	instance->local_time_seconds = 0.75f;
+	TEST_ASSERT_EQUALS(instance->channel_set[0].evaluate(0.75f, 0.5f), 1.5f);
+
+	Pose pose;
+	animated_instance_get_pose(instance, pose);
+	TEST_ASSERT_EQUALS(pose.pos[0].x, 1.5f);
+	TEST_ASSERT_EQUALS(pose.pos[1].z, 91.5f);
+	TEST_ASSERT_EQUALS(pose.rot[1].w, 131.5f);
+
+	// holds the last key
+	instance->local_time_seconds = 3.0f;
+	animated_instance_get_pose(instance, pose);
+	TEST_ASSERT_EQUALS(pose.pos[0].y, 14.0f);
+
+	// non-uniform keys are found by walking from the channel's cursor
+	KeyframeList list(allocator);
+	list.allocate(4);
+	list.duration_seconds = 1.0f;
+	list.set_key(0, 0.0f, 0.0f);
+	list.set_key(1, 0.1f, 1.0f);
+	list.set_key(2, 0.5f, 2.0f);
+	list.set_key(3, 1.0f, 3.0f);
+	list.compute_spacing(0.5f);
+	TEST_ASSERT_TRUE(!list.uniform);
+	TEST_ASSERT_EQUALS(list.find_key(0.75f, 0.5f, 0), 2);
+	TEST_ASSERT_EQUALS(list.find_key(0.05f, 0.5f, 2), 0);
+
+	animation::shutdown();
+}
 
 // ---------------------------------------------------------------------
 // geometry
@@ -250,6 +510,104 @@ UNITTEST(jobqueue)
 	jq.destroy_workers();
 }
 
+// ---------------------------------------------------------------------
+// job_scheduler
+// ---------------------------------------------------------------------
+struct JobSchedulerTestData
+{
+	gemini::JobScheduler* scheduler;
+	gemini::JobCounter* counter;
+	uint32_t values[1024];
+	volatile uint32_t total_executed;
+};
+
+void job_scheduler_increment(void* data)
+{
+	JobSchedulerTestData* test_data = static_cast<JobSchedulerTestData*>(data);
+	atom_increment32(&test_data->total_executed);
+}
+
+void job_scheduler_spawn(void* data)
+{
+	JobSchedulerTestData* test_data = static_cast<JobSchedulerTestData*>(data);
+	for (size_t index = 0; index < 8; ++index)
+	{
+		test_data->scheduler->push_back(job_scheduler_increment, test_data, test_data->counter);
+	}
+}
+
+void job_scheduler_fill(void* data, uint32_t start_index, uint32_t end_index)
+{
+	JobSchedulerTestData* test_data = static_cast<JobSchedulerTestData*>(data);
+	for (uint32_t index = start_index; index < end_index; ++index)
+	{
+		test_data->values[index] = index;
+	}
+}
+
+UNITTEST(job_scheduler)
+{
+	gemini::Allocator default_allocator = gemini::memory_allocator_default(gemini::MEMORY_ZONE_DEFAULT);
+	gemini::JobScheduler scheduler(default_allocator);
+	scheduler.create_workers(3);
+
+	JobSchedulerTestData test_data;
+	memset(&test_data, 0, sizeof(JobSchedulerTestData));
+	test_data.scheduler = &scheduler;
+
+	// more jobs than the initial deque capacity; including nested jobs
+	// which are counted by a child counter.
+	gemini::JobCounter parent;
+	gemini::JobCounter child(&parent);
+	test_data.counter = &child;
+	for (size_t index = 0; index < 512; ++index)
+	{
+		scheduler.push_back(job_scheduler_increment, &test_data, &parent);
+		scheduler.push_back(job_scheduler_spawn, &test_data, &parent);
+	}
+	scheduler.wait(&parent);
+	TEST_ASSERT_EQUALS(test_data.total_executed, 512 + (512 * 8));
+	TEST_ASSERT_EQUALS(child.pending, 0);
+
+	gemini::JobCounter range_counter;
+	scheduler.parallel_for(job_scheduler_fill, &test_data, 1024, 16, &range_counter);
+	scheduler.wait(&range_counter);
+	bool values_match = true;
+	for (uint32_t index = 0; index < 1024; ++index)
+	{
+		values_match = values_match && (test_data.values[index] == index);
+	}
+	TEST_ASSERT_TRUE(values_match);
+
+	// jobs without a counter
+	test_data.total_executed = 0;
+	for (size_t index = 0; index < 64; ++index)
+	{
+		scheduler.push_back(job_scheduler_increment, &test_data);
+	}
+	scheduler.wait_for_jobs_to_complete();
+	TEST_ASSERT_EQUALS(test_data.total_executed, 64);
+
+	// child counters on the stack with a parent; each one goes out of
+	// scope as soon as the wait returns.
+	test_data.total_executed = 0;
+	gemini::JobCounter frame_counter;
+	for (size_t frame = 0; frame < 256; ++frame)
+	{
+		gemini::JobCounter stack_counter(&frame_counter);
+		for (size_t index = 0; index < 4; ++index)
+		{
+			scheduler.push_back(job_scheduler_increment, &test_data, &stack_counter);
+		}
+		scheduler.wait(&stack_counter);
+	}
+	scheduler.wait(&frame_counter);
+	TEST_ASSERT_EQUALS(test_data.total_executed, 256 * 4);
+	TEST_ASSERT_EQUALS(frame_counter.pending, 0);
+
+	scheduler.destroy_workers();
+}
+
 // ---------------------------------------------------------------------
 // debug_event
 // ---------------------------------------------------------------------
@@ -279,6 +637,117 @@ UNITTEST(filesystem)
 	//	TEST_ASSERT(fs->get_absolute_path_for_content(absolute_path, "conf/shaders.conf") == false, get_absolute_path_for_content_missing);
 }
 
+UNITTEST(pack_format)
+{
+	Allocator allocator = memory_allocator_default(MEMORY_ZONE_DEFAULT);
+
+	std::string material;
+	for (uint32_t index = 0; index < 64; ++index)
+	{
+		material.append("{\"shader\": \"objects\", \"parameters\": []}\n");
+	}
+	const char shader[] = "void main() {}";
+
+	PackFormatSource sources[2];
+	sources[0].path = "materials/default.material";
+	sources[0].data = material.c_str();
+	sources[0].size = material.size();
+	sources[1].path = "./shaders\\120\\default.vert";
+	sources[1].data = shader;
+	sources[1].size = sizeof(shader);
+
+	Array<unsigned char> output(allocator);
+	PackFormatWriteState state;
+	state.allocator = &allocator;
+	state.output = &output;
+	state.flags = PackFormatWrite_Compress;
+	TEST_ASSERT_TRUE(pack_format_write(state, sources, 2));
+
+	// only the material shrinks enough to be compressed
+	TEST_ASSERT_EQUALS(state.total_compressed, 1);
+
+	const PackFormatHeader* header = pack_format_header(&output[0], output.size());
+	TEST_ASSERT_TRUE(header != nullptr);
+	TEST_ASSERT_TRUE(pack_format_header(&output[0], output.size() - 1) == nullptr);
+
+	const PackFormatEntry* entry = pack_format_find(header, "materials/default.material");
+	TEST_ASSERT_TRUE(entry != nullptr);
+	TEST_ASSERT_TRUE((entry->flags & PackFormatEntry_Compressed) != 0);
+	Array<char> data(allocator);
+	data.resize(material.size());
+	TEST_ASSERT_TRUE(pack_format_read_entry(header, entry, &data[0], data.size()));
+	TEST_ASSERT_TRUE(memcmp(&data[0], material.c_str(), material.size()) == 0);
+
+	// paths are stored normalized; uncompressed data is used in place
+	entry = pack_format_find(header, "shaders/120/default.vert");
+	TEST_ASSERT_TRUE(entry != nullptr);
+	TEST_ASSERT_EQUALS(entry->flags, 0);
+	TEST_ASSERT_TRUE(memcmp(pack_format_entry_data(header, entry), shader, sizeof(shader)) == 0);
+	TEST_ASSERT_TRUE(pack_format_find(header, "shaders/120/default.frag") == nullptr);
+
+	// duplicate paths are rejected
+	sources[0].path = "shaders/120/default.vert";
+	TEST_ASSERT_TRUE(!pack_format_write(state, sources, 2));
+}
+
+
+// ---------------------------------------------------------------------
+// mesh_format
+// ---------------------------------------------------------------------
+UNITTEST(mesh_format)
+{
+	const char model[] = "{\"children\": [{\"name\": \"quad\", \"type\": \"mesh\","
+		"\"vertices\": [[0, 0, 0], [1, 0, 0], [1, 1, 0], [0, 1, 0]],"
+		"\"normals\": [[0, 0, 1], [0, 0, 1], [0, 0, 1], [0, 0, 1]],"
+		"\"uv_sets\": [[[0, 0], [1, 0], [1, 1], [0, 1]]],"
+		"\"indices\": [0, 1, 2, 2, 3, 0]}]}";
+
+	gemini::Allocator default_allocator = gemini::memory_allocator_default(gemini::MEMORY_ZONE_DEFAULT);
+	Array<unsigned char> output(default_allocator);
+
+	gemini::MeshFormatCompileState state;
+	state.allocator = &default_allocator;
+	state.output = &output;
+	bool compiled = core::util::parse_json_string_with_callback(model, sizeof(model) - 1, gemini::mesh_format_compile_json, &state);
+	TEST_ASSERT_TRUE(compiled);
+
+	const gemini::MeshFormatHeader* header = gemini::mesh_format_header(&output[0], output.size());
+	TEST_ASSERT_TRUE(header != nullptr);
+	TEST_ASSERT_EQUALS(header->total_vertices, 4);
+	TEST_ASSERT_EQUALS(header->total_indices, 6);
+	TEST_ASSERT_EQUALS(header->total_geometry, 1);
+	TEST_ASSERT_TRUE((header->flags & gemini::MeshFormat_Animated) == 0);
+	TEST_ASSERT_EQUALS(header->vertex_stride, sizeof(renderer::StaticMeshVertex));
+
+	// the vertex stream is interleaved and ready for upload
+	const renderer::StaticMeshVertex* vertices = gemini::mesh_format_section<renderer::StaticMeshVertex>(header, header->vertices);
+	TEST_ASSERT_EQUALS(vertices[2].position.y, 1.0f);
+	TEST_ASSERT_EQUALS(vertices[1].uvs.x, 1.0f);
+
+	const uint32_t* indices = gemini::mesh_format_section<uint32_t>(header, header->indices);
+	TEST_ASSERT_EQUALS(indices[4], 3);
+
+	// without a material_id, geometry uses the default material
+	const gemini::MeshFormatGeometry* geometry = gemini::mesh_format_section<gemini::MeshFormatGeometry>(header, header->geometry);
+	TEST_ASSERT_TRUE(core::str::case_insensitive_compare(geometry->material, "default", 0) == 0);
+
+	// truncated data is rejected
+	TEST_ASSERT_TRUE(gemini::mesh_format_header(&output[0], output.size() - 1) == nullptr);
+
+	// geometry must stay inside the vertex section
+	gemini::MeshFormatGeometry* writable_geometry = reinterpret_cast<gemini::MeshFormatGeometry*>(&output[0] + header->geometry.offset);
+	writable_geometry->total_vertices = 5;
+	TEST_ASSERT_TRUE(gemini::mesh_format_header(&output[0], output.size()) == nullptr);
+	writable_geometry->total_vertices = 4;
+
+	// names must be null-terminated
+	char material[gemini::MESH_FORMAT_MAX_NAME];
+	memcpy(material, writable_geometry->material, gemini::MESH_FORMAT_MAX_NAME);
+	memset(writable_geometry->material, 'a', gemini::MESH_FORMAT_MAX_NAME);
+	TEST_ASSERT_TRUE(gemini::mesh_format_header(&output[0], output.size()) == nullptr);
+	memcpy(writable_geometry->material, material, gemini::MESH_FORMAT_MAX_NAME);
+	TEST_ASSERT_TRUE(gemini::mesh_format_header(&output[0], output.size()) != nullptr);
+}
 
 // ---------------------------------------------------------------------
 // http